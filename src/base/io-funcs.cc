@@ -17,6 +17,9 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "base/io-funcs.h"
 #include "base/kaldi-math.h"
 
@@ -143,7 +146,15 @@ void WriteToken(std::ostream &os, bool binary, const char *token) {
 }
 
 int Peek(std::istream &is, bool binary) {
-  if (!binary) is >> std::ws;  // eat up whitespace.
+  if (!binary) {
+    is >> std::ws;  // eat up whitespace.
+  } else {
+    // Skip any padding written before a matrix because of
+    // SetAlignMatrixData(true).  In binary mode Peek() is only called where a
+    // token may start, and a token is never preceded by a space otherwise.
+    while (is.peek() == ' ')
+      is.get();
+  }
   return is.peek();
 }
 
@@ -215,4 +226,97 @@ void ExpectToken(std::istream &is, bool binary, const std::string &token) {
   ExpectToken(is, binary, token.c_str());
 }
 
+void MappedStreambuf::SetMapping(const std::shared_ptr<const char> &mapping,
+                                 size_t size, size_t offset) {
+  KALDI_ASSERT(offset <= size);
+  mapping_ = mapping;
+  char *begin = const_cast<char*>(mapping.get());
+  setg(begin, begin + offset, begin + size);
+}
+
+MappedStreambuf::pos_type MappedStreambuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type pos;
+  if (dir == std::ios_base::beg) pos = off;
+  else if (dir == std::ios_base::cur) pos = (gptr() - eback()) + off;
+  else pos = (egptr() - eback()) + off;
+  if (!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback())
+    return pos_type(off_type(-1));
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+MappedStreambuf::pos_type MappedStreambuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+namespace {
+
+bool align_matrix_data = false;
+
+// The mappings that ShareMappedData() has returned pointers into.  They are
+// kept until the program exits.  IsSharedMappedData() is called each time a
+// matrix is freed, so it does not take a lock: an entry of shared_ranges is
+// filled in before num_shared_ranges is incremented, and never changes after
+// that.
+const int32 kMaxSharedMappings = 64;
+struct MappedRange {
+  const char *begin;
+  const char *end;
+};
+MappedRange shared_ranges[kMaxSharedMappings];
+std::atomic<int32> num_shared_ranges(0);
+std::mutex shared_mappings_mutex;
+std::vector<std::shared_ptr<const char> > *shared_mappings = NULL;
+
+}  // namespace
+
+void SetAlignMatrixData(bool align) {
+  align_matrix_data = align;
+}
+
+bool GetAlignMatrixData() {
+  return align_matrix_data;
+}
+
+char *ShareMappedData(std::istream &is, size_t num_bytes) {
+  MappedStreambuf *buf = dynamic_cast<MappedStreambuf*>(is.rdbuf());
+  if (buf == NULL || !buf->ShareData() || !is.good() ||
+      num_bytes > buf->Remaining() ||
+      (buf->Current() - buf->Mapping().get()) % kMappedDataAlignment != 0)
+    return NULL;
+  {
+    std::lock_guard<std::mutex> lock(shared_mappings_mutex);
+    int32 n = num_shared_ranges.load();
+    bool found = false;
+    for (int32 i = 0; i < n; i++)
+      if (shared_ranges[i].begin == buf->Mapping().get())
+        found = true;
+    if (!found) {
+      if (n == kMaxSharedMappings)
+        return NULL;  // Very unlikely; the data will be copied.
+      if (shared_mappings == NULL)
+        shared_mappings = new std::vector<std::shared_ptr<const char> >();
+      shared_mappings->push_back(buf->Mapping());
+      shared_ranges[n].begin = buf->Mapping().get();
+      shared_ranges[n].end = buf->Current() + buf->Remaining();
+      num_shared_ranges.store(n + 1);
+    }
+  }
+  char *ans = const_cast<char*>(buf->Current());
+  buf->Skip(num_bytes);
+  return ans;
+}
+
+bool IsSharedMappedData(const void *ptr) {
+  int32 n = num_shared_ranges.load();
+  const char *p = static_cast<const char*>(ptr);
+  for (int32 i = 0; i < n; i++)
+    if (p >= shared_ranges[i].begin && p < shared_ranges[i].end)
+      return true;
+  return false;
+}
+
 }  // end namespace kaldi
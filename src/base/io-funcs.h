@@ -29,6 +29,8 @@
 // dependent on them.
 
 #include <cctype>
+#include <memory>
+#include <streambuf>
 #include <vector>
 #include <string>
 
@@ -199,8 +201,9 @@ inline void ReadIntegerPairVector(std::istream &is, bool binary,
 void WriteToken(std::ostream &os, bool binary, const char *token);
 void WriteToken(std::ostream &os, bool binary, const std::string & token);
 
-/// Peek consumes whitespace (if binary == false) and then returns the peek()
-/// value of the stream.
+/// Peek consumes whitespace (if binary == false; if binary == true, it consumes
+/// spaces, which can only be padding written because of SetAlignMatrixData())
+/// and then returns the peek() value of the stream.
 int Peek(std::istream &is, bool binary);
 
 /// ReadToken gets the next token and puts it in str (exception on failure). If
@@ -241,5 +244,82 @@ inline void InitKaldiOutputStream(std::ostream &os, bool binary);
 /// It will typically not be called by users directly.
 inline bool InitKaldiInputStream(std::istream &is, bool *binary);
 
+
+/// MappedStreambuf is the stream buffer of an Input (see util/kaldi-io.h) that
+/// was opened with OpenMapped() on an ordinary file or an offset into one: the
+/// whole file is mapped into memory with mmap() and the stream reads directly
+/// from the mapping.  Code that knows how to use it (e.g. MatrixViewHolder, and
+/// Matrix::Read() via ShareMappedData()) can find it with dynamic_cast on
+/// is.rdbuf(), and use the data in place instead of copying it out with
+/// is.read().  It is declared here rather than in util/ so that the matrix
+/// library can use it.
+class MappedStreambuf: public std::streambuf {
+ public:
+  MappedStreambuf(): share_data_(false) { }
+
+  /// Makes the buffer read the mapping 'mapping' of 'size' bytes, starting at
+  /// byte 'offset'.
+  void SetMapping(const std::shared_ptr<const char> &mapping, size_t size,
+                  size_t offset);
+
+  /// Returns the next byte to be read.
+  const char *Current() const { return gptr(); }
+
+  /// Returns the number of bytes left before the end of the file.
+  size_t Remaining() const { return egptr() - gptr(); }
+
+  /// Skips over 'n' bytes, which must not exceed Remaining().
+  void Skip(size_t n) {
+    KALDI_ASSERT(n <= Remaining());
+    setg(eback(), gptr() + n, egptr());
+  }
+
+  /// Returns the mapping.  Holding a copy of it keeps the memory mapped after
+  /// the Input is closed or opened on another file, so pointers into it stay
+  /// valid.
+  const std::shared_ptr<const char> &Mapping() const { return mapping_; }
+
+  /// If true, ShareMappedData() may return pointers into the mapping; see
+  /// Input::OpenMapped().
+  void SetShareData(bool share_data) { share_data_ = share_data; }
+  bool ShareData() const { return share_data_; }
+
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+ private:
+  std::shared_ptr<const char> mapping_;
+  bool share_data_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedStreambuf);
+};
+
+/// When SetAlignMatrixData(true) has been called, MatrixBase::Write() in binary
+/// mode pads the output with spaces before matrices of at least this many
+/// bytes, so that their data starts at a multiple of this many bytes from the
+/// start of the file.  Peek() and ReadToken() skip the spaces, so readers need
+/// not know about them.  The data can then be shared through a memory mapping;
+/// see ShareMappedData().
+const int32 kMappedDataAlignment = 4096;
+
+/// Sets whether matrices should be aligned as described for
+/// kMappedDataAlignment; programs that write models call this.  The default is
+/// false.
+void SetAlignMatrixData(bool align);
+
+bool GetAlignMatrixData();
+
+/// If 'is' reads through a MappedStreambuf with ShareData() == true, and its
+/// next 'num_bytes' bytes start at a multiple of kMappedDataAlignment bytes
+/// from the start of the file, this function skips over them and returns a
+/// pointer to them; otherwise it returns NULL and does not change the stream.
+/// The memory may be modified (the mapping is copy-on-write), but must not be
+/// freed; it stays mapped until the program exits.
+char *ShareMappedData(std::istream &is, size_t num_bytes);
+
+/// Returns true if 'ptr' points into memory returned by ShareMappedData().
+bool IsSharedMappedData(const void *ptr);
+
 }  // end namespace kaldi.
 #endif  // KALDI_BASE_IO_FUNCS_H_
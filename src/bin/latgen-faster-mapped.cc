@@ -42,7 +42,8 @@ int main(int argc, char *argv[]) {
         "Generate lattices, reading log-likelihoods as matrices\n"
         " (model is needed only for the integer mappings in its transition-model)\n"
         "Usage: latgen-faster-mapped [options] trans-model-in (fst-in|fsts-rspecifier) loglikes-rspecifier"
-        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
+        " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n"
+        "fst-in may also be a graph in the format written by make-flat-fst.\n";
     ParseOptions po(usage);
     Timer timer;
     bool allow_partial = false;
@@ -97,12 +98,25 @@ int main(int argc, char *argv[]) {
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
-      // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      // Input FST is just one FST, not a table of FSTs.  It may be in the
+      // FlatFst format (see make-flat-fst), which is mapped into memory.
+      Fst<StdArc> *decode_fst = NULL;
+      fst::FlatFst *flat_fst = NULL;
+      if (fst::FlatFst::IsFlatFst(fst_in_str)) {
+        flat_fst = new fst::FlatFst();
+        flat_fst->Read(fst_in_str);
+      } else {
+        decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      }
       timer.Reset();
 
       {
-        LatticeFasterDecoder decoder(*decode_fst, config);
+        // Exactly one of these will be non-NULL.
+        LatticeFasterDecoder *decoder = (decode_fst == NULL ? NULL :
+            new LatticeFasterDecoder(*decode_fst, config));
+        LatticeFasterDecoderTpl<fst::FlatFst> *flat_decoder =
+            (flat_fst == NULL ? NULL :
+             new LatticeFasterDecoderTpl<fst::FlatFst>(*flat_fst, config));
 
         for (; !loglike_reader.Done(); loglike_reader.Next()) {
           std::string utt = loglike_reader.Key();
@@ -117,18 +131,29 @@ int main(int argc, char *argv[]) {
           DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
 
           double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, decodable, trans_model, word_syms, utt,
+          bool ans = (decoder != NULL ?
+              DecodeUtteranceLatticeFaster(
+                  *decoder, decodable, trans_model, word_syms, utt,
+                  acoustic_scale, determinize, allow_partial, &alignment_writer,
+                  &words_writer, &compact_lattice_writer, &lattice_writer,
+                  &like) :
+              DecodeUtteranceLatticeFaster(
+                  *flat_decoder, decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &like)) {
+                  &like));
+          if (ans) {
             tot_like += like;
             frame_count += loglikes.NumRows();
             num_success++;
           } else num_fail++;
         }
+        delete decoder;
+        delete flat_decoder;
       }
-      delete decode_fst; // delete this only after decoder goes out of scope.
+      // delete these only after the decoders are deleted.
+      delete decode_fst;
+      delete flat_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader loglike_reader(feature_rspecifier);
@@ -0,0 +1,71 @@
+// bin/make-scp-index.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/script-index.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Make a binary index of a script (scp) file, for fast random access.\n"
+        "Programs that read a table with random access can be given the\n"
+        "index in place of the script file, as in scp:feats.scp.idx; it is\n"
+        "mapped into memory and searched lazily, so opening it is fast and\n"
+        "takes almost no memory however large the script file is.  The index\n"
+        "cannot be used for sequential access, and must be regenerated if the\n"
+        "script file changes.  See util/script-index.h for details.\n"
+        "\n"
+        "Usage: make-scp-index [options] <scp-rxfilename> <index-wxfilename>\n"
+        " e.g.: make-scp-index data/train/feats.scp data/train/feats.scp.idx\n";
+
+    ParseOptions po(usage);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string script_rxfilename = po.GetArg(1),
+        index_wxfilename = po.GetArg(2);
+
+    std::vector<std::pair<std::string, std::string> > script;
+    if (!ReadScriptFile(script_rxfilename, true, &script))
+      KALDI_ERR << "Error reading script file "
+                << PrintableRxfilename(script_rxfilename);
+
+    bool binary = true, write_header = false;
+    Output ko(index_wxfilename, binary, write_header);
+    if (!ScriptIndex::Write(script, ko.Stream()))
+      KALDI_ERR << "Error writing index to "
+                << PrintableWxfilename(index_wxfilename);
+    ko.Close();
+
+    KALDI_LOG << "Wrote index of " << script.size() << " entries to "
+              << PrintableWxfilename(index_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -43,6 +43,7 @@
 #include "cudamatrix/cu-block-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 
 namespace kaldi {
 
@@ -102,7 +103,7 @@ void CuMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) CpuFree(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
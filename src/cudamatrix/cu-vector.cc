@@ -39,6 +39,7 @@
 #include "cudamatrix/cu-sp-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 
 namespace kaldi {
 
@@ -1067,7 +1068,7 @@ void CuVector<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) CpuFree(this->data_);
   }
   this->data_ = NULL;
   this->dim_ = 0;
@@ -59,6 +59,18 @@ BaseFloat DecodableMatrixMapped::LogLikelihood(int32 frame, int32 tid) {
 #endif
 }
 
+bool DecodableMatrixMapped::GetFrameLogLikelihoods(int32 frame,
+                                                   const BaseFloat **row,
+                                                   const int32 **index_map,
+                                                   BaseFloat *scale) {
+  KALDI_PARANOID_ASSERT(frame >= frame_offset_ &&
+                        frame < frame_offset_ + likes_->NumRows());
+  *row = raw_data_ + frame * stride_;
+  *index_map = &(trans_model_.TransitionIdToPdfArray()[0]);
+  *scale = 1.0;
+  return true;
+}
+
 int32 DecodableMatrixMapped::NumFramesReady() const {
   return frame_offset_ + likes_->NumRows();
 }
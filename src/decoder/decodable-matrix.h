@@ -69,6 +69,15 @@ class DecodableMatrixScaledMapped: public DecodableInterface {
     return scale_ * (*likes_)(frame, trans_model_.TransitionIdToPdfFast(tid));
   }
 
+  virtual bool GetFrameLogLikelihoods(int32 frame, const BaseFloat **row,
+                                      const int32 **index_map,
+                                      BaseFloat *scale) {
+    *row = likes_->RowData(frame);
+    *index_map = &(trans_model_.TransitionIdToPdfArray()[0]);
+    *scale = scale_;
+    return true;
+  }
+
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
@@ -116,6 +125,10 @@ class DecodableMatrixMapped: public DecodableInterface {
 
   virtual BaseFloat LogLikelihood(int32 frame, int32 tid);
 
+  virtual bool GetFrameLogLikelihoods(int32 frame, const BaseFloat **row,
+                                      const int32 **index_map,
+                                      BaseFloat *scale);
+
   // Note: these indices are 1-based.
   virtual int32 NumIndices() const;
 
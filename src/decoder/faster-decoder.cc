@@ -23,8 +23,9 @@
 namespace kaldi {
 
 
-FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                             const FasterDecoderOptions &opts):
+template <typename FST>
+FasterDecoderTpl<FST>::FasterDecoderTpl(const FST &fst,
+                                        const FasterDecoderOptions &opts):
     fst_(fst), config_(opts), num_frames_decoded_(-1) {
   KALDI_ASSERT(config_.hash_ratio >= 1.0);  // less doesn't make much sense.
   KALDI_ASSERT(config_.max_active > 1);
@@ -33,7 +34,8 @@ FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
 }
 
 
-void FasterDecoder::InitDecoding() {
+template <typename FST>
+void FasterDecoderTpl<FST>::InitDecoding() {
   // clean up from last time:
   ClearToks(toks_.Clear());
   StateId start_state = fst_.Start();
@@ -45,13 +47,15 @@ void FasterDecoder::InitDecoding() {
 }
 
 
-void FasterDecoder::Decode(DecodableInterface *decodable) {
+template <typename FST>
+void FasterDecoderTpl<FST>::Decode(DecodableInterface *decodable) {
   InitDecoding();
   AdvanceDecoding(decodable);
 }
 
-void FasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
-                                      int32 max_num_frames) {
+template <typename FST>
+void FasterDecoderTpl<FST>::AdvanceDecoding(DecodableInterface *decodable,
+                                            int32 max_num_frames) {
   KALDI_ASSERT(num_frames_decoded_ >= 0 &&
                "You must call InitDecoding() before AdvanceDecoding()");
   int32 num_frames_ready = decodable->NumFramesReady();
@@ -72,7 +76,8 @@ void FasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
 }
 
 
-bool FasterDecoder::ReachedFinal() const {
+template <typename FST>
+bool FasterDecoderTpl<FST>::ReachedFinal() const {
   for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
     if (e->val->cost_ != std::numeric_limits<double>::infinity() &&
         fst_.Final(e->key) != Weight::Zero())
@@ -81,8 +86,9 @@ bool FasterDecoder::ReachedFinal() const {
   return false;
 }
 
-bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out,
-                                bool use_final_probs) {
+template <typename FST>
+bool FasterDecoderTpl<FST>::GetBestPath(fst::MutableFst<LatticeArc> *fst_out,
+                                        bool use_final_probs) {
   // GetBestPath gets the decoding output.  If "use_final_probs" is true
   // AND we reached a final state, it limits itself to final states;
   // otherwise it gets the most likely token not taking into
@@ -145,8 +151,10 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out,
 
 
 // Gets the weight cutoff.  Also counts the active tokens.
-double FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
-                                BaseFloat *adaptive_beam, Elem **best_elem) {
+template <typename FST>
+double FasterDecoderTpl<FST>::GetCutoff(Elem *list_head, size_t *tok_count,
+                                        BaseFloat *adaptive_beam,
+                                        Elem **best_elem) {
   double best_cost = std::numeric_limits<double>::infinity();
   size_t count = 0;
   if (config_.max_active == std::numeric_limits<int32>::max() &&
@@ -209,7 +217,8 @@ double FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
   }
 }
 
-void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
+template <typename FST>
+void FasterDecoderTpl<FST>::PossiblyResizeHash(size_t num_toks) {
   size_t new_sz = static_cast<size_t>(static_cast<BaseFloat>(num_toks)
                                       * config_.hash_ratio);
   if (new_sz > toks_.Size()) {
@@ -218,7 +227,8 @@ void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
 }
 
 // ProcessEmitting returns the likelihood cutoff used.
-double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
+template <typename FST>
+double FasterDecoderTpl<FST>::ProcessEmitting(DecodableInterface *decodable) {
   int32 frame = num_frames_decoded_;
   Elem *last_toks = toks_.Clear();
   size_t tok_cnt;
@@ -239,7 +249,7 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   if (best_elem) {
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::EmittingArcIterator<FST> aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -265,7 +275,7 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
     if (tok->cost_ < weight_cutoff) {  // not pruned.
       // np++;
       KALDI_ASSERT(state == tok->arc_.nextstate);
-      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+      for (fst::EmittingArcIterator<FST> aiter(fst_, state);
            !aiter.Done();
            aiter.Next()) {
         Arc arc = aiter.Value();
@@ -298,7 +308,8 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
 }
 
 // TODO: first time we go through this, could avoid using the queue.
-void FasterDecoder::ProcessNonemitting(double cutoff) {
+template <typename FST>
+void FasterDecoderTpl<FST>::ProcessNonemitting(double cutoff) {
   // Processes nonemitting arcs for one frame.
   KALDI_ASSERT(queue_.empty());
   for (const Elem *e = toks_.GetList(); e != NULL;  e = e->tail)
@@ -313,7 +324,7 @@ void FasterDecoder::ProcessNonemitting(double cutoff) {
       continue;
     }
     KALDI_ASSERT(tok != NULL && state == tok->arc_.nextstate);
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::NonemittingArcIterator<FST> aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -340,7 +351,8 @@ void FasterDecoder::ProcessNonemitting(double cutoff) {
   }
 }
 
-void FasterDecoder::ClearToks(Elem *list) {
+template <typename FST>
+void FasterDecoderTpl<FST>::ClearToks(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
     Token::TokenDelete(e->val);
     e_tail = e->tail;
@@ -348,4 +360,8 @@ void FasterDecoder::ClearToks(Elem *list) {
   }
 }
 
+// Instantiate the template for the FST types that we'll need.
+template class FasterDecoderTpl<fst::Fst<fst::StdArc> >;
+template class FasterDecoderTpl<fst::FlatFst>;
+
 } // end namespace kaldi.
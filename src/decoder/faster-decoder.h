@@ -27,6 +27,7 @@
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
+#include "decoder/flat-fst.h"
 
 namespace kaldi {
 
@@ -59,19 +60,24 @@ struct FasterDecoderOptions {
   }
 };
 
-class FasterDecoder {
+/** FasterDecoderTpl is templated on the FST type.  It will normally be
+    instantiated with fst::StdFst (see the typedef FasterDecoder below), but
+    may also be used with fst::FlatFst.
+ */
+template <typename FST>
+class FasterDecoderTpl {
  public:
   typedef fst::StdArc Arc;
   typedef Arc::Label Label;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
 
-  FasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                const FasterDecoderOptions &config);
+  FasterDecoderTpl(const FST &fst,
+                   const FasterDecoderOptions &config);
 
   void SetOptions(const FasterDecoderOptions &config) { config_ = config; }
 
-  ~FasterDecoder() { ClearToks(toks_.Clear()); }
+  ~FasterDecoderTpl() { ClearToks(toks_.Clear()); }
 
   void Decode(DecodableInterface *decodable);
 
@@ -147,7 +153,7 @@ class FasterDecoder {
 #endif
     }
   };
-  typedef HashList<StateId, Token*>::Elem Elem;
+  typedef typename HashList<StateId, Token*>::Elem Elem;
 
 
   /// Gets the weight cutoff.  Also counts the active tokens.
@@ -168,7 +174,7 @@ class FasterDecoder {
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.
   HashList<StateId, Token*> toks_;
-  const fst::Fst<fst::StdArc> &fst_;
+  const FST &fst_;
   FasterDecoderOptions config_;
   std::vector<const Elem* > queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
@@ -185,9 +191,11 @@ class FasterDecoder {
   // this way for convenience in propagating tokens from one frame to the next.
   void ClearToks(Elem *list);
 
-  KALDI_DISALLOW_COPY_AND_ASSIGN(FasterDecoder);
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FasterDecoderTpl);
 };
 
+typedef FasterDecoderTpl<fst::StdFst> FasterDecoder;
+
 
 } // end namespace kaldi.
 
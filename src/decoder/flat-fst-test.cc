@@ -0,0 +1,200 @@
+// decoder/flat-fst-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "decoder/flat-fst.h"
+#include "fstext/rand-fst.h"
+
+namespace fst {
+
+typedef StdArc::StateId StateId;
+
+// Gets the arcs of state s of 'fst' in the order in which FlatFst stores them:
+// the input-epsilon arcs first, then the others, each in their original order.
+static void GetFlatArcOrder(const VectorFst<StdArc> &fst, StateId s,
+                            std::vector<StdArc> *arcs) {
+  arcs->clear();
+  for (ArcIterator<VectorFst<StdArc> > aiter(fst, s); !aiter.Done();
+       aiter.Next())
+    if (aiter.Value().ilabel == 0)
+      arcs->push_back(aiter.Value());
+  for (ArcIterator<VectorFst<StdArc> > aiter(fst, s); !aiter.Done();
+       aiter.Next())
+    if (aiter.Value().ilabel != 0)
+      arcs->push_back(aiter.Value());
+}
+
+static bool ArcsEqual(const StdArc &a, const StdArc &b) {
+  return a.ilabel == b.ilabel && a.olabel == b.olabel &&
+      a.weight == b.weight && a.nextstate == b.nextstate;
+}
+
+static void WriteFlatFst(const VectorFst<StdArc> &fst,
+                         const std::string &filename) {
+  std::ofstream os(filename.c_str(), std::ios::binary);
+  FlatFst::Write(fst, os);
+  KALDI_ASSERT(os.good());
+}
+
+// Checks that 'flat' has the same start state, final-costs and arcs as 'fst',
+// with the input-epsilon arcs of each state first.
+static void CheckFlatFstEqual(const VectorFst<StdArc> &fst,
+                              const FlatFst &flat) {
+  KALDI_ASSERT(flat.Start() == fst.Start() &&
+               flat.NumStates() == fst.NumStates());
+  size_t num_arcs = 0;
+  std::vector<StdArc> arcs;
+  for (StateId s = 0; s < fst.NumStates(); s++) {
+    KALDI_ASSERT(flat.Final(s) == fst.Final(s) &&
+                 flat.NumArcs(s) == fst.NumArcs(s) &&
+                 flat.NumInputEpsilons(s) == fst.NumInputEpsilons(s));
+    GetFlatArcOrder(fst, s, &arcs);
+    size_t i = 0;
+    for (ArcIterator<FlatFst> aiter(flat, s); !aiter.Done(); aiter.Next(), i++)
+      KALDI_ASSERT(i < arcs.size() && ArcsEqual(aiter.Value(), arcs[i]));
+    KALDI_ASSERT(i == arcs.size());
+    num_arcs += arcs.size();
+  }
+  KALDI_ASSERT(flat.NumArcs() == num_arcs);
+}
+
+// Checks that NonemittingArcIterator and EmittingArcIterator visit the
+// input-epsilon arcs and the other arcs of each state respectively, and that
+// GetEmittingArcs() gives the same arcs as EmittingArcIterator.
+static void CheckArcIterators(const FlatFst &flat) {
+  for (StateId s = 0; s < flat.NumStates(); s++) {
+    size_t num_eps = flat.NumInputEpsilons(s), n = 0;
+    for (NonemittingArcIterator<FlatFst> aiter(flat, s); !aiter.Done();
+         aiter.Next(), n++)
+      KALDI_ASSERT(aiter.Value().ilabel == 0 && aiter.Position() == n);
+    KALDI_ASSERT(n == num_eps);
+    EmittingArcIterator<FlatFst> eiter(flat, s);
+    for (; !eiter.Done(); eiter.Next(), n++)
+      KALDI_ASSERT(eiter.Value().ilabel != 0 && eiter.Position() == n);
+    KALDI_ASSERT(n == flat.NumArcs(s));
+    eiter.Reset();  // goes back to the first emitting arc.
+    KALDI_ASSERT(eiter.Position() == num_eps &&
+                 eiter.Done() == (num_eps == flat.NumArcs(s)));
+
+    const StdArc *arcs = NULL;
+    int32 num_emitting = GetEmittingArcs(flat, s, &arcs);
+    KALDI_ASSERT(num_emitting == static_cast<int32>(n - num_eps));
+    for (int32 i = 0; i < num_emitting; i++)
+      KALDI_ASSERT(arcs + i == flat.Arcs(s) + num_eps + i);
+  }
+}
+
+void UnitTestFlatFst() {
+  RandFstOptions opts;
+  opts.allow_empty = false;
+  VectorFst<StdArc> *fst = RandFst<StdArc>(opts);
+  std::string filename = "tmp.flatfst";
+  WriteFlatFst(*fst, filename);
+  KALDI_ASSERT(FlatFst::IsFlatFst(filename));
+  {
+    FlatFst flat;
+    flat.Read(filename);  // an ordinary file, so it is mapped.
+    KALDI_ASSERT(flat.IsMapped());
+    CheckFlatFstEqual(*fst, flat);
+    CheckArcIterators(flat);
+  }
+  {
+    FlatFst flat;
+    flat.Read("cat " + filename + " |");  // a pipe, so it is read.
+    KALDI_ASSERT(!flat.IsMapped());
+    CheckFlatFstEqual(*fst, flat);
+    CheckArcIterators(flat);
+  }
+  // For other FST types the iterators visit all the arcs, and the arcs cannot
+  // be accessed in bulk.
+  for (StateId s = 0; s < fst->NumStates(); s++) {
+    size_t n = 0;
+    for (EmittingArcIterator<VectorFst<StdArc> > aiter(*fst, s);
+         !aiter.Done(); aiter.Next())
+      n++;
+    KALDI_ASSERT(n == fst->NumArcs(s));
+    const StdArc *arcs;
+    KALDI_ASSERT(GetEmittingArcs(*fst, s, &arcs) == -1);
+  }
+  // An FST in OpenFst format is not a FlatFst.
+  fst->Write(filename);
+  KALDI_ASSERT(!FlatFst::IsFlatFst(filename));
+  std::remove(filename.c_str());
+  delete fst;
+}
+
+// Checks that Read() refuses a file in which the arcs of one state overlap
+// those of the next, instead of indexing outside the arcs later.
+void UnitTestFlatFstCorrupted() {
+  VectorFst<StdArc> fst;
+  for (int32 i = 0; i < 3; i++)
+    fst.AddState();
+  fst.SetStart(0);
+  fst.SetFinal(2, TropicalWeight::One());
+  fst.AddArc(0, StdArc(1, 1, 0.5, 1));
+  fst.AddArc(0, StdArc(0, 0, 1.0, 2));
+  fst.AddArc(1, StdArc(2, 3, 0.0, 2));
+  std::ostringstream os;
+  FlatFst::Write(fst, os);
+  std::string data = os.str();
+  // The FlatFstStates follow the 48-byte header, and each starts with the
+  // int64 first_arc; state 0 has two arcs, so state 1 starts at arc 2.
+  const size_t offset = 48 + 16;
+  int64 first_arc;
+  memcpy(&first_arc, &(data[offset]), sizeof(first_arc));
+  KALDI_ASSERT(first_arc == 2);
+
+  std::string filename = "tmp.flatfst";
+  for (int32 i = 0; i < 2; i++) {
+    bool corrupt = (i == 1);
+    if (corrupt) {
+      first_arc = 100;
+      memcpy(&(data[offset]), &first_arc, sizeof(first_arc));
+    }
+    {
+      std::ofstream file(filename.c_str(), std::ios::binary);
+      file.write(data.data(), data.size());
+    }
+    FlatFst flat;
+    bool ok = true;
+    try {
+      flat.Read(filename);
+    } catch (const std::exception &e) {
+      ok = false;
+    }
+    KALDI_ASSERT(ok == !corrupt);
+    if (ok)
+      CheckFlatFstEqual(fst, flat);
+  }
+  std::remove(filename.c_str());
+}
+
+}  // namespace fst
+
+int main() {
+  using namespace fst;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestFlatFst();
+  UnitTestFlatFstCorrupted();
+  std::cout << "Test OK\n";
+  return 0;
+}
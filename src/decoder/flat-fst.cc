@@ -0,0 +1,235 @@
+// decoder/flat-fst.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "decoder/flat-fst.h"
+#include "util/kaldi-io.h"
+
+namespace fst {
+
+// The reader relies on these sizes, as it interprets the file contents
+// directly.
+static_assert(sizeof(StdArc) == 16, "Unexpected size of StdArc");
+
+static const char kFlatFstMagic[8] = { 'K', 'A', 'L', 'D', 'I', 'F', 'F', 'T' };
+
+FlatFst::FlatFst(): start_(kNoStateId), num_states_(0), num_arcs_(0),
+                    states_(NULL), arcs_(NULL), mapped_data_(NULL),
+                    mapped_size_(0) {
+  static_assert(sizeof(FlatFstHeader) % 16 == 0,
+                "FlatFstHeader size must be a multiple of 16");
+  static_assert(sizeof(FlatFstState) == 16,
+                "Unexpected size of FlatFstState");
+}
+
+FlatFst::~FlatFst() {
+  Destroy();
+}
+
+void FlatFst::Destroy() {
+#if !defined(_MSC_VER)
+  if (mapped_data_ != NULL)
+    munmap(mapped_data_, mapped_size_);
+#endif
+  mapped_data_ = NULL;
+  mapped_size_ = 0;
+  std::vector<int64> empty;
+  buffer_.swap(empty);
+  start_ = kNoStateId;
+  num_states_ = 0;
+  num_arcs_ = 0;
+  states_ = NULL;
+  arcs_ = NULL;
+}
+
+void FlatFst::Read(const std::string &rxfilename) {
+  Destroy();
+#if !defined(_MSC_VER)
+  if (kaldi::ClassifyRxfilename(rxfilename) == kaldi::kFileInput) {
+    int fd = open(rxfilename.c_str(), O_RDONLY);
+    if (fd < 0)
+      KALDI_ERR << "Could not open " << rxfilename << " for reading: "
+                << strerror(errno);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      KALDI_ERR << "Could not stat " << rxfilename << ": " << strerror(errno);
+    }
+    size_t size = st.st_size;
+    if (size < sizeof(FlatFstHeader)) {
+      close(fd);
+      KALDI_ERR << "File " << rxfilename << " is too small to be a FlatFst.";
+    }
+    // MAP_SHARED, so that all processes that map the same file share the
+    // physical memory (via the page cache).
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid after closing.
+    if (data == MAP_FAILED)
+      KALDI_ERR << "Could not mmap " << rxfilename << ": " << strerror(errno);
+    mapped_data_ = data;
+    mapped_size_ = size;
+    Init(static_cast<const char*>(data), size, rxfilename);
+    return;
+  }
+#endif
+  // Not an ordinary file (or no mmap on this platform): read the whole thing
+  // into memory.
+  kaldi::Input ki(rxfilename);
+  std::istream &is = ki.Stream();
+  std::vector<char> contents;
+  char buf[65536];
+  while (is.read(buf, sizeof(buf)) || is.gcount() > 0)
+    contents.insert(contents.end(), buf, buf + is.gcount());
+  if (!is.eof())
+    KALDI_ERR << "Error reading FlatFst from "
+              << kaldi::PrintableRxfilename(rxfilename);
+  buffer_.resize((contents.size() + sizeof(int64) - 1) / sizeof(int64));
+  if (!contents.empty())
+    memcpy(&(buffer_[0]), &(contents[0]), contents.size());
+  Init(reinterpret_cast<const char*>(buffer_.empty() ? NULL : &(buffer_[0])),
+       contents.size(), rxfilename);
+}
+
+void FlatFst::Init(const char *data, size_t size,
+                   const std::string &rxfilename) {
+  if (size < sizeof(FlatFstHeader) ||
+      memcmp(data, kFlatFstMagic, sizeof(kFlatFstMagic)) != 0)
+    KALDI_ERR << "File " << kaldi::PrintableRxfilename(rxfilename)
+              << " does not appear to be a FlatFst (use make-flat-fst to "
+              << "create one).";
+  const FlatFstHeader &header = *reinterpret_cast<const FlatFstHeader*>(data);
+  if (header.byte_order != kByteOrderMark)
+    KALDI_ERR << "FlatFst in " << kaldi::PrintableRxfilename(rxfilename)
+              << " was written on a machine with different byte order.";
+  if (header.version != kVersion)
+    KALDI_ERR << "FlatFst in " << kaldi::PrintableRxfilename(rxfilename)
+              << " has unsupported version " << header.version;
+  if (header.arc_size != static_cast<int32>(sizeof(StdArc)))
+    KALDI_ERR << "FlatFst in " << kaldi::PrintableRxfilename(rxfilename)
+              << " has unexpected arc size " << header.arc_size;
+  int64 states_end = sizeof(FlatFstHeader) +
+      (header.num_states + 1) * sizeof(FlatFstState),
+      arcs_end = header.arcs_offset + header.num_arcs * sizeof(StdArc);
+  if (header.num_states < 0 || header.num_arcs < 0 ||
+      header.num_states > std::numeric_limits<StateId>::max() ||
+      header.arcs_offset < states_end || header.arcs_offset % 16 != 0 ||
+      static_cast<int64>(size) < arcs_end)
+    KALDI_ERR << "FlatFst in " << kaldi::PrintableRxfilename(rxfilename)
+              << " is truncated or corrupted.";
+  start_ = header.start;
+  num_states_ = header.num_states;
+  num_arcs_ = header.num_arcs;
+  states_ = reinterpret_cast<const FlatFstState*>(data + sizeof(FlatFstHeader));
+  arcs_ = reinterpret_cast<const StdArc*>(data + header.arcs_offset);
+  // Check that the arcs of every state are inside the arc array, so that a
+  // corrupted file cannot make the decoder read outside it.
+  bool ok = (states_[0].first_arc == 0 &&
+             states_[num_states_].first_arc == num_arcs_ &&
+             (num_states_ == 0 || (start_ >= 0 && start_ < num_states_)));
+  for (StateId s = 0; ok && s < num_states_; s++) {
+    int64 num_arcs = states_[s + 1].first_arc - states_[s].first_arc;
+    ok = (num_arcs >= 0 && states_[s].num_input_epsilons >= 0 &&
+          states_[s].num_input_epsilons <= num_arcs);
+  }
+  if (!ok)
+    KALDI_ERR << "FlatFst in " << kaldi::PrintableRxfilename(rxfilename)
+              << " is corrupted.";
+}
+
+void FlatFst::Write(const Fst<StdArc> &fst, std::ostream &os) {
+  int64 num_states = CountStates(fst), num_arcs = 0;
+  for (StateIterator<Fst<StdArc> > siter(fst); !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    if (s < 0 || s >= num_states)
+      KALDI_ERR << "FlatFst requires states numbered contiguously from zero.";
+    num_arcs += fst.NumArcs(s);
+  }
+  FlatFstHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kFlatFstMagic, sizeof(kFlatFstMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.arc_size = sizeof(StdArc);
+  header.start = fst.Start();
+  header.num_states = num_states;
+  header.num_arcs = num_arcs;
+  int64 states_end = sizeof(FlatFstHeader) +
+      (num_states + 1) * sizeof(FlatFstState);
+  header.arcs_offset = ((states_end + kArcsAlignment - 1) / kArcsAlignment) *
+      kArcsAlignment;
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  // Write the states.  The epsilon arcs go first, so each state's arcs are
+  // numbered from its first_arc in the order we'll write them below.
+  int64 first_arc = 0;
+  for (StateId s = 0; s <= num_states; s++) {
+    FlatFstState state;
+    state.first_arc = first_arc;
+    if (s < num_states) {
+      state.final_cost = fst.Final(s).Value();
+      state.num_input_epsilons = fst.NumInputEpsilons(s);
+      first_arc += fst.NumArcs(s);
+    } else {  // the sentinel.
+      state.final_cost = Weight::Zero().Value();
+      state.num_input_epsilons = 0;
+    }
+    os.write(reinterpret_cast<const char*>(&state), sizeof(state));
+  }
+  std::vector<char> padding(header.arcs_offset - states_end, 0);
+  if (!padding.empty())
+    os.write(&(padding[0]), padding.size());
+
+  std::vector<StdArc> arcs;
+  for (StateId s = 0; s < num_states; s++) {
+    arcs.clear();
+    for (ArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done(); aiter.Next())
+      if (aiter.Value().ilabel == 0)
+        arcs.push_back(aiter.Value());
+    for (ArcIterator<Fst<StdArc> > aiter(fst, s); !aiter.Done(); aiter.Next())
+      if (aiter.Value().ilabel != 0)
+        arcs.push_back(aiter.Value());
+    if (!arcs.empty())
+      os.write(reinterpret_cast<const char*>(&(arcs[0])),
+               arcs.size() * sizeof(StdArc));
+  }
+  if (!os.good())
+    KALDI_ERR << "Error writing FlatFst.";
+}
+
+bool FlatFst::IsFlatFst(const std::string &rxfilename) {
+  if (kaldi::ClassifyRxfilename(rxfilename) != kaldi::kFileInput)
+    return false;
+  std::ifstream is(rxfilename.c_str(), std::ios::binary);
+  char magic[sizeof(kFlatFstMagic)];
+  if (!is.read(magic, sizeof(magic)))
+    return false;
+  return memcmp(magic, kFlatFstMagic, sizeof(magic)) == 0;
+}
+
+
+}  // namespace fst
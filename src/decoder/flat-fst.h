@@ -0,0 +1,273 @@
+// decoder/flat-fst.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_FLAT_FST_H_
+#define KALDI_DECODER_FLAT_FST_H_
+
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "fst/fstlib.h"
+
+namespace fst {
+
+
+class FlatFst;
+
+// Declare that we'll be overriding class ArcIterator for class FlatFst.
+// This wouldn't work if we were fully using the OpenFst framework,
+// e.g. if we had FlatFst inherit from class Fst.
+template<> class ArcIterator<FlatFst>;
+
+
+/**
+   FlatFst is a read-only decoding graph in a format designed for the decoders:
+   it is loaded with mmap() (when read from a file), so loading is almost
+   instantaneous and the memory is shared between all processes on a machine
+   that decode with the same graph.  Like GrammarFst, this class does not
+   inherit from fst::Fst and supports only the parts of its interface that are
+   necessary for the decoders to work when templated on it
+   (LatticeFasterDecoderTpl, LatticeFasterOnlineDecoderTpl and
+   FasterDecoderTpl).
+
+   The format on disk, which is also the format in memory, is:
+
+     - A header (class FlatFstHeader), including the start state and the
+       numbers of states and arcs.
+     - For each state, plus one extra sentinel state at the end, a 16-byte
+       FlatFstState: the index of its first arc, its final-cost, and its number
+       of input-epsilon arcs.
+     - All the arcs, as StdArc (16 bytes each: ilabel, olabel, weight,
+       nextstate), with the arcs of each state contiguous, and the
+       input-epsilon arcs of each state before its other arcs.  The arcs start
+       at a page-aligned offset.
+
+   The file is written in the native byte order of the machine that wrote it;
+   Read() will refuse to read a file written with a different byte order.  Use
+   the program make-flat-fst to create these files.
+
+   THREAD SAFETY: this object is never modified after Read(), so it can be used
+   by multiple decoders in different threads at once.
+*/
+class FlatFst {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Label Label;
+  typedef Arc::Weight Weight;
+
+  /// This constructor should only be used prior to calling Read().
+  FlatFst();
+
+  /// Reads the FST from 'rxfilename'.  If it is an ordinary file, it is mapped
+  /// into memory read-only; otherwise (e.g. for a pipe or stdin) its contents
+  /// are read into memory.  Throws on error.
+  void Read(const std::string &rxfilename);
+
+  /// Writes 'fst' to 'os' in the format described above.  The states of 'fst'
+  /// must be numbered contiguously from zero, which is the case for
+  /// VectorFst and ConstFst.
+  static void Write(const Fst<StdArc> &fst, std::ostream &os);
+
+  /// Returns true if 'rxfilename' is an ordinary file that starts with the
+  /// header of a FlatFst.  Used by programs that accept either an OpenFst-format
+  /// FST or a FlatFst.  Never throws.
+  static bool IsFlatFst(const std::string &rxfilename);
+
+  StateId Start() const { return start_; }
+
+  Weight Final(StateId s) const { return Weight(states_[s].final_cost); }
+
+  /// Note: NumInputEpsilons(s) is also the index, within the arcs of state s,
+  /// of the first arc with a nonzero ilabel.
+  size_t NumInputEpsilons(StateId s) const {
+    return states_[s].num_input_epsilons;
+  }
+
+  size_t NumArcs(StateId s) const {
+    return states_[s + 1].first_arc - states_[s].first_arc;
+  }
+
+  /// Returns a pointer to the arcs of state s, of which there are NumArcs(s).
+  const Arc *Arcs(StateId s) const { return arcs_ + states_[s].first_arc; }
+
+  StateId NumStates() const { return num_states_; }
+
+  size_t NumArcs() const { return num_arcs_; }
+
+  /// Returns true if the FST was mapped into memory, false if it was read.
+  bool IsMapped() const { return mapped_data_ != NULL; }
+
+  std::string Type() const { return "flat"; }
+
+  ~FlatFst();
+ private:
+  friend class ArcIterator<FlatFst>;
+
+  // The header of the file.  Its size is a multiple of 16 bytes, so that the
+  // FlatFstState array that follows it is aligned.
+  struct FlatFstHeader {
+    char magic[8];  // "KALDIFFT"
+    int32 version;
+    int32 byte_order;  // kByteOrderMark as written by the writer.
+    int32 arc_size;  // sizeof(StdArc), i.e. 16.
+    int32 start;
+    int64 num_states;  // not including the sentinel state.
+    int64 num_arcs;
+    int64 arcs_offset;  // byte offset of the arcs from the start of the file.
+  };
+
+  struct FlatFstState {
+    int64 first_arc;  // index of the first arc of this state.
+    float final_cost;  // infinity if not final.
+    int32 num_input_epsilons;
+  };
+
+  static const int32 kVersion = 1;
+  static const int32 kByteOrderMark = 0x01020304;
+  static const int64 kArcsAlignment = 4096;
+
+  // Frees any memory or mapping we hold and resets the object to empty.
+  void Destroy();
+
+  // Sets up states_, arcs_ and so on from the data in memory, checking that it
+  // is consistent.  'data' must be aligned to at least 16 bytes.
+  void Init(const char *data, size_t size, const std::string &rxfilename);
+
+  StateId start_;
+  StateId num_states_;
+  int64 num_arcs_;
+  const FlatFstState *states_;
+  const StdArc *arcs_;
+
+  // If we mapped the file into memory, mapped_data_ and mapped_size_ describe
+  // the mapping.  Otherwise we read it into buffer_.
+  void *mapped_data_;
+  size_t mapped_size_;
+  std::vector<int64> buffer_;  // int64 to ensure alignment.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FlatFst);
+};
+
+
+/**
+   This is the overridden template for class ArcIterator for FlatFst.  Since
+   the arcs are stored as StdArc, Value() returns a reference directly into the
+   (possibly memory-mapped) arc array; no copying is involved.
+ */
+template <>
+class ArcIterator<FlatFst> {
+ public:
+  typedef FlatFst::Arc Arc;
+  typedef FlatFst::StateId StateId;
+
+  inline ArcIterator(const FlatFst &fst, StateId s):
+      arcs_(fst.arcs_ + fst.states_[s].first_arc),
+      narcs_(fst.states_[s + 1].first_arc - fst.states_[s].first_arc),
+      begin_(0), i_(0) { }
+
+  /// This version of the constructor visits only the arcs of state s with
+  /// positions in [begin, end); Done() becomes true at position 'end' and
+  /// Reset() goes back to 'begin'.  Positions are still counted from the first
+  /// arc of the state.  It is used by EmittingArcIterator and
+  /// NonemittingArcIterator.
+  inline ArcIterator(const FlatFst &fst, StateId s, size_t begin, size_t end):
+      arcs_(fst.arcs_ + fst.states_[s].first_arc), narcs_(end),
+      begin_(begin), i_(begin) { }
+
+  inline bool Done() const { return i_ >= narcs_; }
+
+  inline void Next() { i_++; }
+
+  inline const Arc &Value() const { return arcs_[i_]; }
+
+  inline size_t Position() const { return i_; }
+
+  inline void Seek(size_t a) { i_ = a; }
+
+  inline void Reset() { i_ = begin_; }
+
+ private:
+  const Arc *arcs_;
+  size_t narcs_;  // the end of the range of arcs we visit.
+  size_t begin_;
+  size_t i_;
+};
+
+
+/**
+   EmittingArcIterator and NonemittingArcIterator are used by the decoders to
+   visit the arcs of a state that may have nonzero (respectively zero)
+   ilabels.  For a general FST they visit all the arcs, and the caller still has
+   to check the ilabel of each one.  For FlatFst, which stores the input-epsilon
+   arcs of each state before its other arcs, they visit only the relevant range,
+   so the decoders don't spend time skipping arcs of the wrong kind (a large
+   fraction of the arcs in a typical HCLG are input-epsilon arcs).
+ */
+template <class FST>
+class EmittingArcIterator: public ArcIterator<FST> {
+ public:
+  inline EmittingArcIterator(const FST &fst, typename FST::Arc::StateId s):
+      ArcIterator<FST>(fst, s) { }
+};
+
+template <class FST>
+class NonemittingArcIterator: public ArcIterator<FST> {
+ public:
+  inline NonemittingArcIterator(const FST &fst, typename FST::Arc::StateId s):
+      ArcIterator<FST>(fst, s) { }
+};
+
+template <>
+class EmittingArcIterator<FlatFst>: public ArcIterator<FlatFst> {
+ public:
+  inline EmittingArcIterator(const FlatFst &fst, FlatFst::StateId s):
+      ArcIterator<FlatFst>(fst, s, fst.NumInputEpsilons(s), fst.NumArcs(s)) { }
+};
+
+template <>
+class NonemittingArcIterator<FlatFst>: public ArcIterator<FlatFst> {
+ public:
+  inline NonemittingArcIterator(const FlatFst &fst, FlatFst::StateId s):
+      ArcIterator<FlatFst>(fst, s, 0, fst.NumInputEpsilons(s)) { }
+};
+
+
+/// If the arcs that EmittingArcIterator visits for state s are stored
+/// contiguously in memory, as StdArc, this function sets *arcs to point to the
+/// first of them and returns their number; otherwise it returns -1.  It lets
+/// the decoders process those arcs in bulk.  Of the FST types the decoders
+/// support, only FlatFst stores them that way.
+template <class FST>
+inline int32 GetEmittingArcs(const FST &fst, typename FST::Arc::StateId s,
+                             const StdArc **arcs) {
+  return -1;
+}
+
+inline int32 GetEmittingArcs(const FlatFst &fst, FlatFst::StateId s,
+                             const StdArc **arcs) {
+  size_t num_eps = fst.NumInputEpsilons(s);
+  *arcs = fst.Arcs(s) + num_eps;
+  return fst.NumArcs(s) - num_eps;
+}
+
+
+}  // namespace fst
+
+#endif  // KALDI_DECODER_FLAT_FST_H_
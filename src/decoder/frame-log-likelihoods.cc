@@ -0,0 +1,92 @@
+// decoder/frame-log-likelihoods.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/frame-log-likelihoods.h"
+
+// As in matrix/vectorized-math.cc, the AVX2 code is compiled with GCC's target
+// pragma and only used if the CPU supports it.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+  (__GNUC__ >= 6)
+#define KALDI_FRAME_LOG_LIKELIHOODS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+namespace {
+
+typedef void (*GatherFunction)(const BaseFloat*, const int32*, BaseFloat,
+                               const int32*, int32, int32, BaseFloat*);
+
+void GatherGeneric(const BaseFloat *row, const int32 *index_map,
+                   BaseFloat scale, const int32 *indexes, int32 stride,
+                   int32 n, BaseFloat *ans) {
+  for (int32 i = 0; i < n; i++)
+    ans[i] = scale * row[index_map[indexes[i * stride]]];
+}
+
+#ifdef KALDI_FRAME_LOG_LIKELIHOODS_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+// Only used if BaseFloat is float.
+void GatherAvx2(const BaseFloat *row, const int32 *index_map,
+                BaseFloat scale, const int32 *indexes, int32 stride,
+                int32 n, BaseFloat *ans) {
+  const __m256i offsets = _mm256_mullo_epi32(
+      _mm256_set1_epi32(stride), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  const __m256 scale_v = _mm256_set1_ps(scale);
+  int32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index = _mm256_i32gather_epi32(indexes + i * stride, offsets, 4),
+        pdf = _mm256_i32gather_epi32(index_map, index, 4);
+    __m256 loglike = _mm256_i32gather_ps(
+        reinterpret_cast<const float*>(row), pdf, 4);
+    _mm256_storeu_ps(reinterpret_cast<float*>(ans + i),
+                     _mm256_mul_ps(loglike, scale_v));
+  }
+  for (; i < n; i++)
+    ans[i] = scale * row[index_map[indexes[i * stride]]];
+}
+
+#pragma GCC pop_options
+
+#endif  // KALDI_FRAME_LOG_LIKELIHOODS_X86
+
+GatherFunction ChooseGatherFunction() {
+#ifdef KALDI_FRAME_LOG_LIKELIHOODS_X86
+  __builtin_cpu_init();
+  if (sizeof(BaseFloat) == sizeof(float) && __builtin_cpu_supports("avx2"))
+    return GatherAvx2;
+#endif
+  return GatherGeneric;
+}
+
+}  // namespace
+
+void GatherFrameLogLikelihoods(const BaseFloat *row, const int32 *index_map,
+                               BaseFloat scale, const int32 *indexes,
+                               int32 stride, int32 n, BaseFloat *ans) {
+  // The initialization of function-local statics is thread-safe in C++11.
+  static const GatherFunction gather = ChooseGatherFunction();
+  gather(row, index_map, scale, indexes, stride, n, ans);
+}
+
+}  // namespace kaldi
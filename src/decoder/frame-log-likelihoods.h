@@ -0,0 +1,97 @@
+// decoder/frame-log-likelihoods.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_FRAME_LOG_LIKELIHOODS_H_
+#define KALDI_DECODER_FRAME_LOG_LIKELIHOODS_H_
+
+#include "base/kaldi-common.h"
+#include "itf/decodable-itf.h"
+
+namespace kaldi {
+
+/// Sets ans[i] = scale * row[index_map[indexes[i * stride]]] for 0 <= i < n.
+/// If the CPU supports AVX2 (this is checked at run time, so it does not
+/// depend on how Kaldi was compiled) it uses the AVX2 gather instructions.
+void GatherFrameLogLikelihoods(const BaseFloat *row, const int32 *index_map,
+                               BaseFloat scale, const int32 *indexes,
+                               int32 stride, int32 n, BaseFloat *ans);
+
+/**
+   This class is used in the decoders' inner loops to look up the
+   log-likelihoods of one frame.  If the decodable object supports
+   DecodableInterface::GetFrameLogLikelihoods(), it reads them directly from
+   the array that function returns, which avoids a virtual function call per
+   arc; and LogLikelihoods() can look up the costs of many arcs at once, using
+   the AVX2 gather instructions if the CPU supports them (see
+   GatherFrameLogLikelihoods()).  Otherwise it just calls
+   decodable->LogLikelihood().
+
+   The object becomes invalid when a non-const function of the decodable
+   object is next called.  If HasRow() is true its functions may be called
+   from several threads at once.
+*/
+class FrameLogLikelihoods {
+ public:
+  inline FrameLogLikelihoods(DecodableInterface *decodable, int32 frame):
+      decodable_(decodable), frame_(frame), row_(NULL), index_map_(NULL),
+      scale_(1.0) {
+    if (!decodable->GetFrameLogLikelihoods(frame, &row_, &index_map_,
+                                           &scale_))
+      row_ = NULL;
+  }
+
+  /// Returns true if the decodable object supports GetFrameLogLikelihoods(),
+  /// i.e. if we don't need to call decodable->LogLikelihood().
+  inline bool HasRow() const { return row_ != NULL; }
+
+  /// Equivalent to decodable->LogLikelihood(frame, index).
+  inline BaseFloat LogLikelihood(int32 index) const {
+    if (row_ != NULL)
+      return scale_ * row_[index_map_[index]];
+    else
+      return decodable_->LogLikelihood(frame_, index);
+  }
+
+  /// Sets ans[i] = LogLikelihood(indexes[i * stride]) for 0 <= i < n.  The
+  /// stride (in int32's) lets the caller pass the ilabels of an array of arcs
+  /// directly, e.g. indexes = &(arcs[0].ilabel), stride = sizeof(StdArc) /
+  /// sizeof(int32).
+  inline void LogLikelihoods(const int32 *indexes, int32 stride, int32 n,
+                             BaseFloat *ans) const {
+    if (row_ == NULL) {
+      for (int32 i = 0; i < n; i++)
+        ans[i] = decodable_->LogLikelihood(frame_, indexes[i * stride]);
+      return;
+    }
+    GatherFrameLogLikelihoods(row_, index_map_, scale_, indexes, stride, n,
+                              ans);
+  }
+
+ private:
+  DecodableInterface *decodable_;
+  int32 frame_;
+  const BaseFloat *row_;
+  const int32 *index_map_;
+  BaseFloat scale_;
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_FRAME_LOG_LIKELIHOODS_H_
@@ -30,7 +30,11 @@ template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const FST &fst,
     const LatticeFasterDecoderConfig &config):
-    fst_(&fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(&fst), delete_fst_(false), config_(config), num_toks_(0),
+    use_memory_pool_(config.use_memory_pool), thread_pool_(NULL),
+    num_toks_allocated_(0), num_links_allocated_(0), cutoff_time_(0.0),
+    emitting_time_(0.0), nonemitting_time_(0.0), prune_time_(0.0),
+    timing_(false) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -39,7 +43,11 @@ LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
 template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::LatticeFasterDecoderTpl(
     const LatticeFasterDecoderConfig &config, FST *fst):
-    fst_(fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(fst), delete_fst_(true), config_(config), num_toks_(0),
+    use_memory_pool_(config.use_memory_pool), thread_pool_(NULL),
+    num_toks_allocated_(0), num_links_allocated_(0), cutoff_time_(0.0),
+    emitting_time_(0.0), nonemitting_time_(0.0), prune_time_(0.0),
+    timing_(false) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -49,6 +57,7 @@ template <typename FST, typename Token>
 LatticeFasterDecoderTpl<FST, Token>::~LatticeFasterDecoderTpl() {
   DeleteElems(toks_.Clear());
   ClearActiveTokens();
+  delete thread_pool_;
   if (delete_fst_) delete fst_;
 }
 
@@ -58,14 +67,23 @@ void LatticeFasterDecoderTpl<FST, Token>::InitDecoding() {
   DeleteElems(toks_.Clear());
   cost_offsets_.clear();
   ClearActiveTokens();
+  // It's safe to change the allocation strategy now, since no tokens are alive.
+  use_memory_pool_ = config_.use_memory_pool;
   warned_ = false;
   num_toks_ = 0;
+  num_toks_allocated_ = 0;
+  num_links_allocated_ = 0;
+  cutoff_time_ = 0.0;
+  emitting_time_ = 0.0;
+  nonemitting_time_ = 0.0;
+  prune_time_ = 0.0;
+  timing_ = (config_.timing_stats || GetVerboseLevel() >= 3);
   decoding_finalized_ = false;
   final_costs_.clear();
   StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL, NULL);
+  Token *start_tok = NewToken(0.0, 0.0, NULL, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -263,7 +281,7 @@ LatticeFasterDecoderTpl<FST, Token>::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks, backpointer);
+    Token *new_tok = NewToken(tot_cost, extra_cost, NULL, toks, backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -340,7 +358,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinks(
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          DeleteForwardLink(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -428,7 +446,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneForwardLinksFinal() {
           ForwardLinkT *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          DeleteForwardLink(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -489,7 +507,7 @@ void LatticeFasterDecoderTpl<FST, Token>::PruneTokensForFrame(int32 frame_plus_o
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      DeleteToken(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -610,11 +628,33 @@ void LatticeFasterDecoderTpl<FST, Token>::AdvanceDecoding(DecodableInterface *de
     target_frames_decoded = std::min(target_frames_decoded,
                                      NumFramesDecoded() + max_num_frames);
   while (NumFramesDecoded() < target_frames_decoded) {
+    if (!timing_) {
+      if (NumFramesDecoded() % config_.prune_interval == 0)
+        PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
+      BaseFloat cost_cutoff = ProcessEmitting(decodable);
+      ProcessNonemitting(cost_cutoff);
+      continue;
+    }
+    Timer timer;
+    double prune_time = 0.0, cutoff_time = cutoff_time_;
     if (NumFramesDecoded() % config_.prune_interval == 0) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
+      prune_time = timer.Elapsed();
     }
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
+    double emitting_end = timer.Elapsed();
     ProcessNonemitting(cost_cutoff);
+    double nonemitting_end = timer.Elapsed();
+    // cutoff_time_ was incremented inside ProcessEmitting().
+    cutoff_time = cutoff_time_ - cutoff_time;
+    prune_time_ += prune_time;
+    emitting_time_ += emitting_end - prune_time - cutoff_time;
+    nonemitting_time_ += nonemitting_end - emitting_end;
+    KALDI_VLOG(5) << "Frame " << NumFramesDecoded() - 1 << ": time in "
+                  << "pruning " << prune_time << ", cutoff " << cutoff_time
+                  << ", emitting " << (emitting_end - prune_time - cutoff_time)
+                  << ", nonemitting " << (nonemitting_end - emitting_end)
+                  << " seconds.";
   }
 }
 
@@ -637,6 +677,17 @@ void LatticeFasterDecoderTpl<FST, Token>::FinalizeDecoding() {
   PruneTokensForFrame(0);
   KALDI_VLOG(4) << "pruned tokens from " << num_toks_begin
                 << " to " << num_toks_;
+  KALDI_VLOG(3) << "Allocated " << num_toks_allocated_ << " tokens and "
+                << num_links_allocated_ << " links in this utterance; "
+                << "memory pools hold " << (token_pool_.MemoryUsage() +
+                                            link_pool_.MemoryUsage())
+                << " bytes.";
+  int32 num_frames = std::max<int32>(final_frame_plus_one, 1);
+  KALDI_VLOG(3) << "Time per frame in cutoff/emitting/nonemitting/pruning: "
+                << (cutoff_time_ / num_frames) << '/'
+                << (emitting_time_ / num_frames) << '/'
+                << (nonemitting_time_ / num_frames) << '/'
+                << (prune_time_ / num_frames) << " seconds.";
 }
 
 /// Gets the weight cutoff.  Also counts the active tokens.
@@ -659,6 +710,23 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
     if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
     return best_weight + config_.beam;
   } else {
+    if (config_.histogram_bins > 0) {
+      for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
+        BaseFloat w = e->val->tot_cost;
+        if (w < best_weight) {
+          best_weight = w;
+          if (best_elem) *best_elem = e;
+        }
+      }
+      if (tok_count != NULL) *tok_count = count;
+      BaseFloat cutoff;
+      if (GetCutoffHistogram(list_head, count, best_weight, adaptive_beam,
+                             &cutoff))
+        return cutoff;
+      // Otherwise fall through to the exact computation.
+      best_weight = std::numeric_limits<BaseFloat>::infinity();
+      count = 0;
+    }
     tmp_array_.clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       BaseFloat w = e->val->tot_cost;
@@ -710,6 +778,75 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::GetCutoff(Elem *list_head, size_t
   }
 }
 
+template <typename FST, typename Token>
+bool LatticeFasterDecoderTpl<FST, Token>::GetCutoffHistogram(
+    Elem *list_head, size_t count, BaseFloat best_weight,
+    BaseFloat *adaptive_beam, BaseFloat *cutoff) {
+  size_t max_active = config_.max_active, min_active = config_.min_active;
+  BaseFloat beam_cutoff = best_weight + config_.beam;
+  if (count <= min_active) {
+    // Keep all the tokens, like GetCutoff() would.
+    if (adaptive_beam)
+      *adaptive_beam = std::numeric_limits<BaseFloat>::infinity();
+    *cutoff = std::numeric_limits<BaseFloat>::infinity();
+    return true;
+  }
+  // Bin b of the histogram covers costs in
+  // [best_weight + b * bin_width, best_weight + (b + 1) * bin_width); costs
+  // outside the beam are not counted.
+  int32 num_bins = config_.histogram_bins;
+  BaseFloat bin_width = config_.beam / num_bins,
+      inv_bin_width = 1.0 / bin_width;
+  histogram_.assign(num_bins, 0);
+  size_t num_in_beam = 0;
+  for (Elem *e = list_head; e != NULL; e = e->tail) {
+    BaseFloat w = e->val->tot_cost;
+    if (w < beam_cutoff) {
+      int32 b = static_cast<int32>((w - best_weight) * inv_bin_width);
+      histogram_[std::min(b, num_bins - 1)]++;  // min() in case of roundoff.
+      num_in_beam++;
+    }
+  }
+  if (num_in_beam > max_active) {
+    // max_active is tighter than the beam.  Find the first bin that would take
+    // the number of tokens past max_active, and keep only the tokens in the
+    // bins before it.  If that would keep no tokens, or fewer than
+    // min_active, we let GetCutoff() find the exact cutoff.
+    size_t num_kept = 0;
+    int32 b = 0;
+    for (; b < num_bins; b++) {
+      num_kept += histogram_[b];
+      if (num_kept > max_active)
+        break;
+    }
+    if (num_kept - histogram_[b] < std::max<size_t>(min_active, 1))
+      return false;
+    // The cutoff is the largest cost in those bins, since tokens whose cost is
+    // equal to the cutoff are kept.  (The bin index does not decrease as the
+    // cost increases, so no token from a later bin can be kept.)
+    BaseFloat max_active_cutoff = best_weight;
+    for (Elem *e = list_head; e != NULL; e = e->tail) {
+      BaseFloat w = e->val->tot_cost;
+      if (w < beam_cutoff && w > max_active_cutoff &&
+          static_cast<int32>((w - best_weight) * inv_bin_width) < b)
+        max_active_cutoff = w;
+    }
+    if (adaptive_beam)
+      *adaptive_beam = max_active_cutoff - best_weight + config_.beam_delta;
+    *cutoff = max_active_cutoff;
+    return true;
+  }
+  if (num_in_beam > min_active) {
+    // Neither max_active nor min_active changes the beam.
+    if (adaptive_beam)
+      *adaptive_beam = config_.beam;
+    *cutoff = beam_cutoff;
+    return true;
+  }
+  // min_active is looser than the beam; we need to sort to find the cutoff.
+  return false;
+}
+
 template <typename FST, typename Token>
 BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     DecodableInterface *decodable) {
@@ -725,7 +862,14 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   Elem *best_elem = NULL;
   BaseFloat adaptive_beam;
   size_t tok_cnt;
-  BaseFloat cur_cutoff = GetCutoff(final_toks, &tok_cnt, &adaptive_beam, &best_elem);
+  BaseFloat cur_cutoff;
+  if (timing_) {
+    Timer cutoff_timer;
+    cur_cutoff = GetCutoff(final_toks, &tok_cnt, &adaptive_beam, &best_elem);
+    cutoff_time_ += cutoff_timer.Elapsed();
+  } else {
+    cur_cutoff = GetCutoff(final_toks, &tok_cnt, &adaptive_beam, &best_elem);
+  }
   KALDI_VLOG(6) << "Adaptive beam on frame " << NumFramesDecoded() << " is "
                 << adaptive_beam;
 
@@ -737,6 +881,9 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   BaseFloat cost_offset = 0.0; // Used to keep probabilities in a good
                                // dynamic range.
 
+  // Looks up the log-likelihoods of this frame, directly from the decodable
+  // object's array if it supports that.
+  FrameLogLikelihoods frame_loglikes(decodable, frame);
 
   // First process the best token to get a hopefully
   // reasonably tight bound on the next cutoff.  The only
@@ -745,13 +892,13 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
     cost_offset = - tok->tot_cost;
-    for (fst::ArcIterator<FST> aiter(*fst_, state);
+    for (fst::EmittingArcIterator<FST> aiter(*fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
       if (arc.ilabel != 0) {  // propagate..
         BaseFloat new_weight = arc.weight.Value() + cost_offset -
-            decodable->LogLikelihood(frame, arc.ilabel) + tok->tot_cost;
+            frame_loglikes.LogLikelihood(arc.ilabel) + tok->tot_cost;
         if (new_weight + adaptive_beam < next_cutoff)
           next_cutoff = new_weight + adaptive_beam;
       }
@@ -764,6 +911,23 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   cost_offsets_.resize(frame + 1, 0.0);
   cost_offsets_[frame] = cost_offset;
 
+  // We don't use multiple threads for small numbers of tokens, since the
+  // synchronization would cost more than it saves.  The FST types are the ones
+  // whose arc iterators are known to be safe to use from several threads.
+  // We also need frame_loglikes.HasRow(), because decodable->LogLikelihood()
+  // is not in general safe to call from several threads (e.g. it may write
+  // to a cache).
+  const size_t min_toks_per_thread = 250;
+  if (config_.num_emitting_threads > 1 && frame_loglikes.HasRow() &&
+      tok_cnt >= min_toks_per_thread * config_.num_emitting_threads &&
+      (std::is_same<FST, fst::ConstFst<fst::StdArc> >::value ||
+       std::is_same<FST, fst::VectorFst<fst::StdArc> >::value ||
+       std::is_same<FST, fst::FlatFst>::value)) {
+    ProcessEmittingParallel(frame_loglikes, frame, final_toks, cur_cutoff,
+                            adaptive_beam, cost_offset, &next_cutoff);
+    return next_cutoff;
+  }
+
   // the tokens are now owned here, in final_toks, and the hash is empty.
   // 'owned' is a complex thing here; the point is we need to call DeleteElem
   // on each elem 'e' to let toks_ know we're done with them.
@@ -772,13 +936,30 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <= cur_cutoff) {
-      for (fst::ArcIterator<FST> aiter(*fst_, state);
+      // If the FST stores the emitting arcs of this state contiguously, look
+      // up all their log-likelihoods at once.  arc_loglikes[k] is then the
+      // log-likelihood of the k'th arc visited by the iterator below.
+      const BaseFloat *arc_loglikes = NULL;
+      const fst::StdArc *arcs;
+      int32 num_arcs;
+      if (frame_loglikes.HasRow() &&
+          (num_arcs = fst::GetEmittingArcs(*fst_, state, &arcs)) >= 0) {
+        if (arc_loglikes_.size() < static_cast<size_t>(num_arcs))
+          arc_loglikes_.resize(num_arcs);
+        frame_loglikes.LogLikelihoods(&(arcs[0].ilabel),
+                                      sizeof(fst::StdArc) / sizeof(int32),
+                                      num_arcs, arc_loglikes_.data());
+        arc_loglikes = arc_loglikes_.data();
+      }
+      int32 k = 0;
+      for (fst::EmittingArcIterator<FST> aiter(*fst_, state);
            !aiter.Done();
-           aiter.Next()) {
+           aiter.Next(), k++) {
         const Arc &arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
           BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame, arc.ilabel),
+              (arc_loglikes != NULL ? arc_loglikes[k] :
+               frame_loglikes.LogLikelihood(arc.ilabel)),
               graph_cost = arc.weight.Value(),
               cur_cost = tok->tot_cost,
               tot_cost = cur_cost + ac_cost + graph_cost;
@@ -792,8 +973,8 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
           // NULL: no change indicator needed
 
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLinkT(e_next->val, arc.ilabel, arc.olabel,
-                                        graph_cost, ac_cost, tok->links);
+          tok->links = NewForwardLink(e_next->val, arc.ilabel, arc.olabel,
+                                      graph_cost, ac_cost, tok->links);
         }
       } // for all arcs
     }
@@ -803,18 +984,161 @@ BaseFloat LatticeFasterDecoderTpl<FST, Token>::ProcessEmitting(
   return next_cutoff;
 }
 
-// static inline
 template <typename FST, typename Token>
-void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(Token *tok) {
+void LatticeFasterDecoderTpl<FST, Token>::ProcessEmittingParallel(
+    const FrameLogLikelihoods &frame_loglikes, int32 frame, Elem *final_toks,
+    BaseFloat cur_cutoff, BaseFloat adaptive_beam, BaseFloat cost_offset,
+    BaseFloat *next_cutoff) {
+  int32 num_threads = config_.num_emitting_threads;
+  if (thread_pool_ == NULL || thread_pool_->NumThreads() != num_threads) {
+    delete thread_pool_;
+    thread_pool_ = new ThreadPool(num_threads);
+  }
+  emitting_elems_.clear();
+  for (Elem *e = final_toks; e != NULL; e = e->tail)
+    emitting_elems_.push_back(e);
+  emitting_arcs_.resize(num_threads);
+  std::vector<BaseFloat> thread_cutoffs(num_threads, *next_cutoff);
+
+  // Each thread processes a contiguous range of the tokens, so that
+  // concatenating the threads' outputs gives the arcs in the same order as
+  // the serial code would process them.
+  size_t num_elems = emitting_elems_.size(),
+      block_size = (num_elems + num_threads - 1) / num_threads;
+  thread_pool_->Run([&](int32 thread_id) {
+      std::vector<EmittingArc> &arcs = emitting_arcs_[thread_id];
+      arcs.clear();
+      BaseFloat cutoff = thread_cutoffs[thread_id];
+      size_t begin = std::min(num_elems, block_size * thread_id),
+          end = std::min(num_elems, begin + block_size);
+      for (size_t i = begin; i < end; i++) {
+        Token *tok = emitting_elems_[i]->val;
+        if (tok->tot_cost > cur_cutoff)
+          continue;
+        for (fst::EmittingArcIterator<FST> aiter(*fst_,
+                                                 emitting_elems_[i]->key);
+             !aiter.Done();
+             aiter.Next()) {
+          const Arc &arc = aiter.Value();
+          if (arc.ilabel != 0) {
+            BaseFloat ac_cost = cost_offset -
+                frame_loglikes.LogLikelihood(arc.ilabel),
+                graph_cost = arc.weight.Value(),
+                tot_cost = tok->tot_cost + ac_cost + graph_cost;
+            if (tot_cost >= cutoff) continue;
+            else if (tot_cost + adaptive_beam < cutoff)
+              cutoff = tot_cost + adaptive_beam;
+            EmittingArc earc = { tok, arc.nextstate, arc.ilabel, arc.olabel,
+                                 graph_cost, ac_cost, tot_cost };
+            arcs.push_back(earc);
+          }
+        }
+      }
+      thread_cutoffs[thread_id] = cutoff;
+    });
+
+  for (int32 t = 0; t < num_threads; t++)
+    *next_cutoff = std::min(*next_cutoff, thread_cutoffs[t]);
+
+  // Now add the tokens and links on this thread, since the hash and the token
+  // lists are not thread-safe.
+  for (int32 t = 0; t < num_threads; t++) {
+    const std::vector<EmittingArc> &arcs = emitting_arcs_[t];
+    for (size_t i = 0; i < arcs.size(); i++) {
+      const EmittingArc &earc = arcs[i];
+      if (earc.tot_cost >= *next_cutoff)
+        continue;
+      Elem *e_next = FindOrAddToken(earc.nextstate, frame + 1, earc.tot_cost,
+                                    earc.tok, NULL);
+      earc.tok->links = NewForwardLink(e_next->val, earc.ilabel, earc.olabel,
+                                       earc.graph_cost, earc.ac_cost,
+                                       earc.tok->links);
+    }
+  }
+  for (size_t i = 0; i < num_elems; i++)
+    toks_.Delete(emitting_elems_[i]);
+}
+
+template <typename FST, typename Token>
+inline Token* LatticeFasterDecoderTpl<FST, Token>::NewToken(
+    BaseFloat tot_cost, BaseFloat extra_cost, ForwardLinkT *links,
+    Token *next, Token *backpointer) {
+  num_toks_allocated_++;
+  if (use_memory_pool_)
+    return token_pool_.New(tot_cost, extra_cost, links, next, backpointer);
+  else
+    return new Token(tot_cost, extra_cost, links, next, backpointer);
+}
+
+template <typename FST, typename Token>
+inline void LatticeFasterDecoderTpl<FST, Token>::DeleteToken(Token *tok) {
+  if (use_memory_pool_)
+    token_pool_.Delete(tok);
+  else
+    delete tok;
+}
+
+template <typename FST, typename Token>
+inline typename LatticeFasterDecoderTpl<FST, Token>::ForwardLinkT*
+LatticeFasterDecoderTpl<FST, Token>::NewForwardLink(
+    Token *next_tok, Label ilabel, Label olabel, BaseFloat graph_cost,
+    BaseFloat acoustic_cost, ForwardLinkT *next) {
+  num_links_allocated_++;
+  if (use_memory_pool_)
+    return link_pool_.New(next_tok, ilabel, olabel, graph_cost,
+                          acoustic_cost, next);
+  else
+    return new ForwardLinkT(next_tok, ilabel, olabel, graph_cost,
+                            acoustic_cost, next);
+}
+
+template <typename FST, typename Token>
+inline void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLink(
+    ForwardLinkT *link) {
+  if (use_memory_pool_)
+    link_pool_.Delete(link);
+  else
+    delete link;
+}
+
+template <typename FST, typename Token>
+inline void LatticeFasterDecoderTpl<FST, Token>::DeleteForwardLinks(
+    Token *tok) {
   ForwardLinkT *l = tok->links, *m;
   while (l != NULL) {
     m = l->next;
-    delete l;
+    DeleteForwardLink(l);
     l = m;
   }
   tok->links = NULL;
 }
 
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::GetAllocationStats(
+    int64 *num_toks_allocated, int64 *num_links_allocated,
+    size_t *pool_bytes) const {
+  if (num_toks_allocated != NULL)
+    *num_toks_allocated = num_toks_allocated_;
+  if (num_links_allocated != NULL)
+    *num_links_allocated = num_links_allocated_;
+  if (pool_bytes != NULL)
+    *pool_bytes = token_pool_.MemoryUsage() + link_pool_.MemoryUsage();
+}
+
+template <typename FST, typename Token>
+void LatticeFasterDecoderTpl<FST, Token>::GetTimingStats(
+    double *cutoff_time, double *emitting_time,
+    double *nonemitting_time, double *prune_time) const {
+  if (cutoff_time != NULL)
+    *cutoff_time = cutoff_time_;
+  if (emitting_time != NULL)
+    *emitting_time = emitting_time_;
+  if (nonemitting_time != NULL)
+    *nonemitting_time = nonemitting_time_;
+  if (prune_time != NULL)
+    *prune_time = prune_time_;
+}
+
 
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
@@ -860,7 +1184,7 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
     // but since most states are emitting it's not a huge issue.
     DeleteForwardLinks(tok); // necessary when re-visiting
     tok->links = NULL;
-    for (fst::ArcIterator<FST> aiter(*fst_, state);
+    for (fst::NonemittingArcIterator<FST> aiter(*fst_, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -873,8 +1197,8 @@ void LatticeFasterDecoderTpl<FST, Token>::ProcessNonemitting(BaseFloat cutoff) {
           Elem *e_new = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
                                           tok, &changed);
 
-          tok->links = new ForwardLinkT(e_new->val, 0, arc.olabel,
-                                        graph_cost, 0, tok->links);
+          tok->links = NewForwardLink(e_new->val, 0, arc.olabel,
+                                      graph_cost, 0, tok->links);
 
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -897,13 +1221,22 @@ void LatticeFasterDecoderTpl<FST, Token>::DeleteElems(Elem *list) {
 
 template <typename FST, typename Token>
 void LatticeFasterDecoderTpl<FST, Token>::ClearActiveTokens() { // a cleanup routine, at utt end/begin
+  if (use_memory_pool_) {
+    // All tokens and links live in the pools, so there is no need to visit
+    // them individually; the pools keep their memory for the next utterance.
+    token_pool_.Reset();
+    link_pool_.Reset();
+    active_toks_.clear();
+    num_toks_ = 0;
+    return;
+  }
   for (size_t i = 0; i < active_toks_.size(); i++) {
     // Delete all tokens alive on this frame, and any forward
     // links they may have.
     for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
       DeleteForwardLinks(tok);
       Token *next_tok = tok->next;
-      delete tok;
+      DeleteToken(tok);
       num_toks_--;
       tok = next_tok;
     }
@@ -997,11 +1330,13 @@ template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc>, decoder::StdToken>
 template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::StdToken >;
 template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::StdToken >;
 template class LatticeFasterDecoderTpl<fst::GrammarFst, decoder::StdToken>;
+template class LatticeFasterDecoderTpl<fst::FlatFst, decoder::StdToken>;
 
 template class LatticeFasterDecoderTpl<fst::Fst<fst::StdArc> , decoder::BackpointerToken>;
 template class LatticeFasterDecoderTpl<fst::VectorFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::ConstFst<fst::StdArc>, decoder::BackpointerToken >;
 template class LatticeFasterDecoderTpl<fst::GrammarFst, decoder::BackpointerToken>;
+template class LatticeFasterDecoderTpl<fst::FlatFst, decoder::BackpointerToken>;
 
 
 } // end namespace kaldi.
@@ -26,12 +26,16 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/object-pool.h"
+#include "util/kaldi-thread.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
 #include "decoder/grammar-fst.h"
+#include "decoder/flat-fst.h"
+#include "decoder/frame-log-likelihoods.h"
 
 namespace kaldi {
 
@@ -49,6 +53,26 @@ struct LatticeFasterDecoderConfig {
   // a very important parameter.  It affects the algorithm that prunes the
   // tokens as we go.
   BaseFloat prune_scale;
+  // If true, tokens and forward links are allocated from per-decoder memory
+  // pools (see ../util/object-pool.h) which are reset at the start of each
+  // utterance, instead of individually via new and delete.
+  bool use_memory_pool;
+  // If > 1, the number of threads used to expand emitting arcs on each frame.
+  // Only used for ConstFst, VectorFst and FlatFst graphs, and for frames whose
+  // log-likelihoods the decodable object gives direct access to (see
+  // FrameLogLikelihoods::HasRow(); true of the nnet3 and matrix-based
+  // decodables, but not e.g. of the GMM ones, which cache likelihoods).
+  int32 num_emitting_threads;
+  // If > 0, the max_active pruning is done with a histogram of the token
+  // costs within the beam, with this many bins, instead of by partially
+  // sorting a copy of the costs.  This is faster when many tokens are active,
+  // and approximate: it keeps between max_active - (tokens in one bin) and
+  // max_active tokens.  If 0, pruning is exact.
+  int32 histogram_bins;
+  // If true, time the parts of the search (see
+  // LatticeFasterDecoderTpl::GetTimingStats()).  They are also timed if the
+  // verbose level is 3 or more, since that is when they are printed.
+  bool timing_stats;
 
   // Most of the options inside det_opts are not actually queried by the
   // LatticeFasterDecoder class itself, but by the code that calls it, for
@@ -63,7 +87,11 @@ struct LatticeFasterDecoderConfig {
                                 determinize_lattice(true),
                                 beam_delta(0.5),
                                 hash_ratio(2.0),
-                                prune_scale(0.1) { }
+                                prune_scale(0.1),
+                                use_memory_pool(false),
+                                num_emitting_threads(1),
+                                histogram_bins(0),
+                                timing_stats(false) { }
   void Register(OptionsItf *opts) {
     det_opts.Register(opts);
     opts->Register("beam", &beam, "Decoding beam.  Larger->slower, more accurate.");
@@ -82,12 +110,31 @@ struct LatticeFasterDecoderConfig {
                    "max-active constraint is applied.  Larger is more accurate.");
     opts->Register("hash-ratio", &hash_ratio, "Setting used in decoder to "
                    "control hash behavior");
+    opts->Register("use-memory-pool", &use_memory_pool, "If true, allocate "
+                   "tokens and lattice links from memory pools that are "
+                   "recycled between utterances (faster; uses a little more "
+                   "memory).");
+    opts->Register("num-emitting-threads", &num_emitting_threads, "Number of "
+                   "threads used to expand the emitting arcs of each frame "
+                   "(useful for very long utterances).  Only takes effect for "
+                   "decodable objects that give direct access to each frame's "
+                   "log-likelihoods, e.g. nnet3 ones; otherwise the arcs are "
+                   "expanded on one thread.");
+    opts->Register("histogram-bins", &histogram_bins, "If >0, apply "
+                   "--max-active using a histogram of token costs with this "
+                   "many bins covering the beam (approximate but faster for "
+                   "large --max-active, e.g. 1000 bins); if 0, the cutoff is "
+                   "exact.");
+    opts->Register("timing-stats", &timing_stats, "If true, measure the time "
+                   "spent in the parts of the search (printed at --verbose=3, "
+                   "which also enables this).");
   }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0
                  && min_active <= max_active
                  && prune_interval > 0 && beam_delta > 0.0 && hash_ratio >= 1.0
-                 && prune_scale > 0.0 && prune_scale < 1.0);
+                 && prune_scale > 0.0 && prune_scale < 1.0
+                 && num_emitting_threads > 0 && histogram_bins >= 0);
   }
 };
 
@@ -219,7 +266,7 @@ struct BackpointerToken {
    quick lookup of the current best path (see lattice-faster-online-decoder.h)
 
    The FST you invoke this decoder which is expected to equal
-   Fst::Fst<fst::StdArc>, a.k.a. StdFst, or GrammarFst.  If you invoke it with
+   Fst::Fst<fst::StdArc>, a.k.a. StdFst, or GrammarFst, or FlatFst.  If you invoke it with
    FST == StdFst and it notices that the actual FST type is
    fst::VectorFst<fst::StdArc> or fst::ConstFst<fst::StdArc>, the decoder object
    will internally cast itself to one that is templated on those more specific
@@ -339,13 +386,46 @@ class LatticeFasterDecoderTpl {
   // whenever we call ProcessEmitting().
   inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
 
+  /// Returns the number of tokens and forward links that have been allocated
+  /// since the start of the current utterance, and the number of bytes
+  /// currently held by the memory pools (zero if --use-memory-pool=false).
+  /// This is intended for diagnostics, e.g. to compare the cost of the two
+  /// allocation strategies.
+  void GetAllocationStats(int64 *num_toks_allocated,
+                          int64 *num_links_allocated,
+                          size_t *pool_bytes) const;
+
+  /// Returns the time in seconds spent since the start of the current
+  /// utterance in the different parts of the search: computing the pruning
+  /// cutoff (GetCutoff(), which applies --max-active), the rest of
+  /// ProcessEmitting(), ProcessNonemitting() and PruneActiveTokens().  Divide
+  /// by NumFramesDecoded() to get per-frame figures.  Any of the pointers may
+  /// be NULL.  Per-frame timings are also printed at verbose level 5.  The
+  /// times are only measured if config.timing_stats is true or the verbose
+  /// level is at least 3 (at the time of InitDecoding()); otherwise they are
+  /// zero.
+  void GetTimingStats(double *cutoff_time, double *emitting_time,
+                      double *nonemitting_time, double *prune_time) const;
+
  protected:
   // we make things protected instead of private, as code in
   // LatticeFasterOnlineDecoderTpl, which inherits from this, also uses the
   // internals.
 
   // Deletes the elements of the singly linked list tok->links.
-  inline static void DeleteForwardLinks(Token *tok);
+  inline void DeleteForwardLinks(Token *tok);
+
+  // The following functions allocate and free tokens and forward links,
+  // either from the memory pools or with new and delete, depending on
+  // use_memory_pool_.
+  inline Token *NewToken(BaseFloat tot_cost, BaseFloat extra_cost,
+                         ForwardLinkT *links, Token *next, Token *backpointer);
+  inline void DeleteToken(Token *tok);
+  inline ForwardLinkT *NewForwardLink(Token *next_tok, Label ilabel,
+                                      Label olabel, BaseFloat graph_cost,
+                                      BaseFloat acoustic_cost,
+                                      ForwardLinkT *next);
+  inline void DeleteForwardLink(ForwardLinkT *link);
 
   // head of per-frame list of Tokens (list is in topological order),
   // and something saying whether we ever pruned it using PruneForwardLinks.
@@ -439,11 +519,40 @@ class LatticeFasterDecoderTpl {
   BaseFloat GetCutoff(Elem *list_head, size_t *tok_count,
                       BaseFloat *adaptive_beam, Elem **best_elem);
 
+  /// This is called from GetCutoff() if config_.histogram_bins > 0, with the
+  /// number of tokens 'count' and the best cost 'best_weight' (already
+  /// computed).  It works out the cutoff with a histogram of the costs
+  /// within the beam rather than sorting, which only approximates the
+  /// max_active constraint (it never keeps more than max_active tokens).
+  /// Returns false without setting its outputs in the (rare) cases where the
+  /// min_active constraint is what determines the cutoff, or where keeping
+  /// whole bins would leave too few tokens; GetCutoff() then computes the
+  /// cutoff exactly.
+  bool GetCutoffHistogram(Elem *list_head, size_t count,
+                          BaseFloat best_weight, BaseFloat *adaptive_beam,
+                          BaseFloat *cutoff);
+
   /// Processes emitting arcs for one frame.  Propagates from prev_toks_ to
   /// cur_toks_.  Returns the cost cutoff for subsequent ProcessNonemitting() to
   /// use.
   BaseFloat ProcessEmitting(DecodableInterface *decodable);
 
+  /// This is called from ProcessEmitting() if config_.num_emitting_threads > 1,
+  /// frame_loglikes.HasRow() is true and there are enough active tokens to
+  /// make it worthwhile.  It does the
+  /// work of the main loop of ProcessEmitting(): it propagates the tokens in
+  /// 'final_toks' whose cost is <= cur_cutoff over the emitting arcs, and
+  /// calls toks_.Delete() on each element of that list.  The arcs are
+  /// expanded and pruned on several threads, each with its own running
+  /// cutoff; then the surviving arcs are added to the hash and the lattice
+  /// (in the same order as the serial code would) on the calling thread,
+  /// pruning with the tightest of the threads' cutoffs.  'next_cutoff' is
+  /// used as the starting cutoff, and is updated.
+  void ProcessEmittingParallel(const FrameLogLikelihoods &frame_loglikes,
+                               int32 frame, Elem *final_toks,
+                               BaseFloat cur_cutoff, BaseFloat adaptive_beam,
+                               BaseFloat cost_offset, BaseFloat *next_cutoff);
+
   /// Processes nonemitting (epsilon) arcs for one frame.  Called after
   /// ProcessEmitting() on each frame.  The cost cutoff is computed by the
   /// preceding ProcessEmitting().
@@ -463,6 +572,8 @@ class LatticeFasterDecoderTpl {
   // must_prune_tokens).
   std::vector<const Elem* > queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
+  std::vector<int32> histogram_;  // used in GetCutoffHistogram.
+  std::vector<BaseFloat> arc_loglikes_;  // used in ProcessEmitting.
 
   // fst_ is a pointer to the FST we are decoding from.
   const FST *fst_;
@@ -478,6 +589,45 @@ class LatticeFasterDecoderTpl {
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
 
+  // use_memory_pool_ is a copy of config_.use_memory_pool, taken at the start
+  // of each utterance (so that SetOptions() cannot change the allocation
+  // strategy while tokens are alive).
+  bool use_memory_pool_;
+  ObjectPool<Token> token_pool_;
+  ObjectPool<ForwardLinkT> link_pool_;
+
+  // An emitting arc that survived pruning in ProcessEmittingParallel(), with
+  // its costs.
+  struct EmittingArc {
+    Token *tok;  // the source token.
+    StateId nextstate;
+    Label ilabel;
+    Label olabel;
+    BaseFloat graph_cost;
+    BaseFloat ac_cost;
+    BaseFloat tot_cost;
+  };
+  // Worker threads used by ProcessEmittingParallel(), created when first
+  // needed (NULL if not used).
+  ThreadPool *thread_pool_;
+  // Temporaries used in ProcessEmittingParallel(): the elements to process,
+  // and, for each thread, the arcs it kept.
+  std::vector<Elem*> emitting_elems_;
+  std::vector<std::vector<EmittingArc> > emitting_arcs_;
+  // Numbers of tokens and links allocated in this utterance (for diagnostics;
+  // maintained whether or not we use the memory pools).
+  int64 num_toks_allocated_;
+  int64 num_links_allocated_;
+  // Time spent in the parts of the search in this utterance; see
+  // GetTimingStats().
+  double cutoff_time_;
+  double emitting_time_;
+  double nonemitting_time_;
+  double prune_time_;
+  // True if we are measuring the times above in this utterance; see
+  // config_.timing_stats.
+  bool timing_;
+
   /// decoding_finalized_ is true if someone called FinalizeDecoding().  [note,
   /// calling this is optional].  If true, it's forbidden to decode more.  Also,
   /// if this is set, then the output of ComputeFinalCosts() is in the next
@@ -271,6 +271,7 @@ template class LatticeFasterOnlineDecoderTpl<fst::Fst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::VectorFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::ConstFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::GrammarFst>;
+template class LatticeFasterOnlineDecoderTpl<fst::FlatFst>;
 
 
 } // end namespace kaldi.
@@ -21,6 +21,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
+#include "util/parallel-table-writer.h"
 
 
 int main(int argc, char *argv[]) {
@@ -44,6 +45,7 @@ int main(int argc, char *argv[]) {
     bool compress = false;
     int32 compression_method_in = 1;
     std::string num_frames_wspecifier;
+    TaskSequencerConfig sequencer_config;  // only used with --compress=true.
     po.Register("htk-in", &htk_in, "Read input as HTK features");
     po.Register("sphinx-in", &sphinx_in, "Read input as Sphinx features");
     po.Register("binary", &binary, "Binary-mode output (not relevant if writing "
@@ -60,6 +62,7 @@ int main(int argc, char *argv[]) {
                 "e.g. 'ark,t:utt2num_frames'.  Only applicable if writing tables, "
                 "not when this program is writing individual files.  See also "
                 "feat-to-len.");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -107,13 +110,19 @@ int main(int argc, char *argv[]) {
           }
         }
       } else {
-        CompressedMatrixWriter kaldi_writer(wspecifier);
+        // Compression is done in the TaskSequencer's threads; the archive is
+        // written in the same order as without threads.
+        ParallelTableWriter<KaldiObjectHolder<CompressedMatrix>,
+                            Matrix<BaseFloat> > kaldi_writer(
+            wspecifier, sequencer_config,
+            [compression_method](const Matrix<BaseFloat> &in,
+                                 CompressedMatrix *out) {
+              out->CopyFromMat(in, compression_method);
+            });
         if (htk_in) {
           SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
           for (; !htk_reader.Done(); htk_reader.Next(), num_done++) {
-            kaldi_writer.Write(htk_reader.Key(),
-                               CompressedMatrix(htk_reader.Value().first,
-                                                compression_method));
+            kaldi_writer.Write(htk_reader.Key(), htk_reader.Value().first);
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(htk_reader.Key(),
                                       htk_reader.Value().first.NumRows());
@@ -121,9 +130,7 @@ int main(int argc, char *argv[]) {
         } else if (sphinx_in) {
           SequentialTableReader<SphinxMatrixHolder<> > sphinx_reader(rspecifier);
           for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++) {
-            kaldi_writer.Write(sphinx_reader.Key(),
-                               CompressedMatrix(sphinx_reader.Value(),
-                                                compression_method));
+            kaldi_writer.Write(sphinx_reader.Key(), sphinx_reader.Value());
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(sphinx_reader.Key(),
                                       sphinx_reader.Value().NumRows());
@@ -131,14 +138,13 @@ int main(int argc, char *argv[]) {
         } else {
           SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++) {
-            kaldi_writer.Write(kaldi_reader.Key(),
-                               CompressedMatrix(kaldi_reader.Value(),
-                                                compression_method));
+            kaldi_writer.Write(kaldi_reader.Key(), kaldi_reader.Value());
             if (!num_frames_wspecifier.empty())
               num_frames_writer.Write(kaldi_reader.Key(),
                                       kaldi_reader.Value().NumRows());
           }
         }
+        kaldi_writer.Close();
       }
       KALDI_LOG << "Copied " << num_done << " feature matrices.";
       return (num_done != 0 ? 0 : 1);
@@ -0,0 +1,72 @@
+// fstbin/make-flat-fst.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "decoder/flat-fst.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Convert a decoding graph (e.g. HCLG.fst) to the FlatFst format, which\n"
+        "the decoders can load with mmap(), so that loading is fast and the\n"
+        "graph's memory is shared between processes on the same machine.\n"
+        "Programs such as latgen-faster-mapped and nnet3-latgen-faster detect\n"
+        "this format automatically.  The output is written in the byte order\n"
+        "of this machine and can only be read on machines with the same byte\n"
+        "order.  See decoder/flat-fst.h for details.\n"
+        "\n"
+        "Usage: make-flat-fst [options] <fst-in> <flat-fst-out>\n"
+        "e.g.: make-flat-fst exp/tri3/graph/HCLG.fst exp/tri3/graph/HCLG.flat\n";
+
+    ParseOptions po(usage);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetArg(1),
+        flat_fst_wxfilename = po.GetArg(2);
+
+    Fst<StdArc> *fst = ReadFstKaldiGeneric(fst_rxfilename);
+
+    bool binary = true, write_header = false;
+    Output ko(flat_fst_wxfilename, binary, write_header);
+    FlatFst::Write(*fst, ko.Stream());
+    ko.Close();
+
+    KALDI_LOG << "Wrote FST with " << CountStates(*fst)
+              << " states to " << PrintableWxfilename(flat_fst_wxfilename);
+    delete fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
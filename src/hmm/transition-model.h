@@ -161,6 +161,14 @@ class TransitionModel {
   // (unless we're in paranoid mode).
   inline int32 TransitionIdToPdfFast(int32 trans_id) const;
 
+  // Returns the table that TransitionIdToPdfFast() looks up, indexed by
+  // transition-id (so element zero is unused).  This is for decodable objects
+  // that let the decoder do the mapping itself, see
+  // DecodableInterface::GetFrameLogLikelihoods().
+  const std::vector<int32> &TransitionIdToPdfArray() const {
+    return id2pdf_id_;
+  }
+
   int32 TransitionIdToPhone(int32 trans_id) const;
   int32 TransitionIdToPdfClass(int32 trans_id) const;
   int32 TransitionIdToHmmState(int32 trans_id) const;
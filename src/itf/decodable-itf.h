@@ -114,6 +114,21 @@ class DecodableInterface {
   /// this is for compatibility with OpenFst).
   virtual int32 NumIndices() const = 0;
 
+  /// This optional function exposes the log-likelihoods of a frame as an
+  /// array, so that the decoder can look up many of them without a virtual
+  /// function call for each one.  If it returns true, it has set the outputs
+  /// so that for 1 <= index <= NumIndices(),
+  /// \code
+  ///   LogLikelihood(frame, index) == (*scale) * (*row)[(*index_map)[index]]
+  /// \endcode
+  /// (typically 'index_map' maps transition-ids to pdf-ids).  The pointers
+  /// remain valid until the next call to a non-const function of this object.
+  /// The default implementation returns false, meaning this is not supported,
+  /// in which case the decoder just calls LogLikelihood().
+  virtual bool GetFrameLogLikelihoods(int32 frame, const BaseFloat **row,
+                                      const int32 **index_map,
+                                      BaseFloat *scale) { return false; }
+
   virtual ~DecodableInterface() {}
 };
 /// @}
@@ -0,0 +1,93 @@
+// matrix/block-sparse-matrix-inl.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is only to be included by block-sparse-matrix.cc, once for each
+// instruction set, inside a namespace that defines a struct 'Ops' with the
+// SIMD operations for that instruction set (see block-sparse-matrix.cc).  It
+// defines the function AddBlockSparseProducts() in that namespace.  There is
+// deliberately no include guard.
+
+// Sets c_trans = B * a_trans, where a_trans has B.NumBlockCols() *
+// B.BlockCols() rows and c_trans has B.NumBlockRows() * B.BlockRows() rows,
+// and both have 'num_frames' columns and stride; num_frames must be a multiple
+// of 2 * Ops::kWidth.  kBlockRows equals B.BlockRows().
+//
+// For each block-row of B we go through the frames 2 * Ops::kWidth at a time,
+// keeping the sums for those frames and the kBlockRows rows of c_trans in
+// registers while we go through the stored blocks, so each element of a_trans
+// that is loaded is used kBlockRows times.
+template<int32 kBlockRows>
+static void AddBlockSparseProductsFixed(const BlockSparseMatrix &B,
+                                        const BaseFloat *a_trans,
+                                        int32 num_frames,
+                                        BaseFloat *c_trans) {
+  typedef Ops::V V;
+  const int32 kWidth = Ops::kWidth;
+  int32 block_cols = B.BlockCols(), num_block_rows = B.NumBlockRows();
+  for (int32 r = 0; r < num_block_rows; r++) {
+    int32 begin = B.BlockRowOffset(r), end = B.BlockRowOffset(r + 1);
+    BaseFloat *c = c_trans + static_cast<size_t>(r) * kBlockRows * num_frames;
+    for (int32 t = 0; t < num_frames; t += 2 * kWidth) {
+      V sum0[kBlockRows], sum1[kBlockRows];
+      for (int32 i = 0; i < kBlockRows; i++)
+        sum0[i] = sum1[i] = Ops::Zero();
+      for (int32 b = begin; b < end; b++) {
+        const BaseFloat *w = B.BlockData(b),
+            *a = a_trans + static_cast<size_t>(B.BlockColIndex(b)) *
+            block_cols * num_frames + t;
+        for (int32 j = 0; j < block_cols; j++, w += kBlockRows,
+                 a += num_frames) {
+          V a0 = Ops::Load(a), a1 = Ops::Load(a + kWidth);
+          for (int32 i = 0; i < kBlockRows; i++) {
+            V wi = Ops::Set1(w[i]);
+            sum0[i] = Ops::Fma(wi, a0, sum0[i]);
+            sum1[i] = Ops::Fma(wi, a1, sum1[i]);
+          }
+        }
+      }
+      for (int32 i = 0; i < kBlockRows; i++) {
+        Ops::Store(c + i * num_frames + t, sum0[i]);
+        Ops::Store(c + i * num_frames + t + kWidth, sum1[i]);
+      }
+    }
+  }
+}
+
+static void AddBlockSparseProducts(const BlockSparseMatrix &B,
+                                   const BaseFloat *a_trans,
+                                   int32 num_frames,
+                                   BaseFloat *c_trans) {
+  switch (B.BlockRows()) {
+    case 1:
+      AddBlockSparseProductsFixed<1>(B, a_trans, num_frames, c_trans);
+      break;
+    case 2:
+      AddBlockSparseProductsFixed<2>(B, a_trans, num_frames, c_trans);
+      break;
+    case 4:
+      AddBlockSparseProductsFixed<4>(B, a_trans, num_frames, c_trans);
+      break;
+    case 8:
+      AddBlockSparseProductsFixed<8>(B, a_trans, num_frames, c_trans);
+      break;
+    default:
+      KALDI_ERR << "Unsupported block-rows " << B.BlockRows();
+  }
+  Ops::ZeroUpper();
+}
@@ -0,0 +1,152 @@
+// matrix/block-sparse-matrix-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// Returns a random block size that BlockSparseMatrix supports.
+static void RandomBlockSize(int32 *block_rows, int32 *block_cols) {
+  *block_rows = 1 << RandInt(0, 3);
+  *block_cols = RandInt(1, 9);
+}
+
+// Sets to zero each block of size block_rows by block_cols of 'mat' with
+// probability 'zero_prob'; if 'partly' is true, a quarter of those blocks keep
+// one element.
+static void PruneMatrix(BaseFloat zero_prob, int32 block_rows,
+                        int32 block_cols, bool partly,
+                        MatrixBase<BaseFloat> *mat) {
+  for (int32 r = 0; r < mat->NumRows(); r += block_rows) {
+    for (int32 c = 0; c < mat->NumCols(); c += block_cols) {
+      if (RandUniform() >= zero_prob)
+        continue;
+      bool keep_one = (partly && RandInt(0, 3) == 0);
+      for (int32 i = r; i < std::min(r + block_rows, mat->NumRows()); i++)
+        for (int32 j = c; j < std::min(c + block_cols, mat->NumCols()); j++)
+          if (!(keep_one && i == r && j == c))
+            (*mat)(i, j) = 0.0;
+    }
+  }
+}
+
+void UnitTestBlockSparseMatrixCopy() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_rows = RandInt(1, 30), num_cols = RandInt(1, 30),
+        block_rows, block_cols;
+    RandomBlockSize(&block_rows, &block_cols);
+    Matrix<BaseFloat> mat(num_rows, num_cols);
+    mat.SetRandn();
+    PruneMatrix(0.6, block_rows, block_cols, true, &mat);
+    BlockSparseMatrix bmat(mat, block_rows, block_cols);
+    KALDI_ASSERT(bmat.NumRows() == num_rows && bmat.NumCols() == num_cols &&
+                 bmat.Density() >= 0.0 && bmat.Density() <= 1.0);
+    Matrix<BaseFloat> mat2(num_rows, num_cols);
+    bmat.CopyToMat(&mat2);
+    AssertEqual(mat, mat2);
+
+    // The same from a SparseMatrix.
+    std::vector<std::vector<std::pair<MatrixIndexT, BaseFloat> > > pairs(
+        num_rows);
+    for (int32 r = 0; r < num_rows; r++)
+      for (int32 c = 0; c < num_cols; c++)
+        if (mat(r, c) != 0.0 || RandInt(0, 10) == 0)
+          pairs[r].push_back(std::make_pair(c, mat(r, c)));
+    SparseMatrix<BaseFloat> smat(num_cols, pairs);
+    BlockSparseMatrix bmat2;
+    bmat2.CopyFromSmat(smat, block_rows, block_cols);
+    KALDI_ASSERT(bmat2.NumBlocks() == bmat.NumBlocks());
+    Matrix<BaseFloat> mat3(num_rows, num_cols);
+    bmat2.CopyToMat(&mat3);
+    AssertEqual(mat, mat3);
+
+    for (int32 j = 0; j < 2; j++) {
+      bool binary = (j == 0);
+      std::ostringstream os;
+      bmat.Write(os, binary);
+      BlockSparseMatrix bmat3;
+      std::istringstream is(os.str());
+      bmat3.Read(is, binary);
+      KALDI_ASSERT(bmat3.NumBlocks() == bmat.NumBlocks() &&
+                   bmat3.BlockRows() == block_rows &&
+                   bmat3.BlockCols() == block_cols);
+      Matrix<BaseFloat> mat4(num_rows, num_cols);
+      bmat3.CopyToMat(&mat4);
+      AssertEqual(mat, mat4);
+    }
+  }
+}
+
+void UnitTestAddMatBlockSparseMatTrans() {
+  for (int32 i = 0; i < 40; i++) {
+    int32 num_rows = RandInt(1, 40), dim = RandInt(1, 100),
+        num_out = RandInt(1, 40), block_rows, block_cols;
+    RandomBlockSize(&block_rows, &block_cols);
+    Matrix<BaseFloat> A(num_rows, dim), B(num_out, dim),
+        C(num_rows, num_out);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    PruneMatrix(RandUniform(), block_rows, block_cols, true, &B);
+    Matrix<BaseFloat> C2(C);
+    BaseFloat alpha = 0.5;
+    C.AddMatMat(alpha, A, kNoTrans, B, kTrans, 1.0);
+    BlockSparseMatrix bB(B, block_rows, block_cols);
+    AddMatBlockSparseMatTrans(alpha, A, bB, &C2);
+    AssertEqual(C, C2);
+  }
+}
+
+// Compares the speed with dense matrix multiplication, for sizes typical of
+// TDNN-F layers with 90% of the 4x4 blocks of weights pruned.
+void UnitTestAddMatBlockSparseMatTransSpeed() {
+  int32 num_rows = 64, dim = 1024, num_out = 1024, num_iters = 5,
+      block_rows = 4, block_cols = 4;
+  Matrix<BaseFloat> A(num_rows, dim), B(num_out, dim), C(num_rows, num_out);
+  A.SetRandn();
+  B.SetRandn();
+  PruneMatrix(0.9, block_rows, block_cols, false, &B);
+  BlockSparseMatrix bB(B, block_rows, block_cols);
+  Timer timer;
+  for (int32 i = 0; i < num_iters; i++)
+    C.AddMatMat(1.0, A, kNoTrans, B, kTrans, 0.0);
+  double dense_time = timer.Elapsed();
+  timer.Reset();
+  for (int32 i = 0; i < num_iters; i++) {
+    C.SetZero();
+    AddMatBlockSparseMatTrans(1.0, A, bB, &C);
+  }
+  double sparse_time = timer.Elapsed();
+  KALDI_LOG << "For " << num_rows << " x " << dim << " times " << dim
+            << " x " << num_out << " with density " << bB.Density()
+            << ", block-sparse multiplication is "
+            << (dense_time / sparse_time) << " times faster than dense.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestBlockSparseMatrixCopy();
+  UnitTestAddMatBlockSparseMatTrans();
+  UnitTestAddMatBlockSparseMatTransSpeed();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
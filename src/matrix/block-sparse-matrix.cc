@@ -0,0 +1,336 @@
+// matrix/block-sparse-matrix.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "matrix/block-sparse-matrix.h"
+
+// As in vectorized-math.cc, the SIMD code is compiled with GCC's target
+// pragmas and whether it is used is decided at run time.  It is only for
+// single precision.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+  (__GNUC__ >= 6) && (KALDI_DOUBLEPRECISION == 0)
+#define KALDI_BLOCK_SPARSE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+void BlockSparseMatrix::Init(int32 num_rows, int32 num_cols,
+                             int32 block_rows, int32 block_cols) {
+  if (!(block_rows == 1 || block_rows == 2 || block_rows == 4 ||
+        block_rows == 8) || block_cols <= 0)
+    KALDI_ERR << "Invalid block size " << block_rows << " by " << block_cols
+              << " for BlockSparseMatrix (block-rows must be 1, 2, 4 or 8).";
+  KALDI_ASSERT(num_rows >= 0 && num_cols >= 0);
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  block_rows_ = block_rows;
+  block_cols_ = block_cols;
+  block_row_offsets_.assign((num_rows + block_rows - 1) / block_rows + 1, 0);
+  block_col_indexes_.clear();
+  values_.Resize(0);
+}
+
+template<typename Real>
+void BlockSparseMatrix::CopyFromMat(const MatrixBase<Real> &mat,
+                                    int32 block_rows, int32 block_cols) {
+  Init(mat.NumRows(), mat.NumCols(), block_rows, block_cols);
+  int32 num_block_rows = NumBlockRows(), num_block_cols = NumBlockCols(),
+      block_size = block_rows * block_cols;
+  std::vector<BaseFloat> values;
+  for (int32 r = 0; r < num_block_rows; r++) {
+    int32 row_begin = r * block_rows,
+        row_end = std::min(row_begin + block_rows, num_rows_);
+    for (int32 c = 0; c < num_block_cols; c++) {
+      int32 col_begin = c * block_cols,
+          col_end = std::min(col_begin + block_cols, num_cols_);
+      bool is_zero = true;
+      for (int32 i = row_begin; i < row_end && is_zero; i++)
+        for (int32 j = col_begin; j < col_end; j++)
+          if (mat(i, j) != 0.0) { is_zero = false; break; }
+      if (is_zero)
+        continue;
+      size_t offset = values.size();
+      values.resize(offset + block_size, 0.0);
+      for (int32 i = row_begin; i < row_end; i++)
+        for (int32 j = col_begin; j < col_end; j++)
+          values[offset + (j - col_begin) * block_rows + (i - row_begin)] =
+              mat(i, j);
+      block_col_indexes_.push_back(c);
+    }
+    block_row_offsets_[r + 1] = block_col_indexes_.size();
+  }
+  values_.Resize(values.size(), kUndefined);
+  if (!values.empty())
+    std::copy(values.begin(), values.end(), values_.Data());
+}
+
+template<typename Real>
+void BlockSparseMatrix::CopyFromSmat(const SparseMatrix<Real> &smat,
+                                     int32 block_rows, int32 block_cols) {
+  Init(smat.NumRows(), smat.NumCols(), block_rows, block_cols);
+  int32 num_block_rows = NumBlockRows(), num_block_cols = NumBlockCols(),
+      block_size = block_rows * block_cols;
+  // Indexed by block-column: the offset in 'values' of that block in the
+  // current block-row, or -1.
+  std::vector<int32> block_offset(num_block_cols, -1);
+  std::vector<BaseFloat> values;
+  for (int32 r = 0; r < num_block_rows; r++) {
+    int32 row_begin = r * block_rows,
+        row_end = std::min(row_begin + block_rows, num_rows_),
+        first_block = block_col_indexes_.size();
+    for (int32 i = row_begin; i < row_end; i++) {
+      const SparseVector<Real> &row = smat.Row(i);
+      for (int32 e = 0; e < row.NumElements(); e++)
+        if (row.GetElement(e).second != 0.0)
+          block_col_indexes_.push_back(row.GetElement(e).first / block_cols);
+    }
+    std::sort(block_col_indexes_.begin() + first_block,
+              block_col_indexes_.end());
+    block_col_indexes_.erase(std::unique(block_col_indexes_.begin() +
+                                         first_block,
+                                         block_col_indexes_.end()),
+                             block_col_indexes_.end());
+    for (size_t b = first_block; b < block_col_indexes_.size(); b++) {
+      block_offset[block_col_indexes_[b]] = values.size();
+      values.resize(values.size() + block_size, 0.0);
+    }
+    for (int32 i = row_begin; i < row_end; i++) {
+      const SparseVector<Real> &row = smat.Row(i);
+      for (int32 e = 0; e < row.NumElements(); e++) {
+        int32 j = row.GetElement(e).first;
+        int32 offset = block_offset[j / block_cols];
+        if (offset >= 0)
+          values[offset + (j % block_cols) * block_rows + (i - row_begin)] =
+              row.GetElement(e).second;
+      }
+    }
+    for (size_t b = first_block; b < block_col_indexes_.size(); b++)
+      block_offset[block_col_indexes_[b]] = -1;
+    block_row_offsets_[r + 1] = block_col_indexes_.size();
+  }
+  values_.Resize(values.size(), kUndefined);
+  if (!values.empty())
+    std::copy(values.begin(), values.end(), values_.Data());
+}
+
+template<typename Real>
+void BlockSparseMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  mat->SetZero();
+  int32 num_block_rows = NumBlockRows();
+  for (int32 r = 0; r < num_block_rows; r++) {
+    int32 row_begin = r * block_rows_,
+        row_end = std::min(row_begin + block_rows_, num_rows_);
+    for (int32 b = block_row_offsets_[r]; b < block_row_offsets_[r + 1];
+         b++) {
+      const BaseFloat *block = BlockData(b);
+      int32 col_begin = block_col_indexes_[b] * block_cols_,
+          col_end = std::min(col_begin + block_cols_, num_cols_);
+      for (int32 i = row_begin; i < row_end; i++)
+        for (int32 j = col_begin; j < col_end; j++)
+          (*mat)(i, j) = block[(j - col_begin) * block_rows_ +
+                               (i - row_begin)];
+    }
+  }
+}
+
+BaseFloat BlockSparseMatrix::Density() const {
+  double num_blocks_total = static_cast<double>(NumBlockRows()) *
+      NumBlockCols();
+  return (num_blocks_total == 0.0 ? 0.0 : NumBlocks() / num_blocks_total);
+}
+
+void BlockSparseMatrix::Check() const {
+  int32 num_block_rows = NumBlockRows(), num_block_cols = NumBlockCols();
+  if (block_row_offsets_.empty() || block_row_offsets_[0] != 0 ||
+      block_row_offsets_.back() != NumBlocks() ||
+      values_.Dim() != static_cast<MatrixIndexT>(NumBlocks()) *
+      block_rows_ * block_cols_)
+    KALDI_ERR << "Inconsistent sizes in BlockSparseMatrix.";
+  for (int32 r = 0; r < num_block_rows; r++) {
+    for (int32 b = block_row_offsets_[r]; b < block_row_offsets_[r + 1];
+         b++) {
+      if (block_col_indexes_[b] < 0 ||
+          block_col_indexes_[b] >= num_block_cols ||
+          (b > block_row_offsets_[r] &&
+           block_col_indexes_[b] <= block_col_indexes_[b - 1]))
+        KALDI_ERR << "Bad block-column indexes in BlockSparseMatrix.";
+    }
+    if (block_row_offsets_[r + 1] < block_row_offsets_[r])
+      KALDI_ERR << "Bad block-row offsets in BlockSparseMatrix.";
+  }
+}
+
+void BlockSparseMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<BlockSparseMatrix>");
+  WriteBasicType(os, binary, num_rows_);
+  WriteBasicType(os, binary, num_cols_);
+  WriteBasicType(os, binary, block_rows_);
+  WriteBasicType(os, binary, block_cols_);
+  WriteIntegerVector(os, binary, block_row_offsets_);
+  WriteIntegerVector(os, binary, block_col_indexes_);
+  values_.Write(os, binary);
+  WriteToken(os, binary, "</BlockSparseMatrix>");
+  if (!os.good())
+    KALDI_ERR << "Error writing BlockSparseMatrix to stream.";
+}
+
+void BlockSparseMatrix::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<BlockSparseMatrix>");
+  int32 num_rows, num_cols, block_rows, block_cols;
+  ReadBasicType(is, binary, &num_rows);
+  ReadBasicType(is, binary, &num_cols);
+  ReadBasicType(is, binary, &block_rows);
+  ReadBasicType(is, binary, &block_cols);
+  if (num_rows < 0 || num_cols < 0)
+    KALDI_ERR << "Bad size in BlockSparseMatrix: " << num_rows << " by "
+              << num_cols;
+  Init(num_rows, num_cols, block_rows, block_cols);
+  size_t num_block_row_offsets = block_row_offsets_.size();
+  ReadIntegerVector(is, binary, &block_row_offsets_);
+  if (block_row_offsets_.size() != num_block_row_offsets)
+    KALDI_ERR << "Bad number of block-rows in BlockSparseMatrix.";
+  ReadIntegerVector(is, binary, &block_col_indexes_);
+  values_.Read(is, binary);
+  ExpectToken(is, binary, "</BlockSparseMatrix>");
+  if (!is.good())
+    KALDI_ERR << "Error reading BlockSparseMatrix from stream.";
+  Check();
+}
+
+void BlockSparseMatrix::Swap(BlockSparseMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  std::swap(block_rows_, other->block_rows_);
+  std::swap(block_cols_, other->block_cols_);
+  block_row_offsets_.swap(other->block_row_offsets_);
+  block_col_indexes_.swap(other->block_col_indexes_);
+  values_.Swap(&(other->values_));
+}
+
+template
+void BlockSparseMatrix::CopyFromMat(const MatrixBase<float> &mat,
+                                    int32 block_rows, int32 block_cols);
+template
+void BlockSparseMatrix::CopyFromMat(const MatrixBase<double> &mat,
+                                    int32 block_rows, int32 block_cols);
+template
+void BlockSparseMatrix::CopyFromSmat(const SparseMatrix<float> &smat,
+                                     int32 block_rows, int32 block_cols);
+template
+void BlockSparseMatrix::CopyFromSmat(const SparseMatrix<double> &smat,
+                                     int32 block_rows, int32 block_cols);
+template
+void BlockSparseMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void BlockSparseMatrix::CopyToMat(MatrixBase<double> *mat) const;
+
+
+namespace generic {
+
+struct Ops {
+  typedef BaseFloat V;
+  static const int32 kWidth = 1;
+  static inline V Zero() { return 0.0; }
+  static inline V Load(const BaseFloat *p) { return *p; }
+  static inline void Store(BaseFloat *p, V a) { *p = a; }
+  static inline V Set1(BaseFloat f) { return f; }
+  // Returns a * b + c.
+  static inline V Fma(V a, V b, V c) { return a * b + c; }
+  static inline void ZeroUpper() { }
+};
+
+#include "matrix/block-sparse-matrix-inl.h"
+
+}  // namespace generic
+
+#ifdef KALDI_BLOCK_SPARSE_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+namespace avx2 {
+
+struct Ops {
+  typedef __m256 V;
+  static const int32 kWidth = 8;
+  static inline V Zero() { return _mm256_setzero_ps(); }
+  static inline V Load(const float *p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static inline V Set1(float f) { return _mm256_set1_ps(f); }
+  static inline V Fma(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static inline void ZeroUpper() { _mm256_zeroupper(); }
+};
+
+#include "matrix/block-sparse-matrix-inl.h"
+
+}  // namespace avx2
+
+#pragma GCC pop_options
+
+#endif  // KALDI_BLOCK_SPARSE_X86
+
+namespace {
+
+typedef void (*BlockSparseProductsFunction)(const BlockSparseMatrix &B,
+                                            const BaseFloat *a_trans,
+                                            int32 num_frames,
+                                            BaseFloat *c_trans);
+
+BlockSparseProductsFunction ChooseBlockSparseProducts() {
+#ifdef KALDI_BLOCK_SPARSE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return avx2::AddBlockSparseProducts;
+#endif
+  return generic::AddBlockSparseProducts;
+}
+
+}  // namespace
+
+// The frames are processed this many at a time (twice the widest SIMD width);
+// the transposed matrices are padded to a multiple of it.
+static const int32 kFrameMultiple = 16;
+
+void AddMatBlockSparseMatTrans(BaseFloat alpha, const MatrixBase<BaseFloat> &A,
+                               const BlockSparseMatrix &B,
+                               MatrixBase<BaseFloat> *C) {
+  KALDI_ASSERT(A.NumCols() == B.NumCols() && C->NumRows() == A.NumRows() &&
+               C->NumCols() == B.NumRows());
+  int32 num_frames = A.NumRows();
+  if (num_frames == 0 || B.NumBlocks() == 0 || alpha == 0.0)
+    return;
+  // The initialization of function-local statics is thread-safe in C++11.
+  static const BlockSparseProductsFunction products =
+      ChooseBlockSparseProducts();
+  int32 padded_frames = kFrameMultiple *
+      ((num_frames + kFrameMultiple - 1) / kFrameMultiple);
+  // a_trans is A transposed, padded with zeros to a whole number of blocks
+  // and to padded_frames.  The padding of c_trans is ignored.
+  Matrix<BaseFloat> a_trans(B.NumBlockCols() * B.BlockCols(), padded_frames,
+                            kSetZero, kStrideEqualNumCols),
+      c_trans(B.NumBlockRows() * B.BlockRows(), padded_frames, kUndefined,
+              kStrideEqualNumCols);
+  a_trans.Range(0, A.NumCols(), 0, num_frames).CopyFromMat(A, kTrans);
+  products(B, a_trans.Data(), padded_frames, c_trans.Data());
+  C->AddMat(alpha, c_trans.Range(0, B.NumRows(), 0, num_frames), kTrans);
+}
+
+}  // namespace kaldi
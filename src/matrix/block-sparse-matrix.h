@@ -0,0 +1,153 @@
+// matrix/block-sparse-matrix.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_
+#define KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_ 1
+
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+#include "matrix/kaldi-vector.h"
+#include "matrix/sparse-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   BlockSparseMatrix stores a matrix in block compressed sparse row
+   ("block-CSR") format: the matrix is divided into blocks of BlockRows() by
+   BlockCols() elements, and only the blocks that contain a nonzero element are
+   stored.  Each stored block is dense.  Compared with SparseMatrix, which
+   stores single elements, this needs one index per block rather than one per
+   element, and lets the multiplication code use SIMD instructions.  It exists
+   for fast multiplication by pruned neural-net weight matrices (see
+   AddMatBlockSparseMatTrans()); it is not meant for general use like Matrix.
+
+   BlockRows() must be 1, 2, 4 or 8; BlockCols() may be any positive number.
+   If the dimensions are not multiples of the block size, the last blocks are
+   padded with zeros.
+ */
+class BlockSparseMatrix {
+ public:
+  BlockSparseMatrix(): num_rows_(0), num_cols_(0), block_rows_(1),
+                       block_cols_(1), block_row_offsets_(1, 0) { }
+
+  template<typename Real>
+  BlockSparseMatrix(const MatrixBase<Real> &mat, int32 block_rows,
+                    int32 block_cols) {
+    CopyFromMat(mat, block_rows, block_cols);
+  }
+
+  /// Copies the blocks of 'mat' that contain nonzero elements.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat, int32 block_rows,
+                   int32 block_cols);
+
+  /// Copies the blocks of 'smat' that contain nonzero elements; this avoids
+  /// creating the dense matrix.
+  template<typename Real>
+  void CopyFromSmat(const SparseMatrix<Real> &smat, int32 block_rows,
+                    int32 block_cols);
+
+  /// Copies the values to 'mat', which must have the right size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  int32 NumRows() const { return num_rows_; }
+  int32 NumCols() const { return num_cols_; }
+  int32 BlockRows() const { return block_rows_; }
+  int32 BlockCols() const { return block_cols_; }
+
+  /// Returns the number of block-rows, i.e. NumRows() / BlockRows() rounded
+  /// up; similarly for NumBlockCols().
+  int32 NumBlockRows() const { return block_row_offsets_.size() - 1; }
+  int32 NumBlockCols() const {
+    return (num_cols_ + block_cols_ - 1) / block_cols_;
+  }
+
+  /// Returns the number of blocks stored.
+  int32 NumBlocks() const { return block_col_indexes_.size(); }
+
+  /// Returns the fraction of the blocks that are stored (between 0 and 1).
+  BaseFloat Density() const;
+
+  /// The stored blocks of block-row 'r' are numbered from BlockRowOffset(r) to
+  /// BlockRowOffset(r + 1) - 1, in increasing order of block-column.
+  int32 BlockRowOffset(int32 r) const { return block_row_offsets_[r]; }
+
+  /// Returns the block-column of stored block 'b'.
+  int32 BlockColIndex(int32 b) const { return block_col_indexes_[b]; }
+
+  /// Returns the BlockRows() * BlockCols() values of stored block 'b', in
+  /// column-major order (i.e. element (i, j) of the block is at
+  /// j * BlockRows() + i), which is the order the multiplication code needs.
+  const BaseFloat *BlockData(int32 b) const {
+    return values_.Data() + b * block_rows_ * block_cols_;
+  }
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+  /// Returns the number of bytes the data takes up (for diagnostics).
+  int64 SizeInBytes() const {
+    return values_.Dim() * sizeof(BaseFloat) +
+        (block_row_offsets_.size() + block_col_indexes_.size()) *
+        sizeof(int32);
+  }
+
+  void Swap(BlockSparseMatrix *other);
+
+ private:
+  // Checks the sizes and sets up num_rows_ and so on for a matrix with no
+  // blocks stored.
+  void Init(int32 num_rows, int32 num_cols, int32 block_rows,
+            int32 block_cols);
+  // Checks that the members are consistent, after reading.
+  void Check() const;
+
+  int32 num_rows_;
+  int32 num_cols_;
+  int32 block_rows_;
+  int32 block_cols_;
+  // Indexed by block-row, plus one extra element at the end; see
+  // BlockRowOffset().
+  std::vector<int32> block_row_offsets_;
+  // The block-column of each stored block.
+  std::vector<int32> block_col_indexes_;
+  // The values of the stored blocks, each block in column-major order.
+  Vector<BaseFloat> values_;
+};
+
+/// Does C += alpha * A * B^T, where B is block-sparse.  This is the operation
+/// done by an affine layer whose weights are B.  A is transposed internally so
+/// that the code can multiply each weight by several rows (frames) of A at once
+/// with SIMD instructions; if the CPU supports AVX2 and FMA (detected at run
+/// time) they are used, otherwise plain C++.  The time taken is roughly
+/// proportional to B.NumBlocks().  Requires A.NumCols() == B.NumCols(),
+/// C->NumRows() == A.NumRows() and C->NumCols() == B.NumRows().
+void AddMatBlockSparseMatTrans(BaseFloat alpha, const MatrixBase<BaseFloat> &A,
+                               const BlockSparseMatrix &B,
+                               MatrixBase<BaseFloat> *C);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_BLOCK_SPARSE_MATRIX_H_
@@ -27,6 +27,7 @@
 #include "matrix/kaldi-matrix.h"
 #include "matrix/matrix-functions.h"
 #include "matrix/kaldi-blas.h"
+#include "matrix/small-gemm.h"
 
 // Do not include this file directly.  It is to be included
 // by .cc files in this directory.
@@ -230,9 +231,15 @@ inline void cblas_Xgemm(const float alpha,
                         const float beta,
                         float *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  MatrixIndexT inner_dim = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  if (UseSmallGemm(num_rows, num_cols, inner_dim)) {
+    SmallGemm(alpha, transA, Adata, a_stride, transB, Bdata, b_stride, beta,
+              Mdata, num_rows, num_cols, inner_dim, stride);
+    return;
+  }
   cblas_sgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
-              num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
+              num_rows, num_cols, inner_dim,
               alpha, Adata, a_stride, Bdata, b_stride,
               beta, Mdata, stride); 
 }
@@ -245,9 +252,15 @@ inline void cblas_Xgemm(const double alpha,
                         const double beta,
                         double *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  MatrixIndexT inner_dim = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  if (UseSmallGemm(num_rows, num_cols, inner_dim)) {
+    SmallGemm(alpha, transA, Adata, a_stride, transB, Bdata, b_stride, beta,
+              Mdata, num_rows, num_cols, inner_dim, stride);
+    return;
+  }
   cblas_dgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
-              num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
+              num_rows, num_cols, inner_dim,
               alpha, Adata, a_stride, Bdata, b_stride,
               beta, Mdata, stride); 
 }
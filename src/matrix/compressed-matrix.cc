@@ -21,9 +21,29 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace kaldi {
 
+#ifdef __SSE2__
+// These are specialized further down.
+template<>
+void CompressedMatrix::CompressColumns(const GlobalHeader &global_header,
+                                       const MatrixBase<float> &mat,
+                                       PerColHeader *header_data,
+                                       uint8 *byte_data);
+template<>
+void CompressedMatrix::CompressRowTwoByte(const GlobalHeader &global_header,
+                                          const float *row_data,
+                                          int32 num_cols, uint16 *data);
+template<>
+void CompressedMatrix::CompressRowOneByte(const GlobalHeader &global_header,
+                                          const float *row_data,
+                                          int32 num_cols, uint8 *data);
+#endif
+
 //static
 MatrixIndexT CompressedMatrix::DataSize(const GlobalHeader &header) {
   // Returns size in bytes of the data.
@@ -152,24 +172,13 @@ void CompressedMatrix::CopyFromMat(
     uint8 *byte_data =
         reinterpret_cast<uint8*>(header_data + global_header.num_cols);
 
-    const Real *matrix_data = mat.Data();
-
-    for (int32 col = 0; col < global_header.num_cols; col++) {
-      CompressColumn(global_header,
-                     matrix_data + col, mat.Stride(),
-                     global_header.num_rows,
-                     header_data, byte_data);
-      header_data++;
-      byte_data += global_header.num_rows;
-    }
+    CompressColumns(global_header, mat, header_data, byte_data);
   } else if (format == kTwoByte) {
     uint16 *data = reinterpret_cast<uint16*>(static_cast<char*>(data_) +
                                              sizeof(GlobalHeader));
     int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
     for (int32 r = 0; r < num_rows; r++) {
-      const Real *row_data = mat.RowData(r);
-      for (int32 c = 0; c < num_cols; c++)
-        data[c] = FloatToUint16(global_header, row_data[c]);
+      CompressRowTwoByte(global_header, mat.RowData(r), num_cols, data);
       data += num_cols;
     }
   } else {
@@ -178,9 +187,7 @@ void CompressedMatrix::CopyFromMat(
                                            sizeof(GlobalHeader));
     int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
     for (int32 r = 0; r < num_rows; r++) {
-      const Real *row_data = mat.RowData(r);
-      for (int32 c = 0; c < num_cols; c++)
-        data[c] = FloatToUint8(global_header, row_data[c]);
+      CompressRowOneByte(global_header, mat.RowData(r), num_cols, data);
       data += num_cols;
     }
   }
@@ -520,6 +527,162 @@ void CompressedMatrix::CompressColumn(
   }
 }
 
+template<typename Real>  // static
+void CompressedMatrix::CompressColumns(const GlobalHeader &global_header,
+                                       const MatrixBase<Real> &mat,
+                                       PerColHeader *header_data,
+                                       uint8 *byte_data) {
+  for (int32 col = 0; col < global_header.num_cols; col++) {
+    CompressColumn(global_header,
+                   mat.Data() + col, mat.Stride(),
+                   global_header.num_rows,
+                   header_data, byte_data);
+    header_data++;
+    byte_data += global_header.num_rows;
+  }
+}
+
+template<typename Real>  // static
+void CompressedMatrix::CompressRowTwoByte(const GlobalHeader &global_header,
+                                          const Real *row_data,
+                                          int32 num_cols, uint16 *data) {
+  for (int32 c = 0; c < num_cols; c++)
+    data[c] = FloatToUint16(global_header, row_data[c]);
+}
+
+template<typename Real>  // static
+void CompressedMatrix::CompressRowOneByte(const GlobalHeader &global_header,
+                                          const Real *row_data,
+                                          int32 num_cols, uint8 *data) {
+  for (int32 c = 0; c < num_cols; c++)
+    data[c] = FloatToUint8(global_header, row_data[c]);
+}
+
+#ifdef __SSE2__
+// The SSE2 versions for float below give exactly the same output as the
+// generic versions above.  They do the same float operations in the same
+// order; where FloatToUint16(), FloatToUint8() and FloatToChar() add 0.499 or
+// 0.5 in double precision, so do we.  (Adding it in float would not be the
+// same: e.g. 0.49999997f + 0.5f rounds to 1.0f.)
+
+// Returns static_cast<int>(x + offset) for the four elements of x, computing
+// the sum in double precision like the scalar code.
+static inline __m128i RoundToInt(__m128 x, double offset_value) {
+  const __m128d offset = _mm_set1_pd(offset_value);
+  __m128i lo = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(x), offset)),
+      hi = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+                                       offset));
+  return _mm_unpacklo_epi64(lo, hi);
+}
+
+// Returns (value - min_value) / range limited to [0, 1], as in
+// FloatToUint16() and FloatToUint8().
+static inline __m128 NormalizeToUnit(__m128 value, __m128 min_value,
+                                     __m128 range) {
+  __m128 f = _mm_div_ps(_mm_sub_ps(value, min_value), range);
+  return _mm_max_ps(_mm_min_ps(f, _mm_set1_ps(1.0f)), _mm_setzero_ps());
+}
+
+template<>  // static
+void CompressedMatrix::CompressRowTwoByte(const GlobalHeader &global_header,
+                                          const float *row_data,
+                                          int32 num_cols, uint16 *data) {
+  const __m128 min_value = _mm_set1_ps(global_header.min_value),
+      range = _mm_set1_ps(global_header.range),
+      scale = _mm_set1_ps(65535.0f);
+  int32 c = 0;
+  for (; c + 4 <= num_cols; c += 4) {
+    __m128 f = NormalizeToUnit(_mm_loadu_ps(row_data + c), min_value, range);
+    int32 ans[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ans),
+                     RoundToInt(_mm_mul_ps(f, scale), 0.499));
+    for (int32 i = 0; i < 4; i++)
+      data[c + i] = static_cast<uint16>(ans[i]);
+  }
+  for (; c < num_cols; c++)
+    data[c] = FloatToUint16(global_header, row_data[c]);
+}
+
+template<>  // static
+void CompressedMatrix::CompressRowOneByte(const GlobalHeader &global_header,
+                                          const float *row_data,
+                                          int32 num_cols, uint8 *data) {
+  const __m128 min_value = _mm_set1_ps(global_header.min_value),
+      range = _mm_set1_ps(global_header.range),
+      scale = _mm_set1_ps(255.0f);
+  int32 c = 0;
+  for (; c + 4 <= num_cols; c += 4) {
+    __m128 f = NormalizeToUnit(_mm_loadu_ps(row_data + c), min_value, range);
+    int32 ans[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ans),
+                     RoundToInt(_mm_mul_ps(f, scale), 0.499));
+    for (int32 i = 0; i < 4; i++)
+      data[c + i] = static_cast<uint8>(ans[i]);
+  }
+  for (; c < num_cols; c++)
+    data[c] = FloatToUint8(global_header, row_data[c]);
+}
+
+template<>  // static
+void CompressedMatrix::CompressColumns(const GlobalHeader &global_header,
+                                       const MatrixBase<float> &mat,
+                                       PerColHeader *header_data,
+                                       uint8 *byte_data) {
+  int32 num_rows = global_header.num_rows, num_cols = global_header.num_cols;
+  // p[0 .. 3][c] are p0, p25, p75 and p100 for column c.
+  std::vector<float> p(4 * num_cols);
+  float *p0 = &(p[0]), *p25 = p0 + num_cols, *p75 = p25 + num_cols,
+      *p100 = p75 + num_cols;
+  for (int32 col = 0; col < num_cols; col++) {
+    PerColHeader *header = header_data + col;
+    ComputeColHeader(global_header, mat.Data() + col, mat.Stride(),
+                     num_rows, header);
+    p0[col] = Uint16ToFloat(global_header, header->percentile_0);
+    p25[col] = Uint16ToFloat(global_header, header->percentile_25);
+    p75[col] = Uint16ToFloat(global_header, header->percentile_75);
+    p100[col] = Uint16ToFloat(global_header, header->percentile_100);
+  }
+  const __m128 zero = _mm_setzero_ps(),
+      scale0 = _mm_set1_ps(64.0f), scale1 = _mm_set1_ps(128.0f),
+      scale2 = _mm_set1_ps(63.0f);
+  const __m128i offset1 = _mm_set1_epi32(64), offset2 = _mm_set1_epi32(192);
+  for (int32 r = 0; r < num_rows; r++) {
+    const float *row_data = mat.RowData(r);
+    int32 c = 0;
+    for (; c + 4 <= num_cols; c += 4) {
+      // This is FloatToChar() for 4 columns: we compute all three cases and
+      // select.  Clamping the product to [0, scale] before rounding is the
+      // same as clamping the result after.
+      __m128 value = _mm_loadu_ps(row_data + c),
+          q0 = _mm_loadu_ps(p0 + c), q25 = _mm_loadu_ps(p25 + c),
+          q75 = _mm_loadu_ps(p75 + c), q100 = _mm_loadu_ps(p100 + c);
+      __m128 f0 = _mm_div_ps(_mm_sub_ps(value, q0), _mm_sub_ps(q25, q0)),
+          f1 = _mm_div_ps(_mm_sub_ps(value, q25), _mm_sub_ps(q75, q25)),
+          f2 = _mm_div_ps(_mm_sub_ps(value, q75), _mm_sub_ps(q100, q75));
+      __m128i a0 = RoundToInt(_mm_max_ps(_mm_min_ps(
+          _mm_mul_ps(f0, scale0), scale0), zero), 0.5),
+          a1 = _mm_add_epi32(RoundToInt(_mm_max_ps(_mm_min_ps(
+              _mm_mul_ps(f1, scale1), scale1), zero), 0.5), offset1),
+          a2 = _mm_add_epi32(RoundToInt(_mm_max_ps(_mm_min_ps(
+              _mm_mul_ps(f2, scale2), scale2), zero), 0.5), offset2);
+      __m128i below25 = _mm_castps_si128(_mm_cmplt_ps(value, q25)),
+          below75 = _mm_castps_si128(_mm_cmplt_ps(value, q75));
+      __m128i a12 = _mm_or_si128(_mm_and_si128(below75, a1),
+                                 _mm_andnot_si128(below75, a2)),
+          ans = _mm_or_si128(_mm_and_si128(below25, a0),
+                             _mm_andnot_si128(below25, a12));
+      int32 ans_array[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(ans_array), ans);
+      for (int32 i = 0; i < 4; i++)
+        byte_data[(c + i) * num_rows + r] = static_cast<uint8>(ans_array[i]);
+    }
+    for (; c < num_cols; c++)
+      byte_data[c * num_rows + r] = FloatToChar(p0[c], p25[c], p75[c],
+                                                p100[c], row_data[c]);
+  }
+}
+#endif  // __SSE2__
+
 // static
 void* CompressedMatrix::AllocateData(int32 num_bytes) {
   KALDI_ASSERT(num_bytes > 0);
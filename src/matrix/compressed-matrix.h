@@ -248,6 +248,30 @@ class CompressedMatrix {
                                const Real *data, MatrixIndexT stride,
                                int32 num_rows, PerColHeader *header);
 
+  // Computes the column headers and compresses all the columns of 'mat' in
+  // the kOneByteWithColHeaders format; equivalent to calling CompressColumn()
+  // for each column, but for float it quantizes a row of several columns at a
+  // time with SSE2, where available.
+  template<typename Real>
+  static void CompressColumns(const GlobalHeader &global_header,
+                              const MatrixBase<Real> &mat,
+                              PerColHeader *header_data,
+                              uint8 *byte_data);
+
+  // Compresses a row of 'num_cols' elements in the kTwoByte format; the same
+  // as calling FloatToUint16() on each element, but vectorized for float.
+  template<typename Real>
+  static void CompressRowTwoByte(const GlobalHeader &global_header,
+                                 const Real *row_data, int32 num_cols,
+                                 uint16 *data);
+
+  // Compresses a row of 'num_cols' elements in the kOneByte format; the same
+  // as calling FloatToUint8() on each element, but vectorized for float.
+  template<typename Real>
+  static void CompressRowOneByte(const GlobalHeader &global_header,
+                                 const Real *row_data, int32 num_cols,
+                                 uint8 *data);
+
   static inline uint16 FloatToUint16(const GlobalHeader &global_header,
                                      float value);
 
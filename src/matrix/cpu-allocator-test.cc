@@ -0,0 +1,116 @@
+// matrix/cpu-allocator-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+#include <vector>
+#include "matrix/matrix-lib.h"
+#include "matrix/cpu-allocator.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+void UnitTestCpuAllocatorCache() {
+  bool cache_memory = g_cpu_allocator_options.cache_memory;
+  g_cpu_allocator_options.cache_memory = false;
+  // A block allocated while caching is off must be freed normally when it is
+  // on.
+  Matrix<BaseFloat> uncached(10, 10);
+  g_cpu_allocator_options.cache_memory = true;
+  uncached.Resize(0, 0);
+
+  CpuAllocatorStats stats = GetCpuAllocatorStats();
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_rows = RandInt(1, 100), num_cols = RandInt(1, 100);
+    {
+      Matrix<BaseFloat> mat(num_rows, num_cols);
+      KALDI_ASSERT(reinterpret_cast<size_t>(mat.Data()) % 16 == 0);
+      mat.SetRandn();
+    }
+    // This has the same size as 'mat' so it should come from the cache.
+    Matrix<BaseFloat> mat(num_rows, num_cols, kSetZero);
+    KALDI_ASSERT(mat.IsZero());
+    Vector<BaseFloat> vec(num_rows * num_cols);
+    KALDI_ASSERT(reinterpret_cast<size_t>(vec.Data()) % 16 == 0);
+    vec.SetRandn();
+  }
+  CpuAllocatorStats stats2 = GetCpuAllocatorStats();
+  KALDI_ASSERT(stats2.num_allocations - stats.num_allocations == 30 &&
+               stats2.num_hits - stats.num_hits >= 10 &&
+               stats2.bytes_cached > 0);
+  KALDI_LOG << stats2.Info();
+  CpuReleaseCachedMemory();
+  KALDI_ASSERT(GetCpuAllocatorStats().bytes_cached == 0);
+  g_cpu_allocator_options.cache_memory = cache_memory;
+}
+
+// Memory freed in another thread goes to that thread's cache, which is freed
+// when the thread exits.
+void UnitTestCpuAllocatorThreads() {
+  bool cache_memory = g_cpu_allocator_options.cache_memory;
+  g_cpu_allocator_options.cache_memory = true;
+  std::vector<Matrix<BaseFloat>*> mats;
+  for (int32 i = 0; i < 100; i++)
+    mats.push_back(new Matrix<BaseFloat>(RandInt(1, 50), RandInt(1, 50)));
+  std::vector<std::thread> threads;
+  for (int32 t = 0; t < 4; t++) {
+    threads.push_back(std::thread([&mats, t]() {
+          for (size_t i = t; i < mats.size(); i += 4) {
+            delete mats[i];
+            Matrix<BaseFloat> temp(10, 10);
+            temp.SetZero();
+          }
+        }));
+  }
+  for (size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+  CpuReleaseCachedMemory();
+  KALDI_ASSERT(GetCpuAllocatorStats().bytes_cached == 0);
+  g_cpu_allocator_options.cache_memory = cache_memory;
+}
+
+void UnitTestCpuAllocatorSpeed() {
+  bool cache_memory = g_cpu_allocator_options.cache_memory;
+  for (int32 i = 0; i < 2; i++) {
+    g_cpu_allocator_options.cache_memory = (i == 1);
+    Timer timer;
+    int32 num_iters = 20000;
+    for (int32 iter = 0; iter < num_iters; iter++) {
+      // Sizes typical of neural net computation.
+      Matrix<BaseFloat> a(150, 512, kUndefined), b(150, 1536, kUndefined),
+          c(50, 3000, kUndefined);
+    }
+    KALDI_LOG << "For cache_memory = " << (i == 1) << ", time per allocation "
+              << "was " << (timer.Elapsed() * 1.0e+06 / (num_iters * 3))
+              << " microseconds.";
+  }
+  CpuReleaseCachedMemory();
+  g_cpu_allocator_options.cache_memory = cache_memory;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestCpuAllocatorCache();
+  UnitTestCpuAllocatorThreads();
+  UnitTestCpuAllocatorSpeed();
+  KALDI_LOG << GetCpuAllocatorStats().Info();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,212 @@
+// matrix/cpu-allocator.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "matrix/cpu-allocator.h"
+
+namespace kaldi {
+
+CpuAllocatorOptions::CpuAllocatorOptions():
+    cache_memory(false), max_cached_mb(512) {
+  const char *env = getenv("KALDI_CPU_CACHE_MEMORY");
+  if (env != NULL && (!strcmp(env, "1") || !strcmp(env, "true")))
+    cache_memory = true;
+}
+
+CpuAllocatorOptions g_cpu_allocator_options;
+
+namespace {
+
+// Each block starts with a header of this size, which is a BlockHeader; the
+// user gets the memory after the header.  It is a multiple of the alignment,
+// so the user's memory stays aligned.
+const size_t kHeaderSize = 16;
+
+const int64 kNotCached = -1;
+
+struct BlockHeader {
+  int64 size_class;  // The size class, or kNotCached.
+  int64 size;  // The size of the block, not counting the header.
+};
+
+std::atomic<int64> num_allocations(0), num_hits(0),
+    bytes_cached(0), max_bytes_cached(0);
+
+// Rounds 'size' up to one of four sizes per power of two (so at most 25% of
+// the memory is wasted), and returns the index of that size.
+inline int64 GetSizeClass(size_t size, size_t *class_size) {
+  if (size <= 64) {
+    *class_size = 64;
+    return 0;
+  }
+  size_t s = size - 1;
+  int32 k = 6;  // s is in the range [2^k, 2^(k+1)).
+  while ((s >> (k + 1)) != 0)
+    k++;
+  size_t quarter = static_cast<size_t>(1) << (k - 2),
+      n = s / quarter + 1;  // 5, 6, 7 or 8.
+  *class_size = n * quarter;
+  return (k - 6) * 4 + (n - 4);
+}
+
+struct ThreadCache {
+  // Indexed by size class: the free blocks of that class (pointers to their
+  // headers).
+  std::vector<std::vector<char*> > free_blocks;
+  // The total size of the blocks in free_blocks.
+  int64 bytes;
+
+  ThreadCache(): bytes(0) { }
+  ~ThreadCache() { Release(); }
+
+  void Release() {
+    for (size_t c = 0; c < free_blocks.size(); c++) {
+      for (size_t i = 0; i < free_blocks[c].size(); i++)
+        KALDI_MEMALIGN_FREE(free_blocks[c][i]);
+      free_blocks[c].clear();
+    }
+    bytes_cached -= bytes;
+    bytes = 0;
+  }
+};
+
+// The cache of each thread.  We use a plain pointer, deleted by the destructor
+// of 'thread_cache_deleter', because memory may still be freed after the
+// thread-local objects are destroyed (e.g. by the destructors of static
+// matrices); in that case 'thread_cache_destroyed' is set and we don't cache.
+thread_local ThreadCache *thread_cache = NULL;
+thread_local bool thread_cache_destroyed = false;
+
+struct ThreadCacheDeleter {
+  ~ThreadCacheDeleter() {
+    delete thread_cache;
+    thread_cache = NULL;
+    thread_cache_destroyed = true;
+  }
+};
+thread_local ThreadCacheDeleter thread_cache_deleter;
+
+inline ThreadCache *GetThreadCache() {
+  if (thread_cache == NULL && !thread_cache_destroyed) {
+    // Using thread_cache_deleter makes sure it is constructed, so that its
+    // destructor will be called when the thread exits.
+    (void)&thread_cache_deleter;
+    thread_cache = new ThreadCache();
+  }
+  return thread_cache;
+}
+
+inline char *AllocateBlock(size_t size) {
+  void *data, *temp;
+  if ((data = KALDI_MEMALIGN(16, size + kHeaderSize, &temp)) == NULL)
+    throw std::bad_alloc();
+  return static_cast<char*>(data);
+}
+
+}  // namespace
+
+void* CpuMalloc(size_t size) {
+  KALDI_ASSERT(size > 0);
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  char *block;
+  int64 size_class = kNotCached;
+  ThreadCache *cache;
+  if (g_cpu_allocator_options.cache_memory &&
+      (cache = GetThreadCache()) != NULL) {
+    size_t class_size;
+    size_class = GetSizeClass(size, &class_size);
+    if (static_cast<size_t>(size_class) < cache->free_blocks.size() &&
+        !cache->free_blocks[size_class].empty()) {
+      block = cache->free_blocks[size_class].back();
+      cache->free_blocks[size_class].pop_back();
+      cache->bytes -= class_size;
+      bytes_cached.fetch_sub(class_size, std::memory_order_relaxed);
+      num_hits.fetch_add(1, std::memory_order_relaxed);
+      return block + kHeaderSize;
+    }
+    size = class_size;
+  }
+  block = AllocateBlock(size);
+  BlockHeader header;
+  header.size_class = size_class;
+  header.size = size;
+  memcpy(block, &header, sizeof(header));
+  return block + kHeaderSize;
+}
+
+void CpuFree(void *ptr) {
+  if (ptr == NULL)
+    return;
+  if (IsSharedMappedData(ptr))  // A matrix that points into a mapped file.
+    return;
+  char *block = static_cast<char*>(ptr) - kHeaderSize;
+  BlockHeader header;
+  memcpy(&header, block, sizeof(header));
+  int64 size_class = header.size_class, size = header.size;
+  ThreadCache *cache;
+  if (size_class != kNotCached && g_cpu_allocator_options.cache_memory &&
+      (cache = GetThreadCache()) != NULL) {
+    if (cache->bytes + size <=
+        static_cast<int64>(g_cpu_allocator_options.max_cached_mb) << 20) {
+      if (cache->free_blocks.size() <= static_cast<size_t>(size_class))
+        cache->free_blocks.resize(size_class + 1);
+      cache->free_blocks[size_class].push_back(block);
+      cache->bytes += size;
+      int64 cached = bytes_cached.fetch_add(size,
+                                            std::memory_order_relaxed) + size,
+          max_cached = max_bytes_cached.load(std::memory_order_relaxed);
+      while (cached > max_cached &&
+             !max_bytes_cached.compare_exchange_weak(max_cached, cached)) { }
+      return;
+    }
+  }
+  KALDI_MEMALIGN_FREE(block);
+}
+
+void CpuReleaseCachedMemory() {
+  if (thread_cache != NULL)
+    thread_cache->Release();
+}
+
+CpuAllocatorStats GetCpuAllocatorStats() {
+  CpuAllocatorStats stats;
+  stats.num_allocations = num_allocations;
+  stats.num_hits = num_hits;
+  stats.bytes_cached = bytes_cached;
+  stats.max_bytes_cached = max_bytes_cached;
+  return stats;
+}
+
+std::string CpuAllocatorStats::Info() const {
+  std::ostringstream os;
+  os << "CPU memory allocator: " << num_allocations << " allocations, of "
+     << "which " << num_hits << " ("
+     << (100.0 * num_hits / std::max<int64>(num_allocations, 1))
+     << "%) came from the cache; " << (bytes_cached >> 20) << " MB cached now, "
+     << (max_bytes_cached >> 20) << " MB at most.";
+  return os.str();
+}
+
+}  // namespace kaldi
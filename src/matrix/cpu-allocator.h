@@ -0,0 +1,104 @@
+// matrix/cpu-allocator.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_CPU_ALLOCATOR_H_
+#define KALDI_MATRIX_CPU_ALLOCATOR_H_ 1
+
+#include <string>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   Options for the allocator used for the memory of class Matrix and class
+   Vector (and of CuMatrix and CuVector when not using a GPU).  This is the
+   CPU counterpart of CuAllocatorOptions.
+
+   Caching is off by default.  It can be switched on by setting the
+   environment variable KALDI_CPU_CACHE_MEMORY=1 (which sets the default value
+   of cache_memory), or from the command line in programs that call
+   RegisterCpuAllocatorOptions().
+ */
+struct CpuAllocatorOptions {
+  // True if freed blocks of memory should be kept for reuse instead of being
+  // returned to the system.
+  bool cache_memory;
+
+  // The maximum number of megabytes that each thread keeps in its cache;
+  // memory freed when the cache is full is returned to the system.
+  int32 max_cached_mb;
+
+  CpuAllocatorOptions();
+
+  void Register(OptionsItf *po) {
+    po->Register("cpu-cache-memory", &cache_memory, "True if you want to "
+                 "cache the memory of freed CPU matrices and vectors for "
+                 "reuse; this saves time in programs that allocate many "
+                 "temporary matrices, such as neural net computation.  The "
+                 "default can be set with the environment variable "
+                 "KALDI_CPU_CACHE_MEMORY=1.");
+    po->Register("cpu-max-cached-mb", &max_cached_mb, "Maximum size in "
+                 "megabytes of the cache of each thread, if "
+                 "--cpu-cache-memory=true.");
+  }
+};
+
+extern CpuAllocatorOptions g_cpu_allocator_options;
+
+inline void RegisterCpuAllocatorOptions(OptionsItf *po) {
+  g_cpu_allocator_options.Register(po);
+}
+
+/// Statistics of the allocator, summed over all threads.
+struct CpuAllocatorStats {
+  int64 num_allocations;  // Number of calls to CpuMalloc().
+  int64 num_hits;  // Number of allocations served from the cache.
+  int64 bytes_cached;  // Number of bytes currently in the caches.
+  int64 max_bytes_cached;  // Maximum value that bytes_cached has had.
+
+  std::string Info() const;
+};
+
+/// Allocates 'size' bytes of memory aligned to 16 bytes, from the cache of
+/// the current thread if g_cpu_allocator_options.cache_memory is true and it
+/// has a suitable block.  Throws std::bad_alloc on failure.  size == 0 is not
+/// allowed.  The memory must be freed with CpuFree().
+void* CpuMalloc(size_t size);
+
+/// Frees memory allocated by CpuMalloc(), putting it in the cache of the
+/// current thread if caching is on and the cache is not full.  Memory that
+/// Matrix::Read() got from ShareMappedData() is ignored.
+void CpuFree(void *ptr);
+
+/// Returns the memory in the cache of the current thread to the system.  The
+/// cache of each thread is also freed when the thread exits.
+void CpuReleaseCachedMemory();
+
+/// Returns the statistics of the allocator.
+CpuAllocatorStats GetCpuAllocatorStats();
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_CPU_ALLOCATOR_H_
@@ -27,7 +27,9 @@
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/vectorized-math.h"
 
 static_assert(int(kaldi::kNoTrans) == int(CblasNoTrans) && int(kaldi::kTrans) == int(CblasTrans), 
     "kaldi::kNoTrans and kaldi::kTrans must be equal to the appropriate CBLAS library constants!");
@@ -794,8 +796,6 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   KALDI_ASSERT(rows > 0 && cols > 0);
   MatrixIndexT skip, stride;
   size_t size;
-  void *data;  // aligned memory block
-  void *temp;  // memory block to be really freed
 
   // compute the size of skip and real cols
   skip = ((16 / sizeof(Real)) - cols % (16 / sizeof(Real)))
@@ -804,15 +804,12 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   size = static_cast<size_t>(rows) * static_cast<size_t>(stride)
       * sizeof(Real);
 
-  // allocate the memory and set the right dimensions and parameters
-  if (NULL != (data = KALDI_MEMALIGN(16, size, &temp))) {
-    MatrixBase<Real>::data_        = static_cast<Real *> (data);
-    MatrixBase<Real>::num_rows_      = rows;
-    MatrixBase<Real>::num_cols_      = cols;
-    MatrixBase<Real>::stride_  = (stride_type == kDefaultStride ? stride : cols);
-  } else {
-    throw std::bad_alloc();
-  }
+  // allocate the (aligned) memory and set the right dimensions and
+  // parameters.  CpuMalloc() throws std::bad_alloc on failure.
+  MatrixBase<Real>::data_        = static_cast<Real *> (CpuMalloc(size));
+  MatrixBase<Real>::num_rows_      = rows;
+  MatrixBase<Real>::num_cols_      = cols;
+  MatrixBase<Real>::stride_  = (stride_type == kDefaultStride ? stride : cols);
 }
 
 template<typename Real>
@@ -1128,7 +1125,7 @@ template<typename Real>
 void Matrix<Real>::Destroy() {
   // we need to free the data block if it was defined
   if (NULL != MatrixBase<Real>::data_)
-    KALDI_MEMALIGN_FREE( MatrixBase<Real>::data_);
+    CpuFree(MatrixBase<Real>::data_);
   MatrixBase<Real>::data_ = NULL;
   MatrixBase<Real>::num_rows_ = MatrixBase<Real>::num_cols_
       = MatrixBase<Real>::stride_ = 0;
@@ -1384,6 +1381,21 @@ void MatrixBase<Real>::Write(std::ostream &os, bool binary) const {
     // since in binary mode we need to know if it's float or double.
     std::string my_token = (sizeof(Real) == 4 ? "FM" : "DM");
 
+    size_t num_bytes = sizeof(Real) * static_cast<size_t>(num_rows_) *
+        static_cast<size_t>(num_cols_);
+    std::streamoff pos;
+    if (GetAlignMatrixData() &&
+        num_bytes >= static_cast<size_t>(kMappedDataAlignment) &&
+        (pos = os.tellp()) >= 0) {
+      // Pad with spaces so that the data starts at a multiple of
+      // kMappedDataAlignment bytes.  What precedes it is the token and a
+      // space, and two int32's that take 5 bytes each.
+      int32 header_size = my_token.size() + 1 + 2 * (1 + sizeof(int32)),
+          padding = (kMappedDataAlignment - (pos + header_size) %
+                     kMappedDataAlignment) % kMappedDataAlignment;
+      for (int32 i = 0; i < padding; i++)
+        os.put(' ');
+    }
     WriteToken(os, binary, my_token);
     {
       int32 rows = this->num_rows_;  // make the size 32-bit on disk.
@@ -1469,6 +1481,7 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
   std::ostringstream specific_error;
 
   if (binary) {  // Read in binary mode.
+    // Peek() skips any padding written because of SetAlignMatrixData(true).
     int peekval = Peek(is, binary);
     if (peekval == 'C') {
       // This code enables us to read CompressedMatrix as a regular matrix.
@@ -1498,6 +1511,20 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
     int32 rows, cols;
     ReadBasicType(is, binary, &rows);  // throws on error.
     ReadBasicType(is, binary, &cols);  // throws on error.
+    if (rows > 0 && cols > 0) {
+      // If the stream is a memory-mapped file that allows it, point to the
+      // data instead of copying it.
+      char *shared = ShareMappedData(is, sizeof(Real) *
+                                     static_cast<size_t>(rows) * cols);
+      if (shared != NULL) {
+        Destroy();
+        this->data_ = reinterpret_cast<Real*>(shared);
+        this->num_rows_ = rows;
+        this->num_cols_ = cols;
+        this->stride_ = cols;
+        return;
+      }
+    }
     if ((MatrixIndexT)rows != this->num_rows_ || (MatrixIndexT)cols != this->num_cols_) {
       this->Resize(rows, cols);
     }
@@ -2118,10 +2145,8 @@ void MatrixBase<Real>::Exp(const MatrixBase<Real> &src) {
   Real *row_data = data_;
   const Real *src_row_data = src.Data();
   for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = kaldi::Exp(src_row_data[col]);
-  }
+       row++,row_data += stride_, src_row_data += src.stride_)
+    VectorizedExp(src_row_data, row_data, num_cols);
 }
 
 template<typename Real>
@@ -2163,10 +2188,8 @@ void MatrixBase<Real>::Floor(const MatrixBase<Real> &src, Real floor_val) {
   Real *row_data = data_;
   const Real *src_row_data = src.Data();
   for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = (src_row_data[col] < floor_val ? floor_val : src_row_data[col]);
-  }
+       row++,row_data += stride_, src_row_data += src.stride_)
+    VectorizedFloor(src_row_data, floor_val, row_data, num_cols);
 }
 
 template<typename Real>
@@ -2189,10 +2212,8 @@ void MatrixBase<Real>::Log(const MatrixBase<Real> &src) {
   Real *row_data = data_;
   const Real *src_row_data = src.Data();
   for (MatrixIndexT row = 0; row < num_rows;
-       row++,row_data += stride_, src_row_data += src.stride_) {
-    for (MatrixIndexT col = 0; col < num_cols; col++)
-      row_data[col] = kaldi::Log(src_row_data[col]);
-  }
+       row++,row_data += stride_, src_row_data += src.stride_)
+    VectorizedLog(src_row_data, row_data, num_cols);
 }
 
 template<typename Real>
@@ -2737,23 +2758,21 @@ Real MatrixBase<Real>::LogSumExp(Real prune) const {
 
   double sum_relto_max_elem = 0.0;
 
-  for (MatrixIndexT i = 0; i < num_rows_; i++) {
-    for (MatrixIndexT j = 0; j < num_cols_; j++) {
-      BaseFloat f = (*this)(i, j);
-      if (f >= cutoff)
-        sum_relto_max_elem += kaldi::Exp(f - max_elem);
-    }
-  }
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    sum_relto_max_elem += VectorizedExpSum(RowData(i), -max_elem, cutoff,
+                                           NULL, num_cols_);
   return max_elem + kaldi::Log(sum_relto_max_elem);
 }
 
 template<typename Real>
 Real MatrixBase<Real>::ApplySoftMax() {
-  Real max = this->Max(), sum = 0.0;
+  Real max = this->Max();
+  double sum = 0.0;
   // the 'max' helps to get in good numeric range.
   for (MatrixIndexT i = 0; i < num_rows_; i++)
-    for (MatrixIndexT j = 0; j < num_cols_; j++)
-      sum += ((*this)(i, j) = kaldi::Exp((*this)(i, j) - max));
+    sum += VectorizedExpSum(RowData(i), -max,
+                            -std::numeric_limits<Real>::infinity(),
+                            RowData(i), num_cols_);
   this->Scale(1.0 / sum);
   return max + kaldi::Log(sum);
 }
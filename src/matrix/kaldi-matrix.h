@@ -883,7 +883,10 @@ class Matrix : public MatrixBase<Real> {
   }
 
   /// read from stream.
-  // Unlike one in base, allows resizing.
+  // Unlike one in base, allows resizing.  If 'in' reads a memory-mapped file
+  // that allows it (see ShareMappedData() in base/io-funcs.h), the matrix may
+  // point into the file instead of owning its memory; its stride is then
+  // NumCols().
   void Read(std::istream & in, bool binary, bool add = false);
 
   /// Remove a specified row.
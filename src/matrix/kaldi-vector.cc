@@ -24,12 +24,15 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
 #include <string>
 #include "matrix/cblas-wrappers.h"
+#include "matrix/cpu-allocator.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/vectorized-math.h"
 
 namespace kaldi {
 
@@ -171,18 +174,10 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
     this->data_ = NULL;
     return;
   }
-  MatrixIndexT size;
-  void *data;
-  void *free_data;
-
-  size = dim * sizeof(Real);
-
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
-    this->data_ = static_cast<Real*> (data);
-    this->dim_ = dim;
-  } else {
-    throw std::bad_alloc();
-  }
+  size_t size = static_cast<size_t>(dim) * sizeof(Real);
+  // CpuMalloc() throws std::bad_alloc on failure.
+  this->data_ = static_cast<Real*> (CpuMalloc(size));
+  this->dim_ = dim;
 }
 
 
@@ -279,7 +274,7 @@ template<typename Real>
 void Vector<Real>::Destroy() {
   /// we need to free the data block if it was defined
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    CpuFree(this->data_);
   this->data_ = NULL;
   this->dim_ = 0;
 }
@@ -762,13 +757,8 @@ Real VectorBase<Real>::LogSumExp(Real prune) const {
   if (prune > 0.0 && max_elem - prune > cutoff) // explicit pruning...
     cutoff = max_elem - prune;
 
-  double sum_relto_max_elem = 0.0;
-
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    BaseFloat f = data_[i];
-    if (f >= cutoff)
-      sum_relto_max_elem += Exp(f - max_elem);
-  }
+  double sum_relto_max_elem = VectorizedExpSum(data_, -max_elem, cutoff,
+                                                NULL, dim_);
   return max_elem + Log(sum_relto_max_elem);
 }
 
@@ -781,26 +771,20 @@ void VectorBase<Real>::InvertElements() {
 
 template<typename Real>
 void VectorBase<Real>::ApplyLog() {
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    if (data_[i] < 0.0)
-      KALDI_ERR << "Trying to take log of a negative number.";
-    data_[i] = Log(data_[i]);
-  }
+  if (dim_ != 0 && Min() < 0.0)
+    KALDI_ERR << "Trying to take log of a negative number.";
+  VectorizedLog(data_, data_, dim_);
 }
 
 template<typename Real>
 void VectorBase<Real>::ApplyLogAndCopy(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.Dim());
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] = Log(v(i));
-  }
+  VectorizedLog(v.data_, data_, dim_);
 }
 
 template<typename Real>
 void VectorBase<Real>::ApplyExp() {
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    data_[i] = Exp(data_[i]);
-  }
+  VectorizedExp(data_, data_, dim_);
 }
 
 template<typename Real>
@@ -812,9 +796,7 @@ template<typename Real>
 void VectorBase<Real>::Floor(const VectorBase<Real> &v, Real floor_val, MatrixIndexT *floored_count) {
   KALDI_ASSERT(dim_ == v.dim_);
   if (floored_count == nullptr) {
-    for (MatrixIndexT i = 0; i < dim_; i++) {
-      data_[i] = std::max(v.data_[i], floor_val);
-    }
+    VectorizedFloor(v.data_, floor_val, data_, dim_);
   } else {
     MatrixIndexT num_floored = 0;
     for (MatrixIndexT i = 0; i < dim_; i++) {
@@ -865,21 +847,21 @@ MatrixIndexT VectorBase<Real>::ApplyFloor(const VectorBase<Real> &floor_vec) {
 
 template<typename Real>
 Real VectorBase<Real>::ApplySoftMax() {
-  Real max = this->Max(), sum = 0.0;
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    sum += (data_[i] = Exp(data_[i] - max));
-  }
+  Real max = this->Max(),
+      sum = VectorizedExpSum(data_, -max,
+                             -std::numeric_limits<Real>::infinity(),
+                             data_, dim_);
   this->Scale(1.0 / sum);
   return max + Log(sum);
 }
 
 template<typename Real>
 Real VectorBase<Real>::ApplyLogSoftMax() {
-  Real max = this->Max(), sum = 0.0;
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    sum += Exp((data_[i] -= max));
-  }
-  sum = Log(sum);
+  Real max = this->Max();
+  this->Add(-max);
+  Real sum = Log(VectorizedExpSum(data_, 0.0,
+                                  -std::numeric_limits<Real>::infinity(),
+                                  NULL, dim_));
   this->Add(-1.0 * sum);
   return max + sum;
 }
@@ -899,17 +881,7 @@ void VectorBase<double>::Tanh(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    if (x > 0.0) {
-      Real inv_expx = Exp(-x);
-      x = -1.0 + 2.0 / (1.0 + inv_expx * inv_expx);
-    } else {
-      Real expx = Exp(x);
-      x = 1.0 - 2.0 / (1.0 + expx * expx);
-    }
-    data_[i] = x;
-  }
+  VectorizedTanh(src.data_, data_, dim_);
 }
 #endif
 
@@ -937,17 +909,7 @@ void VectorBase<double>::Sigmoid(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    Real x = src.data_[i];
-    // We aim to avoid floating-point overflow here.
-    if (x > 0.0) {
-      x = 1.0 / (1.0 + Exp(-x));
-    } else {
-      Real ex = Exp(x);
-      x = ex / (ex + 1.0);
-    }
-    data_[i] = x;
-  }
+  VectorizedSigmoid(src.data_, data_, dim_);
 }
 #endif
 
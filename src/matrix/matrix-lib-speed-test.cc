@@ -24,6 +24,7 @@
 #include "matrix/matrix-lib.h"
 #include "base/timer.h"
 #include <numeric>
+#include <sstream>
 
 namespace kaldi {
 
@@ -254,6 +255,124 @@ static void UnitTestAddVecToColsSpeed() {
   CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
 }
 
+template<typename Real>
+static void UnitTestElementwiseFunctionsSpeed() {
+  Timer t;
+  std::vector<MatrixIndexT> sizes;
+  int32 size = 16, num = 4;
+  for(int32 i = 0; i < num; i++) {
+    sizes.push_back(size);
+    size *= 4;
+  }
+
+  const char *names[] = { "Exp", "Log", "Sigmoid", "Tanh", "Floor",
+                          "ApplySoftMax", "LogSumExp" };
+  for(size_t i = 0; i < sizes.size(); i++) {
+    MatrixIndexT size = sizes[i];
+    Matrix<Real> M(size, size), N(size, size);
+    M.SetRandn();
+    for (int32 f = 0; f < 7; f++) {
+      if (f == 1)
+        M.ApplyPowAbs(1.0);  // log needs positive numbers.
+      if (f == 5)
+        N.CopyFromMat(M);
+      int32 iter = 0;
+      BaseFloat time_in_secs = 0.02;
+      Timer t1;
+      for (;t1.Elapsed() < time_in_secs; iter++) {
+        switch (f) {
+          case 0: N.Exp(M); break;
+          case 1: N.Log(M); break;
+          case 2: N.Sigmoid(M); break;
+          case 3: N.Tanh(M); break;
+          case 4: N.Floor(M, 0.1); break;
+          case 5: N.ApplySoftMax(); break;
+          default: M.LogSumExp();
+        }
+      }
+      BaseFloat fdim = size;
+      BaseFloat gflops = (fdim * fdim * iter) / (t1.Elapsed() * 1.0e+09);
+      CsvResult<Real>(names[f], size, gflops, "giga-elements/sec");
+    }
+  }
+  CsvResult<Real>(__func__, sizes.size(), t.Elapsed(), "seconds");
+}
+
+// Compares the built-in small-matrix GEMM with the BLAS library, for products
+// of a num_rows by dim matrix with a dim by dim matrix, and prints the
+// crossover point, which can be used as --small-gemm-threshold.
+template<typename Real>
+static void UnitTestSmallGemmSpeed() {
+  Timer t;
+  int32 threshold = g_small_gemm_options.threshold;
+  // The smallest size at which BLAS was faster, for a single row (index 0)
+  // and for more rows (index 1).
+  int64 crossover[2] = { -1, -1 };
+  for (int32 num_rows = 1; num_rows <= 64; num_rows *= 4) {
+    for (int32 dim = 8; dim <= 512; dim *= 2) {
+      Matrix<Real> A(num_rows, dim), B(dim, dim), C(num_rows, dim);
+      A.SetRandn();
+      B.SetRandn();
+      BaseFloat gflops[2];
+      for (int32 builtin = 0; builtin < 2; builtin++) {
+        g_small_gemm_options.threshold = (builtin ? -1 : 0);
+        int32 iter = 0;
+        BaseFloat time_in_secs = 0.02;
+        Timer t1;
+        for (;t1.Elapsed() < time_in_secs; iter++)
+          C.AddMatMat(1.0, A, kNoTrans, B, kTrans, 0.0);
+        gflops[builtin] = (2.0 * num_rows * dim * dim * iter) /
+            (t1.Elapsed() * 1.0e+09);
+      }
+      std::ostringstream name;
+      name << "SmallGemm-" << num_rows << "xN";
+      CsvResult<Real>(name.str() + "-builtin", dim, gflops[1], "gigaflops");
+      CsvResult<Real>(name.str() + "-blas", dim, gflops[0], "gigaflops");
+      int64 size = static_cast<int64>(num_rows) * dim * dim;
+      int32 c = (num_rows == 1 ? 0 : 1);
+      if (gflops[1] < gflops[0] && (crossover[c] < 0 || size < crossover[c]))
+        crossover[c] = size;
+    }
+  }
+  g_small_gemm_options.threshold = threshold;
+  KALDI_LOG << "For " << NameOf<Real>() << ", BLAS was faster than the "
+            << "built-in GEMM for num-rows * num-cols * inner-dim >= "
+            << crossover[1] << " (threshold is " << threshold << "), and "
+            << "for a single row, from " << crossover[0] << " (threshold is "
+            << g_small_gemm_options.single_row_threshold << "); -1 means "
+            << "never.";
+  CsvResult<Real>(__func__, 0, t.Elapsed(), "seconds");
+}
+
+// Compares AddMatQuantizedMatTrans() with float matrix multiplication, for
+// sizes typical of TDNN-F layers.
+static void UnitTestAddMatQuantizedMatTransSpeed() {
+  Timer t;
+  int32 num_rows = 64, dim = 1024, num_out = 1024, num_iters = 5;
+  Matrix<BaseFloat> A(num_rows, dim), B(num_out, dim), C(num_rows, num_out);
+  A.SetRandn();
+  B.SetRandn();
+  QuantizedMatrix qB(B);
+  Timer t1;
+  for (int32 i = 0; i < num_iters; i++)
+    C.AddMatMat(1.0, A, kNoTrans, B, kTrans, 0.0);
+  double float_time = t1.Elapsed();
+  t1.Reset();
+  for (int32 i = 0; i < num_iters; i++) {
+    C.SetZero();
+    AddMatQuantizedMatTrans(1.0, A, qB, &C);
+  }
+  double quantized_time = t1.Elapsed();
+  double gflops = 2.0 * num_rows * dim * num_out * num_iters / 1.0e+09;
+  KALDI_LOG << "For " << num_rows << " x " << dim << " times " << dim
+            << " x " << num_out << ", float: " << (gflops / float_time)
+            << " GFlops, quantized (" << QuantizedMatrixInstructionSet()
+            << "): " << (gflops / quantized_time) << " GOps.";
+  CsvResult<BaseFloat>("AddMatQuantizedMatTrans", dim,
+                       gflops / quantized_time, "GOps");
+  CsvResult<BaseFloat>(__func__, 1, t.Elapsed(), "seconds");
+}
+
 template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestRealFftSpeed<Real>();
   UnitTestSplitRadixRealFftSpeed<Real>();
@@ -263,6 +382,8 @@ template<typename Real> static void MatrixUnitSpeedTest() {
   UnitTestAddColSumMatSpeed<Real>();
   UnitTestAddVecToRowsSpeed<Real>();
   UnitTestAddVecToColsSpeed<Real>();
+  UnitTestElementwiseFunctionsSpeed<Real>();
+  UnitTestSmallGemmSpeed<Real>();
 }
 
 } // namespace kaldi
@@ -272,6 +393,7 @@ int main() {
   Timer t;
   KALDI_LOG << "Starting, Single precision";
   kaldi::MatrixUnitSpeedTest<float>();
+  kaldi::UnitTestAddMatQuantizedMatTransSpeed();
   KALDI_LOG << "Starting, Double precision";
   kaldi::MatrixUnitSpeedTest<double>();
   KALDI_LOG << "Tests succeeded, total duration " << t.Elapsed() << " seconds.";
@@ -2610,6 +2610,48 @@ template<typename Real> static void UnitTestIoCross() {  // across types.
   }
 }
 
+// Checks that matrices written with SetAlignMatrixData(true), which are
+// preceded by padding, can be read by all the readers that peek at the
+// matrix's token: as the other precision, compressed or as a GeneralMatrix.
+template<typename Real> static void UnitTestIoAlignedMatrix() {
+  typedef typename OtherReal<Real>::Real Other;
+  Matrix<Real> big(100, 30), small(2, 3);
+  big.SetRandn();
+  small.SetRandn();
+  std::ostringstream os;
+  SetAlignMatrixData(true);
+  WriteToken(os, true, "<Foo>");
+  for (int32 i = 0; i < 4; i++) {
+    big.Write(os, true);
+    small.Write(os, true);
+  }
+  SetAlignMatrixData(false);
+  // The token "<Foo> " is followed by padding.
+  KALDI_ASSERT(os.str()[6] == ' ');
+
+  std::istringstream is(os.str());
+  ExpectToken(is, true, "<Foo>");
+  Matrix<Real> a;
+  Matrix<Other> b;
+  a.Read(is, true);
+  AssertEqual(a, big);
+  a.Read(is, true);
+  AssertEqual(a, small);
+  b.Read(is, true);
+  AssertEqual(Matrix<Real>(b), big);
+  b.Read(is, true);
+  AssertEqual(Matrix<Real>(b), small);
+  CompressedMatrix cmat;
+  cmat.Read(is, true);
+  KALDI_ASSERT(cmat.NumRows() == big.NumRows());
+  cmat.Read(is, true);
+  GeneralMatrix gmat;
+  gmat.Read(is, true);
+  AssertEqual(Matrix<Real>(gmat.GetFullMatrix()), big);
+  a.Read(is, true);
+  AssertEqual(a, small);
+}
+
 
 template<typename Real> static void UnitTestHtkIo() {
 
@@ -4054,6 +4096,68 @@ template<typename Real> static void UnitTestCompressedMatrix2() {
 }
 
 
+// Checks that compressing a float matrix, which uses SSE2 code where it is
+// available, gives exactly the same result as compressing the same matrix in
+// double, which uses the generic code; including for values where the code
+// chosen depends on the precision in which 0.5 is added when rounding.
+static void UnitTestCompressedMatrixRounding() {
+  // The matrix has minimum 0 and maximum 65535, so the percentiles of each
+  // column below are stored as the codes 0, 1, 2 and 3, which decompress to
+  // p(0) == 0, p(1), p(2) and p(3), computed as in Uint16ToFloat().
+  const float k = 65535.0f * 1.52590218966964e-05F, p0 = 0.0f,
+      p25 = p0 + k * 1.0f;
+  // Find values x in [p0, p25) with float(f * 64) equal to the largest float
+  // below 0.5, for f = (x - p0) / (p25 - p0).  They should get code 0.
+  const float below_half = 0.49999997f;
+  std::vector<float> boundary_values;
+  float x = 0.5f / 64.0f * (p25 - p0);
+  for (int32 i = 0; i < 1000; i++)
+    x = nextafterf(x, 0.0f);
+  for (int32 i = 0; i < 2000 && boundary_values.size() < 8; i++) {
+    float f = (x - p0) / (p25 - p0);
+    if (f * 64.0f == below_half)
+      boundary_values.push_back(x);
+    x = nextafterf(x, 1.0f);
+  }
+  KALDI_ASSERT(!boundary_values.empty());
+
+  // We need at least 4 columns for the SSE2 code to be used.
+  int32 num_rows = 8, num_cols = 9;
+  Matrix<float> mat(num_rows, num_cols);
+  for (int32 c = 0; c + 1 < num_cols; c++) {
+    // Rows 0, 2, 6 and 7 give the percentiles.
+    float column[] = { 0.0f, boundary_values[c % boundary_values.size()],
+                       1.0f, 1.25f, 1.5f, 1.75f, 2.0f, 3.0f };
+    for (int32 r = 0; r < num_rows; r++)
+      mat(r, c) = column[r];
+  }
+  mat(num_rows - 1, num_cols - 1) = 65535.0f;
+  CompressedMatrix cmat(mat, kSpeechFeature);
+  Matrix<float> mat2(cmat);
+  for (int32 c = 0; c + 1 < num_cols; c++)
+    KALDI_ASSERT(mat2(1, c) == p0);
+
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_rows = RandInt(1, 20), num_cols = RandInt(1, 20);
+    Matrix<float> mat(num_rows, num_cols);
+    mat.SetRandn();
+    if (i % 2 == 0) {
+      // Values on a coarse grid hit the rounding boundaries more often.
+      for (int32 r = 0; r < num_rows; r++)
+        for (int32 c = 0; c < num_cols; c++)
+          mat(r, c) = RandInt(-8, 8) / 4.0f;
+    }
+    Matrix<double> dmat(mat);
+    CompressionMethod methods[] = { kTwoByteAuto, kOneByteAuto,
+                                    kSpeechFeature };
+    for (int32 m = 0; m < 3; m++) {
+      CompressedMatrix cmat(mat, methods[m]), dcmat(dmat, methods[m]);
+      Matrix<float> mat2(cmat), mat3(dcmat);
+      KALDI_ASSERT(mat2.ApproxEqual(mat3, 0.0));
+    }
+  }
+}
+
 template<typename Real> static void UnitTestCompressedMatrix() {
   // This is the basic test.
 
@@ -4602,6 +4706,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   // UnitTestSvdBad<Real>(); // test bug in Jama SVD code.
   UnitTestCompressedMatrix<Real>();
   UnitTestCompressedMatrix2<Real>();
+  UnitTestCompressedMatrixRounding();
   UnitTestExtractCompressedMatrix<Real>();
   UnitTestResize<Real>();
   UnitTestResizeCopyDataDifferentStrideType<Real>();
@@ -4635,6 +4740,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestTpInvert<Real>();
   UnitTestIo<Real>();
   UnitTestIoCross<Real>();
+  UnitTestIoAlignedMatrix<Real>();
   UnitTestHtkIo<Real>();
   UnitTestScale<Real>();
   UnitTestTrace<Real>();
@@ -31,6 +31,11 @@
 #include "matrix/srfft.h"
 #include "matrix/compressed-matrix.h"
 #include "matrix/sparse-matrix.h"
+#include "matrix/quantized-matrix.h"
+#include "matrix/block-sparse-matrix.h"
+#include "matrix/cpu-allocator.h"
+#include "matrix/small-gemm.h"
+#include "matrix/vectorized-math.h"
 #include "matrix/optimization.h"
 
 #endif
@@ -0,0 +1,84 @@
+// matrix/quantized-matrix-inl.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is only to be included by quantized-matrix.cc, once for each
+// instruction set, inside a namespace that defines a struct 'Ops' with the
+// SIMD operations for that instruction set (see quantized-matrix.cc).  It
+// defines the function AddQuantizedProducts() in that namespace.  There is
+// deliberately no include guard.
+
+// Computes the dot products of the quantized row x with the N quantized rows
+// starting at w, whose stride is 'w_stride'.  'len' is a multiple of
+// QuantizedMatrix::kAlignment.  'w_row_sums' are the sums of the rows of w,
+// which we need to correct for Ops::kXOffset.
+template<int32 N>
+static inline void DotProducts(const int8 *x, const int8 *w, int32 w_stride,
+                               int32 len, const int32 *w_row_sums,
+                               int32 *out) {
+  typename Ops::Acc acc[N];
+  for (int32 j = 0; j < N; j++)
+    acc[j] = Ops::Zero();
+  for (int32 k = 0; k < len; k += Ops::kStep) {
+    typename Ops::X xv = Ops::LoadX(x + k);
+    for (int32 j = 0; j < N; j++)
+      acc[j] = Ops::Accumulate(acc[j], xv, w + j * w_stride + k);
+  }
+  for (int32 j = 0; j < N; j++)
+    out[j] = Ops::Sum(acc[j]) - Ops::kXOffset * w_row_sums[j];
+}
+
+// Does the columns [r, r + N) of C += alpha * A * B^T, where A has been
+// quantized to a_data (with stride B.Stride()) and a_scales.
+template<int32 N>
+static void AddMatQuantizedMatTransBlock(BaseFloat alpha,
+                                         const int8 *a_data,
+                                         const BaseFloat *a_scales,
+                                         const QuantizedMatrix &B, int32 r,
+                                         MatrixBase<BaseFloat> *C) {
+  int32 stride = B.Stride();
+  BaseFloat b_scales[N];
+  int32 b_row_sums[N], dots[N];
+  for (int32 j = 0; j < N; j++) {
+    b_scales[j] = alpha * B.Scale(r + j);
+    b_row_sums[j] = B.RowSum(r + j);
+  }
+  const int8 *b_data = B.RowData(r);
+  int32 num_rows = C->NumRows();
+  for (int32 t = 0; t < num_rows; t++) {
+    DotProducts<N>(a_data + t * stride, b_data, stride, stride, b_row_sums,
+                   dots);
+    BaseFloat *c_row = C->RowData(t) + r, a_scale = a_scales[t];
+    for (int32 j = 0; j < N; j++)
+      c_row[j] += a_scale * b_scales[j] * dots[j];
+  }
+}
+
+// Does C += alpha * A * B^T, given A quantized as in AddMatQuantizedMatTrans().
+static void AddQuantizedProducts(BaseFloat alpha, const int8 *a_data,
+                                 const BaseFloat *a_scales,
+                                 const QuantizedMatrix &B,
+                                 MatrixBase<BaseFloat> *C) {
+  // Each block of 4 rows of B (a few kilobytes) stays in the L1 cache while we
+  // go through all the rows of A.
+  int32 num_out = B.NumRows(), r = 0;
+  for (; r + 4 <= num_out; r += 4)
+    AddMatQuantizedMatTransBlock<4>(alpha, a_data, a_scales, B, r, C);
+  for (; r < num_out; r++)
+    AddMatQuantizedMatTransBlock<1>(alpha, a_data, a_scales, B, r, C);
+}
@@ -0,0 +1,109 @@
+// matrix/quantized-matrix-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+void UnitTestQuantizedMatrixCopy() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_rows = RandInt(0, 20), num_cols = RandInt(0, 70);
+    Matrix<BaseFloat> mat(num_rows, num_cols);
+    mat.SetRandn();
+    if (num_rows > 0)
+      mat.Row(0).SetZero();
+    QuantizedMatrix qmat(mat);
+    KALDI_ASSERT(qmat.NumRows() == num_rows && qmat.NumCols() == num_cols);
+    Matrix<BaseFloat> mat2(num_rows, num_cols);
+    qmat.CopyToMat(&mat2);
+    for (int32 r = 0; r < num_rows; r++) {
+      // The error is at most half a quantization step.
+      BaseFloat max_abs = mat.Row(r).Max();
+      max_abs = std::max(max_abs, -mat.Row(r).Min());
+      for (int32 c = 0; c < num_cols; c++)
+        KALDI_ASSERT(std::abs(mat(r, c) - mat2(r, c)) <=
+                     0.5001 * max_abs / 127.0);
+    }
+    for (int32 j = 0; j < 2; j++) {
+      bool binary = (j == 0);
+      std::ostringstream os;
+      qmat.Write(os, binary);
+      QuantizedMatrix qmat2;
+      std::istringstream is(os.str());
+      qmat2.Read(is, binary);
+      Matrix<BaseFloat> mat3(num_rows, num_cols);
+      qmat2.CopyToMat(&mat3);
+      AssertEqual(mat2, mat3);
+      for (int32 r = 0; r < num_rows; r++)
+        KALDI_ASSERT(qmat.RowSum(r) == qmat2.RowSum(r));
+    }
+  }
+}
+
+void UnitTestAddMatQuantizedMatTrans() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_rows = RandInt(1, 30), dim = RandInt(1, 300),
+        num_out = RandInt(1, 30);
+    Matrix<BaseFloat> A(num_rows, dim), B(num_out, dim),
+        C(num_rows, num_out);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    if (i % 2 == 0)  // like the output of a ReLU.
+      A.ApplyFloor(0.0);
+    Matrix<BaseFloat> C2(C);
+    BaseFloat alpha = 0.5;
+    C.AddMatMat(alpha, A, kNoTrans, B, kTrans, 1.0);
+    QuantizedMatrix qB(B);
+    AddMatQuantizedMatTrans(alpha, A, qB, &C2);
+    // Compare the error with the result of multiplying the (dequantized)
+    // matrices; the errors from quantizing A and B are random and partly
+    // cancel out, so we expect much less than 1%.
+    Matrix<BaseFloat> diff(C);
+    diff.AddMat(-1.0, C2);
+    Matrix<BaseFloat> prod(num_rows, num_out);
+    prod.AddMatMat(alpha, A, kNoTrans, B, kTrans, 0.0);
+    KALDI_ASSERT(diff.FrobeniusNorm() <= 0.02 * prod.FrobeniusNorm() + 1.0e-05);
+  }
+  // An exact case: integer values that quantize without error.
+  Matrix<BaseFloat> A(3, 40), B(5, 40), C(3, 5), C2(3, 5);
+  for (int32 r = 0; r < 3; r++) {
+    for (int32 c = 0; c < 40; c++)
+      A(r, c) = RandInt(-127, 127);
+    A(r, 0) = 127;
+  }
+  for (int32 r = 0; r < 5; r++) {
+    for (int32 c = 0; c < 40; c++)
+      B(r, c) = RandInt(-127, 127);
+    B(r, 1) = -127;
+  }
+  C.AddMatMat(1.0, A, kNoTrans, B, kTrans, 0.0);
+  AddMatQuantizedMatTrans(1.0, A, QuantizedMatrix(B), &C2);
+  KALDI_ASSERT(C.ApproxEqual(C2, 1.0e-05));
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestQuantizedMatrixCopy();
+  UnitTestAddMatQuantizedMatTrans();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,405 @@
+// matrix/quantized-matrix.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/quantized-matrix.h"
+#include <algorithm>
+#include <cmath>
+
+// As in vectorized-math.cc, the AVX2 and VNNI code is compiled with GCC's
+// target pragmas and whether it is used is decided at run time.  SSE2 is
+// always available on x86-64.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+  (__GNUC__ >= 6)
+#define KALDI_QUANTIZED_X86 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace kaldi {
+
+// Quantizes the 'dim' elements of x to q and returns the scale.
+template<typename Real>
+static inline BaseFloat QuantizeRow(const Real *x, int32 dim, int8 *q) {
+  Real max_abs = 0.0;
+  for (int32 i = 0; i < dim; i++)
+    max_abs = std::max(max_abs, std::abs(x[i]));
+  if (max_abs == 0.0) {
+    std::fill(q, q + dim, 0);
+    return 0.0;
+  }
+  BaseFloat inv_scale = 127.0 / max_abs;
+  for (int32 i = 0; i < dim; i++) {
+    BaseFloat f = x[i] * inv_scale;
+    // This also maps NaN to -127, avoiding undefined behavior in the cast.
+    f = (f >= -127.0f ? (f <= 127.0f ? f : 127.0f) : -127.0f);
+    q[i] = static_cast<int8>(std::floor(f + 0.5f));
+  }
+  return max_abs / 127.0;
+}
+
+void QuantizedMatrix::Resize(int32 num_rows, int32 num_cols) {
+  KALDI_ASSERT(num_rows >= 0 && num_cols >= 0);
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  stride_ = kAlignment * ((num_cols + kAlignment - 1) / kAlignment);
+  data_.assign(static_cast<size_t>(num_rows) * stride_, 0);
+  scales_.assign(num_rows, 0.0);
+  row_sums_.assign(num_rows, 0);
+}
+
+void QuantizedMatrix::ComputeRowSums() {
+  for (int32 r = 0; r < num_rows_; r++) {
+    const int8 *row = RowData(r);
+    int32 sum = 0;
+    for (int32 c = 0; c < num_cols_; c++)
+      sum += row[c];
+    row_sums_[r] = sum;
+  }
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyFromMat(const MatrixBase<Real> &mat) {
+  Resize(mat.NumRows(), mat.NumCols());
+  for (int32 r = 0; r < num_rows_; r++)
+    scales_[r] = QuantizeRow(mat.RowData(r), num_cols_,
+                             &(data_[0]) + r * stride_);
+  ComputeRowSums();
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (int32 r = 0; r < num_rows_; r++) {
+    const int8 *row = RowData(r);
+    Real *out = mat->RowData(r), scale = scales_[r];
+    for (int32 c = 0; c < num_cols_; c++)
+      out[c] = scale * row[c];
+  }
+}
+
+template void QuantizedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+template void QuantizedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+template void QuantizedMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template void QuantizedMatrix::CopyToMat(MatrixBase<double> *mat) const;
+
+void QuantizedMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedMatrix>");
+  WriteBasicType(os, binary, num_rows_);
+  WriteBasicType(os, binary, num_cols_);
+  for (int32 r = 0; r < num_rows_; r++) {
+    WriteBasicType(os, binary, scales_[r]);
+    const int8 *row = RowData(r);
+    if (binary) {
+      os.write(reinterpret_cast<const char*>(row), num_cols_);
+    } else {
+      for (int32 c = 0; c < num_cols_; c++)
+        WriteBasicType(os, binary, static_cast<int32>(row[c]));
+      os << '\n';
+    }
+  }
+  WriteToken(os, binary, "</QuantizedMatrix>");
+  if (!os.good())
+    KALDI_ERR << "Error writing QuantizedMatrix to stream.";
+}
+
+void QuantizedMatrix::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<QuantizedMatrix>");
+  int32 num_rows, num_cols;
+  ReadBasicType(is, binary, &num_rows);
+  ReadBasicType(is, binary, &num_cols);
+  if (num_rows < 0 || num_cols < 0)
+    KALDI_ERR << "Bad size in QuantizedMatrix: " << num_rows << " by "
+              << num_cols;
+  Resize(num_rows, num_cols);
+  for (int32 r = 0; r < num_rows_; r++) {
+    ReadBasicType(is, binary, &(scales_[r]));
+    int8 *row = &(data_[0]) + r * stride_;
+    if (binary) {
+      is.read(reinterpret_cast<char*>(row), num_cols_);
+    } else {
+      for (int32 c = 0; c < num_cols_; c++) {
+        int32 i;
+        ReadBasicType(is, binary, &i);
+        if (i < -127 || i > 127)
+          KALDI_ERR << "Bad value in QuantizedMatrix: " << i;
+        row[c] = static_cast<int8>(i);
+      }
+    }
+  }
+  ExpectToken(is, binary, "</QuantizedMatrix>");
+  if (!is.good())
+    KALDI_ERR << "Error reading QuantizedMatrix from stream.";
+  ComputeRowSums();
+}
+
+void QuantizedMatrix::Swap(QuantizedMatrix *other) {
+  std::swap(num_rows_, other->num_rows_);
+  std::swap(num_cols_, other->num_cols_);
+  std::swap(stride_, other->stride_);
+  data_.swap(other->data_);
+  scales_.swap(other->scales_);
+  row_sums_.swap(other->row_sums_);
+}
+
+
+#ifndef __SSE2__
+
+namespace generic {
+
+struct Ops {
+  typedef int32 Acc;
+  typedef int32 X;
+  static const int32 kStep = 1, kXOffset = 0;
+  static inline Acc Zero() { return 0; }
+  static inline X LoadX(const int8 *x) { return *x; }
+  static inline Acc Accumulate(Acc acc, X x, const int8 *w) {
+    return acc + x * static_cast<int32>(*w);
+  }
+  static inline int32 Sum(Acc acc) { return acc; }
+};
+
+#include "matrix/quantized-matrix-inl.h"
+
+}  // namespace generic
+
+#else
+
+
+namespace sse2 {
+
+// Sign-extends the 16 bytes of v to 16 bits, by unpacking each byte into the
+// high half and shifting right arithmetically.
+static inline void SignExtend(__m128i v, __m128i *lo, __m128i *hi) {
+  *lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+  *hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+}
+
+struct Ops {
+  typedef __m128i Acc;
+  struct X { __m128i lo, hi; };
+  static const int32 kStep = 16, kXOffset = 0;
+  static inline Acc Zero() { return _mm_setzero_si128(); }
+  static inline X LoadX(const int8 *x) {
+    X ans;
+    SignExtend(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)),
+               &ans.lo, &ans.hi);
+    return ans;
+  }
+  // _mm_madd_epi16 multiplies and adds adjacent pairs to 32 bits, which
+  // cannot overflow.
+  static inline Acc Accumulate(Acc acc, const X &x, const int8 *w) {
+    __m128i w_lo, w_hi;
+    SignExtend(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w)),
+               &w_lo, &w_hi);
+    return _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(x.lo, w_lo),
+                                            _mm_madd_epi16(x.hi, w_hi)));
+  }
+  static inline int32 Sum(Acc s) {
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+  }
+};
+
+#include "matrix/quantized-matrix-inl.h"
+
+}  // namespace sse2
+
+#endif  // __SSE2__
+
+#ifdef KALDI_QUANTIZED_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace avx2 {
+
+static inline int32 HorizontalSum(__m256i v) {
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),
+                            _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+struct Ops {
+  typedef __m256i Acc;
+  typedef __m256i X;
+  static const int32 kStep = 16, kXOffset = 0;
+  static inline Acc Zero() { return _mm256_setzero_si256(); }
+  // Sign-extends 16 bytes to 16 bits.
+  static inline X LoadX(const int8 *x) {
+    return _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+  }
+  static inline Acc Accumulate(Acc acc, X x, const int8 *w) {
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(x, LoadX(w)));
+  }
+  static inline int32 Sum(Acc acc) { return HorizontalSum(acc); }
+};
+
+#include "matrix/quantized-matrix-inl.h"
+
+}  // namespace avx2
+
+#pragma GCC pop_options
+
+// With VNNI we can multiply unsigned by signed bytes and add groups of four
+// products to 32-bit integers in one instruction.  We add 128 to x (x ^ 0x80
+// is x + 128 as an unsigned byte) and correct for it with the row sums of w.
+
+#if __GNUC__ >= 8
+
+#pragma GCC push_options
+#pragma GCC target("avx2,avx512vnni,avx512vl")
+
+namespace avx512vnni {
+
+struct Ops {
+  typedef __m256i Acc;
+  typedef __m256i X;
+  static const int32 kStep = 32, kXOffset = 128;
+  static inline Acc Zero() { return _mm256_setzero_si256(); }
+  static inline X LoadX(const int8 *x) {
+    return _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)),
+        _mm256_set1_epi8(static_cast<char>(0x80)));
+  }
+  static inline Acc Accumulate(Acc acc, X x, const int8 *w) {
+    return _mm256_dpbusd_epi32(
+        acc, x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w)));
+  }
+  static inline int32 Sum(Acc acc) { return avx2::HorizontalSum(acc); }
+};
+
+#include "matrix/quantized-matrix-inl.h"
+
+}  // namespace avx512vnni
+
+#pragma GCC pop_options
+
+#endif  // __GNUC__ >= 8
+
+#if __GNUC__ >= 11
+
+#pragma GCC push_options
+#pragma GCC target("avx2,avxvnni")
+
+namespace avxvnni {
+
+struct Ops {
+  typedef __m256i Acc;
+  typedef __m256i X;
+  static const int32 kStep = 32, kXOffset = 128;
+  static inline Acc Zero() { return _mm256_setzero_si256(); }
+  static inline X LoadX(const int8 *x) {
+    return _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)),
+        _mm256_set1_epi8(static_cast<char>(0x80)));
+  }
+  static inline Acc Accumulate(Acc acc, X x, const int8 *w) {
+    return _mm256_dpbusd_avx_epi32(
+        acc, x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w)));
+  }
+  static inline int32 Sum(Acc acc) { return avx2::HorizontalSum(acc); }
+};
+
+#include "matrix/quantized-matrix-inl.h"
+
+}  // namespace avxvnni
+
+#pragma GCC pop_options
+
+#endif  // __GNUC__ >= 11
+
+#endif  // KALDI_QUANTIZED_X86
+
+namespace {
+
+typedef void (*QuantizedProductsFunction)(BaseFloat alpha,
+                                          const int8 *a_data,
+                                          const BaseFloat *a_scales,
+                                          const QuantizedMatrix &B,
+                                          MatrixBase<BaseFloat> *C);
+
+struct QuantizedKernel {
+  const char *name;
+  QuantizedProductsFunction products;
+};
+
+QuantizedKernel ChooseQuantizedKernel() {
+#ifdef KALDI_QUANTIZED_X86
+  __builtin_cpu_init();
+#if __GNUC__ >= 8
+  if (__builtin_cpu_supports("avx512vnni") &&
+      __builtin_cpu_supports("avx512vl")) {
+    QuantizedKernel k = { "AVX512-VNNI", avx512vnni::AddQuantizedProducts };
+    return k;
+  }
+#endif
+#if __GNUC__ >= 11
+  if (__builtin_cpu_supports("avxvnni")) {
+    QuantizedKernel k = { "AVX-VNNI", avxvnni::AddQuantizedProducts };
+    return k;
+  }
+#endif
+  if (__builtin_cpu_supports("avx2")) {
+    QuantizedKernel k = { "AVX2", avx2::AddQuantizedProducts };
+    return k;
+  }
+#endif
+#ifdef __SSE2__
+  QuantizedKernel k = { "SSE2", sse2::AddQuantizedProducts };
+#else
+  QuantizedKernel k = { "none", generic::AddQuantizedProducts };
+#endif
+  return k;
+}
+
+// The initialization of function-local statics is thread-safe in C++11.
+inline const QuantizedKernel &GetQuantizedKernel() {
+  static const QuantizedKernel kernel = ChooseQuantizedKernel();
+  return kernel;
+}
+
+}  // namespace
+
+void AddMatQuantizedMatTrans(BaseFloat alpha, const MatrixBase<BaseFloat> &A,
+                             const QuantizedMatrix &B,
+                             MatrixBase<BaseFloat> *C) {
+  KALDI_ASSERT(A.NumCols() == B.NumCols() && C->NumRows() == A.NumRows() &&
+               C->NumCols() == B.NumRows());
+  int32 num_rows = A.NumRows(), dim = A.NumCols(), stride = B.Stride(),
+      num_out = B.NumRows();
+  if (num_rows == 0 || num_out == 0 || dim == 0 || alpha == 0.0)
+    return;
+  // The padding in a_data is zero, like that of B.
+  std::vector<int8> a_data(static_cast<size_t>(num_rows) * stride, 0);
+  std::vector<BaseFloat> a_scales(num_rows);
+  for (int32 t = 0; t < num_rows; t++)
+    a_scales[t] = QuantizeRow(A.RowData(t), dim, &(a_data[0]) + t * stride);
+  GetQuantizedKernel().products(alpha, &(a_data[0]), &(a_scales[0]), B, C);
+}
+
+const char *QuantizedMatrixInstructionSet() {
+  return GetQuantizedKernel().name;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,118 @@
+// matrix/quantized-matrix.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_QUANTIZED_MATRIX_H_
+#define KALDI_MATRIX_QUANTIZED_MATRIX_H_ 1
+
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   QuantizedMatrix stores a matrix as 8-bit signed integers with one scale per
+   row: element (r, c) is approximately Scale(r) * q(r, c), where q(r, c) is in
+   [-127, 127] and Scale(r) is the largest absolute value in row r divided by
+   127.  It exists for fast, approximate matrix multiplication in inference (see
+   AddMatQuantizedMatTrans()); it is not meant for general use like Matrix.
+
+   The rows are stored padded with zeros to a multiple of 32 elements so that
+   the multiplication code can use whole SIMD registers.
+ */
+class QuantizedMatrix {
+ public:
+  QuantizedMatrix(): num_rows_(0), num_cols_(0), stride_(0) { }
+
+  template<typename Real>
+  explicit QuantizedMatrix(const MatrixBase<Real> &mat) { CopyFromMat(mat); }
+
+  /// Quantizes 'mat'.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat);
+
+  /// Copies the (approximate) values to 'mat', which must have the right size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  int32 NumRows() const { return num_rows_; }
+  int32 NumCols() const { return num_cols_; }
+
+  BaseFloat Scale(int32 r) const { return scales_[r]; }
+
+  /// Returns the quantized row 'r', which has Stride() elements of which those
+  /// past NumCols() are zero.
+  const int8 *RowData(int32 r) const { return &(data_[0]) + r * stride_; }
+  int32 Stride() const { return stride_; }
+
+  /// Returns the sum of the quantized elements of row r (this is needed by
+  /// some of the multiplication code).
+  int32 RowSum(int32 r) const { return row_sums_[r]; }
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+  /// Returns the number of bytes the data takes up (for diagnostics).
+  int64 SizeInBytes() const {
+    return data_.size() + scales_.size() * sizeof(BaseFloat) +
+        row_sums_.size() * sizeof(int32);
+  }
+
+  void Swap(QuantizedMatrix *other);
+
+  /// Rows are padded to a multiple of this number of elements.
+  static const int32 kAlignment = 32;
+
+ private:
+  // Sets the sizes and allocates the data (zeroed).
+  void Resize(int32 num_rows, int32 num_cols);
+  void ComputeRowSums();
+
+  int32 num_rows_;
+  int32 num_cols_;
+  int32 stride_;
+  std::vector<int8> data_;  // num_rows_ * stride_ elements.
+  std::vector<BaseFloat> scales_;  // one per row.
+  std::vector<int32> row_sums_;  // one per row; not stored on disk.
+};
+
+/// Does C += alpha * A * B^T, where B is quantized.  The rows of A are
+/// quantized to 8 bits in the same way as the rows of B (with one scale per
+/// row) before multiplying, and the products are accumulated as 32-bit
+/// integers, so the result is approximate: for typical neural-net weights and
+/// activations the error is around 1% of the magnitude of the result.  The code
+/// uses AVX512-VNNI, AVX-VNNI, AVX2 or SSE2 instructions, whichever the CPU
+/// supports (detected at run time), and plain C++ on other platforms.
+/// Requires A.NumCols() == B.NumCols(), C->NumRows() == A.NumRows() and
+/// C->NumCols() == B.NumRows().
+void AddMatQuantizedMatTrans(BaseFloat alpha, const MatrixBase<BaseFloat> &A,
+                             const QuantizedMatrix &B,
+                             MatrixBase<BaseFloat> *C);
+
+/// Returns the name of the instruction set used by AddMatQuantizedMatTrans()
+/// on this machine, e.g. "AVX2" (for diagnostics).
+const char *QuantizedMatrixInstructionSet();
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_QUANTIZED_MATRIX_H_
@@ -0,0 +1,108 @@
+// matrix/small-gemm-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include "matrix/matrix-lib.h"
+#include "matrix/small-gemm.h"
+
+namespace kaldi {
+
+// Tests SmallGemm() against a simple implementation, for all combinations of
+// transposes and sizes that exercise the edges of the blocks.
+template<typename Real>
+void UnitTestSmallGemm() {
+  for (int32 i = 0; i < 200; i++) {
+    MatrixIndexT num_rows = RandInt(1, 9), num_cols = RandInt(1, 9),
+        inner_dim = RandInt(1, 9);
+    MatrixTransposeType transA = (RandInt(0, 1) == 0 ? kNoTrans : kTrans),
+        transB = (RandInt(0, 1) == 0 ? kNoTrans : kTrans);
+    Matrix<Real> A(transA == kNoTrans ? num_rows : inner_dim,
+                   transA == kNoTrans ? inner_dim : num_rows),
+        B(transB == kNoTrans ? inner_dim : num_cols,
+          transB == kNoTrans ? num_cols : inner_dim),
+        C(num_rows, num_cols);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    Matrix<Real> C_ref(C);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      for (MatrixIndexT c = 0; c < num_cols; c++) {
+        double sum = 0.0;
+        for (MatrixIndexT k = 0; k < inner_dim; k++)
+          sum += (transA == kNoTrans ? A(r, k) : A(k, r)) *
+              (transB == kNoTrans ? B(k, c) : B(c, k));
+        C_ref(r, c) = alpha * sum + beta * C(r, c);
+      }
+    }
+    if (beta == 0.0)  // C must not be read.
+      C(0, 0) = std::numeric_limits<Real>::quiet_NaN();
+    SmallGemm(alpha, transA, A.Data(), A.Stride(), transB, B.Data(),
+              B.Stride(), beta, C.Data(), num_rows, num_cols, inner_dim,
+              C.Stride());
+    AssertEqual(C, C_ref);
+  }
+}
+
+// Checks that AddMatMat() gives the same results whichever implementation
+// is used, including for sub-matrices whose stride is not the number of
+// columns.
+template<typename Real>
+void UnitTestSmallGemmAddMatMat() {
+  int32 threshold = g_small_gemm_options.threshold;
+  for (int32 i = 0; i < 50; i++) {
+    MatrixIndexT num_rows = RandInt(1, 20), num_cols = RandInt(1, 20),
+        inner_dim = RandInt(1, 20);
+    Matrix<Real> A_big(num_rows + 3, inner_dim + 5),
+        B_big(num_cols + 2, inner_dim + 1);
+    A_big.SetRandn();
+    B_big.SetRandn();
+    SubMatrix<Real> A(A_big, 1, num_rows, 2, inner_dim),
+        B(B_big, 2, num_cols, 1, inner_dim);
+    Matrix<Real> C1(num_rows, num_cols), C2(num_rows, num_cols);
+    C1.SetRandn();
+    C2.CopyFromMat(C1);
+    g_small_gemm_options.threshold = 0;
+    C1.AddMatMat(0.5, A, kNoTrans, B, kTrans, 2.0);
+    g_small_gemm_options.threshold = -1;
+    C2.AddMatMat(0.5, A, kNoTrans, B, kTrans, 2.0);
+    AssertEqual(C1, C2);
+    KALDI_ASSERT(UseSmallGemm(num_rows, num_cols, inner_dim));
+    g_small_gemm_options.threshold = num_rows * num_cols * inner_dim;
+    KALDI_ASSERT(UseSmallGemm(num_rows, num_cols, inner_dim) &&
+                 !UseSmallGemm(num_rows + 1, num_cols, inner_dim));
+    g_small_gemm_options.threshold = 1;
+    KALDI_ASSERT(UseSmallGemm(1, num_cols, inner_dim) ==
+                 (num_cols * inner_dim <=
+                  g_small_gemm_options.single_row_threshold));
+  }
+  g_small_gemm_options.threshold = threshold;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestSmallGemm<float>();
+  UnitTestSmallGemm<double>();
+  UnitTestSmallGemmAddMatMat<float>();
+  UnitTestSmallGemmAddMatMat<double>();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,175 @@
+// matrix/small-gemm.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include "matrix/small-gemm.h"
+
+namespace kaldi {
+
+SmallGemmOptions::SmallGemmOptions():
+    threshold(512), single_row_threshold(65536) {
+  const char *env = getenv("KALDI_SMALL_GEMM_THRESHOLD");
+  if (env != NULL)
+    threshold = atoi(env);
+}
+
+SmallGemmOptions g_small_gemm_options;
+
+namespace {
+
+// Writes 'sum' times alpha into *c, adding beta times its old value.
+template<typename Real>
+inline void StoreResult(Real alpha, Real beta, Real sum, Real *c) {
+  if (beta == 0.0)
+    *c = alpha * sum;
+  else
+    *c = alpha * sum + beta * *c;
+}
+
+// Does a block of block_rows by block_cols elements of C one element at a
+// time; this is for the edges of the matrix.
+template<typename Real>
+void GemmEdgeBlock(Real alpha, const Real *A, MatrixIndexT a_row_stride,
+                   MatrixIndexT a_col_stride, const Real *B,
+                   MatrixIndexT b_row_stride, MatrixIndexT b_col_stride,
+                   Real beta, Real *C, MatrixIndexT c_stride,
+                   MatrixIndexT block_rows, MatrixIndexT block_cols,
+                   MatrixIndexT inner_dim) {
+  for (MatrixIndexT r = 0; r < block_rows; r++) {
+    for (MatrixIndexT c = 0; c < block_cols; c++) {
+      const Real *a = A + r * a_row_stride, *b = B + c * b_col_stride;
+      Real sum = 0.0;
+      for (MatrixIndexT k = 0; k < inner_dim; k++)
+        sum += a[k * a_col_stride] * b[k * b_row_stride];
+      StoreResult(alpha, beta, sum, C + r * c_stride + c);
+    }
+  }
+}
+
+// Does a block of 4 by 4 elements of C, keeping the 16 sums in registers;
+// each element of A and B that is loaded is used 4 times.
+template<typename Real>
+void GemmBlock4x4(Real alpha, const Real *A, MatrixIndexT a_row_stride,
+                  MatrixIndexT a_col_stride, const Real *B,
+                  MatrixIndexT b_row_stride, MatrixIndexT b_col_stride,
+                  Real beta, Real *C, MatrixIndexT c_stride,
+                  MatrixIndexT inner_dim) {
+  Real c00 = 0, c01 = 0, c02 = 0, c03 = 0,
+      c10 = 0, c11 = 0, c12 = 0, c13 = 0,
+      c20 = 0, c21 = 0, c22 = 0, c23 = 0,
+      c30 = 0, c31 = 0, c32 = 0, c33 = 0;
+  const Real *a0 = A, *a1 = A + a_row_stride, *a2 = a1 + a_row_stride,
+      *a3 = a2 + a_row_stride;
+  const Real *b0 = B, *b1 = B + b_col_stride, *b2 = b1 + b_col_stride,
+      *b3 = b2 + b_col_stride;
+  for (MatrixIndexT k = 0; k < inner_dim; k++) {
+    MatrixIndexT ak = k * a_col_stride, bk = k * b_row_stride;
+    Real x0 = a0[ak], x1 = a1[ak], x2 = a2[ak], x3 = a3[ak],
+        y0 = b0[bk], y1 = b1[bk], y2 = b2[bk], y3 = b3[bk];
+    c00 += x0 * y0; c01 += x0 * y1; c02 += x0 * y2; c03 += x0 * y3;
+    c10 += x1 * y0; c11 += x1 * y1; c12 += x1 * y2; c13 += x1 * y3;
+    c20 += x2 * y0; c21 += x2 * y1; c22 += x2 * y2; c23 += x2 * y3;
+    c30 += x3 * y0; c31 += x3 * y1; c32 += x3 * y2; c33 += x3 * y3;
+  }
+  Real *r0 = C, *r1 = C + c_stride, *r2 = r1 + c_stride, *r3 = r2 + c_stride;
+  StoreResult(alpha, beta, c00, r0); StoreResult(alpha, beta, c01, r0 + 1);
+  StoreResult(alpha, beta, c02, r0 + 2); StoreResult(alpha, beta, c03, r0 + 3);
+  StoreResult(alpha, beta, c10, r1); StoreResult(alpha, beta, c11, r1 + 1);
+  StoreResult(alpha, beta, c12, r1 + 2); StoreResult(alpha, beta, c13, r1 + 3);
+  StoreResult(alpha, beta, c20, r2); StoreResult(alpha, beta, c21, r2 + 1);
+  StoreResult(alpha, beta, c22, r2 + 2); StoreResult(alpha, beta, c23, r2 + 3);
+  StoreResult(alpha, beta, c30, r3); StoreResult(alpha, beta, c31, r3 + 1);
+  StoreResult(alpha, beta, c32, r3 + 2); StoreResult(alpha, beta, c33, r3 + 3);
+}
+
+// Does a block of 1 by 4 elements of C; this is used for the rows left over
+// after the 4 by 4 blocks, e.g. when C is a single row.
+template<typename Real>
+void GemmBlock1x4(Real alpha, const Real *A, MatrixIndexT a_col_stride,
+                  const Real *B, MatrixIndexT b_row_stride,
+                  MatrixIndexT b_col_stride, Real beta, Real *C,
+                  MatrixIndexT inner_dim) {
+  Real c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+  const Real *b0 = B, *b1 = B + b_col_stride, *b2 = b1 + b_col_stride,
+      *b3 = b2 + b_col_stride;
+  for (MatrixIndexT k = 0; k < inner_dim; k++) {
+    MatrixIndexT bk = k * b_row_stride;
+    Real x = A[k * a_col_stride];
+    c0 += x * b0[bk]; c1 += x * b1[bk]; c2 += x * b2[bk]; c3 += x * b3[bk];
+  }
+  StoreResult(alpha, beta, c0, C); StoreResult(alpha, beta, c1, C + 1);
+  StoreResult(alpha, beta, c2, C + 2); StoreResult(alpha, beta, c3, C + 3);
+}
+
+}  // namespace
+
+template<typename Real>
+void SmallGemm(Real alpha, MatrixTransposeType transA, const Real *A,
+               MatrixIndexT a_stride, MatrixTransposeType transB,
+               const Real *B, MatrixIndexT b_stride, Real beta, Real *C,
+               MatrixIndexT num_rows, MatrixIndexT num_cols,
+               MatrixIndexT inner_dim, MatrixIndexT c_stride) {
+  // The strides of op(A) and op(B) in memory, along their rows and columns,
+  // so that op(A)(i, k) = A[i * a_row_stride + k * a_col_stride].
+  MatrixIndexT a_row_stride = (transA == kNoTrans ? a_stride : 1),
+      a_col_stride = (transA == kNoTrans ? 1 : a_stride),
+      b_row_stride = (transB == kNoTrans ? b_stride : 1),
+      b_col_stride = (transB == kNoTrans ? 1 : b_stride);
+  MatrixIndexT i = 0;
+  for (; i + 4 <= num_rows; i += 4) {
+    const Real *A_i = A + i * a_row_stride;
+    Real *C_i = C + i * c_stride;
+    MatrixIndexT j = 0;
+    for (; j + 4 <= num_cols; j += 4)
+      GemmBlock4x4(alpha, A_i, a_row_stride, a_col_stride,
+                   B + j * b_col_stride, b_row_stride, b_col_stride,
+                   beta, C_i + j, c_stride, inner_dim);
+    if (j < num_cols)
+      GemmEdgeBlock(alpha, A_i, a_row_stride, a_col_stride,
+                    B + j * b_col_stride, b_row_stride, b_col_stride,
+                    beta, C_i + j, c_stride, 4, num_cols - j, inner_dim);
+  }
+  for (; i < num_rows; i++) {
+    const Real *A_i = A + i * a_row_stride;
+    Real *C_i = C + i * c_stride;
+    MatrixIndexT j = 0;
+    for (; j + 4 <= num_cols; j += 4)
+      GemmBlock1x4(alpha, A_i, a_col_stride, B + j * b_col_stride,
+                   b_row_stride, b_col_stride, beta, C_i + j, inner_dim);
+    if (j < num_cols)
+      GemmEdgeBlock(alpha, A_i, a_row_stride, a_col_stride,
+                    B + j * b_col_stride, b_row_stride, b_col_stride,
+                    beta, C_i + j, c_stride, 1, num_cols - j, inner_dim);
+  }
+}
+
+template
+void SmallGemm(float alpha, MatrixTransposeType transA, const float *A,
+               MatrixIndexT a_stride, MatrixTransposeType transB,
+               const float *B, MatrixIndexT b_stride, float beta, float *C,
+               MatrixIndexT num_rows, MatrixIndexT num_cols,
+               MatrixIndexT inner_dim, MatrixIndexT c_stride);
+template
+void SmallGemm(double alpha, MatrixTransposeType transA, const double *A,
+               MatrixIndexT a_stride, MatrixTransposeType transB,
+               const double *B, MatrixIndexT b_stride, double beta, double *C,
+               MatrixIndexT num_rows, MatrixIndexT num_cols,
+               MatrixIndexT inner_dim, MatrixIndexT c_stride);
+
+}  // namespace kaldi
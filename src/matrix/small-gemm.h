@@ -0,0 +1,106 @@
+// matrix/small-gemm.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SMALL_GEMM_H_
+#define KALDI_MATRIX_SMALL_GEMM_H_ 1
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/**
+   Options that decide, at run time, which implementation of matrix
+   multiplication (GEMM) is used by cblas_Xgemm() and hence by
+   MatrixBase::AddMatMat(): the BLAS library that Kaldi was linked with, or
+   the built-in kernel SmallGemm().  For small matrices the built-in kernel is
+   faster, because BLAS libraries have a fixed overhead per call (argument
+   checking, dispatch, sometimes threading) that dominates when the product
+   is e.g. a single row times a matrix.
+
+   The default of the threshold can be set with the environment variable
+   KALDI_SMALL_GEMM_THRESHOLD; the "small-gemm" part of matrix-lib-speed-test
+   prints the crossover point on the current machine.
+ */
+struct SmallGemmOptions {
+  // Products with num_rows * num_cols * inner_dim <= this are done by the
+  // built-in kernel; 0 means always use the BLAS library, and -1 means
+  // always use the built-in kernel.
+  int32 threshold;
+  // The same as 'threshold', for products where C is a single row (a vector
+  // times a matrix); BLAS libraries are not very fast for those, so the
+  // built-in kernel wins up to much larger sizes.
+  int32 single_row_threshold;
+
+  SmallGemmOptions();
+
+  void Register(OptionsItf *po) {
+    po->Register("small-gemm-threshold", &threshold, "Matrix products with "
+                 "num-rows * num-cols * inner-dimension up to this value are "
+                 "done with Kaldi's built-in kernel instead of the BLAS "
+                 "library, which is faster for small matrices.  0 means always "
+                 "use the BLAS library, -1 means never use it.  The default can "
+                 "be set with the environment variable "
+                 "KALDI_SMALL_GEMM_THRESHOLD.");
+    po->Register("small-gemm-single-row-threshold", &single_row_threshold,
+                 "The same as --small-gemm-threshold, for products whose "
+                 "output is a single row.");
+  }
+};
+
+extern SmallGemmOptions g_small_gemm_options;
+
+inline void RegisterSmallGemmOptions(OptionsItf *po) {
+  g_small_gemm_options.Register(po);
+}
+
+/// Returns true if a matrix product of this size should be done by
+/// SmallGemm() rather than by the BLAS library.
+inline bool UseSmallGemm(MatrixIndexT num_rows, MatrixIndexT num_cols,
+                         MatrixIndexT inner_dim) {
+  int32 threshold = g_small_gemm_options.threshold;
+  if (threshold <= 0)
+    return (threshold < 0);
+  int64 size = static_cast<int64>(num_rows) * num_cols * inner_dim;
+  return size <= threshold || (num_rows == 1 && size <=
+                               g_small_gemm_options.single_row_threshold);
+}
+
+/// Sets C = alpha op(A) op(B) + beta C, with the same conventions as
+/// cblas_Xgemm(): all matrices are row-major, C is num_rows by num_cols, and
+/// inner_dim is the number of columns of op(A).  If beta == 0, C is not read,
+/// as in BLAS.  This is a register-blocked kernel that does not need any
+/// temporary memory; it is meant for small matrices, and is much slower than
+/// a good BLAS library for large ones.
+template<typename Real>
+void SmallGemm(Real alpha, MatrixTransposeType transA, const Real *A,
+               MatrixIndexT a_stride, MatrixTransposeType transB,
+               const Real *B, MatrixIndexT b_stride, Real beta, Real *C,
+               MatrixIndexT num_rows, MatrixIndexT num_cols,
+               MatrixIndexT inner_dim, MatrixIndexT c_stride);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SMALL_GEMM_H_
@@ -901,7 +901,7 @@ void GeneralMatrix::Write(std::ostream &os, bool binary) const {
 void GeneralMatrix::Read(std::istream &is, bool binary) {
   Clear();
   if (binary) {
-    int peekval = is.peek();
+    int peekval = Peek(is, binary);
     if (peekval == 'C') {
       // Token CM for compressed matrix
       cmat_.Read(is, binary);
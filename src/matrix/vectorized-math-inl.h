@@ -0,0 +1,215 @@
+// matrix/vectorized-math-inl.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is only to be included by vectorized-math.cc, once for each
+// instruction set, inside a namespace that defines a struct 'Ops' with the
+// SIMD operations for that instruction set (see vectorized-math.cc).  It
+// defines the functions ExpArray(), LogArray() and so on in that namespace.
+// There is deliberately no include guard.
+//
+// Each of the functions that are called from outside calls Ops::ZeroUpper()
+// before it returns, to avoid the slowdown of any SSE code that runs after
+// it; the compiler doesn't always do that for us.
+
+static const int32 kWidth = Ops::kWidth;
+
+// Returns exp(x), using the polynomial approximation from Cephes's expf().
+// We write x = n log(2) + r with |r| <= log(2)/2, so exp(x) = 2^n exp(r).  We
+// multiply by 2^n in two steps so that n can be outside the range of normal
+// float exponents, which gives correct results for denormal and near-overflow
+// outputs.
+static inline Ops::V ExpV(Ops::V x) {
+  typedef Ops::V V;
+  typedef Ops::I I;
+  const V max_x = Ops::Set1(88.72283935546875f),  // log(FLT_MAX)
+      min_x = Ops::Set1(-103.972076416f),  // log(smallest denormal / 2)
+      zero = Ops::Set1(0.0f);
+  V xc = Ops::Min(Ops::Max(x, min_x), max_x);
+  V n = Ops::Round(Ops::Mul(xc, Ops::Set1(1.44269504088896341f)));
+  // r = x - n log(2), where log(2) is split into two parts for accuracy.
+  V r = Ops::Fma(n, Ops::Set1(-0.693359375f), xc);
+  r = Ops::Fma(n, Ops::Set1(2.12194440e-4f), r);
+  V p = Ops::Set1(1.9875691500e-4f);
+  p = Ops::Fma(p, r, Ops::Set1(1.3981999507e-3f));
+  p = Ops::Fma(p, r, Ops::Set1(8.3334519073e-3f));
+  p = Ops::Fma(p, r, Ops::Set1(4.1665795894e-2f));
+  p = Ops::Fma(p, r, Ops::Set1(1.6666665459e-1f));
+  p = Ops::Fma(p, r, Ops::Set1(5.0000001201e-1f));
+  V y = Ops::Fma(p, Ops::Mul(r, r), Ops::Add(r, Ops::Set1(1.0f)));
+  I n_int = Ops::ToInt(n),
+      n1 = Ops::ShiftRightArith<1>(n_int),
+      n2 = Ops::IntSub(n_int, n1);
+  y = Ops::Mul(Ops::Mul(y, Ops::Pow2(n1)), Ops::Pow2(n2));
+  y = Ops::SelectLt(x, min_x, zero, y);
+  y = Ops::SelectLt(max_x, x, Ops::Set1(std::numeric_limits<float>::infinity()),
+                    y);
+  return Ops::SelectNan(x, x, y);
+}
+
+// Returns log(x), using the polynomial approximation from Cephes's logf().  We
+// write x = 2^e m with sqrt(0.5) <= m < sqrt(2), and approximate log(m).
+static inline Ops::V LogV(Ops::V x) {
+  typedef Ops::V V;
+  typedef Ops::I I;
+  const V zero = Ops::Set1(0.0f), one = Ops::Set1(1.0f),
+      min_normal = Ops::Set1(std::numeric_limits<float>::min()),
+      inf = Ops::Set1(std::numeric_limits<float>::infinity()),
+      sqrt_half = Ops::Set1(0.707106781186547524f);
+  // Denormals are scaled by 2^23 to make them normal.
+  V x_scaled = Ops::SelectLt(x, min_normal, Ops::Mul(x, Ops::Set1(8388608.0f)),
+                             x),
+      e_offset = Ops::SelectLt(x, min_normal, Ops::Set1(-23.0f), zero);
+  I bits = Ops::AsInt(x_scaled);
+  V e = Ops::Add(Ops::ToFloat(Ops::IntAdd(Ops::ShiftRightLogical<23>(bits),
+                                          -126)),
+                 e_offset);
+  // m is in [0.5, 1).
+  V m = Ops::AsFloat(Ops::IntOr(Ops::IntAnd(bits, 0x007fffff), 0x3f000000));
+  V e_decrement = Ops::SelectLt(m, sqrt_half, one, zero),
+      m_increment = Ops::SelectLt(m, sqrt_half, m, zero);
+  e = Ops::Sub(e, e_decrement);
+  // Now log(x) = e log(2) + log(1 + m).
+  m = Ops::Add(Ops::Sub(m, one), m_increment);
+  V z = Ops::Mul(m, m);
+  V p = Ops::Set1(7.0376836292e-2f);
+  p = Ops::Fma(p, m, Ops::Set1(-1.1514610310e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(1.1676998740e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(-1.2420140846e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(1.4249322787e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(-1.6668057665e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(2.0000714765e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(-2.4999993993e-1f));
+  p = Ops::Fma(p, m, Ops::Set1(3.3333331174e-1f));
+  V y = Ops::Mul(Ops::Mul(p, m), z);
+  y = Ops::Fma(e, Ops::Set1(-2.12194440e-4f), y);
+  y = Ops::Fma(z, Ops::Set1(-0.5f), y);
+  V ans = Ops::Fma(e, Ops::Set1(0.693359375f), Ops::Add(m, y));
+  // log(0) = -inf, log(negative) = NaN, log(inf) = inf, log(NaN) = NaN.
+  ans = Ops::SelectEq(x, zero, Ops::Set1(-std::numeric_limits<float>::infinity()),
+                      ans);
+  ans = Ops::SelectLt(x, zero,
+                      Ops::Set1(std::numeric_limits<float>::quiet_NaN()), ans);
+  ans = Ops::SelectEq(x, inf, inf, ans);
+  return Ops::SelectNan(x, x, ans);
+}
+
+static inline Ops::V SigmoidV(Ops::V x) {
+  // 1 / (1 + exp(-x)); if exp(-x) overflows to infinity this gives 0.
+  Ops::V one = Ops::Set1(1.0f);
+  return Ops::Div(one, Ops::Add(one, ExpV(Ops::Sub(Ops::Set1(0.0f), x))));
+}
+
+static inline Ops::V TanhV(Ops::V x) {
+  // tanh(|x|) = (1 - t) / (1 + t) with t = exp(-2|x|), then copy the sign.
+  typedef Ops::V V;
+  typedef Ops::I I;
+  I bits = Ops::AsInt(x),
+      sign = Ops::IntAnd(bits, 0x80000000);
+  V abs_x = Ops::AsFloat(Ops::IntAnd(bits, 0x7fffffff)),
+      one = Ops::Set1(1.0f),
+      t = ExpV(Ops::Mul(abs_x, Ops::Set1(-2.0f))),
+      y = Ops::Div(Ops::Sub(one, t), Ops::Add(one, t));
+  return Ops::AsFloat(Ops::IntOr(Ops::AsInt(y), sign));
+}
+
+// Applies 'Function' to x[0 .. n-1], putting the result in y.  The last
+// partial vector is done via a buffer padded with 'pad' so we never read or
+// write past the ends of the arrays.
+template<Ops::V (*Function)(Ops::V)>
+static void ApplyToArray(const float *x, float *y, MatrixIndexT n, float pad) {
+  MatrixIndexT i = 0;
+  for (; i + kWidth <= n; i += kWidth)
+    Ops::Store(y + i, Function(Ops::Load(x + i)));
+  if (i < n) {
+    float buf[kWidth];
+    MatrixIndexT rest = n - i;
+    for (MatrixIndexT j = 0; j < kWidth; j++)
+      buf[j] = (j < rest ? x[i + j] : pad);
+    Ops::Store(buf, Function(Ops::Load(buf)));
+    for (MatrixIndexT j = 0; j < rest; j++)
+      y[i + j] = buf[j];
+  }
+  Ops::ZeroUpper();
+}
+
+static void ExpArray(const float *x, float *y, MatrixIndexT n) {
+  ApplyToArray<ExpV>(x, y, n, 0.0f);
+}
+
+static void LogArray(const float *x, float *y, MatrixIndexT n) {
+  ApplyToArray<LogV>(x, y, n, 1.0f);
+}
+
+static void SigmoidArray(const float *x, float *y, MatrixIndexT n) {
+  ApplyToArray<SigmoidV>(x, y, n, 0.0f);
+}
+
+static void TanhArray(const float *x, float *y, MatrixIndexT n) {
+  ApplyToArray<TanhV>(x, y, n, 0.0f);
+}
+
+static void FloorArray(const float *x, float floor, float *y, MatrixIndexT n) {
+  Ops::V f = Ops::Set1(floor);
+  MatrixIndexT i = 0;
+  // x < floor ? floor : x; unlike max(), this keeps NaNs.
+  for (; i + kWidth <= n; i += kWidth) {
+    Ops::V v = Ops::Load(x + i);
+    Ops::Store(y + i, Ops::SelectLt(v, f, f, v));
+  }
+  Ops::ZeroUpper();
+  for (; i < n; i++)
+    y[i] = (x[i] < floor ? floor : x[i]);
+}
+
+static double ExpSumArray(const float *x, float shift, float cutoff,
+                          float *y, MatrixIndexT n) {
+  typedef Ops::V V;
+  const V shift_v = Ops::Set1(shift), cutoff_v = Ops::Set1(cutoff),
+      zero = Ops::Set1(0.0f);
+  // We sum in float within blocks, and in double across blocks.
+  const MatrixIndexT kBlockSize = 1024;
+  double sum = 0.0;
+  MatrixIndexT i = 0;
+  while (i + kWidth <= n) {
+    MatrixIndexT block_end = (n - i > kBlockSize ? i + kBlockSize : n);
+    V acc = zero;
+    for (; i + kWidth <= block_end; i += kWidth) {
+      V v = Ops::Load(x + i), e = ExpV(Ops::Add(v, shift_v));
+      if (y != NULL)
+        Ops::Store(y + i, e);
+      acc = Ops::Add(acc, Ops::SelectLt(v, cutoff_v, zero, e));
+    }
+    sum += Ops::Sum(acc);
+  }
+  if (i < n) {
+    float buf[kWidth];
+    MatrixIndexT rest = n - i;
+    for (MatrixIndexT j = 0; j < kWidth; j++)
+      buf[j] = (j < rest ? x[i + j] : -std::numeric_limits<float>::infinity());
+    V v = Ops::Load(buf), e = ExpV(Ops::Add(v, shift_v));
+    sum += Ops::Sum(Ops::SelectLt(v, cutoff_v, zero, e));
+    if (y != NULL) {
+      Ops::Store(buf, e);
+      for (MatrixIndexT j = 0; j < rest; j++)
+        y[i + j] = buf[j];
+    }
+  }
+  Ops::ZeroUpper();
+  return sum;
+}
@@ -0,0 +1,218 @@
+// matrix/vectorized-math-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "matrix/matrix-lib.h"
+#include "matrix/vectorized-math.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+// Returns the relative error of 'approx' compared with 'exact', treating
+// numbers smaller than 'tiny' as absolute errors; this is zero if both are
+// the same infinity or both are NaN.
+static double RelativeError(float approx, double exact, double tiny) {
+  if (KALDI_ISNAN(exact))
+    return KALDI_ISNAN(approx) ? 0.0 : 1.0;
+  if (KALDI_ISINF(exact))
+    return (approx == exact) ? 0.0 : 1.0;
+  return std::abs(approx - exact) / std::max(std::abs(exact), tiny);
+}
+
+// Values covering the whole range of floats, with many values of each
+// exponent, plus some special values; returns them in 'x'.
+static void GetTestValues(std::vector<float> *x) {
+  x->clear();
+  // Numbers of the form 2^e * m, for all exponents, both signs.
+  for (int32 e = -149; e <= 127; e++) {
+    for (int32 i = 0; i < 100; i++) {
+      float m = 1.0 + RandUniform();
+      x->push_back(std::ldexp(m, e));
+      x->push_back(-std::ldexp(m, e));
+    }
+  }
+  // The range in which exp(x) doesn't overflow or underflow.
+  for (int32 i = 0; i < 100000; i++)
+    x->push_back(-110.0 + 200.0 * RandUniform());
+  const float inf = std::numeric_limits<float>::infinity();
+  const float special[] = { 0.0, -0.0, 1.0, -1.0, inf, -inf,
+                            std::numeric_limits<float>::quiet_NaN(),
+                            std::numeric_limits<float>::min(),
+                            std::numeric_limits<float>::denorm_min(),
+                            std::numeric_limits<float>::max(),
+                            88.72283935546875, 88.7228394, -87.3365479,
+                            -103.972076, -103.97208, -104.0 };
+  for (size_t i = 0; i < sizeof(special) / sizeof(special[0]); i++)
+    x->push_back(special[i]);
+}
+
+void UnitTestVectorizedExp() {
+  std::vector<float> x, y;
+  GetTestValues(&x);
+  y.resize(x.size());
+  VectorizedExp(x.data(), y.data(), x.size());
+  double max_error = 0.0;
+  for (size_t i = 0; i < x.size(); i++) {
+    double exact = std::exp(static_cast<double>(x[i]));
+    if (exact > std::numeric_limits<float>::max())
+      exact = std::numeric_limits<float>::infinity();
+    // Below the smallest normal number, the precision of floats itself is
+    // limited, so we measure the error relative to that number.
+    double error = RelativeError(y[i], exact,
+                                 std::numeric_limits<float>::min());
+    if (error > 3.0e-07)
+      KALDI_ERR << "exp(" << x[i] << ") = " << exact << ", got " << y[i];
+    max_error = std::max(max_error, error);
+  }
+  KALDI_LOG << "Maximum relative error of exp() was " << max_error
+            << " using instruction set " << VectorizedMathInstructionSet();
+}
+
+void UnitTestVectorizedLog() {
+  std::vector<float> x, y;
+  GetTestValues(&x);
+  for (int32 i = 0; i < 100000; i++)  // Numbers close to 1.
+    x.push_back(1.0 + 0.01 * RandGauss());
+  y.resize(x.size());
+  VectorizedLog(x.data(), y.data(), x.size());
+  double max_error = 0.0;
+  for (size_t i = 0; i < x.size(); i++) {
+    double exact = (x[i] < 0.0 ? std::numeric_limits<double>::quiet_NaN() :
+                    std::log(static_cast<double>(x[i])));
+    double error = RelativeError(y[i], exact, 1.0e-30);
+    if (error > 3.0e-07)
+      KALDI_ERR << "log(" << x[i] << ") = " << exact << ", got " << y[i];
+    max_error = std::max(max_error, error);
+  }
+  KALDI_LOG << "Maximum relative error of log() was " << max_error;
+}
+
+void UnitTestVectorizedSigmoidTanh() {
+  std::vector<float> x, y, z;
+  GetTestValues(&x);
+  y.resize(x.size());
+  z.resize(x.size());
+  VectorizedSigmoid(x.data(), y.data(), x.size());
+  VectorizedTanh(x.data(), z.data(), x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    double sigmoid = 1.0 / (1.0 + std::exp(-static_cast<double>(x[i]))),
+        tanh = std::tanh(static_cast<double>(x[i]));
+    // These are bounded functions so we use absolute errors.
+    if (!(RelativeError(y[i], sigmoid, 1.0) < 1.0e-06) ||
+        (x[i] < -87.0 && y[i] > 1.0e-30))
+      KALDI_ERR << "sigmoid(" << x[i] << ") = " << sigmoid << ", got " << y[i];
+    if (!(RelativeError(z[i], tanh, 1.0) < 1.0e-06))
+      KALDI_ERR << "tanh(" << x[i] << ") = " << tanh << ", got " << z[i];
+  }
+}
+
+// Tests the functions for all lengths and alignments, so that the code that
+// handles the ends of the arrays is tested, and that the vector and matrix
+// functions agree with kaldi-math.h up to the precision of floats.
+void UnitTestVectorizedLengths() {
+  for (int32 n = 0; n < 70; n++) {
+    for (int32 offset = 0; offset < 3; offset++) {
+      Vector<float> x(n + offset + 1);
+      x.SetRandn();
+      x.Scale(5.0);
+      float guard = x(n + offset);
+      SubVector<float> xs(x, offset, n);
+      Vector<float> y(n + 1);
+      y(n) = 7.0;
+      for (int32 i = 0; i < n; i++)
+        y(i) = 0.0;
+      VectorizedExp(xs.Data(), y.Data(), n);
+      for (int32 i = 0; i < n; i++)
+        KALDI_ASSERT(ApproxEqual(y(i), Exp(xs(i)), 1.0e-06));
+      KALDI_ASSERT(y(n) == 7.0 && x(n + offset) == guard);
+
+      float shift = -1.0, cutoff = 0.5;
+      double sum = VectorizedExpSum(xs.Data(), shift, cutoff, y.Data(), n),
+          ref_sum = 0.0;
+      for (int32 i = 0; i < n; i++) {
+        KALDI_ASSERT(ApproxEqual(y(i), Exp(xs(i) + shift), 1.0e-06));
+        if (xs(i) >= cutoff)
+          ref_sum += Exp(xs(i) + shift);
+      }
+      KALDI_ASSERT(std::abs(sum - ref_sum) <= 1.0e-06 * ref_sum);
+      KALDI_ASSERT(y(n) == 7.0);
+      double sum2 = VectorizedExpSum(xs.Data(), shift, cutoff, NULL, n);
+      KALDI_ASSERT(sum2 == sum);
+
+      VectorizedFloor(xs.Data(), 0.5f, y.Data(), n);
+      for (int32 i = 0; i < n; i++)
+        KALDI_ASSERT(y(i) == std::max(xs(i), 0.5f));
+      KALDI_ASSERT(y(n) == 7.0);
+    }
+  }
+  // The floor keeps NaNs.
+  float nan = std::numeric_limits<float>::quiet_NaN(), y;
+  VectorizedFloor(&nan, 0.0f, &y, 1);
+  KALDI_ASSERT(KALDI_ISNAN(y));
+}
+
+// Checks that the double versions give the same as kaldi-math.h.
+void UnitTestVectorizedDouble() {
+  Vector<double> x(100), y(100);
+  x.SetRandn();
+  x.Scale(10.0);
+  VectorizedExp(x.Data(), y.Data(), 100);
+  for (int32 i = 0; i < 100; i++)
+    KALDI_ASSERT(y(i) == Exp(x(i)));
+  x.ApplyAbs();
+  VectorizedLog(x.Data(), y.Data(), 100);
+  for (int32 i = 0; i < 100; i++)
+    KALDI_ASSERT(y(i) == Log(x(i)));
+}
+
+void UnitTestVectorizedSpeed() {
+  int32 dim = 1024, num_iters = 20000;
+  Vector<float> x(dim), y(dim);
+  x.SetRandn();
+  Timer timer;
+  for (int32 iter = 0; iter < num_iters; iter++)
+    VectorizedExp(x.Data(), y.Data(), dim);
+  double vectorized_time = timer.Elapsed();
+  timer.Reset();
+  for (int32 iter = 0; iter < num_iters; iter++)
+    for (int32 i = 0; i < dim; i++)
+      y(i) = Exp(x(i));
+  double libm_time = timer.Elapsed();
+  KALDI_LOG << "Time per exp() was " << (vectorized_time * 1.0e+09 /
+                                         (dim * num_iters))
+            << " ns vectorized, " << (libm_time * 1.0e+09 /
+                                      (dim * num_iters))
+            << " ns using the C library.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestVectorizedExp();
+  UnitTestVectorizedLog();
+  UnitTestVectorizedSigmoidTanh();
+  UnitTestVectorizedLengths();
+  UnitTestVectorizedDouble();
+  UnitTestVectorizedSpeed();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,357 @@
+// matrix/vectorized-math.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "base/kaldi-math.h"
+#include "matrix/vectorized-math.h"
+
+// The SIMD code is compiled with GCC's target pragmas, so it does not matter
+// whether Kaldi itself is compiled with -mavx2 etc.; whether it is used is
+// decided at run time.  (clang does not support the target pragma, so with
+// clang we always use the C library functions.)
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+  (__GNUC__ >= 6)
+#define KALDI_VECTORIZED_MATH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+namespace {
+
+// These are the versions that use the C library functions; they are used for
+// double, and for float on CPUs without AVX2.
+template<typename Real>
+void ExpArrayGeneric(const Real *x, Real *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++)
+    y[i] = Exp(x[i]);
+}
+
+template<typename Real>
+void LogArrayGeneric(const Real *x, Real *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++)
+    y[i] = Log(x[i]);
+}
+
+template<typename Real>
+void SigmoidArrayGeneric(const Real *x, Real *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real f = x[i];
+    // We aim to avoid floating-point overflow here.
+    if (f > 0.0) {
+      f = 1.0 / (1.0 + Exp(-f));
+    } else {
+      Real ef = Exp(f);
+      f = ef / (ef + 1.0);
+    }
+    y[i] = f;
+  }
+}
+
+template<typename Real>
+void TanhArrayGeneric(const Real *x, Real *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real f = x[i];
+    if (f > 0.0) {
+      Real inv_expf = Exp(-f);
+      f = -1.0 + 2.0 / (1.0 + inv_expf * inv_expf);
+    } else {
+      Real expf = Exp(f);
+      f = 1.0 - 2.0 / (1.0 + expf * expf);
+    }
+    y[i] = f;
+  }
+}
+
+template<typename Real>
+void FloorArrayGeneric(const Real *x, Real floor, Real *y, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++)
+    y[i] = (x[i] < floor ? floor : x[i]);
+}
+
+template<typename Real>
+double ExpSumArrayGeneric(const Real *x, Real shift, Real cutoff, Real *y,
+                          MatrixIndexT n) {
+  double sum = 0.0;
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real f = x[i], e = Exp(f + shift);
+    if (y != NULL)
+      y[i] = e;
+    if (f >= cutoff)
+      sum += e;
+  }
+  return sum;
+}
+
+}  // namespace
+
+#ifdef KALDI_VECTORIZED_MATH_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+namespace avx2 {
+
+struct Ops {
+  typedef __m256 V;
+  typedef __m256i I;
+  static const int32 kWidth = 8;
+  static inline V Load(const float *p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm256_storeu_ps(p, a); }
+  static inline V Set1(float f) { return _mm256_set1_ps(f); }
+  static inline V Add(V a, V b) { return _mm256_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm256_div_ps(a, b); }
+  // Returns a * b + c.
+  static inline V Fma(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static inline V Max(V a, V b) { return _mm256_max_ps(a, b); }
+  static inline V Min(V a, V b) { return _mm256_min_ps(a, b); }
+  static inline V Round(V a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static inline I ToInt(V a) { return _mm256_cvtps_epi32(a); }
+  static inline V ToFloat(I a) { return _mm256_cvtepi32_ps(a); }
+  static inline I IntAdd(I a, int32 b) {
+    return _mm256_add_epi32(a, _mm256_set1_epi32(b));
+  }
+  static inline I IntSub(I a, I b) { return _mm256_sub_epi32(a, b); }
+  static inline I IntAnd(I a, uint32 b) {
+    return _mm256_and_si256(a, _mm256_set1_epi32(static_cast<int32>(b)));
+  }
+  static inline I IntOr(I a, uint32 b) {
+    return _mm256_or_si256(a, _mm256_set1_epi32(static_cast<int32>(b)));
+  }
+  static inline I IntOr(I a, I b) { return _mm256_or_si256(a, b); }
+  template<int kBits> static inline I ShiftRightArith(I a) {
+    return _mm256_srai_epi32(a, kBits);
+  }
+  template<int kBits> static inline I ShiftRightLogical(I a) {
+    return _mm256_srli_epi32(a, kBits);
+  }
+  static inline V AsFloat(I a) { return _mm256_castsi256_ps(a); }
+  static inline I AsInt(V a) { return _mm256_castps_si256(a); }
+  // Returns 2^n, for -126 <= n <= 127.
+  static inline V Pow2(I n) {
+    return AsFloat(_mm256_slli_epi32(IntAdd(n, 127), 23));
+  }
+  // Returns (a < b ? t : f), elementwise.
+  static inline V SelectLt(V a, V b, V t, V f) {
+    return _mm256_blendv_ps(f, t, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+  // Returns (a == b ? t : f), elementwise.
+  static inline V SelectEq(V a, V b, V t, V f) {
+    return _mm256_blendv_ps(f, t, _mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+  }
+  // Returns (a is NaN ? t : f), elementwise.
+  static inline V SelectNan(V a, V t, V f) {
+    return _mm256_blendv_ps(f, t, _mm256_cmp_ps(a, a, _CMP_UNORD_Q));
+  }
+  static inline float Sum(V a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a),
+                          _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  }
+  static inline void ZeroUpper() { _mm256_zeroupper(); }
+};
+
+#include "matrix/vectorized-math-inl.h"
+
+}  // namespace avx2
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// The AVX-512 intrinsics in GCC's headers pass an "undefined" vector as the
+// pass-through operand of the masked instructions, which makes some GCC
+// versions (e.g. 12) give false -Wmaybe-uninitialized warnings when they are
+// inlined here.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+namespace avx512 {
+
+struct Ops {
+  typedef __m512 V;
+  typedef __m512i I;
+  static const int32 kWidth = 16;
+  static inline V Load(const float *p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float *p, V a) { _mm512_storeu_ps(p, a); }
+  static inline V Set1(float f) { return _mm512_set1_ps(f); }
+  static inline V Add(V a, V b) { return _mm512_add_ps(a, b); }
+  static inline V Sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static inline V Mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static inline V Div(V a, V b) { return _mm512_div_ps(a, b); }
+  static inline V Fma(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+  static inline V Max(V a, V b) { return _mm512_max_ps(a, b); }
+  static inline V Min(V a, V b) { return _mm512_min_ps(a, b); }
+  static inline V Round(V a) {
+    return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT |
+                                _MM_FROUND_NO_EXC);
+  }
+  static inline I ToInt(V a) { return _mm512_cvtps_epi32(a); }
+  static inline V ToFloat(I a) { return _mm512_cvtepi32_ps(a); }
+  static inline I IntAdd(I a, int32 b) {
+    return _mm512_add_epi32(a, _mm512_set1_epi32(b));
+  }
+  static inline I IntSub(I a, I b) { return _mm512_sub_epi32(a, b); }
+  static inline I IntAnd(I a, uint32 b) {
+    return _mm512_and_si512(a, _mm512_set1_epi32(static_cast<int32>(b)));
+  }
+  static inline I IntOr(I a, uint32 b) {
+    return _mm512_or_si512(a, _mm512_set1_epi32(static_cast<int32>(b)));
+  }
+  static inline I IntOr(I a, I b) { return _mm512_or_si512(a, b); }
+  template<int kBits> static inline I ShiftRightArith(I a) {
+    return _mm512_srai_epi32(a, kBits);
+  }
+  template<int kBits> static inline I ShiftRightLogical(I a) {
+    return _mm512_srli_epi32(a, kBits);
+  }
+  static inline V AsFloat(I a) { return _mm512_castsi512_ps(a); }
+  static inline I AsInt(V a) { return _mm512_castps_si512(a); }
+  static inline V Pow2(I n) {
+    return AsFloat(_mm512_slli_epi32(IntAdd(n, 127), 23));
+  }
+  static inline V SelectLt(V a, V b, V t, V f) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), f, t);
+  }
+  static inline V SelectEq(V a, V b, V t, V f) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ), f, t);
+  }
+  static inline V SelectNan(V a, V t, V f) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q), f, t);
+  }
+  static inline float Sum(V a) { return _mm512_reduce_add_ps(a); }
+  static inline void ZeroUpper() { _mm256_zeroupper(); }
+};
+
+#include "matrix/vectorized-math-inl.h"
+
+}  // namespace avx512
+
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+
+#endif  // KALDI_VECTORIZED_MATH_X86
+
+namespace {
+
+// The float kernels for one instruction set.
+struct FloatKernels {
+  const char *name;
+  void (*exp)(const float*, float*, MatrixIndexT);
+  void (*log)(const float*, float*, MatrixIndexT);
+  void (*sigmoid)(const float*, float*, MatrixIndexT);
+  void (*tanh)(const float*, float*, MatrixIndexT);
+  void (*floor)(const float*, float, float*, MatrixIndexT);
+  double (*exp_sum)(const float*, float, float, float*, MatrixIndexT);
+};
+
+FloatKernels ChooseFloatKernels() {
+#ifdef KALDI_VECTORIZED_MATH_X86
+  // Setting the environment variable KALDI_VECTORIZED_MATH=none makes us use
+  // the C library functions, e.g. to check whether the approximations make a
+  // difference to some result.
+  const char *env = getenv("KALDI_VECTORIZED_MATH");
+  bool use_simd = (env == NULL || strcmp(env, "none") != 0);
+  __builtin_cpu_init();
+  if (use_simd && __builtin_cpu_supports("avx512f")) {
+    FloatKernels k = { "AVX-512", avx512::ExpArray, avx512::LogArray,
+                       avx512::SigmoidArray, avx512::TanhArray,
+                       avx512::FloorArray, avx512::ExpSumArray };
+    return k;
+  }
+  if (use_simd && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma")) {
+    FloatKernels k = { "AVX2", avx2::ExpArray, avx2::LogArray,
+                       avx2::SigmoidArray, avx2::TanhArray,
+                       avx2::FloorArray, avx2::ExpSumArray };
+    return k;
+  }
+#endif
+  FloatKernels k = { "none", ExpArrayGeneric<float>, LogArrayGeneric<float>,
+                     SigmoidArrayGeneric<float>, TanhArrayGeneric<float>,
+                     FloorArrayGeneric<float>, ExpSumArrayGeneric<float> };
+  return k;
+}
+
+// The initialization of function-local statics is thread-safe in C++11.
+inline const FloatKernels &GetFloatKernels() {
+  static const FloatKernels kernels = ChooseFloatKernels();
+  return kernels;
+}
+
+}  // namespace
+
+void VectorizedExp(const float *x, float *y, MatrixIndexT n) {
+  GetFloatKernels().exp(x, y, n);
+}
+void VectorizedExp(const double *x, double *y, MatrixIndexT n) {
+  ExpArrayGeneric(x, y, n);
+}
+
+void VectorizedLog(const float *x, float *y, MatrixIndexT n) {
+  GetFloatKernels().log(x, y, n);
+}
+void VectorizedLog(const double *x, double *y, MatrixIndexT n) {
+  LogArrayGeneric(x, y, n);
+}
+
+void VectorizedSigmoid(const float *x, float *y, MatrixIndexT n) {
+  GetFloatKernels().sigmoid(x, y, n);
+}
+void VectorizedSigmoid(const double *x, double *y, MatrixIndexT n) {
+  SigmoidArrayGeneric(x, y, n);
+}
+
+void VectorizedTanh(const float *x, float *y, MatrixIndexT n) {
+  GetFloatKernels().tanh(x, y, n);
+}
+void VectorizedTanh(const double *x, double *y, MatrixIndexT n) {
+  TanhArrayGeneric(x, y, n);
+}
+
+void VectorizedFloor(const float *x, float floor, float *y, MatrixIndexT n) {
+  GetFloatKernels().floor(x, floor, y, n);
+}
+void VectorizedFloor(const double *x, double floor, double *y,
+                     MatrixIndexT n) {
+  FloorArrayGeneric(x, floor, y, n);
+}
+
+double VectorizedExpSum(const float *x, float shift, float cutoff, float *y,
+                        MatrixIndexT n) {
+  return GetFloatKernels().exp_sum(x, shift, cutoff, y, n);
+}
+double VectorizedExpSum(const double *x, double shift, double cutoff,
+                        double *y, MatrixIndexT n) {
+  return ExpSumArrayGeneric(x, shift, cutoff, y, n);
+}
+
+const char *VectorizedMathInstructionSet() {
+  return GetFloatKernels().name;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,86 @@
+// matrix/vectorized-math.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_VECTORIZED_MATH_H_
+#define KALDI_MATRIX_VECTORIZED_MATH_H_ 1
+
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/**
+   @file vectorized-math.h
+
+   These functions apply exp, log and some functions derived from them to
+   arrays of numbers; they are used in the implementation of class VectorBase
+   and class MatrixBase (e.g. VectorBase::ApplyExp(), ApplySoftMax(), Sigmoid()
+   and Tanh()).
+
+   The float versions use SIMD code with polynomial approximations to exp and
+   log (the ones from the Cephes library), if the CPU they run on supports
+   AVX-512 or AVX2 with FMA; this is checked at run time, so it does not depend
+   on how Kaldi was compiled (but it requires GCC on x86-64).  The
+   relative error of exp and log is then at most about 2e-07, i.e. one or two
+   units in the last place, over the whole range of floats including
+   infinities, NaN and denormals.  On other CPUs, and for the double versions,
+   they call the C library functions; this can also be forced by setting the
+   environment variable KALDI_VECTORIZED_MATH=none.  In all of them 'x' and 'y'
+   may be the same array.
+ */
+
+/// Sets y[i] = exp(x[i]) for 0 <= i < n.
+void VectorizedExp(const float *x, float *y, MatrixIndexT n);
+void VectorizedExp(const double *x, double *y, MatrixIndexT n);
+
+/// Sets y[i] = log(x[i]) for 0 <= i < n.
+void VectorizedLog(const float *x, float *y, MatrixIndexT n);
+void VectorizedLog(const double *x, double *y, MatrixIndexT n);
+
+/// Sets y[i] = 1 / (1 + exp(-x[i])) for 0 <= i < n.
+void VectorizedSigmoid(const float *x, float *y, MatrixIndexT n);
+void VectorizedSigmoid(const double *x, double *y, MatrixIndexT n);
+
+/// Sets y[i] = tanh(x[i]) for 0 <= i < n.
+void VectorizedTanh(const float *x, float *y, MatrixIndexT n);
+void VectorizedTanh(const double *x, double *y, MatrixIndexT n);
+
+/// Sets y[i] = max(x[i], floor) for 0 <= i < n.
+void VectorizedFloor(const float *x, float floor, float *y, MatrixIndexT n);
+void VectorizedFloor(const double *x, double floor, double *y, MatrixIndexT n);
+
+/// Returns the sum over i of exp(x[i] + shift), only including the terms for
+/// which x[i] >= cutoff; and if y != NULL, also sets y[i] = exp(x[i] + shift)
+/// for all i.  This is used in the softmax and log-sum-exp functions.
+double VectorizedExpSum(const float *x, float shift, float cutoff, float *y,
+                        MatrixIndexT n);
+double VectorizedExpSum(const double *x, double shift, double cutoff,
+                        double *y, MatrixIndexT n);
+
+/// Returns a string such as "AVX2", "AVX-512" or "none" that says which
+/// instruction set the float versions of the functions above are using.
+const char *VectorizedMathInstructionSet();
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_VECTORIZED_MATH_H_
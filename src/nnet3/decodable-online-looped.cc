@@ -19,6 +19,7 @@
 
 #include "nnet3/decodable-online-looped.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-batch-compute.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -26,15 +27,18 @@ namespace nnet3 {
 DecodableNnetLoopedOnlineBase::DecodableNnetLoopedOnlineBase(
     const DecodableNnetSimpleLoopedInfo &info,
     OnlineFeatureInterface *input_features,
-    OnlineFeatureInterface *ivector_features):
+    OnlineFeatureInterface *ivector_features,
+    NnetBatchLoopedComputer *batch_computer):
     num_chunks_computed_(0),
+    num_frames_computed_(0),
     current_log_post_subsampled_offset_(-1),
     info_(info),
     frame_offset_(0),
     input_features_(input_features),
     ivector_features_(ivector_features),
-    computer_(info_.opts.compute_config, info_.computation,
-              info_.nnet, NULL) {   // NULL is 'nnet_to_update'
+    computer_(NULL),
+    current_computation_(-1),
+    batch_computer_(batch_computer) {
   // Check that feature dimensions match.
   KALDI_ASSERT(input_features_ != NULL);
   int32 nnet_input_dim = info_.nnet.InputDim("input"),
@@ -116,25 +120,53 @@ void DecodableNnetLoopedOnlineBase::SetFrameOffset(int32 frame_offset) {
 }
 
 void DecodableNnetLoopedOnlineBase::AdvanceChunk() {
+  int32 num_feature_frames_ready = input_features_->NumFramesReady();
+  bool is_finished = input_features_->IsLastFrame(num_feature_frames_ready - 1);
+
+  int32 chunk_size = info_.frames_per_chunk;
+  if (batch_computer_ == NULL) {
+    int32 frames_available = num_feature_frames_ready - num_frames_computed_;
+    if (!is_finished)
+      frames_available -= info_.frames_right_context;
+    int32 computation = info_.ChooseComputation(current_computation_,
+                                                frames_available, is_finished);
+    if (computation != current_computation_) {
+      // Start a new computation from the current frame.  This is only
+      // equivalent to continuing the old one because the network is not
+      // recurrent (see ChooseComputation()).
+      delete computer_;
+      computer_ = new NnetComputer(info_.opts.compute_config,
+                                   info_.Computation(computation),
+                                   info_.nnet,
+                                   NULL);  // NULL is 'nnet_to_update'
+      current_computation_ = computation;
+      num_chunks_computed_ = 0;
+    }
+    chunk_size = info_.ChunkSize(computation);
+  }
+
   // Prepare the input data for the next chunk of features.
   // note: 'end' means one past the last.
   int32 begin_input_frame, end_input_frame;
-  if (num_chunks_computed_ == 0) {
-    begin_input_frame = -info_.frames_left_context;
+  if (batch_computer_ != NULL) {
+    // The batched computation does not keep any state between chunks, so it
+    // needs the full left context for each chunk.
+    begin_input_frame = num_frames_computed_ - batch_computer_->LeftContext();
+    end_input_frame = num_frames_computed_ + chunk_size +
+        batch_computer_->RightContext();
+  } else if (num_chunks_computed_ == 0) {
+    begin_input_frame = num_frames_computed_ - info_.frames_left_context;
     // note: end is last plus one.
-    end_input_frame = info_.frames_per_chunk + info_.frames_right_context;
+    end_input_frame = num_frames_computed_ + chunk_size +
+        info_.frames_right_context;
   } else {
     // note: begin_input_frame will be the same as the previous end_input_frame.
     // you can verify this directly if num_chunks_computed_ == 0, and then by
     // induction.
-    begin_input_frame = num_chunks_computed_ * info_.frames_per_chunk +
-        info_.frames_right_context;
-    end_input_frame = begin_input_frame + info_.frames_per_chunk;
+    begin_input_frame = num_frames_computed_ + info_.frames_right_context;
+    end_input_frame = begin_input_frame + chunk_size;
   }
 
-  int32 num_feature_frames_ready = input_features_->NumFramesReady();
-  bool is_finished = input_features_->IsLastFrame(num_feature_frames_ready - 1);
-
   if (end_input_frame > num_feature_frames_ready && !is_finished) {
     // we shouldn't be attempting to read past the end of the available features
     // until we have reached the end of the input (i.e. the end-user called
@@ -164,75 +196,90 @@ void DecodableNnetLoopedOnlineBase::AdvanceChunk() {
     }
     feats_chunk.Swap(&this_feats);
   }
-  computer_.AcceptInput("input", &feats_chunk);
-
-  if (info_.has_ivectors) {
-    KALDI_ASSERT(ivector_features_ != NULL);
-    KALDI_ASSERT(info_.request1.inputs.size() == 2);
-    // all but the 1st chunk should have 1 iVector, but there is no need to
-    // assume this.
-    int32 num_ivectors = (num_chunks_computed_ == 0 ?
-			  info_.request1.inputs[1].indexes.size() :
-			  info_.request2.inputs[1].indexes.size());
-    KALDI_ASSERT(num_ivectors > 0);
-
-    Vector<BaseFloat> ivector(ivector_features_->Dim());
-    // we just get the iVector from the last input frame we needed,
-    // reduced as necessary
-    // we don't bother trying to be 'accurate' in getting the iVectors
-    // for their 'correct' frames, because in general using the
-    // iVector from as large 't' as possible will be better.
-
-    int32 most_recent_input_frame = num_feature_frames_ready - 1,
-      num_ivector_frames_ready = ivector_features_->NumFramesReady();
-
-    if (num_ivector_frames_ready > 0) {
-      int32 ivector_frame_to_use = std::min<int32>(
-          most_recent_input_frame, num_ivector_frames_ready - 1);
-      ivector_features_->GetFrame(ivector_frame_to_use,
-                                  &ivector);
+  if (batch_computer_ != NULL) {
+    Vector<BaseFloat> ivector;
+    GetCurrentIvector(num_feature_frames_ready, &ivector);
+    current_log_post_.Resize(0, 0);
+    batch_computer_->Compute(&feats_chunk,
+                             info_.has_ivectors ? &ivector : NULL,
+                             &current_log_post_);
+  } else {
+    computer_->AcceptInput("input", &feats_chunk);
+
+    if (info_.has_ivectors) {
+      // all but the 1st chunk should have chunk_size / info_.frames_per_chunk
+      // iVectors, but there is no need to assume this.
+      int32 num_ivectors = info_.NumIvectors(current_computation_,
+                                             num_chunks_computed_ == 0);
+      KALDI_ASSERT(num_ivectors > 0);
+
+      Vector<BaseFloat> ivector;
+      GetCurrentIvector(num_feature_frames_ready, &ivector);
+
+      // note: we expect num_ivectors to be 1 in practice.
+      Matrix<BaseFloat> ivectors(num_ivectors,
+                                 ivector.Dim());
+      ivectors.CopyRowsFromVec(ivector);
+      CuMatrix<BaseFloat> cu_ivectors;
+      cu_ivectors.Swap(&ivectors);
+      computer_->AcceptInput("ivector", &cu_ivectors);
     }
-    // else just leave the iVector zero (would only happen with very small
-    // chunk-size, like a chunk size of 2 which would be very inefficient; and
-    // only at file begin.
-
-    // note: we expect num_ivectors to be 1 in practice.
-    Matrix<BaseFloat> ivectors(num_ivectors,
-			       ivector.Dim());
-    ivectors.CopyRowsFromVec(ivector);
-    CuMatrix<BaseFloat> cu_ivectors;
-    cu_ivectors.Swap(&ivectors);
-    computer_.AcceptInput("ivector", &cu_ivectors);
-  }
-  computer_.Run();
-
-  {
-    // Note: it's possible in theory that if you had weird recurrence that went
-    // directly from the output, the call to GetOutputDestructive() would cause
-    // a crash on the next chunk.  If that happens, GetOutput() should be used
-    // instead of GetOutputDestructive().  But we don't anticipate this will
-    // happen in practice.
-    CuMatrix<BaseFloat> output;
-    computer_.GetOutputDestructive("output", &output);
-
-    if (info_.log_priors.Dim() != 0) {
-      // subtract log-prior (divide by prior)
-      output.AddVecToRows(-1.0, info_.log_priors);
+    computer_->Run();
+
+    {
+      // Note: it's possible in theory that if you had weird recurrence that
+      // went directly from the output, the call to GetOutputDestructive() would
+      // cause a crash on the next chunk.  If that happens, GetOutput() should
+      // be used instead of GetOutputDestructive().  But we don't anticipate
+      // this will happen in practice.
+      CuMatrix<BaseFloat> output;
+      computer_->GetOutputDestructive("output", &output);
+
+      if (info_.log_priors.Dim() != 0) {
+        // subtract log-prior (divide by prior)
+        output.AddVecToRows(-1.0, info_.log_priors);
+      }
+      // apply the acoustic scale
+      output.Scale(info_.opts.acoustic_scale);
+      current_log_post_.Resize(0, 0);
+      current_log_post_.Swap(&output);
     }
-    // apply the acoustic scale
-    output.Scale(info_.opts.acoustic_scale);
-    current_log_post_.Resize(0, 0);
-    current_log_post_.Swap(&output);
   }
-  KALDI_ASSERT(current_log_post_.NumRows() == info_.frames_per_chunk /
+  KALDI_ASSERT(current_log_post_.NumRows() == chunk_size /
                info_.opts.frame_subsampling_factor &&
                current_log_post_.NumCols() == info_.output_dim);
 
   num_chunks_computed_++;
 
   current_log_post_subsampled_offset_ =
-      (num_chunks_computed_ - 1) *
-      (info_.frames_per_chunk / info_.opts.frame_subsampling_factor);
+      num_frames_computed_ / info_.opts.frame_subsampling_factor;
+  num_frames_computed_ += chunk_size;
+}
+
+void DecodableNnetLoopedOnlineBase::GetCurrentIvector(
+    int32 num_feature_frames_ready, Vector<BaseFloat> *ivector) {
+  if (!info_.has_ivectors)
+    return;
+  KALDI_ASSERT(ivector_features_ != NULL);
+  ivector->Resize(ivector_features_->Dim());
+  // we just get the iVector from the last input frame we needed,
+  // reduced as necessary
+  // we don't bother trying to be 'accurate' in getting the iVectors
+  // for their 'correct' frames, because in general using the
+  // iVector from as large 't' as possible will be better.
+
+  int32 most_recent_input_frame = num_feature_frames_ready - 1,
+    num_ivector_frames_ready = ivector_features_->NumFramesReady();
+
+  if (num_ivector_frames_ready > 0) {
+    int32 ivector_frame_to_use = std::min<int32>(
+        most_recent_input_frame, num_ivector_frames_ready - 1);
+    ivector_features_->GetFrame(ivector_frame_to_use,
+                                ivector);
+  }
+  // else just leave the iVector zero (would only happen with very small
+  // chunk-size, like a chunk size of 2 which would be very inefficient; and
+  // only at file begin.
 }
 
 BaseFloat DecodableNnetLoopedOnline::LogLikelihood(int32 subsampled_frame,
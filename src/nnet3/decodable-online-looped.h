@@ -33,6 +33,7 @@
 namespace kaldi {
 namespace nnet3 {
 
+class NnetBatchLoopedComputer;  // declared in nnet-batch-compute.h
 
 // The Decodable objects that we define in this header do the neural net
 // computation in a way that's compatible with online feature extraction.  It
@@ -57,10 +58,17 @@ class DecodableNnetLoopedOnlineBase: public DecodableInterface {
  public:
   // Constructor.  'input_feature' is for the feature that will be given
   // as 'input' to the neural network; 'ivector_feature' is for the iVector
-  // feature, or NULL if iVectors are not being used.
+  // feature, or NULL if iVectors are not being used.  If 'batch_computer' is
+  // non-NULL, the chunks are computed by it, together with those of other
+  // streams, instead of by the looped computation (see
+  // NnetBatchLoopedComputer); the --adaptive-frames-per-chunk option is then
+  // not used.
   DecodableNnetLoopedOnlineBase(const DecodableNnetSimpleLoopedInfo &info,
                                  OnlineFeatureInterface *input_features,
-                                 OnlineFeatureInterface *ivector_features);
+                                 OnlineFeatureInterface *ivector_features,
+                                 NnetBatchLoopedComputer *batch_computer = NULL);
+
+  virtual ~DecodableNnetLoopedOnlineBase() { delete computer_; }
 
   // note: the LogLikelihood function is not overridden; the child
   // class needs to do this.
@@ -112,12 +120,14 @@ class DecodableNnetLoopedOnlineBase: public DecodableInterface {
   // ran the computation.
   Matrix<BaseFloat> current_log_post_;
 
-  // The number of chunks we have computed so far.
+  // The number of chunks we have computed so far with computer_ (or with
+  // batch_computer_, if set).
   int32 num_chunks_computed_;
 
-  // The time-offset of the current log-posteriors, equals
-  // (num_chunks_computed_ - 1) *
-  //    (info_.frames_per_chunk_ / info_.opts_.frame_subsampling_factor).
+  // The number of (non-subsampled) output frames computed so far.
+  int32 num_frames_computed_;
+
+  // The time-offset of the current log-posteriors, in subsampled frames.
   int32 current_log_post_subsampled_offset_;
 
   const DecodableNnetSimpleLoopedInfo &info_;
@@ -134,10 +144,20 @@ class DecodableNnetLoopedOnlineBase: public DecodableInterface {
   // increment num_chunks_computed_.
   void AdvanceChunk();
 
+  // Gets the iVector to use for a chunk, if we are using iVectors.
+  void GetCurrentIvector(int32 num_feature_frames_ready,
+                         Vector<BaseFloat> *ivector);
+
   OnlineFeatureInterface *input_features_;
   OnlineFeatureInterface *ivector_features_;
 
-  NnetComputer computer_;
+  // The computer for info_.Computation(current_computation_); it is created
+  // afresh each time the computation changes.  NULL if batching.
+  NnetComputer *computer_;
+  // The computation in use, or -1 before the first chunk.
+  int32 current_computation_;
+
+  NnetBatchLoopedComputer *batch_computer_;  // NULL if not batching.
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableNnetLoopedOnlineBase);
 };
@@ -155,8 +175,10 @@ class DecodableNnetLoopedOnline: public DecodableNnetLoopedOnlineBase {
   DecodableNnetLoopedOnline(
       const DecodableNnetSimpleLoopedInfo &info,
       OnlineFeatureInterface *input_features,
-      OnlineFeatureInterface *ivector_features):
-      DecodableNnetLoopedOnlineBase(info, input_features, ivector_features) { }
+      OnlineFeatureInterface *ivector_features,
+      NnetBatchLoopedComputer *batch_computer = NULL):
+      DecodableNnetLoopedOnlineBase(info, input_features, ivector_features,
+                                    batch_computer) { }
 
 
   // returns the output-dim of the neural net.
@@ -186,8 +208,10 @@ class DecodableAmNnetLoopedOnline: public DecodableNnetLoopedOnlineBase {
       const TransitionModel &trans_model,
       const DecodableNnetSimpleLoopedInfo &info,
       OnlineFeatureInterface *input_features,
-      OnlineFeatureInterface *ivector_features):
-      DecodableNnetLoopedOnlineBase(info, input_features, ivector_features),
+      OnlineFeatureInterface *ivector_features,
+      NnetBatchLoopedComputer *batch_computer = NULL):
+      DecodableNnetLoopedOnlineBase(info, input_features, ivector_features,
+                                    batch_computer),
       trans_model_(trans_model) { }
 
 
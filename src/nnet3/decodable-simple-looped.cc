@@ -87,6 +87,95 @@ void DecodableNnetSimpleLoopedInfo::Init(
   computation.ComputeCudaIndexes();
   KALDI_VLOG(3) << "Computation is:\n"
                 << NnetComputationPrintInserter{computation, *nnet};
+
+  adaptive_chunk_sizes.clear();
+  adaptive_computations.clear();
+  adaptive_num_ivectors.clear();
+  if (opts.adaptive_frames_per_chunk.empty())
+    return;
+  std::vector<int32> sizes;
+  if (!SplitStringToIntegers(opts.adaptive_frames_per_chunk, ",", false,
+                             &sizes))
+    KALDI_ERR << "Invalid option --adaptive-frames-per-chunk="
+              << opts.adaptive_frames_per_chunk;
+  if (NnetIsRecurrent(*nnet)) {
+    // Changing the computation discards the recurrent state, which would
+    // change the output.
+    KALDI_WARN << "Ignoring --adaptive-frames-per-chunk because the network "
+               << "is recurrent.";
+    return;
+  }
+  for (size_t i = 0; i < sizes.size(); i++) {
+    if (sizes[i] <= 0)
+      KALDI_ERR << "Invalid option --adaptive-frames-per-chunk="
+                << opts.adaptive_frames_per_chunk;
+    // Rounding to a multiple of frames_per_chunk makes it a multiple of the
+    // iVector period, and keeps all chunk boundaries on multiples of
+    // frames_per_chunk, which NumFramesReady() of the online decodable relies
+    // on.
+    int32 size = frames_per_chunk *
+        ((sizes[i] + frames_per_chunk - 1) / frames_per_chunk);
+    if (size > frames_per_chunk)
+      adaptive_chunk_sizes.push_back(size);
+  }
+  SortAndUniq(&adaptive_chunk_sizes);
+
+  int32 num_adaptive = adaptive_chunk_sizes.size();
+  adaptive_computations.resize(num_adaptive);
+  for (int32 i = 0; i < num_adaptive; i++) {
+    ComputationRequest r1, r2, r3;
+    CreateLoopedComputationRequest(*nnet, adaptive_chunk_sizes[i],
+                                   opts.frame_subsampling_factor,
+                                   ivector_period,
+                                   frames_left_context,
+                                   frames_right_context,
+                                   num_sequences, &r1, &r2, &r3);
+    CompileLooped(*nnet, opts.optimize_config, r1, r2, r3,
+                  &(adaptive_computations[i]));
+    adaptive_computations[i].ComputeCudaIndexes();
+    adaptive_num_ivectors.push_back(std::pair<int32, int32>(
+        has_ivectors ? r1.inputs[1].indexes.size() : 0,
+        has_ivectors ? r2.inputs[1].indexes.size() : 0));
+  }
+  KALDI_VLOG(1) << "Compiled looped computations for " << num_adaptive
+                << " additional chunk sizes.";
+}
+
+int32 DecodableNnetSimpleLoopedInfo::NumIvectors(int32 c,
+                                                 bool first_chunk) const {
+  if (!has_ivectors)
+    return 0;
+  if (c == 0) {
+    KALDI_ASSERT(request1.inputs.size() == 2);
+    return (first_chunk ? request1.inputs[1].indexes.size() :
+            request2.inputs[1].indexes.size());
+  }
+  return (first_chunk ? adaptive_num_ivectors[c - 1].first :
+          adaptive_num_ivectors[c - 1].second);
+}
+
+int32 DecodableNnetSimpleLoopedInfo::ChooseComputation(
+    int32 current_computation, int32 frames_available,
+    bool input_finished) const {
+  int32 num_computations = NumComputations();
+  if (num_computations == 1)
+    return 0;
+  // 'largest' is the largest computation whose chunk fits in the available
+  // frames, or -1 if none does.
+  int32 largest = num_computations - 1;
+  while (largest >= 0 && ChunkSize(largest) > frames_available)
+    largest--;
+  if (current_computation < 0 || largest > current_computation)
+    return std::max<int32>(largest, 0);
+  if (ChunkSize(current_computation) <= frames_available)
+    return current_computation;
+  // The current chunk size is too large.  If the input has finished we could
+  // keep it and pad the input; we do so if the padding takes less time than
+  // the left context that changing the computation would recompute.
+  if (input_finished && ChunkSize(current_computation) - frames_available <=
+      frames_left_context)
+    return current_computation;
+  return std::max<int32>(largest, 0);
 }
 
 
@@ -97,12 +186,13 @@ DecodableNnetSimpleLooped::DecodableNnetSimpleLooped(
     const MatrixBase<BaseFloat> *online_ivectors,
     int32 online_ivector_period):
     info_(info),
-    computer_(info_.opts.compute_config, info_.computation,
-              info_.nnet, NULL),  // NULL is 'nnet_to_update'
+    computer_(NULL),
+    current_computation_(-1),
     feats_(feats),
     ivector_(ivector), online_ivector_feats_(online_ivectors),
     online_ivector_period_(online_ivector_period),
     num_chunks_computed_(0),
+    num_frames_computed_(0),
     current_log_post_subsampled_offset_(-1) {
   num_subsampled_frames_ =
       (feats_.NumRows() + info_.opts.frame_subsampling_factor - 1) /
@@ -135,15 +225,30 @@ int32 DecodableNnetSimpleLooped::GetIvectorDim() const {
 
 
 void DecodableNnetSimpleLooped::AdvanceChunk() {
+  int32 computation = info_.ChooseComputation(
+      current_computation_, feats_.NumRows() - num_frames_computed_, true);
+  if (computation != current_computation_) {
+    // Start a new computation from the current frame.  This is only
+    // equivalent to continuing the old one because the network is not
+    // recurrent (see ChooseComputation()).
+    delete computer_;
+    computer_ = new NnetComputer(info_.opts.compute_config,
+                                 info_.Computation(computation),
+                                 info_.nnet, NULL);  // NULL is 'nnet_to_update'
+    current_computation_ = computation;
+    num_chunks_computed_ = 0;
+  }
+  int32 chunk_size = info_.ChunkSize(computation);
+
   int32 begin_input_frame, end_input_frame;
   if (num_chunks_computed_ == 0) {
-    begin_input_frame = -info_.frames_left_context;
+    begin_input_frame = num_frames_computed_ - info_.frames_left_context;
     // note: end is last plus one.
-    end_input_frame = info_.frames_per_chunk + info_.frames_right_context;
-  } else {
-    begin_input_frame = num_chunks_computed_ * info_.frames_per_chunk +
+    end_input_frame = num_frames_computed_ + chunk_size +
         info_.frames_right_context;
-    end_input_frame = begin_input_frame + info_.frames_per_chunk;
+  } else {
+    begin_input_frame = num_frames_computed_ + info_.frames_right_context;
+    end_input_frame = begin_input_frame + chunk_size;
   }
   CuMatrix<BaseFloat> feats_chunk(end_input_frame - begin_input_frame,
                                   feats_.NumCols(), kUndefined);
@@ -167,15 +272,13 @@ void DecodableNnetSimpleLooped::AdvanceChunk() {
     }
     feats_chunk.CopyFromMat(this_feats);
   }
-  computer_.AcceptInput("input", &feats_chunk);
+  computer_->AcceptInput("input", &feats_chunk);
 
   if (info_.has_ivectors) {
-    KALDI_ASSERT(info_.request1.inputs.size() == 2);
-    // all but the 1st chunk should have 1 iVector, but no need
-    // to assume this.
-    int32 num_ivectors = (num_chunks_computed_ == 0 ?
-			  info_.request1.inputs[1].indexes.size() :
-			  info_.request2.inputs[1].indexes.size());
+    // all but the 1st chunk should have chunk_size / info_.frames_per_chunk
+    // iVectors, but no need to assume this.
+    int32 num_ivectors = info_.NumIvectors(computation,
+                                           num_chunks_computed_ == 0);
     KALDI_ASSERT(num_ivectors > 0);
 
     Vector<BaseFloat> ivector;
@@ -188,9 +291,9 @@ void DecodableNnetSimpleLooped::AdvanceChunk() {
 			       ivector.Dim());
     ivectors.CopyRowsFromVec(ivector);
     CuMatrix<BaseFloat> cu_ivectors(ivectors);
-    computer_.AcceptInput("ivector", &cu_ivectors);
+    computer_->AcceptInput("ivector", &cu_ivectors);
   }
-  computer_.Run();
+  computer_->Run();
 
   {
     // Note: it's possible in theory that if you had weird recurrence that went
@@ -199,7 +302,7 @@ void DecodableNnetSimpleLooped::AdvanceChunk() {
     // instead of GetOutputDestructive().  But we don't anticipate this will
     // happen in practice.
     CuMatrix<BaseFloat> output;
-    computer_.GetOutputDestructive("output", &output);
+    computer_->GetOutputDestructive("output", &output);
 
     if (info_.log_priors.Dim() != 0) {
       // subtract log-prior (divide by prior)
@@ -210,15 +313,15 @@ void DecodableNnetSimpleLooped::AdvanceChunk() {
     current_log_post_.Resize(0, 0);
     current_log_post_.Swap(&output);
   }
-  KALDI_ASSERT(current_log_post_.NumRows() == info_.frames_per_chunk /
+  KALDI_ASSERT(current_log_post_.NumRows() == chunk_size /
                info_.opts.frame_subsampling_factor &&
                current_log_post_.NumCols() == info_.output_dim);
 
   num_chunks_computed_++;
 
   current_log_post_subsampled_offset_ =
-      (num_chunks_computed_ - 1) *
-      (info_.frames_per_chunk / info_.opts.frame_subsampling_factor);
+      num_frames_computed_ / info_.opts.frame_subsampling_factor;
+  num_frames_computed_ += chunk_size;
 }
 
 
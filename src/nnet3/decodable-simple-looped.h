@@ -47,6 +47,7 @@ struct NnetSimpleLoopedComputationOptions {
   int32 extra_left_context_initial;
   int32 frame_subsampling_factor;
   int32 frames_per_chunk;
+  std::string adaptive_frames_per_chunk;
   BaseFloat acoustic_scale;
   bool debug_computation;
   NnetOptimizeOptions optimize_config;
@@ -81,6 +82,17 @@ struct NnetSimpleLoopedComputationOptions {
                    "--frame-subsampling-factor options is used (i.e. counts "
                    "input frames.  This is only advisory (may be rounded up "
                    "if needed.");
+    opts->Register("adaptive-frames-per-chunk", &adaptive_frames_per_chunk,
+                   "Comma-separated list of chunk sizes larger than "
+                   "--frames-per-chunk (e.g. '60,150'; each is rounded up to a "
+                   "multiple of it) for which looped computations are also "
+                   "compiled.  For each chunk, the largest size for which "
+                   "enough input is ready is used, so a stream that has fallen "
+                   "behind is processed in larger, more efficient chunks while "
+                   "one that is keeping up keeps the latency of "
+                   "--frames-per-chunk.  Each change of chunk size recomputes "
+                   "the model's left context.  Ignored for recurrent "
+                   "networks, whose state cannot be carried across sizes.");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
 
@@ -151,6 +163,41 @@ class DecodableNnetSimpleLoopedInfo  {
 
   // The compiled, 'looped' computation.
   NnetComputation computation;
+
+  // The following are only nonempty if the --adaptive-frames-per-chunk option
+  // was used.  They hold, in increasing order of chunk size, the larger chunk
+  // sizes (multiples of frames_per_chunk), the looped computations compiled
+  // for them, and the number of iVectors those need for the first and for
+  // later chunks.
+  std::vector<int32> adaptive_chunk_sizes;
+  std::vector<NnetComputation> adaptive_computations;
+  std::vector<std::pair<int32, int32> > adaptive_num_ivectors;
+
+  // The number of looped computations; computation 0 is 'computation' and
+  // computation c > 0 is adaptive_computations[c - 1].
+  int32 NumComputations() const { return 1 + adaptive_chunk_sizes.size(); }
+
+  // The chunk size (in input frames) of computation c.
+  int32 ChunkSize(int32 c) const {
+    return (c == 0 ? frames_per_chunk : adaptive_chunk_sizes[c - 1]);
+  }
+
+  const NnetComputation &Computation(int32 c) const {
+    return (c == 0 ? computation : adaptive_computations[c - 1]);
+  }
+
+  // The number of iVectors that computation c needs for its first chunk if
+  // first_chunk == true, else for its later chunks; zero if !has_ivectors.
+  int32 NumIvectors(int32 c, bool first_chunk) const;
+
+  // Returns the computation to use for the next chunk, given the computation
+  // used for the previous chunk ('current_computation', or -1 if this is the
+  // first chunk) and the number of input frames available from the start of
+  // the chunk to the end of the input (not counting the right context).  If
+  // the input is not finished, the chunk size it returns is never more than
+  // 'frames_available' as long as that is at least frames_per_chunk.
+  int32 ChooseComputation(int32 current_computation, int32 frames_available,
+                          bool input_finished) const;
 };
 
 /*
@@ -187,6 +234,7 @@ class DecodableNnetSimpleLooped {
                             const MatrixBase<BaseFloat> *online_ivectors = NULL,
                             int32 online_ivector_period = 1);
 
+  ~DecodableNnetSimpleLooped() { delete computer_; }
 
   // returns the number of frames of likelihoods.  The same as feats_.NumRows()
   // in the normal case (but may be less if opts_.frame_subsampling_factor !=
@@ -234,7 +282,11 @@ class DecodableNnetSimpleLooped {
 
   const DecodableNnetSimpleLoopedInfo &info_;
 
-  NnetComputer computer_;
+  // The computer for info_.Computation(current_computation_); it is created
+  // afresh each time the computation changes.
+  NnetComputer *computer_;
+  // The computation in use, or -1 before the first chunk.
+  int32 current_computation_;
 
   const MatrixBase<BaseFloat> &feats_;
   // note: num_subsampled_frames_ will equal feats_.NumRows() in the normal case
@@ -255,12 +307,13 @@ class DecodableNnetSimpleLooped {
   // ran the computation.
   Matrix<BaseFloat> current_log_post_;
 
-  // The number of chunks we have computed so far.
+  // The number of chunks computed so far with computer_.
   int32 num_chunks_computed_;
 
-  // The time-offset of the current log-posteriors, equals
-  // (num_chunks_computed_ - 1) *
-  //    (info_.frames_per_chunk_ / info_.opts_.frame_subsampling_factor).
+  // The number of (non-subsampled) output frames computed so far.
+  int32 num_frames_computed_;
+
+  // The time-offset of the current log-posteriors, in subsampled frames.
   int32 current_log_post_subsampled_offset_;
 };
 
@@ -17,12 +17,89 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
 #include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-simple-component.h"
 #include "nnet3/nnet-utils.h"
 
 namespace kaldi {
 namespace nnet3 {
 
+// If the descriptor of 'node' (an output or component-input node) just
+// forwards the output of a component-node, returns the index of that
+// component-node; otherwise returns -1.
+static int32 GetForwardedComponentNode(const Nnet &nnet, int32 node) {
+  std::ostringstream os;
+  nnet.GetNode(node).descriptor.WriteConfig(os, nnet.GetNodeNames());
+  int32 ans = nnet.GetNodeIndex(os.str());
+  return (ans != -1 && nnet.IsComponentNode(ans) ? ans : -1);
+}
+
+bool NnetLazyOutputInfo::GetFinalLayer(const Nnet &nnet, int32 *affine_node,
+                                       bool *has_log_softmax) {
+  int32 output_node = nnet.GetNodeIndex("output");
+  if (output_node == -1 || !nnet.IsOutputNode(output_node))
+    return false;
+  int32 node = GetForwardedComponentNode(nnet, output_node);
+  if (node == -1)
+    return false;
+  const Component *c = nnet.GetComponent(nnet.GetNode(node).u.component_index);
+  *has_log_softmax = (dynamic_cast<const LogSoftmaxComponent*>(c) != NULL);
+  if (*has_log_softmax) {
+    // the component-input node of a component-node is the one before it.
+    node = GetForwardedComponentNode(nnet, node - 1);
+    if (node == -1)
+      return false;
+    c = nnet.GetComponent(nnet.GetNode(node).u.component_index);
+  }
+  if (dynamic_cast<const AffineComponent*>(c) == NULL)
+    return false;
+  *affine_node = node;
+  return true;
+}
+
+bool NnetLazyOutputInfo::IsSupported(const Nnet &nnet) {
+  int32 affine_node;
+  bool has_log_softmax;
+  return GetFinalLayer(nnet, &affine_node, &has_log_softmax);
+}
+
+NnetLazyOutputInfo::NnetLazyOutputInfo(const Nnet &nnet): trunk_(nnet) {
+  int32 affine_node;
+  if (!GetFinalLayer(nnet, &affine_node, &has_log_softmax_))
+    KALDI_ERR << "The --lazy-output option requires the network's output to "
+              << "come directly from an affine component, or from a "
+              << "log-softmax that comes directly from one.";
+  const AffineComponent *affine = dynamic_cast<const AffineComponent*>(
+      nnet.GetComponent(nnet.GetNode(affine_node).u.component_index));
+  linear_params_.Resize(affine->OutputDim(), affine->InputDim(), kUndefined);
+  affine->LinearParams().CopyToMat(&linear_params_);
+  bias_params_.Resize(affine->OutputDim(), kUndefined);
+  affine->BiasParams().CopyToVec(&bias_params_);
+
+  // Make the trunk's output the input of the affine component (whose
+  // component-input node is the one before it), and remove what is no longer
+  // used.
+  std::ostringstream config;
+  config << "output-node name=output input=";
+  nnet.GetNode(affine_node - 1).descriptor.WriteConfig(config,
+                                                       nnet.GetNodeNames());
+  std::istringstream config_is(config.str());
+  trunk_.ReadConfig(config_is);
+  trunk_.RemoveOrphanNodes();
+  trunk_.RemoveOrphanComponents();
+  KALDI_LOG << "Computing the final layer of the network lazily; output-dim "
+            << "is " << OutputDim() << ", its input-dim is "
+            << trunk_.OutputDim("output") << (has_log_softmax_ ?
+            ", log-softmax normalizer will be omitted." : ".");
+}
+
+void NnetLazyOutputInfo::ComputeOutputs(const VectorBase<BaseFloat> &input,
+                                        VectorBase<BaseFloat> *output) const {
+  output->CopyFromVec(bias_params_);
+  output->AddMatVec(1.0, linear_params_, kNoTrans, input, 1.0);
+}
+
 
 DecodableNnetSimple::DecodableNnetSimple(
     const NnetSimpleComputationOptions &opts,
@@ -32,16 +109,19 @@ DecodableNnetSimple::DecodableNnetSimple(
     CachingOptimizingCompiler *compiler,
     const VectorBase<BaseFloat> *ivector,
     const MatrixBase<BaseFloat> *online_ivectors,
-    int32 online_ivector_period):
+    int32 online_ivector_period,
+    const NnetLazyOutputInfo *lazy_output_info):
     opts_(opts),
     nnet_(nnet),
-    output_dim_(nnet_.OutputDim("output")),
+    output_dim_(lazy_output_info != NULL ? lazy_output_info->OutputDim() :
+                nnet_.OutputDim("output")),
     log_priors_(priors),
     feats_(feats),
     ivector_(ivector), online_ivector_feats_(online_ivectors),
     online_ivector_period_(online_ivector_period),
     compiler_(*compiler),
-    current_log_post_subsampled_offset_(0) {
+    current_log_post_subsampled_offset_(0),
+    lazy_output_info_(lazy_output_info) {
   num_subsampled_frames_ =
       (feats_.NumRows() + opts_.frame_subsampling_factor - 1) /
       opts_.frame_subsampling_factor;
@@ -51,6 +131,9 @@ DecodableNnetSimple::DecodableNnetSimple(
   KALDI_ASSERT(!(online_ivectors != NULL && online_ivector_period <= 0 &&
                  "You need to set the --online-ivector-period option!"));
   log_priors_.ApplyLog();
+  if (opts_.lazy_output && lazy_output_info == NULL)
+    KALDI_ERR << "The --lazy-output option is not supported by this program.";
+  KALDI_ASSERT(lazy_output_info == NULL || &nnet == &lazy_output_info->Trunk());
   CheckAndFixConfigs();
 }
 
@@ -63,12 +146,16 @@ DecodableAmNnetSimple::DecodableAmNnetSimple(
     const VectorBase<BaseFloat> *ivector,
     const MatrixBase<BaseFloat> *online_ivectors,
     int32 online_ivector_period,
-    CachingOptimizingCompiler *compiler):
-    compiler_(am_nnet.GetNnet(), opts.optimize_config, opts.compiler_config),
-    decodable_nnet_(opts, am_nnet.GetNnet(), am_nnet.Priors(),
+    CachingOptimizingCompiler *compiler,
+    const NnetLazyOutputInfo *lazy_output_info):
+    compiler_(lazy_output_info != NULL ? lazy_output_info->Trunk() :
+              am_nnet.GetNnet(), opts.optimize_config, opts.compiler_config),
+    decodable_nnet_(opts, lazy_output_info != NULL ?
+                    lazy_output_info->Trunk() : am_nnet.GetNnet(),
+                    am_nnet.Priors(),
                     feats, compiler != NULL ? compiler : &compiler_,
                     ivector, online_ivectors,
-                    online_ivector_period),
+                    online_ivector_period, lazy_output_info),
     trans_model_(trans_model) {
   // note: we only use compiler_ if the passed-in 'compiler' is NULL.
 }
@@ -81,6 +168,18 @@ BaseFloat DecodableAmNnetSimple::LogLikelihood(int32 frame,
   return decodable_nnet_.GetOutput(frame, pdf_id);
 }
 
+bool DecodableAmNnetSimple::GetFrameLogLikelihoods(int32 frame,
+                                                   const BaseFloat **row,
+                                                   const int32 **index_map,
+                                                   BaseFloat *scale) {
+  if (decodable_nnet_.LazyOutput())
+    return false;  // we don't want to compute the whole row.
+  *row = decodable_nnet_.GetOutputRow(frame);
+  *index_map = &(trans_model_.TransitionIdToPdfArray()[0]);
+  *scale = 1.0;  // the acoustic scale was already applied.
+  return true;
+}
+
 int32 DecodableNnetSimple::GetIvectorDim() const {
   if (ivector_ != NULL)
     return ivector_->Dim();
@@ -174,10 +273,55 @@ void DecodableNnetSimple::GetOutputForFrame(int32 subsampled_frame,
       subsampled_frame >= current_log_post_subsampled_offset_ +
       current_log_post_.NumRows())
     EnsureFrameIsComputed(subsampled_frame);
+  if (lazy_output_info_ != NULL)
+    ComputeLazyOutputRow(subsampled_frame -
+                         current_log_post_subsampled_offset_);
   output->CopyFromVec(current_log_post_.Row(
       subsampled_frame - current_log_post_subsampled_offset_));
 }
 
+void DecodableNnetSimple::ComputeLazyOutput(int32 row, int32 pdf_id) {
+  BaseFloat ans = lazy_output_info_->ComputeOutput(lazy_output_input_.Row(row),
+                                                   pdf_id);
+  if (log_priors_.Dim() != 0)
+    ans -= log_priors_(pdf_id);
+  current_log_post_(row, pdf_id) = opts_.acoustic_scale * ans;
+  lazy_output_computed_[row * output_dim_ + pdf_id] = true;
+}
+
+void DecodableNnetSimple::ComputeLazyOutputRow(int32 row) {
+  SubVector<BaseFloat> this_row(current_log_post_, row);
+  Vector<BaseFloat> output(output_dim_, kUndefined);
+  lazy_output_info_->ComputeOutputs(lazy_output_input_.Row(row), &output);
+  if (log_priors_.Dim() != 0)
+    output.AddVec(-1.0, log_priors_.Vec());
+  output.Scale(opts_.acoustic_scale);
+  // Only fill in the elements not already computed, so that earlier calls to
+  // GetOutput() stay consistent with later ones.
+  std::vector<bool>::iterator computed =
+      lazy_output_computed_.begin() + row * output_dim_;
+  for (int32 i = 0; i < output_dim_; i++, ++computed) {
+    if (!*computed) {
+      this_row(i) = output(i);
+      *computed = true;
+    }
+  }
+}
+
+BaseFloat DecodableNnetSimple::GetLazyOutputOffset(int32 subsampled_frame) {
+  KALDI_ASSERT(lazy_output_info_ != NULL);
+  if (!lazy_output_info_->HasLogSoftmax())
+    return 0.0;
+  if (subsampled_frame < current_log_post_subsampled_offset_ ||
+      subsampled_frame >= current_log_post_subsampled_offset_ +
+      current_log_post_.NumRows())
+    EnsureFrameIsComputed(subsampled_frame);
+  Vector<BaseFloat> output(output_dim_, kUndefined);
+  lazy_output_info_->ComputeOutputs(lazy_output_input_.Row(
+      subsampled_frame - current_log_post_subsampled_offset_), &output);
+  return opts_.acoustic_scale * output.LogSumExp();
+}
+
 void DecodableNnetSimple::GetCurrentIvector(int32 output_t_start,
                                             int32 num_output_frames,
                                             Vector<BaseFloat> *ivector) {
@@ -264,6 +408,17 @@ void DecodableNnetSimple::DoNnetComputation(
   computer.Run();
   CuMatrix<BaseFloat> cu_output;
   computer.GetOutputDestructive("output", &cu_output);
+  if (lazy_output_info_ != NULL) {
+    // cu_output is the input of the final layer, which will be computed
+    // as needed.
+    lazy_output_input_.Resize(0, 0);
+    cu_output.Swap(&lazy_output_input_);
+    current_log_post_.Resize(num_subsampled_frames, output_dim_, kUndefined);
+    lazy_output_computed_.assign(
+        static_cast<size_t>(num_subsampled_frames) * output_dim_, false);
+    current_log_post_subsampled_offset_ = output_t_start / subsample;
+    return;
+  }
   // subtract log-prior (divide by prior)
   if (log_priors_.Dim() != 0)
     cu_output.AddVecToRows(-1.0, log_priors_);
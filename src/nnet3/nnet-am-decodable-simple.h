@@ -49,6 +49,7 @@ struct NnetSimpleComputationOptions {
   int32 frames_per_chunk;
   BaseFloat acoustic_scale;
   bool debug_computation;
+  bool lazy_output;
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
   CachingOptimizingCompilerOptions compiler_config;
@@ -61,7 +62,8 @@ struct NnetSimpleComputationOptions {
       frame_subsampling_factor(1),
       frames_per_chunk(50),
       acoustic_scale(0.1),
-      debug_computation(false) {
+      debug_computation(false),
+      lazy_output(false) {
     compiler_config.cache_capacity += frames_per_chunk;
   }
 
@@ -94,6 +96,15 @@ struct NnetSimpleComputationOptions {
                    "input frames");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("lazy-output", &lazy_output, "If true, compute the final "
+                   "affine layer of the network only for the pdf-ids that the "
+                   "decoder asks for, which is faster for models with many "
+                   "pdfs.  For models with a final log-softmax, the "
+                   "log-likelihoods are then offset by a per-frame constant, "
+                   "which does not affect the search.  Not supported by all "
+                   "programs; see class NnetLazyOutputInfo.  With this option "
+                   "the decoder processes emitting arcs in one thread, even "
+                   "if --num-emitting-threads > 1.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -138,6 +149,79 @@ struct NnetSimpleComputationOptions {
   }
 };
 
+/**
+   NnetLazyOutputInfo is used for the --lazy-output option.  For models with
+   many pdfs, the final affine layer (and the log-softmax after it, if any)
+   takes a large part of the computation, but the decoder only asks for the
+   pdf-ids on its active arcs, which are usually a small fraction of them.
+   This class splits the network into the 'trunk', which is the network with
+   its output taken from the input of the final affine component, and the
+   parameters of that component.  DecodableNnetSimple then runs the trunk on
+   each chunk and computes the final layer only for the pdf-ids it is asked
+   for.
+
+   The output node of the network must take its input directly from an
+   AffineComponent (or a child class such as NaturalGradientAffineComponent),
+   or from a LogSoftmaxComponent that takes its input directly from one.  In
+   the latter case the log-normalizer of the softmax is not computed, so the
+   outputs exceed the usual ones by an amount that depends only on the frame.
+   This does not change the result of decoding, because all the paths active
+   on a frame get the same offset and the beam is relative to the best one;
+   but it changes the acoustic costs in lattices.  See
+   DecodableNnetSimple::GetLazyOutputOffset().
+
+   Because the outputs are computed and cached as they are asked for, a
+   decodable object that uses this must not be called from several threads at
+   once.  Its GetFrameLogLikelihoods() returns false, so a decoder with
+   --num-emitting-threads > 1 falls back to processing the emitting arcs in
+   one thread.
+
+   This object is created once by the program, which should give Trunk()
+   instead of the original network to the CachingOptimizingCompiler.
+ */
+class NnetLazyOutputInfo {
+ public:
+  /// Dies if 'nnet' does not have the structure described above (see
+  /// IsSupported()).
+  explicit NnetLazyOutputInfo(const Nnet &nnet);
+
+  /// Returns true if 'nnet' has the structure described above.
+  static bool IsSupported(const Nnet &nnet);
+
+  /// The network whose output is the input of the final affine layer.
+  const Nnet &Trunk() const { return trunk_; }
+
+  /// The output dimension of the original network.
+  int32 OutputDim() const { return linear_params_.NumRows(); }
+
+  /// True if the original network has a final log-softmax.
+  bool HasLogSoftmax() const { return has_log_softmax_; }
+
+  /// Returns the output of the final affine layer for 'pdf_id', given its input
+  /// (a row of the output of Trunk()).
+  BaseFloat ComputeOutput(const VectorBase<BaseFloat> &input,
+                          int32 pdf_id) const {
+    return VecVec(input, linear_params_.Row(pdf_id)) + bias_params_(pdf_id);
+  }
+
+  /// Computes the output of the final affine layer for all pdf-ids.
+  void ComputeOutputs(const VectorBase<BaseFloat> &input,
+                      VectorBase<BaseFloat> *output) const;
+
+ private:
+  // Sets *affine_node to the component-node of the final affine component
+  // and *has_log_softmax to whether there is a log-softmax after it; returns
+  // false if 'nnet' does not have the required structure.
+  static bool GetFinalLayer(const Nnet &nnet, int32 *affine_node,
+                            bool *has_log_softmax);
+
+  Nnet trunk_;
+  Matrix<BaseFloat> linear_params_;
+  Vector<BaseFloat> bias_params_;
+  bool has_log_softmax_;
+};
+
+
 /*
   This class handles the neural net computation; it's mostly accessed
   via other wrapper classes.
@@ -177,6 +261,11 @@ class DecodableNnetSimple {
      @param [in] online_ivector_period If you are using iVectors estimated 'online'
                         (i.e. if online_ivectors != NULL) gives the periodicity
                         (in frames) with which the iVectors are estimated.
+     @param [in] lazy_output_info  If non-NULL, the final layer is only
+                        computed for the outputs that are asked for (see
+                        NnetLazyOutputInfo); 'nnet' must then be
+                        lazy_output_info->Trunk().  Required if
+                        opts.lazy_output is true.
   */
   DecodableNnetSimple(const NnetSimpleComputationOptions &opts,
                       const Nnet &nnet,
@@ -185,7 +274,8 @@ class DecodableNnetSimple {
                       CachingOptimizingCompiler *compiler,
                       const VectorBase<BaseFloat> *ivector = NULL,
                       const MatrixBase<BaseFloat> *online_ivectors = NULL,
-                      int32 online_ivector_period = 1);
+                      int32 online_ivector_period = 1,
+                      const NnetLazyOutputInfo *lazy_output_info = NULL);
 
 
   // returns the number of frames of likelihoods.  The same as feats_.NumRows()
@@ -207,13 +297,50 @@ class DecodableNnetSimple {
         subsampled_frame >= current_log_post_subsampled_offset_ +
                             current_log_post_.NumRows())
       EnsureFrameIsComputed(subsampled_frame);
-    return current_log_post_(subsampled_frame -
-                             current_log_post_subsampled_offset_,
-                             pdf_id);
+    int32 row = subsampled_frame - current_log_post_subsampled_offset_;
+    if (lazy_output_info_ != NULL &&
+        !lazy_output_computed_[row * output_dim_ + pdf_id])
+      ComputeLazyOutput(row, pdf_id);
+    return current_log_post_(row, pdf_id);
   }
+
+  // Returns a pointer to the output for a particular frame (dimension
+  // OutputDim()), with 0 <= subsampled_frame < NumFrames().  The pointer is
+  // valid until the next call to GetOutput(), GetOutputForFrame() or
+  // GetOutputRow() for a frame in a different chunk.
+  inline const BaseFloat *GetOutputRow(int32 subsampled_frame) {
+    if (subsampled_frame < current_log_post_subsampled_offset_ ||
+        subsampled_frame >= current_log_post_subsampled_offset_ +
+                            current_log_post_.NumRows())
+      EnsureFrameIsComputed(subsampled_frame);
+    if (lazy_output_info_ != NULL)
+      ComputeLazyOutputRow(subsampled_frame -
+                           current_log_post_subsampled_offset_);
+    return current_log_post_.RowData(subsampled_frame -
+                                     current_log_post_subsampled_offset_);
+  }
+
+  // Returns true if the final layer is only computed for the outputs that are
+  // asked for (see NnetLazyOutputInfo).
+  bool LazyOutput() const { return lazy_output_info_ != NULL; }
+
+  // Only applicable if LazyOutput().  Returns the amount by which all the
+  // outputs for this frame exceed the ones the original network would give,
+  // i.e. the acoustic scale times the log-normalizer of its log-softmax, or
+  // zero if it has none.  This computes the whole final layer for the frame,
+  // so it is slow; it is for checking accuracy.
+  BaseFloat GetLazyOutputOffset(int32 subsampled_frame);
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableNnetSimple);
 
+  // Computes element (row, pdf_id) of current_log_post_ from
+  // lazy_output_input_, if lazy_output_info_ != NULL.
+  void ComputeLazyOutput(int32 row, int32 pdf_id);
+
+  // Computes the elements of this row of current_log_post_ that have not
+  // been computed yet, if lazy_output_info_ != NULL.
+  void ComputeLazyOutputRow(int32 row);
+
   // This call is made to ensure that we have the log-probs for this frame
   // cached in current_log_post_.
   void EnsureFrameIsComputed(int32 subsampled_frame);
@@ -271,12 +398,24 @@ class DecodableNnetSimple {
   CachingOptimizingCompiler &compiler_;
 
   // The current log-posteriors that we got from the last time we
-  // ran the computation.
+  // ran the computation.  If lazy_output_info_ != NULL, only the elements
+  // marked in lazy_output_computed_ have been computed.
   Matrix<BaseFloat> current_log_post_;
   // The time-offset of the current log-posteriors.  Note: if
   // opts_.frame_subsampling_factor > 1, this will be measured in subsampled
   // frames.
   int32 current_log_post_subsampled_offset_;
+
+  // NULL unless we compute the final layer lazily.
+  const NnetLazyOutputInfo *lazy_output_info_;
+  // If lazy_output_info_ != NULL, the output of the trunk of the network for
+  // the frames of current_log_post_, which is the input of the final layer.
+  Matrix<BaseFloat> lazy_output_input_;
+  // If lazy_output_info_ != NULL, indexed by row * output_dim_ + pdf_id: true
+  // if that element of current_log_post_ has been computed.  (No value of the
+  // output could be used as a marker instead, as the outputs may be infinite,
+  // e.g. if a prior is zero.)
+  std::vector<bool> lazy_output_computed_;
 };
 
 class DecodableAmNnetSimple: public DecodableInterface {
@@ -313,7 +452,14 @@ class DecodableAmNnetSimple: public DecodableInterface {
                         supply pointers to it, which allows for caching of computations
                         across consecutive decodes.  You'd want to have initialized
                         the compiler object with as
-                        compiler(am_nnet.GetNnet(), opts.optimize_config).
+                        compiler(am_nnet.GetNnet(), opts.optimize_config), or
+                        with lazy_output_info->Trunk() instead of
+                        am_nnet.GetNnet() if lazy_output_info is non-NULL.
+     @param [in] lazy_output_info  If non-NULL, the final layer is only
+                        computed for the pdf-ids that the decoder asks for; see
+                        NnetLazyOutputInfo.  It must have been initialized with
+                        am_nnet.GetNnet().  Required if opts.lazy_output is
+                        true.
   */
   DecodableAmNnetSimple(const NnetSimpleComputationOptions &opts,
                         const TransitionModel &trans_model,
@@ -322,11 +468,16 @@ class DecodableAmNnetSimple: public DecodableInterface {
                         const VectorBase<BaseFloat> *ivector = NULL,
                         const MatrixBase<BaseFloat> *online_ivectors = NULL,
                         int32 online_ivector_period = 1,
-                        CachingOptimizingCompiler *compiler = NULL);
+                        CachingOptimizingCompiler *compiler = NULL,
+                        const NnetLazyOutputInfo *lazy_output_info = NULL);
 
 
   virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id);
 
+  virtual bool GetFrameLogLikelihoods(int32 frame, const BaseFloat **row,
+                                      const int32 **index_map,
+                                      BaseFloat *scale);
+
   virtual inline int32 NumFramesReady() const {
     return decodable_nnet_.NumFrames();
   }
@@ -19,6 +19,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include "nnet3/nnet-batch-compute.h"
 #include "nnet3/nnet-utils.h"
@@ -41,7 +42,8 @@ NnetBatchComputer::NnetBatchComputer(
   opts_.CheckAndFixConfigs(nnet_.Modulus());
   KALDI_ASSERT(opts_.minibatch_size >= 1 && opts_.edge_minibatch_size >= 1 &&
                opts_.partial_minibatch_factor < 1.0 &&
-               opts_.partial_minibatch_factor >= 0.0);
+               opts_.partial_minibatch_factor >= 0.0 &&
+               opts_.length_bucket_size >= 0);
 
   ComputeSimpleNnetContext(nnet, &nnet_left_context_, &nnet_right_context_);
   input_dim_ = nnet.InputDim("input");
@@ -621,10 +623,14 @@ bool NnetBatchComputer::Compute(bool allow_partial_minibatch) {
   output.Scale(opts_.acoustic_scale);
   FormatOutputs(output, tasks);
 
-  // Update the stats, for diagnostics.
-  minfo->num_done++;
-  minfo->tot_num_tasks += static_cast<int64>(tasks.size());
-  minfo->seconds_taken += tim.Elapsed();
+  {
+    // Update the stats, for diagnostics.  We need the lock because Compute()
+    // may be called from more than one thread.
+    std::unique_lock<std::mutex> lock(mutex_);
+    minfo->num_done++;
+    minfo->tot_num_tasks += static_cast<int64>(tasks.size());
+    minfo->seconds_taken += tim.Elapsed();
+  }
 
   SynchronizeGpu();
 
@@ -681,6 +687,15 @@ void GetOutputFrameInfoForTasks(
       task.is_irregular = true;
     } else {
       task.num_output_frames = fpc;
+      if (opts.length_bucket_size > 0) {
+        // Pad only up to the next multiple of the bucket size, so utterances
+        // of similar lengths share a computation.
+        int32 bucket_size = std::max<int32>(
+            1, opts.length_bucket_size / opts.frame_subsampling_factor);
+        task.num_output_frames = std::min<int32>(
+            fpc, bucket_size * ((num_subsampled_frames + bucket_size - 1) /
+                                bucket_size));
+      }
       task.num_initial_unused_output_frames = 0;
       task.num_used_output_frames = num_subsampled_frames;
       task.is_irregular = false;
@@ -1083,12 +1098,16 @@ void MergeTaskOutput(
 NnetBatchInference::NnetBatchInference(
     const NnetBatchComputerOptions &opts,
     const Nnet &nnet,
-    const VectorBase<BaseFloat> &priors):
+    const VectorBase<BaseFloat> &priors,
+    int32 num_threads):
     computer_(opts, nnet, priors),
     is_finished_(false),
-    utterance_counter_(0) {
-  // 'thread_' will run the Compute() function in the background.
-  compute_thread_ = std::thread(ComputeFunc, this);
+    utterance_counter_(0),
+    num_threads_(num_threads) {
+  KALDI_ASSERT(num_threads > 0);
+  // These threads will run the Compute() function in the background.
+  for (int32 i = 0; i < num_threads; i++)
+    compute_threads_.push_back(std::thread(ComputeFunc, this));
 }
 
 
@@ -1112,9 +1131,9 @@ void NnetBatchInference::AcceptInput(
       online_ivector_period, &(info->tasks));
 
   // Setting this to a nonzero value will cause the AcceptTask() call below to
-  // hang until the computation thread has made some progress, if too much
+  // hang until the computation threads have made some progress, if too much
   // data is already queued.
-  int32 max_full_minibatches = 2;
+  int32 max_full_minibatches = 1 + num_threads_;
 
   // Earlier utterances have higher priority, which is important to make sure
   // that their corresponding tasks are completed and they can be output to disk.
@@ -1159,15 +1178,18 @@ NnetBatchInference::~NnetBatchInference() {
     KALDI_ERR << "Object destroyed before Finished() was called.";
   if (!utts_.empty())
     KALDI_ERR << "You should get all output before destroying this object.";
-  compute_thread_.join();
+  for (size_t i = 0; i < compute_threads_.size(); i++)
+    compute_threads_[i].join();
 }
 
 void NnetBatchInference::Finished() {
   is_finished_ = true;
-  tasks_ready_semaphore_.Signal();
+  // Each computation thread consumes one of these signals when it exits.
+  for (int32 i = 0; i < num_threads_; i++)
+    tasks_ready_semaphore_.Signal();
 }
 
-// This is run as the thread of class NnetBatchInference.
+// This is run in the threads of class NnetBatchInference.
 void NnetBatchInference::Compute() {
   bool allow_partial_minibatch = false;
   while (true) {
@@ -1181,6 +1203,10 @@ void NnetBatchInference::Compute() {
       while (computer_.Compute(allow_partial_minibatch));
       return;
     }
+    // If there is more work than this thread can start on right now, wake up
+    // another thread to help.
+    if (num_threads_ > 1 && computer_.NumFullPendingMinibatches() > 1)
+      tasks_ready_semaphore_.Signal();
   }
 }
 
@@ -1524,5 +1550,163 @@ NnetBatchDecoder::~NnetBatchDecoder() {
 }
 
 
+NnetBatchLoopedComputer::NnetBatchLoopedComputer(
+    const NnetBatchLoopedComputerOptions &opts,
+    const DecodableNnetSimpleLoopedInfo &info):
+    opts_(opts),
+    info_(info),
+    nnet_(GetNnet(info)),
+    priors_(GetPriors(info)),
+    computer_(GetComputerOptions(opts, info), nnet_, priors_),
+    exit_(false) {
+  KALDI_ASSERT(opts.batch_size >= 1 && opts.max_wait_ms >= 0.0);
+  if (NnetIsRecurrent(info.nnet))
+    KALDI_ERR << "Batched computation of online chunks is not supported for "
+              << "recurrent models.";
+  ComputeSimpleNnetContext(nnet_, &left_context_, &right_context_);
+  compute_thread_ = std::thread(&NnetBatchLoopedComputer::ComputeLoop, this);
+}
+
+// static
+NnetBatchComputerOptions NnetBatchLoopedComputer::GetComputerOptions(
+    const NnetBatchLoopedComputerOptions &opts,
+    const DecodableNnetSimpleLoopedInfo &info) {
+  NnetBatchComputerOptions ans;
+  ans.frame_subsampling_factor = info.opts.frame_subsampling_factor;
+  ans.frames_per_chunk = info.frames_per_chunk;
+  ans.acoustic_scale = info.opts.acoustic_scale;
+  ans.debug_computation = info.opts.debug_computation;
+  ans.optimize_config = info.opts.optimize_config;
+  ans.compute_config = info.opts.compute_config;
+  ans.minibatch_size = opts.batch_size;
+  ans.edge_minibatch_size = opts.batch_size;
+  ans.partial_minibatch_factor = opts.partial_minibatch_factor;
+  return ans;
+}
+
+// static
+Vector<BaseFloat> NnetBatchLoopedComputer::GetPriors(
+    const DecodableNnetSimpleLoopedInfo &info) {
+  Vector<BaseFloat> priors(info.log_priors);
+  priors.ApplyExp();
+  return priors;
+}
+
+// static
+Nnet NnetBatchLoopedComputer::GetNnet(
+    const DecodableNnetSimpleLoopedInfo &info) {
+  Nnet nnet(info.nnet);
+  if (!info.has_ivectors)
+    return nnet;
+  // This undoes the search-and-replace of ModifyNnetIvectorPeriod(), e.g.
+  // turning Round(ivector, 21) back into ReplaceIndex(ivector, t, 0).
+  std::ostringstream period_end;
+  period_end << ", " << info.frames_per_chunk << ")";
+  const std::string to_search_for = "Round(", end = period_end.str();
+  std::vector<std::string> config_lines;
+  nnet.GetConfigLines(false, &config_lines);
+  std::ostringstream config_to_read;
+  for (size_t i = 0; i < config_lines.size(); i++) {
+    std::string whole_line = config_lines[i];
+    if (whole_line.compare(0, 15, "component-node ") != 0)
+      continue;
+    std::string::size_type pos = whole_line.find(to_search_for);
+    if (pos == std::string::npos)
+      continue;
+    std::string::size_type end_pos = whole_line.find(end, pos);
+    if (end_pos == std::string::npos)
+      KALDI_ERR << "Could not process the Round expression in: "
+                << whole_line;
+    std::string descriptor_name = whole_line.substr(
+        pos + to_search_for.size(), end_pos - (pos + to_search_for.size()));
+    whole_line.replace(pos, end_pos + end.size() - pos,
+                       "ReplaceIndex(" + descriptor_name + ", t, 0)");
+    config_to_read << whole_line << "\n";
+  }
+  if (!config_to_read.str().empty()) {
+    std::istringstream is(config_to_read.str());
+    nnet.ReadConfig(is);
+  }
+  return nnet;
+}
+
+void NnetBatchLoopedComputer::Compute(CuMatrix<BaseFloat> *input,
+                                      const VectorBase<BaseFloat> *ivector,
+                                      Matrix<BaseFloat> *output) {
+  int32 sf = info_.opts.frame_subsampling_factor;
+  KALDI_ASSERT(input->NumRows() ==
+               left_context_ + info_.frames_per_chunk + right_context_);
+  NnetInferenceTask task;
+  task.input.Swap(input);
+  task.first_input_t = -left_context_;
+  task.output_t_stride = sf;
+  task.num_output_frames = info_.frames_per_chunk / sf;
+  task.num_initial_unused_output_frames = 0;
+  task.num_used_output_frames = task.num_output_frames;
+  task.first_used_output_frame_index = 0;
+  task.is_edge = false;
+  task.is_irregular = false;
+  if (ivector != NULL)
+    task.ivector = *ivector;
+  task.priority = 0.0;
+  task.output_to_cpu = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PendingTask pending;
+    pending.task = &task;
+    pending.arrival_time = timer_.Elapsed();
+    pending_.push_back(pending);
+  }
+  cond_.notify_one();
+  task.semaphore.Wait();
+  output->Swap(&task.output_cpu);
+}
+
+void NnetBatchLoopedComputer::ComputeLoop() {
+  std::vector<NnetInferenceTask*> tasks;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (pending_.empty()) {
+      if (exit_)
+        return;
+      cond_.wait(lock);
+      continue;
+    }
+    // We wait for more chunks unless we have a full batch or the oldest chunk
+    // has waited long enough.
+    double wait_ms = opts_.max_wait_ms -
+        1000.0 * (timer_.Elapsed() - pending_.front().arrival_time);
+    if (static_cast<int32>(pending_.size()) < opts_.batch_size &&
+        wait_ms > 0.0 && !exit_) {
+      cond_.wait_for(lock, std::chrono::microseconds(
+          static_cast<int64>(1000.0 * wait_ms) + 1));
+      continue;
+    }
+    tasks.clear();
+    while (!pending_.empty() &&
+           static_cast<int32>(tasks.size()) < opts_.batch_size) {
+      tasks.push_back(pending_.front().task);
+      pending_.pop_front();
+    }
+    lock.unlock();
+    for (size_t i = 0; i < tasks.size(); i++)
+      computer_.AcceptTask(tasks[i]);
+    // This may take more than one computation if the batch is not full,
+    // depending on the partial minibatch sizes.
+    while (computer_.Compute(true)) { }
+    lock.lock();
+  }
+}
+
+NnetBatchLoopedComputer::~NnetBatchLoopedComputer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  cond_.notify_one();
+  compute_thread_.join();
+}
+
+
 }  // namespace nnet3
 }  // namespace kaldi
@@ -26,6 +26,9 @@
 #include <list>
 #include <utility>
 #include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include "base/kaldi-common.h"
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
@@ -34,6 +37,7 @@
 #include "nnet3/nnet-compute.h"
 #include "nnet3/am-nnet-simple.h"
 #include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/decodable-simple-looped.h"
 #include "decoder/lattice-faster-decoder.h"
 #include "util/stl-utils.h"
 
@@ -146,11 +150,13 @@ struct NnetBatchComputerOptions: public NnetSimpleComputationOptions {
   int32 edge_minibatch_size;
   bool ensure_exact_final_context;
   BaseFloat partial_minibatch_factor;
+  int32 length_bucket_size;
 
   NnetBatchComputerOptions(): minibatch_size(128),
                               edge_minibatch_size(32),
                               ensure_exact_final_context(false),
-                              partial_minibatch_factor(0.5) {
+                              partial_minibatch_factor(0.5),
+                              length_bucket_size(0) {
   }
 
   void Register(OptionsItf *po) {
@@ -174,6 +180,14 @@ struct NnetBatchComputerOptions: public NnetSimpleComputationOptions {
                  "for sizes: int(partial_minibatch_factor^n * minibatch_size "
                  ", for n = 0, 1, 2....  Set it to 0.0 if you want to use "
                  "only the specified minibatch sizes.");
+    po->Register("length-bucket-size", &length_bucket_size,
+                 "If >0 (and --ensure-exact-final-context=false), utterances "
+                 "shorter than --frames-per-chunk are padded with repeats of "
+                 "the last frame only up to a multiple of this many frames, "
+                 "instead of up to --frames-per-chunk.  Utterances in the same "
+                 "length bucket are computed together in minibatches.  This "
+                 "saves computation when there are many short utterances, "
+                 "e.g. on CPU.");
   }
 };
 
@@ -497,15 +511,28 @@ class NnetBatchComputer {
    This class implements a simplified interface to class NnetBatchComputer,
    which is suitable for programs like 'nnet3-compute' where you want to support
    fast GPU-based inference on a sequence of utterances, and get them back
-   from the object in the same order.
+   from the object in the same order.  It can also be used without a GPU; in
+   that case you will probably want more than one computation thread, and a
+   single-threaded BLAS library.
  */
 class NnetBatchInference {
  public:
 
+  /**
+     Constructor.
+       @param [in] opts  Options for the NnetBatchComputer object
+       @param [in] nnet  The neural net
+       @param [in] priors  If nonempty, the log of these is subtracted from
+                   the output.
+       @param [in] num_threads  The number of threads that do the neural net
+                   computation, each working on its own minibatch.  Values
+                   greater than one are mostly useful on CPU.
+  */
   NnetBatchInference(
       const NnetBatchComputerOptions &opts,
       const Nnet &nnet,
-      const VectorBase<BaseFloat> &priors);
+      const VectorBase<BaseFloat> &priors,
+      int32 num_threads = 1);
 
   /**
     The user should call this one by one for the utterances that this class
@@ -558,7 +585,7 @@ class NnetBatchInference {
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(NnetBatchInference);
 
-  // This is the computation thread, which is run in the background.  It will
+  // This is run by the computation threads, in the background.  It will
   // exit once the user calls Finished() and all computation is completed.
   void Compute();
   // static wrapper for Compute().
@@ -577,7 +604,8 @@ class NnetBatchInference {
 
   // This semaphore is signaled by the main thread (the thread in which
   // AcceptInput() is called) every time a new utterance is added, and waited on
-  // in the background thread in which Compute() is called.
+  // in the background threads in which Compute() is called.  Finished()
+  // signals it once per thread.
   Semaphore tasks_ready_semaphore_;
 
   struct UtteranceInfo {
@@ -598,8 +626,11 @@ class NnetBatchInference {
 
   int32 utterance_counter_;  // counter that increases on every utterance.
 
-  // The thread running the Compute() process.
-  std::thread compute_thread_;
+  // The number of computation threads.
+  int32 num_threads_;
+
+  // The threads running the Compute() process.
+  std::vector<std::thread> compute_threads_;
 };
 
 
@@ -840,6 +871,119 @@ class NnetBatchDecoder {
 };
 
 
+
+struct NnetBatchLoopedComputerOptions {
+  int32 batch_size;
+  BaseFloat max_wait_ms;
+  BaseFloat partial_minibatch_factor;
+
+  NnetBatchLoopedComputerOptions(): batch_size(32),
+                                    max_wait_ms(5.0),
+                                    partial_minibatch_factor(0.5) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("nnet-batch-size", &batch_size, "Maximum number of chunks, "
+                 "from different streams, that are computed together.");
+    po->Register("nnet-batch-max-wait-ms", &max_wait_ms, "Maximum time in "
+                 "milliseconds that a chunk waits for other streams' chunks "
+                 "before it is computed in a partial batch.");
+    po->Register("nnet-batch-partial-factor", &partial_minibatch_factor,
+                 "Controls the sizes of partial batches, as for "
+                 "--partial-minibatch-factor in nnet3-latgen-faster-batch.");
+  }
+};
+
+/**
+   NnetBatchLoopedComputer does the neural net computation for many online
+   decoders at once (e.g. the clients of a server, each decoded in its own
+   thread), so that each chunk is computed with a larger matrix multiplication
+   than in the looped computation that each DecodableNnetLoopedOnline object
+   would otherwise do.  Decodables that are given a pointer to this object
+   (see DecodableNnetLoopedOnlineBase) call Compute() for each chunk instead
+   of running their own computation; Compute() waits until a background thread
+   has computed the chunk together with those of other streams, using
+   NnetBatchComputer.  A batch is computed as soon as --nnet-batch-size chunks
+   are waiting, or the oldest has waited --nnet-batch-max-wait-ms.
+
+   Because the streams start and end at different times, their chunks cannot
+   share the state of a looped computation; instead each chunk is computed
+   with its full left and right context, as in nnet3-latgen-faster-batch.  So
+   this only gives the same output as the looped computation for models
+   without recurrence (e.g. TDNN or TDNN-F), and the constructor will refuse
+   recurrent models.  Each chunk costs more arithmetic than in the looped
+   computation (the context is recomputed), which the batching has to make up
+   for.
+ */
+class NnetBatchLoopedComputer {
+ public:
+  /// It stores a reference to 'info', so don't delete it while this object
+  /// exists.  The chunk size, acoustic scale and priors are taken from
+  /// 'info', so the output is scaled like that of DecodableNnetLoopedOnline.
+  NnetBatchLoopedComputer(const NnetBatchLoopedComputerOptions &opts,
+                          const DecodableNnetSimpleLoopedInfo &info);
+
+  /// The number of frames of left and right context that the input to
+  /// Compute() must have.
+  int32 LeftContext() const { return left_context_; }
+  int32 RightContext() const { return right_context_; }
+
+  /**
+     Computes one chunk of one stream; thread safe.  It blocks until the chunk
+     has been computed.
+        @param [in,out] input  The features of the chunk, info.frames_per_chunk
+                       frames plus LeftContext() and RightContext() frames of
+                       context.  Its contents are consumed.
+        @param [in] ivector  The iVector, if the model takes one, else NULL.
+        @param [out] output  The output for the info.frames_per_chunk /
+                       frame_subsampling_factor frames of the chunk, with
+                       priors subtracted and acoustic scale applied.
+   */
+  void Compute(CuMatrix<BaseFloat> *input,
+               const VectorBase<BaseFloat> *ivector,
+               Matrix<BaseFloat> *output);
+
+  ~NnetBatchLoopedComputer();
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetBatchLoopedComputer);
+
+  // Returns the options for computer_.
+  static NnetBatchComputerOptions GetComputerOptions(
+      const NnetBatchLoopedComputerOptions &opts,
+      const DecodableNnetSimpleLoopedInfo &info);
+  // Returns info.log_priors converted back to priors.
+  static Vector<BaseFloat> GetPriors(const DecodableNnetSimpleLoopedInfo &info);
+  // Returns a copy of info.nnet in which the iVector inputs are
+  // ReplaceIndex(ivector, t, 0) again, as NnetBatchComputer expects, instead
+  // of the Round(ivector, info.frames_per_chunk) that
+  // ModifyNnetIvectorPeriod() made them for the looped computation.
+  static Nnet GetNnet(const DecodableNnetSimpleLoopedInfo &info);
+
+  // The background thread that does the computation.
+  void ComputeLoop();
+
+  struct PendingTask {
+    NnetInferenceTask *task;
+    double arrival_time;
+  };
+
+  NnetBatchLoopedComputerOptions opts_;
+  const DecodableNnetSimpleLoopedInfo &info_;
+  int32 left_context_;
+  int32 right_context_;
+  Nnet nnet_;  // must outlive computer_.
+  Vector<BaseFloat> priors_;  // must outlive computer_.
+  NnetBatchComputer computer_;
+  Timer timer_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;  // notified when a task arrives, or on exit.
+  std::deque<PendingTask> pending_;  // guarded by mutex_.
+  bool exit_;  // guarded by mutex_.
+  std::thread compute_thread_;
+};
+
+
 }  // namespace nnet3
 }  // namespace kaldi
 
@@ -28,6 +28,8 @@
 #include "nnet3/nnet-general-component.h"
 #include "nnet3/nnet-convolutional-component.h"
 #include "nnet3/nnet-attention-component.h"
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-sparse-component.h"
 #include "nnet3/nnet-parse.h"
 #include "nnet3/nnet-computation-graph.h"
 
@@ -141,6 +143,14 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new ConvolutionComponent();
   } else if (component_type == "TdnnComponent") {
     ans = new TdnnComponent();
+  } else if (component_type == "QuantizedAffineComponent") {
+    ans = new QuantizedAffineComponent();
+  } else if (component_type == "QuantizedTdnnComponent") {
+    ans = new QuantizedTdnnComponent();
+  } else if (component_type == "SparseAffineComponent") {
+    ans = new SparseAffineComponent();
+  } else if (component_type == "SparseTdnnComponent") {
+    ans = new SparseTdnnComponent();
   } else if (component_type == "MaxpoolingComponent") {
     ans = new MaxpoolingComponent();
   } else if (component_type == "PermuteComponent") {
@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <iterator>
 #include <sstream>
 #include "nnet3/nnet-computation.h"
@@ -99,6 +100,137 @@ void NnetComputation::ComputeCudaIndexes() {
   }
 }
 
+const NnetComputation::MemoryPlan &NnetComputation::GetMemoryPlan() const {
+  std::lock_guard<std::mutex> lock(memory_plan_mutex_);
+  if (!memory_plan_) {
+    MemoryPlan *plan = new MemoryPlan();
+    ComputeMemoryPlan(plan);
+    memory_plan_.reset(plan);
+  }
+  return *memory_plan_;
+}
+
+void NnetComputation::ClearMemoryPlan() {
+  std::lock_guard<std::mutex> lock(memory_plan_mutex_);
+  memory_plan_.reset();
+}
+
+void NnetComputation::ComputeMemoryPlan(MemoryPlan *plan) const {
+  int32 num_matrices = matrices.size(),
+      num_commands = commands.size();
+  for (int32 c = 0; c < num_commands; c++)
+    if (commands[c].command_type == kGotoLabel)
+      return;  // Looped computation: matrices may be reallocated each time.
+
+  // Each kAllocMatrix command creates a block of memory (a "buffer") whose
+  // lifetime ends with the kDeallocMatrix of whichever matrix owns it at that
+  // point; kSwapMatrix commands move buffers between matrices.  We work out
+  // the lifetime of each buffer and which buffers cannot be planned.
+  // Offsets are multiples of 16 BaseFloats.  This does not make the matrices
+  // 64-byte aligned in memory, as NnetComputer's arena is a Vector, which is
+  // only 16-byte aligned; they are 16-byte aligned, like the data of a Matrix.
+  const int32 kAlignment = 16;
+  std::vector<int32> strides(num_matrices, 0);
+  for (int32 m = 1; m < num_matrices; m++) {
+    const MatrixInfo &info = matrices[m];
+    // kDefaultStride pads the rows to a multiple of 16 bytes, as in
+    // class Matrix.
+    int32 pad = 16 / sizeof(BaseFloat);
+    strides[m] = (info.stride_type == kStrideEqualNumCols ? info.num_cols :
+                  (info.num_cols + pad - 1) / pad * pad);
+  }
+  // For each buffer: the command that allocates it, the command that frees it,
+  // its size, and whether it can be planned.
+  std::vector<int32> buffer_start, buffer_end;
+  std::vector<int64> buffer_size;
+  std::vector<bool> buffer_ok;
+  // The buffer currently owned by each matrix, or -1.
+  std::vector<int32> owner(num_matrices, -1);
+  for (int32 c = 0; c < num_commands; c++) {
+    const Command &command = commands[c];
+    switch (command.command_type) {
+      case kAllocMatrix: {
+        int32 m = submatrices[command.arg1].matrix_index;
+        if (owner[m] != -1) buffer_ok[owner[m]] = false;
+        owner[m] = buffer_start.size();
+        buffer_start.push_back(c);
+        buffer_end.push_back(num_commands);
+        int64 size = static_cast<int64>(matrices[m].num_rows) * strides[m];
+        buffer_size.push_back((size + kAlignment - 1) / kAlignment *
+                              kAlignment);
+        buffer_ok.push_back(true);
+        break;
+      }
+      case kDeallocMatrix: {
+        int32 m = submatrices[command.arg1].matrix_index;
+        if (owner[m] != -1) {
+          buffer_end[owner[m]] = c;
+          owner[m] = -1;
+        }
+        break;
+      }
+      case kSwapMatrix: {
+        int32 m1 = submatrices[command.arg1].matrix_index,
+            m2 = submatrices[command.arg2].matrix_index;
+        std::swap(owner[m1], owner[m2]);
+        break;
+      }
+      case kAcceptInput: case kProvideOutput:
+      case kCompressMatrix: case kDecompressMatrix: {
+        // These replace or reallocate the matrix's memory outside of the
+        // arena.
+        int32 m = submatrices[command.arg1].matrix_index;
+        if (owner[m] != -1) buffer_ok[owner[m]] = false;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  // Greedy placement: largest buffers first, each at the lowest offset that
+  // does not overlap any already-placed buffer whose lifetime overlaps its
+  // own.
+  int32 num_buffers = buffer_start.size();
+  std::vector<std::pair<int64, int32> > order;
+  for (int32 b = 0; b < num_buffers; b++)
+    if (buffer_ok[b] && buffer_size[b] > 0)
+      order.push_back(std::pair<int64, int32>(-buffer_size[b], b));
+  if (order.empty())
+    return;
+  std::sort(order.begin(), order.end());
+  std::vector<int64> buffer_offset(num_buffers, -1);
+  std::vector<int32> placed;
+  std::vector<std::pair<int64, int64> > busy;
+  int64 arena_size = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    int32 b = order[i].second;
+    busy.clear();
+    for (size_t j = 0; j < placed.size(); j++) {
+      int32 p = placed[j];
+      if (buffer_start[p] < buffer_end[b] && buffer_start[b] < buffer_end[p])
+        busy.push_back(std::pair<int64, int64>(
+            buffer_offset[p], buffer_offset[p] + buffer_size[p]));
+    }
+    std::sort(busy.begin(), busy.end());
+    int64 offset = 0;
+    for (size_t j = 0; j < busy.size(); j++) {
+      if (offset + buffer_size[b] <= busy[j].first)
+        break;
+      offset = std::max(offset, busy[j].second);
+    }
+    buffer_offset[b] = offset;
+    arena_size = std::max(arena_size, offset + buffer_size[b]);
+    placed.push_back(b);
+  }
+
+  plan->offsets.resize(num_commands, -1);
+  for (int32 b = 0; b < num_buffers; b++)
+    plan->offsets[buffer_start[b]] = buffer_offset[b];
+  plan->strides.swap(strides);
+  plan->size = arena_size;
+}
+
 int32 NnetComputation::NewSubMatrix(int32 base_submatrix,
                                     int32 row_offset, int32 num_rows,
                                     int32 col_offset, int32 num_cols) {
@@ -549,7 +681,10 @@ static void PrintCommand(std::ostream &os_out,
       if (c.arg2 == 0) os << "NULL, ";
       else os << "precomputed_indexes[" << c.arg2 << "], ";
       os << submatrix_strings[c.arg3] << ", &" << submatrix_strings[c.arg4]
-         << ")\n";
+         << ")";
+      if (c.arg7 > 1)
+        os << " [fused with the next " << (c.arg7 - 1) << "]";
+      os << "\n";
       break;
     case kBackprop:
     case kBackpropNoModelUpdate: {
@@ -860,6 +995,7 @@ void NnetComputation::Read(std::istream &is, bool binary) {
   ReadBasicType(is, binary, &need_model_derivative);
 
   ComputeCudaIndexes();
+  ClearMemoryPlan();
   ExpectToken(is, binary, "</NnetComputation>");
 }
 
@@ -1143,6 +1279,10 @@ NnetComputation::NnetComputation(const NnetComputation &other):
     need_model_derivative(other.need_model_derivative),
     indexes_cuda(other.indexes_cuda),
     indexes_ranges_cuda(other.indexes_ranges_cuda) {
+  {
+    std::lock_guard<std::mutex> lock(other.memory_plan_mutex_);
+    memory_plan_ = other.memory_plan_;
+  }
   for (size_t i = 1; i < component_precomputed_indexes.size(); i++)
     component_precomputed_indexes[i].data =
         component_precomputed_indexes[i].data->Copy();
@@ -1159,6 +1299,15 @@ NnetComputation& NnetComputation::operator = (const NnetComputation &other) {
   need_model_derivative = other.need_model_derivative;
   indexes_cuda = other.indexes_cuda;
   indexes_ranges_cuda = other.indexes_ranges_cuda;
+  if (this != &other) {
+    std::shared_ptr<const MemoryPlan> memory_plan;
+    {
+      std::lock_guard<std::mutex> lock(other.memory_plan_mutex_);
+      memory_plan = other.memory_plan_;
+    }
+    std::lock_guard<std::mutex> lock(memory_plan_mutex_);
+    memory_plan_ = memory_plan;
+  }
 
   for (size_t i = 1; i < component_precomputed_indexes.size(); i++)
     delete component_precomputed_indexes[i].data;
@@ -28,6 +28,8 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 
 
 namespace kaldi {
@@ -205,6 +207,10 @@ struct ComputationRequestPtrEqual {
      - arg6 is 1 if we need to call StoreStats() after the Propagate, or 0
        if we don't.  We used to have a separate command for storing the
        stats, but that has been removed.
+     - arg7 is normally -1.  If it is n > 1, this command and the n - 1
+       commands after it are in-place propagations on the same submatrix that
+       may be done together a block of rows at a time; see
+       FuseElementwisePropagations().
    - kBackprop: Do the back-propagation operation, see Component::Backprop()
      - arg1 is index of component in neural net
      - arg2 is index into ComponentPrecomputedIndexes (0 if NULL; always 0
@@ -447,6 +453,24 @@ struct NnetComputation {
   // computed from "indexes_ranges" by ComputeCudaIndexes().
   std::vector<CuArray<Int32Pair> > indexes_ranges_cuda;
 
+  // MemoryPlan is a static plan of where in a single pre-allocated block of
+  // memory (an "arena") each matrix should live, so that NnetComputer does not
+  // have to allocate and free memory for each matrix as it runs the
+  // computation.  It is computed from "commands" and "matrices" when
+  // GetMemoryPlan() is first called, and is not written to disk.
+  struct MemoryPlan {
+    // Indexed by command index.  For kAllocMatrix commands whose memory is
+    // planned, the offset (in BaseFloats) of the start of the matrix in the
+    // arena; -1 for all other commands.  Empty if there is no plan.
+    std::vector<int64> offsets;
+    // Indexed by matrix index: the stride of each matrix when it is stored
+    // in the arena.
+    std::vector<int32> strides;
+    // The size of the arena in BaseFloats.
+    int64 size;
+    MemoryPlan(): size(0) { }
+  };
+
 
   /// Convenience function used when adding new matrices.  Writes to
   /// 'this->matrices' and 'this->submatrices'; and if 'this->matrix_debug_info'
@@ -473,6 +497,21 @@ struct NnetComputation {
   // the indexes.
   void ComputeCudaIndexes();
 
+  // Returns the memory plan, which is computed the first time this is called
+  // (this is thread safe).  Matrices whose lifetimes do not overlap are
+  // assigned overlapping parts of the arena, so the arena is generally much
+  // smaller than the total size of the matrices.  Matrices that are involved in
+  // input, output or compression are not planned (they are allocated
+  // normally), and no plan is made for computations with loops (i.e. with
+  // kGotoLabel commands).  Computing the plan takes time quadratic in the
+  // number of matrices, so it is left until NnetComputer needs it, which it
+  // only does when running on the CPU with --use-memory-plan=true.
+  const MemoryPlan &GetMemoryPlan() const;
+
+  // Discards the memory plan, if it was computed.  This must be called if the
+  // commands or matrices are changed after GetMemoryPlan() was called.
+  void ClearMemoryPlan();
+
   // This function produces pretty-print ouput intended to allow a human to
   // interpret the computation.
   void Print(std::ostream &os, const Nnet &nnet) const;
@@ -512,6 +551,16 @@ struct NnetComputation {
   NnetComputation &operator = (const NnetComputation &other);
   // Default constructor
   NnetComputation(): need_model_derivative(false) { }
+
+ private:
+  // Computes the plan that GetMemoryPlan() returns.
+  void ComputeMemoryPlan(MemoryPlan *plan) const;
+
+  // Guards memory_plan_.
+  mutable std::mutex memory_plan_mutex_;
+  // The memory plan, or NULL if it has not been computed yet.  Copies of this
+  // computation share it, as it does not change once computed.
+  mutable std::shared_ptr<const MemoryPlan> memory_plan_;
 };
 
 // A helper class equipped with the stream insertion operator<< to print out
@@ -0,0 +1,139 @@
+// nnet3/nnet-compute-profile.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "nnet3/nnet-compute-profile.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+void NnetComputeProfiler::Add(const std::string &command_type,
+                              const std::string &component,
+                              double seconds, double flops, double bytes) {
+  Stats stats;
+  stats.count = 1;
+  stats.seconds = seconds;
+  stats.flops = flops;
+  stats.bytes = bytes;
+  std::lock_guard<std::mutex> lock(mutex_);
+  command_type_stats_[command_type].Add(stats);
+  if (!component.empty())
+    component_stats_[command_type + " " + component].Add(stats);
+}
+
+void NnetComputeProfiler::Add(const NnetComputeProfiler &other) {
+  if (&other == this)
+    return;
+  std::map<std::string, Stats> command_type_stats, component_stats;
+  {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    command_type_stats = other.command_type_stats_;
+    component_stats = other.component_stats_;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, Stats>::const_iterator iter;
+  for (iter = command_type_stats.begin(); iter != command_type_stats.end();
+       ++iter)
+    command_type_stats_[iter->first].Add(iter->second);
+  for (iter = component_stats.begin(); iter != component_stats.end(); ++iter)
+    component_stats_[iter->first].Add(iter->second);
+}
+
+bool NnetComputeProfiler::Empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return command_type_stats_.empty();
+}
+
+void NnetComputeProfiler::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  command_type_stats_.clear();
+  component_stats_.clear();
+}
+
+NnetComputeProfiler::Stats NnetComputeProfiler::CommandTypeStats(
+    const std::string &command_type) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, Stats>::const_iterator iter =
+      command_type_stats_.find(command_type);
+  return (iter == command_type_stats_.end() ? Stats() : iter->second);
+}
+
+// Prints one table of 'stats' to 'os', sorted from the most to the least time
+// consuming, with percentages relative to 'total_seconds'.
+static void PrintProfileTable(const std::map<std::string,
+                                  NnetComputeProfiler::Stats> &stats,
+                              double total_seconds,
+                              std::ostream &os) {
+  std::vector<std::pair<double, std::string> > pairs;
+  std::map<std::string, NnetComputeProfiler::Stats>::const_iterator iter;
+  for (iter = stats.begin(); iter != stats.end(); ++iter)
+    pairs.push_back(std::make_pair(-iter->second.seconds, iter->first));
+  std::sort(pairs.begin(), pairs.end());
+  os << std::setw(10) << "seconds" << std::setw(8) << "%"
+     << std::setw(10) << "count" << std::setw(10) << "GFLOP/s"
+     << std::setw(10) << "GB/s" << "  name\n";
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const NnetComputeProfiler::Stats &s = stats.find(pairs[i].second)->second;
+    double seconds = std::max(s.seconds, 1.0e-09);
+    os << std::fixed << std::setprecision(4) << std::setw(10) << s.seconds
+       << std::setprecision(1) << std::setw(8)
+       << (total_seconds > 0.0 ? 100.0 * s.seconds / total_seconds : 0.0)
+       << std::setw(10) << s.count
+       << std::setprecision(2)
+       << std::setw(10) << (s.flops * 1.0e-09 / seconds)
+       << std::setw(10) << (s.bytes * 1.0e-09 / seconds)
+       << "  " << pairs[i].second << "\n";
+  }
+}
+
+std::string NnetComputeProfiler::Info() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats total;
+  std::map<std::string, Stats>::const_iterator iter;
+  for (iter = command_type_stats_.begin(); iter != command_type_stats_.end();
+       ++iter)
+    total.Add(iter->second);
+  std::ostringstream os;
+  os << "-----\n[nnet3 computation profile]\n"
+     << "Per command type:\n";
+  PrintProfileTable(command_type_stats_, total.seconds, os);
+  os << "Per component:\n";
+  PrintProfileTable(component_stats_, total.seconds, os);
+  os << "Total time in " << total.count << " commands: " << std::fixed
+     << std::setprecision(4) << total.seconds << "s; FLOPs and bytes are "
+     << "rough estimates.\n-----";
+  return os.str();
+}
+
+NnetComputeProfiler &GetNnetComputeProfiler() {
+  static NnetComputeProfiler profiler;
+  return profiler;
+}
+
+void PrintNnetComputeProfile() {
+  const NnetComputeProfiler &profiler = GetNnetComputeProfiler();
+  if (!profiler.Empty())
+    KALDI_LOG << profiler.Info();
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
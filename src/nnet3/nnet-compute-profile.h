@@ -0,0 +1,103 @@
+// nnet3/nnet-compute-profile.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_COMPUTE_PROFILE_H_
+#define KALDI_NNET3_NNET_COMPUTE_PROFILE_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/**
+   class NnetComputeProfiler accumulates the time spent in the commands of
+   neural net computations, together with rough estimates of the floating
+   point operations done and the bytes of memory touched.  Statistics are kept
+   per command type (e.g. "Propagate", "Backprop", "MatrixCopy") and, for the
+   commands that invoke a component, per component.
+
+   It is filled in by class NnetComputer when the option --profile (usually
+   seen as --computation.profile) is true; see GetNnetComputeProfiler() and
+   PrintNnetComputeProfile().  All the member functions are thread safe.
+ */
+class NnetComputeProfiler {
+ public:
+  struct Stats {
+    int64 count;
+    double seconds;
+    double flops;
+    double bytes;
+    Stats(): count(0), seconds(0.0), flops(0.0), bytes(0.0) { }
+    void Add(const Stats &other) {
+      count += other.count;
+      seconds += other.seconds;
+      flops += other.flops;
+      bytes += other.bytes;
+    }
+  };
+
+  NnetComputeProfiler() { }
+
+  /// Records one execution of a command of type 'command_type' (e.g.
+  /// "Propagate") that took 'seconds'.  'component' is a description of the
+  /// component the command invoked, or empty if it did not invoke one.
+  void Add(const std::string &command_type, const std::string &component,
+           double seconds, double flops, double bytes);
+
+  /// Adds the stats in 'other' to the stats of this object.
+  void Add(const NnetComputeProfiler &other);
+
+  bool Empty() const;
+
+  void Clear();
+
+  /// Returns the stats for command type 'command_type', summed over all
+  /// components; they will be zero if nothing was recorded for it.
+  Stats CommandTypeStats(const std::string &command_type) const;
+
+  /// Returns a table of the stats, per command type and per component, each
+  /// sorted from the most to the least time consuming.
+  std::string Info() const;
+
+ private:
+  mutable std::mutex mutex_;
+  // Indexed by command type.
+  std::map<std::string, Stats> command_type_stats_;
+  // Indexed by command type followed by component description, e.g.
+  // "Propagate tdnn1.affine (NaturalGradientAffineComponent)".
+  std::map<std::string, Stats> component_stats_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetComputeProfiler);
+};
+
+/// Returns the process-wide profiler to which all NnetComputer objects with
+/// the option 'profile' set add their stats.
+NnetComputeProfiler &GetNnetComputeProfiler();
+
+/// Prints the stats of the process-wide profiler to the log, if anything was
+/// recorded.  Programs call this at exit.
+void PrintNnetComputeProfile();
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+#endif  // KALDI_NNET3_NNET_COMPUTE_PROFILE_H_
@@ -27,6 +27,11 @@
 #include "nnet3/nnet-compute.h"
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "nnet3/decodable-simple-looped.h"
+#include "nnet3/decodable-online-looped.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "base/timer.h"
+#include <limits>
+#include <thread>
 
 namespace kaldi {
 namespace nnet3 {
@@ -114,6 +119,13 @@ void TestNnetDecodable(Nnet *nnet) {
 
   {
     NnetSimpleLoopedComputationOptions opts;
+    if (RandInt(0, 1) == 0) {
+      // test switching between chunk sizes.
+      opts.frames_per_chunk = RandInt(5, 25);
+      std::ostringstream os;
+      os << RandInt(1, 40) << ',' << RandInt(1, 80);
+      opts.adaptive_frames_per_chunk = os.str();
+    }
     // caution: this may modify nnet, by changing how it consumes iVectors.
     DecodableNnetSimpleLoopedInfo info(opts, priors, nnet);
     DecodableNnetSimpleLooped decodable(info, input,
@@ -144,6 +156,123 @@ void TestNnetDecodable(Nnet *nnet) {
   }
 }
 
+// Checks that computing the final layer lazily gives the same output as
+// computing it all, apart from the per-frame offset, and compares the speed
+// when 5% of the outputs are needed.
+void UnitTestNnetLazyOutput() {
+  for (int32 i = 0; i < 2; i++) {
+    bool log_softmax = (i == 1);
+    int32 output_dim = RandInt(1000, 4000);
+    std::ostringstream config;
+    config << "component name=affine1 type=AffineComponent input-dim=120 "
+           << "output-dim=256\n"
+           << "component name=relu1 type=RectifiedLinearComponent dim=256\n"
+           << "component name=affine2 type=NaturalGradientAffineComponent "
+           << "input-dim=256 output-dim=" << output_dim << "\n"
+           << "component name=log-softmax2 type=LogSoftmaxComponent dim="
+           << output_dim << "\n"
+           << "input-node name=input dim=40\n"
+           << "component-node name=affine1 component=affine1 "
+           << "input=Append(Offset(input, -1), input, Offset(input, 1))\n"
+           << "component-node name=relu1 component=relu1 input=affine1\n"
+           << "component-node name=affine2 component=affine2 input=relu1\n"
+           << "component-node name=log-softmax2 component=log-softmax2 "
+           << "input=affine2\n"
+           << "output-node name=output input="
+           << (log_softmax ? "log-softmax2" : "affine2") << "\n";
+    Nnet nnet;
+    std::istringstream is(config.str());
+    nnet.ReadConfig(is);
+    KALDI_ASSERT(NnetLazyOutputInfo::IsSupported(nnet));
+    NnetLazyOutputInfo info(nnet);
+    KALDI_ASSERT(info.HasLogSoftmax() == log_softmax &&
+                 info.OutputDim() == output_dim);
+
+    int32 num_frames = RandInt(100, 300);
+    Matrix<BaseFloat> input(num_frames, 40);
+    input.SetRandn();
+    Vector<BaseFloat> priors(RandInt(0, 1) == 0 ? output_dim : 0);
+    if (priors.Dim() != 0) {
+      priors.SetRandn();
+      priors.ApplyExp();
+    }
+    NnetSimpleComputationOptions opts;
+    CachingOptimizingCompiler compiler(nnet), lazy_compiler(info.Trunk());
+
+    // The pdf-ids that we ask for on each frame.
+    std::vector<std::vector<int32> > pdf_ids(num_frames);
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 p = 0; p < output_dim; p++)
+        if (RandInt(0, 19) == 0)
+          pdf_ids[t].push_back(p);
+
+    // Run twice so that the second time does not include compilation.
+    double time, lazy_time;
+    for (int32 j = 0; j < 2; j++) {
+      Timer timer;
+      DecodableNnetSimple decodable(opts, nnet, priors, input, &compiler);
+      BaseFloat tot = 0.0;
+      for (int32 t = 0; t < num_frames; t++)
+        for (size_t k = 0; k < pdf_ids[t].size(); k++)
+          tot += decodable.GetOutput(t, pdf_ids[t][k]);
+      time = timer.Elapsed();
+      timer.Reset();
+      DecodableNnetSimple lazy_decodable(opts, info.Trunk(), priors, input,
+                                         &lazy_compiler, NULL, NULL, 1,
+                                         &info);
+      BaseFloat lazy_tot = 0.0;
+      for (int32 t = 0; t < num_frames; t++)
+        for (size_t k = 0; k < pdf_ids[t].size(); k++)
+          lazy_tot += lazy_decodable.GetOutput(t, pdf_ids[t][k]);
+      lazy_time = timer.Elapsed();
+      KALDI_ASSERT(lazy_decodable.LazyOutput() && !decodable.LazyOutput());
+      if (!log_softmax)
+        AssertEqual(tot, lazy_tot, 0.01);
+    }
+    KALDI_LOG << "With output-dim=" << output_dim << ", log-softmax="
+              << (log_softmax ? "true" : "false") << ", time is " << time
+              << " seconds normally, " << lazy_time << " lazily.";
+
+    // Check the values, in order of increasing frame as a decoder would.
+    DecodableNnetSimple decodable(opts, nnet, priors, input, &compiler),
+        lazy_decodable(opts, info.Trunk(), priors, input, &lazy_compiler,
+                       NULL, NULL, 1, &info);
+    Vector<BaseFloat> row(output_dim), lazy_row(output_dim);
+    for (int32 t = 0; t < num_frames; t++) {
+      BaseFloat offset = lazy_decodable.GetLazyOutputOffset(t);
+      KALDI_ASSERT(log_softmax || offset == 0.0);
+      for (size_t k = 0; k < pdf_ids[t].size(); k++) {
+        int32 p = pdf_ids[t][k];
+        BaseFloat a = decodable.GetOutput(t, p),
+            b = lazy_decodable.GetOutput(t, p) - offset;
+        KALDI_ASSERT(ApproxEqual(a, b, 1.0e-03) ||
+                     std::abs(a - b) < 1.0e-04);
+      }
+      if (t % 10 == 0) {
+        decodable.GetOutputForFrame(t, &row);
+        lazy_decodable.GetOutputForFrame(t, &lazy_row);
+        lazy_row.Add(-offset);
+        KALDI_ASSERT(row.ApproxEqual(lazy_row, 1.0e-04));
+      }
+    }
+
+    // A zero prior gives an infinite output, which must be computed like the
+    // others.
+    if (priors.Dim() != 0) {
+      priors(0) = 0.0;
+      DecodableNnetSimple lazy_decodable(opts, info.Trunk(), priors, input,
+                                         &lazy_compiler, NULL, NULL, 1, &info);
+      const BaseFloat inf = std::numeric_limits<BaseFloat>::infinity();
+      for (int32 t = 0; t < num_frames; t++) {
+        KALDI_ASSERT(lazy_decodable.GetOutput(t, 0) == inf);
+        BaseFloat a = lazy_decodable.GetOutput(t, 1);
+        lazy_decodable.GetOutputForFrame(t, &lazy_row);
+        KALDI_ASSERT(lazy_row(0) == inf && lazy_row(1) == a);
+      }
+    }
+  }
+}
+
 void UnitTestNnetCompute() {
   for (int32 n = 0; n < 20; n++) {
     struct NnetGenerationOptions gen_config;
@@ -218,6 +347,9 @@ void UnitTestNnetCompute() {
     NnetComputeOptions compute_opts;
     if (RandInt(0, 1) == 0)
       compute_opts.debug = true;
+    if (RandInt(0, 1) == 0)
+      compute_opts.profile = true;
+    GetNnetComputeProfiler().Clear();
 
     computation.ComputeCudaIndexes();
     NnetComputer computer(compute_opts,
@@ -232,6 +364,8 @@ void UnitTestNnetCompute() {
 
     }
     computer.Run();
+    // Only the profiled computation should have recorded stats.
+    KALDI_ASSERT(GetNnetComputeProfiler().Empty() == !compute_opts.profile);
 
 
     const CuMatrixBase<BaseFloat> &output(computer.GetOutput("output"));
@@ -273,6 +407,129 @@ void UnitTestNnetCompute() {
       }
     }
     TestNnetDecodable(&nnet);
+    PrintNnetComputeProfile();
+  }
+}
+
+// An OnlineFeatureInterface that reads the rows of a matrix, all of which are
+// ready from the start, like OnlineMatrixFeature in feat/ (which this library
+// does not depend on).
+class TestOnlineMatrixFeature: public OnlineFeatureInterface {
+ public:
+  explicit TestOnlineMatrixFeature(const MatrixBase<BaseFloat> &mat):
+      mat_(mat) { }
+  virtual int32 Dim() const { return mat_.NumCols(); }
+  virtual BaseFloat FrameShiftInSeconds() const { return 0.01; }
+  virtual int32 NumFramesReady() const { return mat_.NumRows(); }
+  virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+    feat->CopyFromVec(mat_.Row(frame));
+  }
+  virtual bool IsLastFrame(int32 frame) const {
+    return frame + 1 == mat_.NumRows();
+  }
+ private:
+  const MatrixBase<BaseFloat> &mat_;
+};
+
+// Sets 'output' to the log-likelihoods of all frames and outputs of 'decodable',
+// which must have all its input ready.
+static void GetOnlineDecodableOutput(DecodableNnetLoopedOnline *decodable,
+                                     Matrix<BaseFloat> *output) {
+  int32 num_frames = decodable->NumFramesReady(),
+      num_indices = decodable->NumIndices();
+  output->Resize(num_frames, num_indices);
+  for (int32 t = 0; t < num_frames; t++)
+    for (int32 i = 0; i < num_indices; i++)
+      (*output)(t, i) = decodable->LogLikelihood(t, i + 1);
+}
+
+// Checks that, for a TDNN with and without iVectors, several streams computed
+// together by one NnetBatchLoopedComputer (each decoded in its own thread) give
+// the same output as DecodableNnetLoopedOnline on each stream alone.
+void UnitTestNnetBatchLoopedComputer() {
+  for (int32 i = 0; i < 2; i++) {
+    bool use_ivectors = (i == 1);
+    int32 input_dim = 40, ivector_dim = use_ivectors ? 10 : 0,
+        output_dim = 100;
+    std::ostringstream config;
+    config << "component name=affine1 type=NaturalGradientAffineComponent "
+           << "input-dim=" << (3 * input_dim + ivector_dim)
+           << " output-dim=200\n"
+           << "component name=relu1 type=RectifiedLinearComponent dim=200\n"
+           << "component name=tdnn2 type=TdnnComponent input-dim=200 "
+           << "output-dim=200 time-offsets=-3,0,3\n"
+           << "component name=relu2 type=RectifiedLinearComponent dim=200\n"
+           << "component name=affine3 type=NaturalGradientAffineComponent "
+           << "input-dim=200 output-dim=" << output_dim << "\n"
+           << "component name=log-softmax3 type=LogSoftmaxComponent dim="
+           << output_dim << "\n"
+           << "input-node name=input dim=" << input_dim << "\n";
+    if (use_ivectors)
+      config << "input-node name=ivector dim=" << ivector_dim << "\n";
+    config << "component-node name=affine1 component=affine1 "
+           << "input=Append(Offset(input, -1), input, Offset(input, 1)"
+           << (use_ivectors ? ", ReplaceIndex(ivector, t, 0))\n" : ")\n")
+           << "component-node name=relu1 component=relu1 input=affine1\n"
+           << "component-node name=tdnn2 component=tdnn2 input=relu1\n"
+           << "component-node name=relu2 component=relu2 input=tdnn2\n"
+           << "component-node name=affine3 component=affine3 input=relu2\n"
+           << "component-node name=log-softmax3 component=log-softmax3 "
+           << "input=affine3\n"
+           << "output-node name=output input=log-softmax3\n";
+    Nnet nnet;
+    std::istringstream is(config.str());
+    nnet.ReadConfig(is);
+
+    NnetSimpleLoopedComputationOptions opts;
+    opts.frame_subsampling_factor = RandInt(1, 3);
+    opts.frames_per_chunk = RandInt(10, 30);
+    Vector<BaseFloat> priors(RandInt(0, 1) == 0 ? output_dim : 0);
+    if (priors.Dim() != 0) {
+      priors.SetRandn();
+      priors.ApplyExp();
+    }
+    DecodableNnetSimpleLoopedInfo info(opts, priors, &nnet);
+    NnetBatchLoopedComputerOptions batch_opts;
+    batch_opts.batch_size = RandInt(2, 4);
+    NnetBatchLoopedComputer batch_computer(batch_opts, info);
+
+    // The iVector is the same on each frame of a stream, so it does not matter
+    // which frame's iVector each computation uses.
+    int32 num_streams = 4;
+    std::vector<Matrix<BaseFloat> > feats(num_streams), ivectors(num_streams),
+        batch_output(num_streams);
+    for (int32 n = 0; n < num_streams; n++) {
+      feats[n].Resize(RandInt(50, 150), input_dim);
+      feats[n].SetRandn();
+      if (use_ivectors) {
+        Vector<BaseFloat> ivector(ivector_dim);
+        ivector.SetRandn();
+        ivectors[n].Resize(feats[n].NumRows(), ivector_dim);
+        ivectors[n].CopyRowsFromVec(ivector);
+      }
+    }
+
+    std::vector<std::thread> threads;
+    for (int32 n = 0; n < num_streams; n++)
+      threads.push_back(std::thread([&, n]() {
+            TestOnlineMatrixFeature input(feats[n]), ivector(ivectors[n]);
+            DecodableNnetLoopedOnline decodable(
+                info, &input, use_ivectors ? &ivector : NULL,
+                &batch_computer);
+            GetOnlineDecodableOutput(&decodable, &(batch_output[n]));
+          }));
+    for (int32 n = 0; n < num_streams; n++)
+      threads[n].join();
+
+    for (int32 n = 0; n < num_streams; n++) {
+      TestOnlineMatrixFeature input(feats[n]), ivector(ivectors[n]);
+      DecodableNnetLoopedOnline decodable(info, &input,
+                                          use_ivectors ? &ivector : NULL);
+      Matrix<BaseFloat> output;
+      GetOnlineDecodableOutput(&decodable, &output);
+      KALDI_ASSERT(output.NumRows() > 0 &&
+                   output.ApproxEqual(batch_output[n], 1.0e-04));
+    }
   }
 }
 
@@ -296,6 +553,8 @@ int main() {
       CuDevice::Instantiate().SelectGpuId("yes");
 #endif
     UnitTestNnetCompute();
+    UnitTestNnetLazyOutput();
+    UnitTestNnetBatchLoopedComputer();
   }
 
   KALDI_LOG << "Nnet tests succeeded.";
@@ -20,6 +20,10 @@
 #include <iterator>
 #include <sstream>
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-normalize-component.h"
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-sparse-component.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -52,6 +56,26 @@ void NnetComputer::Init() {
                "executing the computation.");
   matrices_.resize(computation_.matrices.size());
   debug_ = (options_.debug || GetVerboseLevel() >= 5);
+  // The memory plan is only used on the CPU; in debug mode we want the
+  // matrices in matrices_ so we can inspect them.  We check this before
+  // calling GetMemoryPlan(), which computes the plan the first time.
+  memory_plan_ = NULL;
+  use_memory_plan_ = options_.use_memory_plan && !debug_;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    use_memory_plan_ = false;
+#endif
+  if (use_memory_plan_) {
+    memory_plan_ = &(computation_.GetMemoryPlan());
+    use_memory_plan_ = !memory_plan_->offsets.empty();
+  }
+  if (use_memory_plan_) {
+    KALDI_ASSERT(memory_plan_->offsets.size() ==
+                 computation_.commands.size());
+    memory_plan_data_.Resize(memory_plan_->size, kUndefined);
+    matrix_offsets_.resize(computation_.matrices.size(), -1);
+    matrix_strides_.resize(computation_.matrices.size(), 0);
+  }
   if (debug_) {
     ComputationVariables variables;
     variables.Init(computation_);
@@ -199,6 +223,11 @@ NnetComputer::NnetComputer(const NnetComputer &other):
     submatrix_strings_(other.submatrix_strings_),
     command_strings_(other.command_strings_),
     matrices_(other.matrices_),
+    use_memory_plan_(other.use_memory_plan_),
+    memory_plan_(other.memory_plan_),
+    memory_plan_data_(other.memory_plan_data_),
+    matrix_offsets_(other.matrix_offsets_),
+    matrix_strides_(other.matrix_strides_),
     memos_(other.memos_) {
   // Note: this is the same as the default copy constructor, except for the check below.
   if (!memos_.empty()) {
@@ -214,19 +243,31 @@ void NnetComputer::ExecuteCommand() {
     switch (c.command_type) {
       case kAllocMatrix:
         m1 = computation_.submatrices[c.arg1].matrix_index;
-        matrices_[m1].Resize(computation_.matrices[m1].num_rows,
-                             computation_.matrices[m1].num_cols,
-                             kUndefined,
-                             computation_.matrices[m1].stride_type);
+        if (use_memory_plan_ && memory_plan_->offsets[program_counter_] >= 0) {
+          matrix_offsets_[m1] = memory_plan_->offsets[program_counter_];
+          matrix_strides_[m1] = memory_plan_->strides[m1];
+        } else {
+          matrices_[m1].Resize(computation_.matrices[m1].num_rows,
+                               computation_.matrices[m1].num_cols,
+                               kUndefined,
+                               computation_.matrices[m1].stride_type);
+        }
         break;
       case kDeallocMatrix:
         m1 = computation_.submatrices[c.arg1].matrix_index;
-        matrices_[m1].Resize(0, 0);
+        if (use_memory_plan_ && matrix_offsets_[m1] >= 0)
+          matrix_offsets_[m1] = -1;
+        else
+          matrices_[m1].Resize(0, 0);
         break;
       case kSwapMatrix:
         m1 = computation_.submatrices[c.arg1].matrix_index;
         m2 = computation_.submatrices[c.arg2].matrix_index;
         matrices_[m1].Swap(&(matrices_[m2]));
+        if (use_memory_plan_) {
+          std::swap(matrix_offsets_[m1], matrix_offsets_[m2]);
+          std::swap(matrix_strides_[m1], matrix_strides_[m2]);
+        }
         break;
       case kSetConst: {
         CuSubMatrix<BaseFloat> s(GetSubMatrix(c.arg1));
@@ -236,6 +277,18 @@ void NnetComputer::ExecuteCommand() {
       }
       case kPropagate: {
         NVTX_RANGE("NnetComputer::ExecuteCommand::kPropagate");
+        if (c.arg7 > 1 && !debug_ && !options_.profile) {
+          // The fused version only helps on the CPU.
+#if HAVE_CUDA == 1
+          bool fuse = !CuDevice::Instantiate().Enabled();
+#else
+          bool fuse = true;
+#endif
+          if (fuse) {
+            PropagateFused(c.arg7);
+            break;
+          }
+        }
         const Component *component = nnet_.GetComponent(c.arg1);
         ComponentPrecomputedIndexes *indexes =
             computation_.component_precomputed_indexes[c.arg2].data;
@@ -451,6 +504,13 @@ CuSubMatrix<BaseFloat> NnetComputer::GetSubMatrix(int32 submatrix_index) {
                         computation_.submatrices.size());
   const NnetComputation::SubMatrixInfo &info =
       computation_.submatrices[submatrix_index];
+  if (use_memory_plan_ && matrix_offsets_[info.matrix_index] >= 0) {
+    int32 stride = matrix_strides_[info.matrix_index];
+    const BaseFloat *data = memory_plan_data_.Data() +
+        matrix_offsets_[info.matrix_index] +
+        static_cast<int64>(info.row_offset) * stride + info.col_offset;
+    return CuSubMatrix<BaseFloat>(data, info.num_rows, info.num_cols, stride);
+  }
   const CuMatrix<BaseFloat> &mat = matrices_[info.matrix_index];
   return CuSubMatrix<BaseFloat>(
       mat, info.row_offset, info.num_rows, info.col_offset, info.num_cols);
@@ -509,6 +569,166 @@ void NnetComputer::GetPointers(int32 indexes_multi_index,
               reinterpret_cast<CuArray<BaseFloat*>*>(pointers));
 }
 
+// Describes the operation y = f(x) * scale + offset, done on each row of a
+// matrix, where f(x) is max(x, 0) if 'relu' is true and x otherwise; an empty
+// 'scale' or 'offset' means 1 or 0 respectively.  Used in PropagateFused().
+struct ElementwiseStage {
+  bool relu;
+  Vector<BaseFloat> scale;
+  Vector<BaseFloat> offset;
+  ElementwiseStage(): relu(false) { }
+};
+
+// Sets 'out' to 'in' repeated as many times as needed to have dimension 'dim'.
+static void RepeatVector(const CuVectorBase<BaseFloat> &in, int32 dim,
+                         Vector<BaseFloat> *out) {
+  int32 block_dim = in.Dim();
+  KALDI_ASSERT(block_dim > 0 && dim % block_dim == 0);
+  Vector<BaseFloat> in_cpu(block_dim, kUndefined);
+  in.CopyToVec(&in_cpu);
+  out->Resize(dim, kUndefined);
+  for (int32 i = 0; i < dim; i += block_dim)
+    out->Range(i, block_dim).CopyFromVec(in_cpu);
+}
+
+// If the in-place propagation of 'c' on a matrix with 'dim' columns can be
+// expressed as an ElementwiseStage, this combines it with the operations in
+// 'stages' and returns true; otherwise it returns false.
+static bool AppendElementwiseStage(const Component &c, int32 dim,
+                                   std::vector<ElementwiseStage> *stages) {
+  if (dynamic_cast<const NoOpComponent*>(&c) != NULL)
+    return true;
+  if (dynamic_cast<const RectifiedLinearComponent*>(&c) != NULL) {
+    stages->push_back(ElementwiseStage());
+    stages->back().relu = true;
+    return true;
+  }
+  const CuVectorBase<BaseFloat> *scale = NULL, *offset = NULL;
+  const BatchNormComponent *bn = dynamic_cast<const BatchNormComponent*>(&c);
+  const FixedScaleComponent *fs = dynamic_cast<const FixedScaleComponent*>(&c);
+  const FixedBiasComponent *fb = dynamic_cast<const FixedBiasComponent*>(&c);
+  if (bn != NULL) {
+    if (bn->Offset().Dim() == 0)
+      return false;  // not in test mode.
+    scale = &(bn->Scale());
+    offset = &(bn->Offset());
+  } else if (fs != NULL) {
+    scale = &(fs->Scales());
+  } else if (fb != NULL) {
+    offset = &(fb->Bias());
+  } else {
+    return false;
+  }
+  if (stages->empty())
+    stages->push_back(ElementwiseStage());
+  ElementwiseStage &stage = stages->back();
+  // (x * s1 + o1) * s2 + o2 = x * (s1 * s2) + (o1 * s2 + o2).
+  if (scale != NULL) {
+    Vector<BaseFloat> s;
+    RepeatVector(*scale, dim, &s);
+    if (stage.offset.Dim() != 0) stage.offset.MulElements(s);
+    if (stage.scale.Dim() == 0) stage.scale.Swap(&s);
+    else stage.scale.MulElements(s);
+  }
+  if (offset != NULL) {
+    Vector<BaseFloat> o;
+    RepeatVector(*offset, dim, &o);
+    if (stage.offset.Dim() == 0) stage.offset.Swap(&o);
+    else stage.offset.AddVec(1.0, o);
+  }
+  return true;
+}
+
+// Does one ElementwiseStage on the row 'row' of dimension 'dim'.  The
+// template arguments say whether the stage has a ReLU, a scale and an offset;
+// making them constant keeps the loop simple and free of branches.
+template<bool relu, bool has_scale, bool has_offset>
+static void ApplyElementwiseStageToRow(const BaseFloat *scale,
+                                       const BaseFloat *offset,
+                                       int32 dim, BaseFloat *row) {
+  for (int32 c = 0; c < dim; c++) {
+    BaseFloat x = row[c];
+    if (relu) x = std::max<BaseFloat>(x, 0.0);
+    if (has_scale) x *= scale[c];
+    if (has_offset) x += offset[c];
+    row[c] = x;
+  }
+}
+
+// Applies 'stages' to each row of 'mat'.
+static void ApplyElementwiseStages(const std::vector<ElementwiseStage> &stages,
+                                   MatrixBase<BaseFloat> *mat) {
+  typedef void (*RowFunction)(const BaseFloat*, const BaseFloat*, int32,
+                              BaseFloat*);
+  // indexed by 4 * relu + 2 * has_scale + has_offset.
+  static const RowFunction row_functions[8] = {
+    ApplyElementwiseStageToRow<false, false, false>,
+    ApplyElementwiseStageToRow<false, false, true>,
+    ApplyElementwiseStageToRow<false, true, false>,
+    ApplyElementwiseStageToRow<false, true, true>,
+    ApplyElementwiseStageToRow<true, false, false>,
+    ApplyElementwiseStageToRow<true, false, true>,
+    ApplyElementwiseStageToRow<true, true, false>,
+    ApplyElementwiseStageToRow<true, true, true> };
+  int32 num_rows = mat->NumRows(), num_cols = mat->NumCols();
+  for (int32 r = 0; r < num_rows; r++) {
+    BaseFloat *row = mat->RowData(r);
+    for (size_t i = 0; i < stages.size(); i++) {
+      const ElementwiseStage &stage = stages[i];
+      bool has_scale = (stage.scale.Dim() != 0),
+          has_offset = (stage.offset.Dim() != 0);
+      row_functions[4 * stage.relu + 2 * has_scale + has_offset](
+          stage.scale.Data(), stage.offset.Data(), num_cols, row);
+    }
+  }
+}
+
+void NnetComputer::PropagateFused(int32 num_commands) {
+  const NnetComputation::Command &first =
+      computation_.commands[program_counter_];
+  CuSubMatrix<BaseFloat> data(GetSubMatrix(first.arg3));
+  int32 num_rows = data.NumRows(), num_cols = data.NumCols();
+  for (int32 i = 0; i < num_commands; i++) {
+    const NnetComputation::Command &c =
+        computation_.commands[program_counter_ + i];
+    KALDI_ASSERT(c.command_type == kPropagate && c.arg3 == first.arg3 &&
+                 c.arg4 == first.arg3);
+  }
+
+  // For the common component types (ReLU, test-mode batch-norm, fixed scales
+  // and biases), we do all the commands in one pass over the data, row by
+  // row, while each row is in the L1 cache.
+  std::vector<ElementwiseStage> stages;
+  bool all_elementwise = true;
+  for (int32 i = 0; i < num_commands && all_elementwise; i++) {
+    const Component *component = nnet_.GetComponent(
+        computation_.commands[program_counter_ + i].arg1);
+    all_elementwise = AppendElementwiseStage(*component, num_cols, &stages);
+  }
+  if (all_elementwise) {
+    ApplyElementwiseStages(stages, &(data.Mat()));
+  } else {
+    // Otherwise we call Propagate() on blocks of rows small enough to stay in
+    // the L2 cache while all the components process them.
+    const int32 block_elements = 16384;
+    int32 block_rows = std::max<int32>(1, block_elements /
+                                       std::max<int32>(1, num_cols));
+    for (int32 r = 0; r < num_rows; r += block_rows) {
+      CuSubMatrix<BaseFloat> block(data, r, std::min(block_rows, num_rows - r),
+                                   0, num_cols);
+      for (int32 i = 0; i < num_commands; i++) {
+        const Component *component = nnet_.GetComponent(
+            computation_.commands[program_counter_ + i].arg1);
+        void *memo = component->Propagate(NULL, block, &block);
+        SaveMemo(0, *component, memo);
+      }
+    }
+  }
+  // Skip the commands we have done; Run() will increment program_counter_
+  // once more.
+  program_counter_ += num_commands - 1;
+}
+
 void NnetComputer::Run() {
   NVTX_RANGE(__func__);
   const std::vector<NnetComputation::Command> &c = computation_.commands;
@@ -524,6 +744,9 @@ void NnetComputer::Run() {
   CommandDebugInfo info;
   Timer timer;
   double total_elapsed_previous = 0.0;
+  // The stats are accumulated locally and added to the process-wide profiler
+  // at the end, so that threads running computations don't contend for it.
+  NnetComputeProfiler profiler;
 
   for (; program_counter_ < num_commands; program_counter_++) {
     if (c[program_counter_].command_type == kAcceptInput ||
@@ -534,7 +757,17 @@ void NnetComputer::Run() {
     }
     if (debug_)
       DebugBeforeExecute(program_counter_, &info);
+    int32 command = program_counter_;
+    if (options_.profile)
+      total_elapsed_previous = timer.Elapsed();
     ExecuteCommand();
+    if (options_.profile) {
+      // Make sure the time of GPU kernels is attributed to the command that
+      // launched them.
+      SynchronizeGpu();
+      ProfileCommand(command, timer.Elapsed() - total_elapsed_previous,
+                     &profiler);
+    }
     if (debug_) {
       double total_elapsed_now = timer.Elapsed();
       DebugAfterExecute(program_counter_, info,
@@ -542,6 +775,145 @@ void NnetComputer::Run() {
       total_elapsed_previous = total_elapsed_now;
     }
   }
+  if (options_.profile)
+    GetNnetComputeProfiler().Add(profiler);
+}
+
+// Returns the name under which commands of type 'command_type' are profiled.
+static const char *CommandTypeName(CommandType command_type) {
+  switch (command_type) {
+    case kAllocMatrix: return "AllocMatrix";
+    case kDeallocMatrix: return "DeallocMatrix";
+    case kSwapMatrix: return "SwapMatrix";
+    case kSetConst: return "SetConst";
+    case kPropagate: return "Propagate";
+    case kBackprop: case kBackpropNoModelUpdate: return "Backprop";
+    case kMatrixCopy: return "MatrixCopy";
+    case kMatrixAdd: return "MatrixAdd";
+    case kCopyRows: return "CopyRows";
+    case kAddRows: return "AddRows";
+    case kCopyRowsMulti: return "CopyRowsMulti";
+    case kCopyToRowsMulti: return "CopyToRowsMulti";
+    case kAddRowsMulti: return "AddRowsMulti";
+    case kAddToRowsMulti: return "AddToRowsMulti";
+    case kAddRowRanges: return "AddRowRanges";
+    case kCompressMatrix: return "CompressMatrix";
+    case kDecompressMatrix: return "DecompressMatrix";
+    case kAcceptInput: return "AcceptInput";
+    case kProvideOutput: return "ProvideOutput";
+    case kGotoLabel: return "GotoLabel";
+    default: return "NoOperation";
+  }
+}
+
+void NnetComputer::ProfileCommand(int32 command, double seconds,
+                                  NnetComputeProfiler *profiler) const {
+  const NnetComputation::Command &c = computation_.commands[command];
+  const std::vector<NnetComputation::SubMatrixInfo> &submatrices =
+      computation_.submatrices;
+  // The number of elements of each submatrix argument; submatrix 0 is empty,
+  // and args that are not submatrix indexes are not looked at.
+  double size1 = 0.0, size2 = 0.0, flops = 0.0, bytes = 0.0;
+  std::string component_desc;
+  switch (c.command_type) {
+    case kSetConst:
+      size1 = submatrices[c.arg1].num_rows *
+          static_cast<double>(submatrices[c.arg1].num_cols);
+      bytes = size1;
+      break;
+    case kMatrixCopy: case kCopyRows:
+    case kMatrixAdd: case kAddRows: case kAddRowRanges:
+      size1 = submatrices[c.arg1].num_rows *
+          static_cast<double>(submatrices[c.arg1].num_cols);
+      size2 = submatrices[c.arg2].num_rows *
+          static_cast<double>(submatrices[c.arg2].num_cols);
+      if (c.command_type == kMatrixCopy || c.command_type == kCopyRows) {
+        bytes = size1 + size2;
+      } else {
+        flops = size1;
+        bytes = 2 * size1 + size2;
+      }
+      break;
+    case kCopyRowsMulti: case kCopyToRowsMulti:
+    case kAddRowsMulti: case kAddToRowsMulti:
+      size1 = submatrices[c.arg1].num_rows *
+          static_cast<double>(submatrices[c.arg1].num_cols);
+      bytes = 2 * size1;
+      if (c.command_type == kAddRowsMulti || c.command_type == kAddToRowsMulti)
+        flops = size1;
+      break;
+    case kCompressMatrix: case kDecompressMatrix:
+      size1 = computation_.matrices[
+          submatrices[c.arg1].matrix_index].num_rows *
+          static_cast<double>(computation_.matrices[
+              submatrices[c.arg1].matrix_index].num_cols);
+      bytes = size1;
+      break;
+    case kPropagate: case kBackprop: case kBackpropNoModelUpdate: {
+      const Component *component = nnet_.GetComponent(c.arg1);
+      component_desc = nnet_.GetComponentName(c.arg1) + " (" +
+          component->Type() + ")";
+      // num_params is the number of parameters that multiply the input, and
+      // param_bytes their size in units of sizeof(BaseFloat).  The quantized
+      // and sparse components are not updatable but do matrix products too;
+      // the quantized ones store one byte per parameter.
+      double num_params = 0.0, param_bytes = 0.0;
+      if (component->Properties() & kUpdatableComponent) {
+        num_params = dynamic_cast<const UpdatableComponent*>(component)->
+            NumParameters();
+        param_bytes = num_params;
+      } else if (const QuantizedAffineComponent *qa =
+                 dynamic_cast<const QuantizedAffineComponent*>(component)) {
+        num_params = qa->NumParameters();
+        param_bytes = num_params / sizeof(BaseFloat);
+      } else if (const QuantizedTdnnComponent *qt =
+                 dynamic_cast<const QuantizedTdnnComponent*>(component)) {
+        num_params = qt->NumParameters();
+        param_bytes = num_params / sizeof(BaseFloat);
+      } else if (const SparseAffineComponent *sa =
+                 dynamic_cast<const SparseAffineComponent*>(component)) {
+        num_params = param_bytes = sa->NumParameters();
+      } else if (const SparseTdnnComponent *st =
+                 dynamic_cast<const SparseTdnnComponent*>(component)) {
+        num_params = param_bytes = st->NumParameters();
+      }
+      // For a Propagate, arg3 and arg4 are the input and output; for a
+      // Backprop, arg3 to arg6 are in-value, out-value, out-deriv and
+      // in-deriv.
+      int32 last_arg = (c.command_type == kPropagate ? 4 : 6);
+      const int32 args[] = { c.arg3, c.arg4, c.arg5, c.arg6 };
+      double num_rows = submatrices[c.arg4].num_rows;
+      for (int32 i = 0; i + 3 <= last_arg; i++)
+        bytes += submatrices[args[i]].num_rows *
+            static_cast<double>(submatrices[args[i]].num_cols);
+      if (c.command_type == kPropagate) {
+        // A parameter-times-input product, or else elementwise work.
+        flops = (num_params != 0.0 ? 2.0 * num_rows * num_params :
+                 submatrices[c.arg4].num_rows *
+                 static_cast<double>(submatrices[c.arg4].num_cols));
+        bytes += param_bytes;
+      } else {
+        num_rows = submatrices[c.arg5].num_rows;
+        bool update = (c.command_type == kBackprop && num_params != 0.0 &&
+                       computation_.need_model_derivative);
+        if (num_params == 0.0)
+          flops = submatrices[c.arg5].num_rows *
+              static_cast<double>(submatrices[c.arg5].num_cols);
+        if (c.arg6 != 0)
+          flops += 2.0 * num_rows * num_params;
+        if (update) {
+          flops += 2.0 * num_rows * num_params;
+          bytes += 2.0 * param_bytes;  // read and write the parameters.
+        }
+        bytes += param_bytes;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  profiler->Add(CommandTypeName(c.command_type), component_desc, seconds,
+                flops, bytes * sizeof(BaseFloat));
 }
 
 void NnetComputer::AcceptInput(const std::string &node_name,
@@ -25,6 +25,7 @@
 #include "nnet3/nnet-computation.h"
 #include "nnet3/nnet-analyze.h"
 #include "nnet3/nnet-example.h"
+#include "nnet3/nnet-compute-profile.h"
 
 #include <iostream>
 #include <sstream>
@@ -38,11 +39,23 @@ namespace nnet3 {
 
 struct NnetComputeOptions {
   bool debug;
-  NnetComputeOptions(): debug(false) { }
+  bool use_memory_plan;
+  bool profile;
+  NnetComputeOptions(): debug(false), use_memory_plan(true), profile(false) { }
   void Register(OptionsItf *opts) {
     opts->Register("debug", &debug, "If true, turn on "
                    "debug for the neural net computation (very verbose!) "
                    "Will be turned on regardless if --verbose >= 5");
+    opts->Register("use-memory-plan", &use_memory_plan, "If true, and the "
+                   "computation has a memory plan (see "
+                   "NnetComputation::GetMemoryPlan()), allocate the "
+                   "matrices within one block of memory instead of "
+                   "separately.  Only affects CPU computation.");
+    opts->Register("profile", &profile, "If true, accumulate the time spent "
+                   "in each type of command and in each component, with "
+                   "estimates of the FLOPs and bytes involved, and print them "
+                   "at exit.  Disables the fusing of elementwise propagations, "
+                   "so each component is timed separately.");
   }
 
 };
@@ -156,9 +169,24 @@ class NnetComputer {
   // command_strings_ is only used if debug_=true, or in case of error.
   std::vector<std::string> command_strings_;
 
-  // The matrices used in the computation.
+  // The matrices used in the computation.  Matrices that live in
+  // memory_plan_data_ (see below) are empty here.
   std::vector<CuMatrix<BaseFloat> > matrices_;
 
+  // True if we are using the memory plan of computation_.
+  bool use_memory_plan_;
+  // The memory plan, from computation_.GetMemoryPlan(); only set if
+  // use_memory_plan_ is true.
+  const NnetComputation::MemoryPlan *memory_plan_;
+  // The arena in which the planned matrices live, if use_memory_plan_ is true.
+  Vector<BaseFloat> memory_plan_data_;
+  // Indexed by matrix index: the offset of the matrix in memory_plan_data_ if
+  // it currently lives there, or -1.  Only used if use_memory_plan_ is true.
+  std::vector<int64> matrix_offsets_;
+  // Indexed by matrix index: the stride of the matrix in memory_plan_data_,
+  // valid if matrix_offsets_ is not -1.
+  std::vector<int32> matrix_strides_;
+
   // Memos returned by Propagate() that must be passed to the corresponding
   // Backprop() routines, indexed by memo-index (zeroth element always
   // NULL).
@@ -176,6 +204,17 @@ class NnetComputer {
   // executes the command in computation_.commands[program_counter_].
   void ExecuteCommand();
 
+  // Executes the 'num_commands' in-place propagate commands starting at
+  // program_counter_, a block of rows at a time, and advances program_counter_
+  // to the last of them.  See FuseElementwisePropagations().
+  void PropagateFused(int32 num_commands);
+
+  // Adds to 'profiler' one execution, taking 'seconds', of the command with
+  // index 'command', with rough estimates of the FLOPs and bytes involved.
+  // Used if options_.profile is true.
+  void ProfileCommand(int32 command, double seconds,
+                      NnetComputeProfiler *profiler) const;
+
   // Returns the matrix index where the input (if is_output==false) or output
   // matrix index for "node_name" is stored.  This looks at the next command (at
   // program_counter_) and in pending_commands_, and sees whether we were
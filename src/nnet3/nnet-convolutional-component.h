@@ -552,6 +552,9 @@ class TdnnComponent: public UpdatableComponent {
   };
 
   CuMatrixBase<BaseFloat> &LinearParams() { return linear_params_; }
+  const CuMatrix<BaseFloat> &LinearParams() const { return linear_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+  const std::vector<int32> &TimeOffsets() const { return time_offsets_; }
 
   // This allows you to resize the vector in order to add a bias where
   // there previously was none-- obviously this should be done carefully.
@@ -561,6 +564,26 @@ class TdnnComponent: public UpdatableComponent {
 
   void ConsolidateMemory();
  private:
+  friend class QuantizedTdnnComponent;
+  friend class SparseTdnnComponent;
+
+  // The following static functions implement ReorderIndexes(),
+  // GetInputIndexes(), IsComputable() and PrecomputeIndexes() given the time
+  // offsets, which are all they depend on; they are shared with
+  // QuantizedTdnnComponent and SparseTdnnComponent.
+  static void ReorderIndexesStatic(std::vector<Index> *input_indexes,
+                                   std::vector<Index> *output_indexes);
+  static void GetInputIndexesStatic(const std::vector<int32> &time_offsets,
+                                    const Index &output_index,
+                                    std::vector<Index> *desired_indexes);
+  static bool IsComputableStatic(const std::vector<int32> &time_offsets,
+                                 const Index &output_index,
+                                 const IndexSet &input_index_set,
+                                 std::vector<Index> *used_inputs);
+  static PrecomputedIndexes *PrecomputeIndexesStatic(
+      const std::vector<int32> &time_offsets,
+      const std::vector<Index> &input_indexes,
+      const std::vector<Index> &output_indexes);
 
   // This static function is a utility function that extracts a CuSubMatrix
   // representing a subset of rows of 'input_matrix'.
@@ -23,6 +23,8 @@
 #include "nnet3/nnet-test-utils.h"
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-utils.h"
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -292,6 +294,282 @@ static void UnitTestNnetOptimizeInternal(int32 srand_seed) {
 #undef KALDI_SUCCFAIL
 }
 
+// Runs the computation for 'request' with fuse_elementwise set to the value
+// given; returns the time taken.
+static double RunWithFusion(const Nnet &nnet,
+                            const ComputationRequest &request,
+                            const Matrix<BaseFloat> &input,
+                            bool fuse_elementwise,
+                            Matrix<BaseFloat> *output) {
+  NnetOptimizeOptions opt_config;
+  opt_config.fuse_elementwise = fuse_elementwise;
+  CachingOptimizingCompiler compiler(nnet, opt_config);
+  std::shared_ptr<const NnetComputation> computation =
+      compiler.Compile(request);
+  int32 num_fused = 0;
+  for (size_t i = 0; i < computation->commands.size(); i++)
+    if (computation->commands[i].command_type == kPropagate &&
+        computation->commands[i].arg7 > 1)
+      num_fused++;
+  // relu1 and bn1, and tanh2 and bn2, should have been fused.
+  KALDI_ASSERT(num_fused == (fuse_elementwise ? 2 : 0));
+
+  NnetComputeOptions compute_opts;
+  Timer timer;
+  for (int32 i = 0; i < 5; i++) {
+    NnetComputer computer(compute_opts, *computation, nnet, NULL);
+    CuMatrix<BaseFloat> temp(input);
+    computer.AcceptInput("input", &temp);
+    computer.Run();
+    CuMatrix<BaseFloat> cu_output;
+    computer.GetOutputDestructive("output", &cu_output);
+    output->Resize(cu_output.NumRows(), cu_output.NumCols());
+    cu_output.CopyToMat(output);
+  }
+  return timer.Elapsed();
+}
+
+// Checks that FuseElementwisePropagations() does not change the output, and
+// prints the speed with and without it.  relu1 and bn1 are done by the
+// specialized code in NnetComputer::PropagateFused(), tanh2 and bn2 by the
+// general code.
+static void UnitTestNnetOptimizeFuseElementwise() {
+  std::string config =
+    "component name=affine1 type=AffineComponent input-dim=40 "
+    "output-dim=1024\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=1024\n"
+    "component name=bn1 type=BatchNormComponent dim=1024\n"
+    "component name=affine2 type=AffineComponent input-dim=1024 "
+    "output-dim=100\n"
+    "component name=tanh2 type=TanhComponent dim=100\n"
+    "component name=bn2 type=BatchNormComponent dim=100 block-dim=50\n"
+    "\n"
+    "input-node name=input dim=40\n"
+    "component-node name=affine1 component=affine1 input=input\n"
+    "component-node name=relu1 component=relu1 input=affine1\n"
+    "component-node name=bn1 component=bn1 input=relu1\n"
+    "component-node name=affine2 component=affine2 input=bn1\n"
+    "component-node name=tanh2 component=tanh2 input=affine2\n"
+    "component-node name=bn2 component=bn2 input=tanh2\n"
+    "output-node name=output input=bn2\n";
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+  SetBatchnormTestMode(true, &nnet);
+
+  int32 num_frames = 2000;
+  ComputationRequest request;
+  request.inputs.push_back(IoSpecification("input", 0, num_frames));
+  request.outputs.push_back(IoSpecification("output", 0, num_frames));
+  Matrix<BaseFloat> input(num_frames, 40), output, fused_output;
+  input.SetRandn();
+  double time = RunWithFusion(nnet, request, input, false, &output),
+      fused_time = RunWithFusion(nnet, request, input, true, &fused_output);
+  KALDI_LOG << "Time taken without fusion was " << time << " seconds, with "
+            << "fusion " << fused_time;
+  KALDI_ASSERT(output.ApproxEqual(fused_output, 1.0e-06));
+}
+
+// Runs the computation, forward and (if applicable) backward, and returns the
+// output and the input derivatives (if any) in 'results'.
+static void RunWithMemoryPlan(int32 srand_seed,
+                              const Nnet &nnet,
+                              const ComputationRequest &request,
+                              const std::vector<Matrix<BaseFloat> > &inputs,
+                              const NnetComputation &computation,
+                              bool use_memory_plan,
+                              std::vector<Matrix<BaseFloat> > *results) {
+  NnetComputeOptions compute_opts;
+  compute_opts.use_memory_plan = use_memory_plan;
+  Nnet nnet_copy(nnet), nnet_to_update(nnet);
+  ScaleNnet(0.0, &nnet_to_update);
+  SetNnetAsGradient(&nnet_to_update);
+  NnetComputer computer(compute_opts, computation, nnet_copy,
+                        &nnet_to_update);
+  for (size_t i = 0; i < request.inputs.size(); i++) {
+    CuMatrix<BaseFloat> temp(inputs[i]);
+    computer.AcceptInput(request.inputs[i].name, &temp);
+  }
+  srand(srand_seed);
+  ResetGenerators(&nnet_copy);
+  computer.Run();
+  results->clear();
+  results->push_back(Matrix<BaseFloat>(computer.GetOutput("output")));
+  if (request.outputs[0].has_deriv) {
+    CuMatrix<BaseFloat> output_deriv(results->back().NumRows(),
+                                     results->back().NumCols());
+    srand(srand_seed);
+    output_deriv.SetRandn();
+    computer.AcceptInput("output", &output_deriv);
+    computer.Run();
+    for (size_t i = 0; i < request.inputs.size(); i++)
+      if (request.inputs[i].has_deriv)
+        results->push_back(Matrix<BaseFloat>(
+            computer.GetOutput(request.inputs[i].name)));
+  }
+}
+
+// Checks that using the memory plan (see NnetComputation::GetMemoryPlan())
+// does not change the results of the computation, and that it saves memory.
+static void UnitTestNnetOptimizeMemoryPlan() {
+  int64 tot_allocated = 0, tot_arena = 0;
+  for (int32 srand_seed = 0; srand_seed < 20; srand_seed++) {
+    srand(srand_seed);
+    struct NnetGenerationOptions gen_config;
+    std::vector<std::string> configs;
+    GenerateConfigSequence(gen_config, &configs);
+    Nnet nnet;
+    for (size_t j = 0; j < configs.size(); j++) {
+      std::istringstream is(configs[j]);
+      nnet.ReadConfig(is);
+    }
+    ComputationRequest request;
+    std::vector<Matrix<BaseFloat> > inputs;
+    ComputeExampleComputationRequestSimple(nnet, &request, &inputs);
+
+    NnetOptimizeOptions opt_config;
+    CachingOptimizingCompiler compiler(nnet, opt_config);
+    std::shared_ptr<const NnetComputation> computation =
+        compiler.Compile(request);
+    const NnetComputation::MemoryPlan &plan = computation->GetMemoryPlan();
+    if (plan.offsets.empty())
+      continue;
+    KALDI_ASSERT(plan.offsets.size() == computation->commands.size());
+    for (size_t c = 0; c < computation->commands.size(); c++) {
+      const NnetComputation::Command &command = computation->commands[c];
+      if (command.command_type == kAllocMatrix) {
+        int32 m = computation->submatrices[command.arg1].matrix_index;
+        // the arena rounds sizes up to a multiple of 16.
+        tot_allocated += (static_cast<int64>(computation->matrices[m].num_rows) *
+                          plan.strides[m] + 15) / 16 * 16;
+        // -1 means the matrix is allocated outside the arena.
+        KALDI_ASSERT(plan.offsets[c] == -1 ||
+                     (plan.offsets[c] % 16 == 0 &&
+                      plan.offsets[c] + computation->matrices[m].num_rows *
+                      plan.strides[m] <= plan.size));
+      } else {
+        KALDI_ASSERT(plan.offsets[c] == -1);
+      }
+    }
+    tot_arena += plan.size;
+
+    std::vector<Matrix<BaseFloat> > results, results_planned;
+    RunWithMemoryPlan(srand_seed, nnet, request, inputs, *computation,
+                      false, &results);
+    RunWithMemoryPlan(srand_seed, nnet, request, inputs, *computation,
+                      true, &results_planned);
+    KALDI_ASSERT(results.size() == results_planned.size());
+    for (size_t i = 0; i < results.size(); i++)
+      KALDI_ASSERT(results[i].ApproxEqual(results_planned[i], 1.0e-04));
+  }
+  KALDI_LOG << "Total size of memory-plan arenas is " << tot_arena
+            << " floats, versus " << tot_allocated << " allocated.";
+  KALDI_ASSERT(tot_arena <= tot_allocated);
+}
+
+// Returns true if the computation cache 'filename', written by
+// CachingOptimizingCompiler::WriteCacheFile(), has a computation for
+// 'request'.
+static bool CacheFileHasRequest(const std::string &filename,
+                                const ComputationRequest &request) {
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  KALDI_ASSERT(is.is_open());
+  uint64 nnet_hash;
+  ExpectToken(is, true, "<NnetComputationCache>");
+  ExpectToken(is, true, "<NnetHash>");
+  ReadBasicType(is, true, &nnet_hash);
+  NnetOptimizeOptions opt_config;
+  opt_config.Read(is, true);
+  ComputationCache cache(1000);
+  cache.Read(is, true);
+  return cache.Find(request) != NULL;
+}
+
+// Tests CachingOptimizingCompiler::ReadCacheFile() and WriteCacheFile(),
+// including the merging of computations written by another job in the mean
+// time and the rejection of caches written for a different nnet.
+static void UnitTestNnetOptimizeCacheFile() {
+  struct NnetGenerationOptions gen_config;
+  std::vector<std::string> configs;
+  GenerateConfigSequence(gen_config, &configs);
+  Nnet nnet;
+  for (size_t j = 0; j < configs.size(); j++) {
+    std::istringstream is(configs[j]);
+    nnet.ReadConfig(is);
+  }
+  // Three different requests.
+  ComputationRequest request1, request2, request3;
+  std::vector<Matrix<BaseFloat> > inputs;
+  ComputeExampleComputationRequestSimple(nnet, &request1, &inputs);
+  request2 = request1;
+  request2.store_component_stats = !request1.store_component_stats;
+  request3 = request1;
+  request3.need_model_derivative = !request1.need_model_derivative;
+
+  std::string filename = "tmp.computation-cache";
+  std::remove(filename.c_str());
+  NnetOptimizeOptions opt_config;
+  {
+    CachingOptimizingCompiler compiler(nnet, opt_config);
+    KALDI_ASSERT(!compiler.ReadCacheFile(filename));  // It does not exist.
+    compiler.Compile(request1);
+    compiler.WriteCacheFile(filename);
+  }
+  KALDI_ASSERT(CacheFileHasRequest(filename, request1) &&
+               !CacheFileHasRequest(filename, request2));
+  {
+    // Two jobs read the cache and each compile one new computation; the second
+    // one to write it must keep the computation written by the first.
+    CachingOptimizingCompiler compiler2(nnet, opt_config),
+        compiler3(nnet, opt_config);
+    KALDI_ASSERT(compiler2.ReadCacheFile(filename) &&
+                 compiler3.ReadCacheFile(filename));
+    compiler2.Compile(request1);
+    compiler2.Compile(request2);
+    compiler3.Compile(request3);
+    compiler2.WriteCacheFile(filename);
+    compiler3.WriteCacheFile(filename);
+  }
+  KALDI_ASSERT(CacheFileHasRequest(filename, request1) &&
+               CacheFileHasRequest(filename, request2) &&
+               CacheFileHasRequest(filename, request3));
+#if !defined(_MSC_VER)
+  {
+    // The file is updated under a lock on a separate file, and written
+    // through a temporary file that is renamed.
+    std::ifstream lock((filename + ".lock").c_str()),
+        tmp((filename + ".tmp").c_str());
+    KALDI_ASSERT(lock.is_open() && !tmp.is_open());
+  }
+#endif
+  {
+    // A cache written for a different nnet, or with different optimization
+    // options, is not used.
+    Nnet nnet2(nnet);
+    if (NumParameters(nnet2) > 0) {
+      PerturbParams(0.1, &nnet2);
+    } else {
+      std::istringstream is("input-node name=extra-input dim=1\n");
+      nnet2.ReadConfig(is);
+    }
+    CachingOptimizingCompiler compiler(nnet2, opt_config);
+    KALDI_ASSERT(!compiler.ReadCacheFile(filename));
+    NnetOptimizeOptions opt_config2(opt_config);
+    opt_config2.optimize = !opt_config.optimize;
+    CachingOptimizingCompiler compiler2(nnet, opt_config2);
+    KALDI_ASSERT(!compiler2.ReadCacheFile(filename));
+  }
+  {
+    // A corrupted cache is ignored, with a warning.
+    std::ofstream os(filename.c_str(), std::ios::binary);
+    os << "<NnetComputationCache> garbage";
+  }
+  CachingOptimizingCompiler compiler(nnet, opt_config);
+  KALDI_ASSERT(!compiler.ReadCacheFile(filename));
+  std::remove(filename.c_str());
+  std::remove((filename + ".lock").c_str());
+}
+
 static void UnitTestNnetOptimize() {
   for (int32 srand_seed = 0; srand_seed < 40; srand_seed++) {
     KALDI_LOG << "About to run UnitTestNnetOptimizeInternal with srand_seed = "
@@ -317,6 +595,9 @@ int main() {
   CuDevice::Instantiate().SelectGpuId("yes");
 #endif
   UnitTestNnetOptimize();
+  UnitTestNnetOptimizeFuseElementwise();
+  UnitTestNnetOptimizeMemoryPlan();
+  UnitTestNnetOptimizeCacheFile();
 
   KALDI_LOG << "Nnet tests succeeded.";
 
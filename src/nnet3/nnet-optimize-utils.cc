@@ -5015,22 +5015,36 @@ std::shared_ptr<const NnetComputation> ComputationCache::Insert(
 }
 
 
-void ComputationCache::Read(std::istream &is, bool binary) {
+void ComputationCache::Read(std::istream &is, bool binary, bool merge) {
   // Note: the object on disk doesn't have tokens like "<ComputationCache>"
   // and "</ComputationCache>" for back-compatibility reasons.
   int32 computation_cache_size;
   ExpectToken(is, binary, "<ComputationCacheSize>");
   ReadBasicType(is, binary, &computation_cache_size);
   KALDI_ASSERT(computation_cache_size >= 0);
-  computation_cache_.clear();
-  access_queue_.clear();
+  if (!merge) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (CacheType::iterator iter = computation_cache_.begin();
+         iter != computation_cache_.end(); ++iter)
+      delete iter->first;
+    computation_cache_.clear();
+    access_queue_.clear();
+  }
   ExpectToken(is, binary, "<ComputationCache>");
   for (size_t c = 0; c < computation_cache_size; c++) {
     ComputationRequest request;
     request.Read(is, binary);
     NnetComputation *computation = new NnetComputation();
     computation->Read(is, binary);
-    Insert(request, computation);
+    bool present = false;
+    if (merge) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      present = (computation_cache_.count(&request) != 0);
+    }
+    if (present)
+      delete computation;
+    else
+      Insert(request, computation);
   }
 }
 
@@ -627,8 +627,10 @@ class ComputationCache {
   ComputationCache(int32 cache_capacity);
 
   // Note: if something fails in Read(), or the written cache was from an older
-  // format, it will just leave the cache empty.
-  void Read(std::istream &is, bool binary);
+  // format, it will just leave the cache empty.  If 'merge' is true, the
+  // computations read are added to those already in the cache (those for
+  // requests already in the cache are discarded) instead of replacing them.
+  void Read(std::istream &is, bool binary, bool merge = false);
 
   void Write(std::ostream &os, bool binary) const;
 
@@ -18,11 +18,22 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-optimize-utils.h"
 #include "nnet3/nnet-utils.h"
 #include "base/timer.h"
+#include "util/kaldi-io.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -79,6 +90,10 @@ void NnetOptimizeOptions::Read(std::istream &is, bool binary) {
     ExpectToken(is, binary, "<MemoryCompressionLevel>");
     ReadBasicType(is, binary, &memory_compression_level);
   }
+  if (PeekToken(is, binary) == 'F') {
+    ExpectToken(is, binary, "<FuseElementwise>");
+    ReadBasicType(is, binary, &fuse_elementwise);
+  }
   ExpectToken(is, binary, "</NnetOptimizeOptions>");
 }
 
@@ -122,6 +137,8 @@ void NnetOptimizeOptions::Write(std::ostream &os, bool binary) const {
   WriteBasicType(os, binary, snip_row_ops);
   WriteToken(os, binary, "<MemoryCompressionLevel>");
   WriteBasicType(os, binary, memory_compression_level);
+  WriteToken(os, binary, "<FuseElementwise>");
+  WriteBasicType(os, binary, fuse_elementwise);
   WriteToken(os, binary, "</NnetOptimizeOptions>");
 }
 
@@ -143,7 +160,8 @@ bool NnetOptimizeOptions::operator == (const NnetOptimizeOptions &other) const {
           other.max_deriv_time == max_deriv_time &&
           other.max_deriv_time_relative == max_deriv_time_relative &&
           other.snip_row_ops == snip_row_ops &&
-          other.memory_compression_level == memory_compression_level);
+          other.memory_compression_level == memory_compression_level &&
+          other.fuse_elementwise == fuse_elementwise);
 }
 
 // move commands that resize and zero matrices to as late/early as possible.
@@ -507,6 +525,8 @@ void Optimize(const NnetOptimizeOptions &config,
     KALDI_LOG << "Before optimization, max memory use (bytes) = "
               << GetMaxMemoryUse(*computation);
   }
+  // Any memory plan would be invalidated by the changes we make.
+  computation->ClearMemoryPlan();
 
   { // Call LimitDerivativeTimes(); it's important that this
     // should come before other optimizations (search for "insist" in
@@ -624,6 +644,11 @@ void Optimize(const NnetOptimizeOptions &config,
       CheckComputation(nnet, *computation, false);
   }
 
+  // This only marks commands, so it must come after anything that might
+  // reorder or remove them.
+  if (config.optimize && config.fuse_elementwise)
+    FuseElementwisePropagations(nnet, computation);
+
   if (GetVerboseLevel() >= 3) {
     CheckComputation(nnet, *computation, false);
     KALDI_LOG << "After optimization, max memory use (bytes) = "
@@ -640,7 +665,7 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    num_compiled_(0), nnet_left_context_(-1), nnet_right_context_(-1) { }
 
 CachingOptimizingCompiler::CachingOptimizingCompiler(
     const Nnet &nnet,
@@ -651,7 +676,7 @@ CachingOptimizingCompiler::CachingOptimizingCompiler(
     seconds_taken_optimize_(0.0), seconds_taken_expand_(0.0),
     seconds_taken_check_(0.0), seconds_taken_indexes_(0.0),
     seconds_taken_io_(0.0), cache_(config.cache_capacity),
-    nnet_left_context_(-1), nnet_right_context_(-1) { }
+    num_compiled_(0), nnet_left_context_(-1), nnet_right_context_(-1) { }
 
 void CachingOptimizingCompiler::GetSimpleNnetContext(
     int32 *nnet_left_context, int32 *nnet_right_context) {
@@ -663,15 +688,16 @@ void CachingOptimizingCompiler::GetSimpleNnetContext(
   *nnet_right_context = nnet_right_context_;
 }
 
-void CachingOptimizingCompiler::ReadCache(std::istream &is, bool binary) {
+bool CachingOptimizingCompiler::ReadCache(std::istream &is, bool binary,
+                                          bool merge) {
   {
     Timer timer;
     NnetOptimizeOptions opt_config_cached;
     opt_config_cached.Read(is, binary);
     // we won't read cached computations if any optimize option has been changed.
     if (!(opt_config_ == opt_config_cached))
-      return;
-    cache_.Read(is, binary);
+      return false;
+    cache_.Read(is, binary, merge);
     seconds_taken_io_ += timer.Elapsed();
   }
   if (GetVerboseLevel() >= 2) {
@@ -682,7 +708,7 @@ void CachingOptimizingCompiler::ReadCache(std::istream &is, bool binary) {
     // arbitrary but it only affects printed times-taken.
     seconds_taken_total_ += timer.Elapsed();
   }
-
+  return true;
 }
 
 void CachingOptimizingCompiler::WriteCache(std::ostream &os, bool binary) {
@@ -692,6 +718,104 @@ void CachingOptimizingCompiler::WriteCache(std::ostream &os, bool binary) {
   seconds_taken_io_ += timer.Elapsed();
 }
 
+uint64 CachingOptimizingCompiler::NnetHash() {
+  std::ostringstream os;
+  nnet_.Write(os, true);
+  return StringHasher()(os.str());
+}
+
+bool CachingOptimizingCompiler::ReadCacheFile(const std::string &filename) {
+  return ReadCacheFileInternal(filename, false);
+}
+
+bool CachingOptimizingCompiler::ReadCacheFileInternal(
+    const std::string &filename, bool merge) {
+  if (ClassifyRxfilename(filename) != kFileInput)
+    KALDI_ERR << "The computation cache must be an ordinary file: "
+              << filename;
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  if (!is.is_open()) {
+    KALDI_VLOG(1) << "Computation cache " << filename << " does not exist yet.";
+    return false;
+  }
+  try {
+    uint64 nnet_hash;
+    ExpectToken(is, true, "<NnetComputationCache>");
+    ExpectToken(is, true, "<NnetHash>");
+    ReadBasicType(is, true, &nnet_hash);
+    if (nnet_hash != NnetHash()) {
+      KALDI_LOG << "Not using computation cache " << filename
+                << " since it was written for a different model.";
+      return false;
+    }
+    if (!ReadCache(is, true, merge)) {
+      KALDI_LOG << "Not using computation cache " << filename
+                << " since it was written with different optimization options.";
+      return false;
+    }
+    ExpectToken(is, true, "</NnetComputationCache>");
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error reading computation cache " << filename
+               << ", ignoring it: " << e.what();
+    return false;
+  }
+  KALDI_VLOG(1) << "Read computation cache from " << filename;
+  return true;
+}
+
+void CachingOptimizingCompiler::WriteCacheFile(const std::string &filename) {
+  if (num_compiled_ == 0) {
+    KALDI_VLOG(1) << "No new computations were compiled; not updating "
+                  << "computation cache " << filename;
+    return;
+  }
+  if (ClassifyWxfilename(filename) != kFileOutput)
+    KALDI_ERR << "The computation cache must be an ordinary file: "
+              << filename;
+  std::string tmp_filename = filename + ".tmp";
+#if !defined(_MSC_VER)
+  // The lock serializes the jobs that update the same file.  We lock a
+  // separate file, because the cache file itself is replaced by rename().
+  std::string lock_filename = filename + ".lock";
+  int lock_fd = open(lock_filename.c_str(), O_RDWR | O_CREAT, 0666);
+  if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+    KALDI_WARN << "Could not lock " << lock_filename << ", not updating "
+               << "computation cache: " << strerror(errno);
+    if (lock_fd >= 0)
+      close(lock_fd);
+    return;
+  }
+  std::ostringstream pid;
+  pid << '.' << getpid();
+  tmp_filename += pid.str();
+#endif
+  // Keep the computations that other jobs have written since we read the file.
+  ReadCacheFileInternal(filename, true);
+  bool ok;
+  {
+    std::ofstream os(tmp_filename.c_str(), std::ios::binary);
+    WriteToken(os, true, "<NnetComputationCache>");
+    WriteToken(os, true, "<NnetHash>");
+    WriteBasicType(os, true, NnetHash());
+    WriteCache(os, true);
+    WriteToken(os, true, "</NnetComputationCache>");
+    os.close();
+    ok = !os.fail();
+  }
+  if (!ok || std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    KALDI_WARN << "Error writing computation cache " << filename << ": "
+               << strerror(errno);
+    std::remove(tmp_filename.c_str());
+  } else {
+    KALDI_LOG << "Wrote computation cache to " << filename;
+    num_compiled_ = 0;
+  }
+#if !defined(_MSC_VER)
+  flock(lock_fd, LOCK_UN);
+  close(lock_fd);
+#endif
+}
+
 CachingOptimizingCompiler::~CachingOptimizingCompiler() {
   if (seconds_taken_total_ > 0.0 || seconds_taken_io_ > 0.0) {
     std::ostringstream os;
@@ -733,6 +857,7 @@ std::shared_ptr<const NnetComputation> CachingOptimizingCompiler::CompileInterna
     if (computation == NULL)
       computation = CompileNoShortcut(request);
     KALDI_ASSERT(computation != NULL);
+    num_compiled_++;
     return cache_.Insert(request, computation);
   }
 }
@@ -918,6 +1043,46 @@ void ConsolidateIoOperations(const Nnet &nnet,
   computation->commands.swap(reordered_commands);
 }
 
+// Returns true if command 'c' is a propagate command that can be part of a
+// group of commands fused by FuseElementwisePropagations().  We exclude
+// components that use memos because batch-norm in training mode uses them, and
+// it is not row-by-row although it is a simple component.
+static bool IsFusablePropagate(const Nnet &nnet,
+                               const NnetComputation::Command &c) {
+  if (c.command_type != kPropagate || c.arg3 != c.arg4 ||
+      c.arg5 > 0 || c.arg6 > 0)
+    return false;
+  int32 properties = nnet.GetComponent(c.arg1)->Properties();
+  return (properties & kSimpleComponent) &&
+      (properties & kPropagateInPlace) &&
+      !(properties & (kUsesMemo|kRandomComponent));
+}
+
+void FuseElementwisePropagations(const Nnet &nnet,
+                                 NnetComputation *computation) {
+  std::vector<NnetComputation::Command> &commands = computation->commands;
+  int32 num_commands = commands.size(), num_fused = 0;
+  for (int32 c = 0; c < num_commands; c++) {
+    if (commands[c].command_type == kPropagate)
+      commands[c].arg7 = -1;  // in case this function was called before.
+  }
+  for (int32 c = 0; c < num_commands; ) {
+    int32 end = c;
+    while (end < num_commands && IsFusablePropagate(nnet, commands[end]) &&
+           commands[end].arg3 == commands[c].arg3)
+      end++;
+    if (end - c > 1) {
+      commands[c].arg7 = end - c;
+      num_fused += end - c;
+      c = end;
+    } else {
+      c++;
+    }
+  }
+  if (num_fused > 0 && GetVerboseLevel() >= 4)
+    KALDI_LOG << "Fused " << num_fused << " propagate commands.";
+}
+
 
 
 
@@ -21,6 +21,7 @@
 #ifndef KALDI_NNET3_NNET_OPTIMIZE_H_
 #define KALDI_NNET3_NNET_OPTIMIZE_H_
 
+#include <atomic>
 #include "nnet3/nnet-compile.h"
 #include "nnet3/nnet-analyze.h"
 #include "nnet3/nnet-optimize-utils.h"
@@ -54,6 +55,7 @@ struct NnetOptimizeOptions {
   int32 max_deriv_time_relative;
   bool snip_row_ops;
   int32 memory_compression_level;
+  bool fuse_elementwise;
   // optimize_looped_computation is a 'hidden config' not available from
   // the command line; it's set to true to enable the optimization for
   // looped computation that turns a linear computation into a loop.
@@ -79,6 +81,7 @@ struct NnetOptimizeOptions {
       max_deriv_time_relative(std::numeric_limits<int32>::max()),
       snip_row_ops(true),
       memory_compression_level(1),
+      fuse_elementwise(true),
       optimize_looped_computation(false) { }
 
   void Register(OptionsItf *opts) {
@@ -145,6 +148,11 @@ struct NnetOptimizeOptions {
                    "potentially at the expense of speed and the accuracy "
                    "of derivatives.  0 means no compression at all; 1 means "
                    "compression that shouldn't affect results at all.");
+    opts->Register("fuse-elementwise", &fuse_elementwise, "Set this to false "
+                   "to disable an optimization that, on the CPU, does "
+                   "successive in-place elementwise operations such as ReLU "
+                   "and test-mode batch-norm (as after an affine layer) in a "
+                   "single pass over the data.  Mostly relevant in test time.");
 
   }
   void Read(std::istream &is, bool binary);
@@ -239,9 +247,33 @@ class CachingOptimizingCompiler {
   /// 'std::shared_ptr<const NnetComputation>' in the calling code.
   std::shared_ptr<const NnetComputation> Compile(
       const ComputationRequest &request);
-  void ReadCache(std::istream &is, bool binary);
+
+  /// Reads computations written by WriteCache().  Returns false, reading
+  /// nothing more, if they were compiled with different optimization options.
+  /// If 'merge' is true they are added to the computations already cached
+  /// rather than replacing them.
+  bool ReadCache(std::istream &is, bool binary, bool merge = false);
   void WriteCache(std::ostream &os, bool binary);
 
+  /// Reads the cache file written by WriteCacheFile(), which must be an
+  /// ordinary file.  The file is only used if it was written for the same
+  /// neural net (this is checked with a hash of the nnet's parameters and
+  /// structure) and with the same optimization options; returns true if it
+  /// was.  It is not an error if the file does not exist or is not usable;
+  /// this only prints a message.
+  bool ReadCacheFile(const std::string &filename);
+
+  /// Writes the cached computations to 'filename' if any computation was
+  /// compiled since the file was read (or since the last call).  This is
+  /// designed to be called at the end of each of many jobs that share one
+  /// cache file: the file is updated while holding an exclusive lock on
+  /// "<filename>.lock", the computations other jobs have added to it in the
+  /// mean time are kept, and the new version is written to a temporary file
+  /// that is then renamed, so readers never see a partially written file.
+  /// Failures only produce a warning.  Note: the number of computations
+  /// stored is limited by the --cache-capacity option.
+  void WriteCacheFile(const std::string &filename);
+
 
   // GetSimpleNnetContext() is equivalent to calling:
   // ComputeSimpleNnetContext(nnet_, &nnet_left_context,
@@ -285,6 +317,13 @@ class CachingOptimizingCompiler {
   // the computation cache).
   const NnetComputation *CompileNoShortcut(const ComputationRequest &request);
 
+  // Does the work of ReadCacheFile().
+  bool ReadCacheFileInternal(const std::string &filename, bool merge);
+
+  // Returns a hash of the binary form of nnet_, used to check that a cache
+  // file belongs to this nnet.
+  uint64 NnetHash();
+
   const Nnet &nnet_;
   CachingOptimizingCompilerOptions config_;
   NnetOptimizeOptions opt_config_;
@@ -301,6 +340,10 @@ class CachingOptimizingCompiler {
 
   ComputationCache cache_;
 
+  // The number of computations compiled (not found in the cache) since
+  // construction or the last call to WriteCacheFile().
+  std::atomic<int32> num_compiled_;
+
   // These following two variables are only used by the function GetSimpleNnetContext().
   int32 nnet_left_context_;
   int32 nnet_right_context_;
@@ -390,6 +433,18 @@ void RemoveUnnecessaryAllocation(const Nnet &nnet,
 void ConsolidateIoOperations(const Nnet &nnet,
                              NnetComputation *computation);
 
+/// This optimization finds sequences of two or more successive kPropagate
+/// commands that operate in-place on the same submatrix, for simple components
+/// such as ReLU, test-mode batch-norm or fixed scales that need no memo and no
+/// stats (in practice, the elementwise operations that follow an affine
+/// component in test time).  It marks the first of them by setting its arg7
+/// to the number of commands; NnetComputer then, on the CPU, does them
+/// together a block of rows at a time, so the data is read from memory only
+/// once.  This must be the last optimization, since it relies on the commands
+/// being adjacent.
+void FuseElementwisePropagations(const Nnet &nnet,
+                                 NnetComputation *computation);
+
 
 
 } // namespace nnet3
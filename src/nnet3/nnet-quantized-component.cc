@@ -0,0 +1,278 @@
+// nnet3/nnet-quantized-component.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-parse.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// The quantized matrix multiplication is only implemented on the CPU.
+static void CheckNotUsingGpu(const std::string &type) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    KALDI_ERR << type << " cannot be used on a GPU; use the model "
+              << "from before quantization.";
+#endif
+}
+
+QuantizedAffineComponent::QuantizedAffineComponent(const AffineComponent &c) {
+  Init(c.LinearParams(), c.BiasParams());
+}
+
+QuantizedAffineComponent::QuantizedAffineComponent(const LinearComponent &c) {
+  Init(c.Params(), CuVector<BaseFloat>());
+}
+
+void QuantizedAffineComponent::Init(const CuMatrixBase<BaseFloat> &linear,
+                                    const CuVectorBase<BaseFloat> &bias) {
+  KALDI_ASSERT(bias.Dim() == 0 || bias.Dim() == linear.NumRows());
+  Matrix<BaseFloat> linear_cpu(linear);
+  linear_params_.CopyFromMat(linear_cpu);
+  bias_params_ = bias;
+}
+
+std::string QuantizedAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info()
+         << ", linear-params-bytes=" << linear_params_.SizeInBytes();
+  if (bias_params_.Dim() == 0)
+    stream << ", has-bias=false";
+  else
+    PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void QuantizedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  AffineComponent c;
+  c.InitFromConfig(cfl);
+  Init(c.LinearParams(), c.BiasParams());
+}
+
+void* QuantizedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  CheckNotUsingGpu(Type());
+  // if bias_params_.Dim() == 0 we have the kPropagateAdds flag, so we add to
+  // 'out'.
+  if (bias_params_.Dim() != 0)
+    out->CopyRowsFromVec(bias_params_);
+  AddMatQuantizedMatTrans(1.0, in.Mat(), linear_params_, &(out->Mat()));
+  return NULL;
+}
+
+void QuantizedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const { // in_deriv
+  KALDI_ERR << Type() << " does not support backprop (component "
+            << debug_info << ")";
+}
+
+Component* QuantizedAffineComponent::Copy() const {
+  QuantizedAffineComponent *ans = new QuantizedAffineComponent();
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedAffineComponent>");
+  WriteToken(os, binary, "<LinearParams>");
+  linear_params_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedAffineComponent>");
+}
+
+void QuantizedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedAffineComponent>",
+                       "<LinearParams>");
+  linear_params_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</QuantizedAffineComponent>");
+  KALDI_ASSERT(bias_params_.Dim() == 0 ||
+               bias_params_.Dim() == linear_params_.NumRows());
+}
+
+
+QuantizedTdnnComponent::QuantizedTdnnComponent(const TdnnComponent &c) {
+  Init(c);
+}
+
+void QuantizedTdnnComponent::Init(const TdnnComponent &c) {
+  time_offsets_ = c.TimeOffsets();
+  int32 num_offsets = time_offsets_.size(), input_dim = c.InputDim();
+  Matrix<BaseFloat> linear(c.LinearParams());
+  linear_params_.clear();
+  linear_params_.resize(num_offsets);
+  for (int32 i = 0; i < num_offsets; i++)
+    linear_params_[i].CopyFromMat(
+        SubMatrix<BaseFloat>(linear, 0, linear.NumRows(),
+                             i * input_dim, input_dim));
+  bias_params_ = c.BiasParams();
+}
+
+std::string QuantizedTdnnComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info() << ", time-offsets=";
+  for (size_t i = 0; i < time_offsets_.size(); i++) {
+    if (i != 0) stream << ',';
+    stream << time_offsets_[i];
+  }
+  int64 num_bytes = 0;
+  for (size_t i = 0; i < linear_params_.size(); i++)
+    num_bytes += linear_params_[i].SizeInBytes();
+  stream << ", linear-params-bytes=" << num_bytes;
+  if (bias_params_.Dim() == 0)
+    stream << ", has-bias=false";
+  else
+    PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+int32 QuantizedTdnnComponent::NumParameters() const {
+  int32 ans = bias_params_.Dim();
+  for (size_t i = 0; i < linear_params_.size(); i++)
+    ans += linear_params_[i].NumRows() * linear_params_[i].NumCols();
+  return ans;
+}
+
+void QuantizedTdnnComponent::InitFromConfig(ConfigLine *cfl) {
+  TdnnComponent c;
+  c.InitFromConfig(cfl);
+  Init(c);
+}
+
+void* QuantizedTdnnComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes_in,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  CheckNotUsingGpu(Type());
+  const TdnnComponent::PrecomputedIndexes *indexes =
+      dynamic_cast<const TdnnComponent::PrecomputedIndexes*>(indexes_in);
+  KALDI_ASSERT(indexes != NULL &&
+               indexes->row_offsets.size() == time_offsets_.size());
+  if (bias_params_.Dim() != 0)
+    out->CopyRowsFromVec(bias_params_);
+  int32 num_offsets = time_offsets_.size();
+  for (int32 i = 0; i < num_offsets; i++) {
+    CuSubMatrix<BaseFloat> in_part = TdnnComponent::GetInputPart(
+        in, out->NumRows(), indexes->row_stride, indexes->row_offsets[i]);
+    AddMatQuantizedMatTrans(1.0, in_part.Mat(), linear_params_[i],
+                            &(out->Mat()));
+  }
+  return NULL;
+}
+
+void QuantizedTdnnComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const { // in_deriv
+  KALDI_ERR << Type() << " does not support backprop (component "
+            << debug_info << ")";
+}
+
+Component* QuantizedTdnnComponent::Copy() const {
+  QuantizedTdnnComponent *ans = new QuantizedTdnnComponent();
+  ans->time_offsets_ = time_offsets_;
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedTdnnComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedTdnnComponent>");
+  WriteToken(os, binary, "<TimeOffsets>");
+  WriteIntegerVector(os, binary, time_offsets_);
+  WriteToken(os, binary, "<LinearParams>");
+  for (size_t i = 0; i < linear_params_.size(); i++)
+    linear_params_[i].Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedTdnnComponent>");
+}
+
+void QuantizedTdnnComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedTdnnComponent>",
+                       "<TimeOffsets>");
+  ReadIntegerVector(is, binary, &time_offsets_);
+  KALDI_ASSERT(!time_offsets_.empty());
+  ExpectToken(is, binary, "<LinearParams>");
+  linear_params_.clear();
+  linear_params_.resize(time_offsets_.size());
+  for (size_t i = 0; i < linear_params_.size(); i++) {
+    linear_params_[i].Read(is, binary);
+    KALDI_ASSERT(linear_params_[i].NumRows() == linear_params_[0].NumRows() &&
+                 linear_params_[i].NumCols() == linear_params_[0].NumCols());
+  }
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</QuantizedTdnnComponent>");
+  KALDI_ASSERT(bias_params_.Dim() == 0 || bias_params_.Dim() == OutputDim());
+}
+
+void QuantizedTdnnComponent::ReorderIndexes(
+    std::vector<Index> *input_indexes,
+    std::vector<Index> *output_indexes) const {
+  TdnnComponent::ReorderIndexesStatic(input_indexes, output_indexes);
+}
+
+void QuantizedTdnnComponent::GetInputIndexes(
+    const MiscComputationInfo &misc_info,
+    const Index &output_index,
+    std::vector<Index> *desired_indexes) const {
+  TdnnComponent::GetInputIndexesStatic(time_offsets_, output_index,
+                                       desired_indexes);
+}
+
+bool QuantizedTdnnComponent::IsComputable(
+    const MiscComputationInfo &misc_info,
+    const Index &output_index,
+    const IndexSet &input_index_set,
+    std::vector<Index> *used_inputs) const {
+  return TdnnComponent::IsComputableStatic(time_offsets_, output_index,
+                                           input_index_set, used_inputs);
+}
+
+ComponentPrecomputedIndexes* QuantizedTdnnComponent::PrecomputeIndexes(
+    const MiscComputationInfo &misc_info,
+    const std::vector<Index> &input_indexes,
+    const std::vector<Index> &output_indexes,
+    bool need_backprop) const {
+  return TdnnComponent::PrecomputeIndexesStatic(time_offsets_, input_indexes,
+                                                output_indexes);
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
@@ -0,0 +1,203 @@
+// nnet3/nnet-sparse-component.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_SPARSE_COMPONENT_H_
+#define KALDI_NNET3_NNET_SPARSE_COMPONENT_H_
+
+#include <vector>
+#include "matrix/block-sparse-matrix.h"
+#include "nnet3/nnet-common.h"
+#include "nnet3/nnet-component-itf.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-convolutional-component.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  nnet-sparse-component.h
+///
+/// This file contains inference-only versions of AffineComponent and
+/// TdnnComponent whose parameter matrices are stored in block-sparse form (see
+/// class BlockSparseMatrix), so that the time taken by Propagate() is roughly
+/// proportional to the number of blocks of weights that are not all zero.
+/// This is for models that have been pruned, e.g. TDNN-F models in which most
+/// of the weights were set to zero during training.  The output is the same as
+/// that of the dense components, apart from roundoff.  These components cannot
+/// be trained and only work on the CPU.  You would normally create them with
+/// "nnet3-copy --prepare-for-test=true --sparsify=true" or the same options of
+/// nnet3-am-copy; see SparsifyNnet() in nnet-utils.h.
+
+
+/**
+   SparseAffineComponent is the block-sparse version of AffineComponent (and
+   its child classes such as NaturalGradientAffineComponent) and of
+   LinearComponent (in which case there is no bias).
+
+   It accepts the same configuration values as AffineComponent, plus
+   block-rows and block-cols (default 4), and is initialized from the
+   AffineComponent they describe; this is mostly useful for testing.
+ */
+class SparseAffineComponent: public Component {
+ public:
+  SparseAffineComponent() { }
+  SparseAffineComponent(const AffineComponent &c, int32 block_rows,
+                        int32 block_cols);
+  SparseAffineComponent(const LinearComponent &c, int32 block_rows,
+                        int32 block_cols);
+
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+
+  virtual std::string Type() const { return "SparseAffineComponent"; }
+  virtual std::string Info() const;
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual int32 Properties() const {
+    return kSimpleComponent|(bias_params_.Dim() == 0 ? kPropagateAdds : 0);
+  }
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  // Backprop() dies; this component cannot be trained.
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  const BlockSparseMatrix &LinearParams() const { return linear_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+  // Returns the fraction of the blocks of the linear parameters that are
+  // stored.
+  BaseFloat Density() const { return linear_params_.Density(); }
+  // Returns the number of parameters that are stored (those in the stored
+  // blocks, and the bias); NnetComputer uses it to estimate the FLOPs done
+  // (this is not an UpdatableComponent).
+  int32 NumParameters() const {
+    return linear_params_.NumBlocks() * linear_params_.BlockRows() *
+        linear_params_.BlockCols() + bias_params_.Dim();
+  }
+ private:
+  // Converts 'linear' and copies 'bias', which may be empty.
+  void Init(const CuMatrixBase<BaseFloat> &linear,
+            const CuVectorBase<BaseFloat> &bias,
+            int32 block_rows, int32 block_cols);
+
+  BlockSparseMatrix linear_params_;
+  // Empty if there is no bias (i.e. if this came from a LinearComponent).
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SparseAffineComponent);
+};
+
+
+/**
+   SparseTdnnComponent is the block-sparse version of TdnnComponent.  The part
+   of the parameter matrix for each time offset is stored separately.
+
+   It accepts the same configuration values as TdnnComponent, plus block-rows
+   and block-cols (default 4), and is initialized from the TdnnComponent they
+   describe; this is mostly useful for testing.
+ */
+class SparseTdnnComponent: public Component {
+ public:
+  SparseTdnnComponent() { }
+  SparseTdnnComponent(const TdnnComponent &c, int32 block_rows,
+                      int32 block_cols);
+
+  virtual int32 InputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumCols();
+  }
+  virtual int32 OutputDim() const {
+    return linear_params_.empty() ? 0 : linear_params_[0].NumRows();
+  }
+
+  virtual std::string Type() const { return "SparseTdnnComponent"; }
+  virtual std::string Info() const;
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual int32 Properties() const {
+    return kReordersIndexes|(bias_params_.Dim() == 0 ? kPropagateAdds : 0);
+  }
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  // Backprop() dies; this component cannot be trained.
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  // The following functions do the same as in TdnnComponent, and use
+  // TdnnComponent::PrecomputedIndexes.
+  virtual void ReorderIndexes(std::vector<Index> *input_indexes,
+                              std::vector<Index> *output_indexes) const;
+  virtual void GetInputIndexes(const MiscComputationInfo &misc_info,
+                               const Index &output_index,
+                               std::vector<Index> *desired_indexes) const;
+  virtual bool IsComputable(const MiscComputationInfo &misc_info,
+                            const Index &output_index,
+                            const IndexSet &input_index_set,
+                            std::vector<Index> *used_inputs) const;
+  virtual ComponentPrecomputedIndexes* PrecomputeIndexes(
+      const MiscComputationInfo &misc_info,
+      const std::vector<Index> &input_indexes,
+      const std::vector<Index> &output_indexes,
+      bool need_backprop) const;
+
+  // Returns the fraction of the blocks of the linear parameters (over all
+  // time offsets) that are stored.
+  BaseFloat Density() const;
+
+  // Returns the number of parameters that are stored, as for
+  // SparseAffineComponent.
+  int32 NumParameters() const;
+
+ private:
+  // Sets up this object from 'c'.
+  void Init(const TdnnComponent &c, int32 block_rows, int32 block_cols);
+
+  std::vector<int32> time_offsets_;
+  // One matrix of dimension output-dim by input-dim per time offset.
+  std::vector<BlockSparseMatrix> linear_params_;
+  // Empty if there is no bias.
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SparseTdnnComponent);
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+
+#endif
@@ -20,7 +20,9 @@
 
 #include "nnet3/nnet-nnet.h"
 #include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-convolutional-component.h"
 #include "nnet3/nnet-test-utils.h"
+#include "nnet3/nnet-am-decodable-simple.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -100,6 +102,217 @@ void UnitTestConvertRepeatedToBlockAffineComposite() {
   }
 }
 
+// Computes the output of 'nnet' for 'input', without acoustic scaling.  If
+// 'profile' is true, the computation is recorded by GetNnetComputeProfiler().
+static void ComputeNnetOutput(const Nnet &nnet,
+                              const Matrix<BaseFloat> &input,
+                              Matrix<BaseFloat> *output,
+                              bool profile = false) {
+  NnetSimpleComputationOptions opts;
+  opts.acoustic_scale = 1.0;
+  opts.compute_config.profile = profile;
+  CachingOptimizingCompiler compiler(nnet, opts.optimize_config);
+  Vector<BaseFloat> priors;
+  DecodableNnetSimple decodable(opts, nnet, priors, input, &compiler);
+  output->Resize(decodable.NumFrames(), decodable.OutputDim());
+  for (int32 t = 0; t < decodable.NumFrames(); t++) {
+    SubVector<BaseFloat> row(*output, t);
+    decodable.GetOutputForFrame(t, &row);
+  }
+}
+
+// Reads into 'nnet' a small TDNN with input dimension 40, whose components
+// include all the types that QuantizeNnet() and SparsifyNnet() convert:
+// tdnn1, linear2, tdnn3 (without bias) and affine4.
+static void ReadTdnnTestNnet(Nnet *nnet) {
+  std::string config =
+    "component name=tdnn1 type=TdnnComponent input-dim=40 output-dim=512 "
+    "time-offsets=-1,0,1\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=512\n"
+    "component name=linear2 type=LinearComponent input-dim=512 "
+    "output-dim=128\n"
+    "component name=tdnn3 type=TdnnComponent input-dim=128 output-dim=512 "
+    "time-offsets=-3,0,3 use-bias=false\n"
+    "component name=relu3 type=RectifiedLinearComponent dim=512\n"
+    "component name=affine4 type=NaturalGradientAffineComponent "
+    "input-dim=512 output-dim=300\n"
+    "\n"
+    "input-node name=input dim=40\n"
+    "component-node name=tdnn1 component=tdnn1 input=input\n"
+    "component-node name=relu1 component=relu1 input=tdnn1\n"
+    "component-node name=linear2 component=linear2 input=relu1\n"
+    "component-node name=tdnn3 component=tdnn3 input=linear2\n"
+    "component-node name=relu3 component=relu3 input=tdnn3\n"
+    "component-node name=affine4 component=affine4 input=relu3\n"
+    "output-node name=output input=affine4\n";
+  std::istringstream is(config);
+  nnet->ReadConfig(is);
+}
+
+// Returns the number of components of 'nnet' whose type contains 'str'.
+static int32 NumComponentsOfType(const Nnet &nnet, const std::string &str) {
+  int32 ans = 0;
+  for (int32 i = 0; i < nnet.NumComponents(); i++)
+    if (nnet.GetComponent(i)->Type().find(str) != std::string::npos)
+      ans++;
+  return ans;
+}
+
+// Checks that writing 'nnet' and reading it back, in binary and in text mode,
+// does not change its output 'output' for 'input' by more than a relative
+// 1.0e-05 in binary mode or 'text_tolerance' in text mode (where the
+// parameters are rounded).
+static void CheckNnetWriteRead(const Nnet &nnet,
+                               const Matrix<BaseFloat> &input,
+                               const Matrix<BaseFloat> &output,
+                               BaseFloat text_tolerance) {
+  for (int32 i = 0; i < 2; i++) {
+    bool binary = (i == 0);
+    std::ostringstream os;
+    nnet.Write(os, binary);
+    Nnet nnet2;
+    std::istringstream is(os.str());
+    nnet2.Read(is, binary);
+    Matrix<BaseFloat> output2;
+    ComputeNnetOutput(nnet2, input, &output2);
+    KALDI_ASSERT(output2.ApproxEqual(output,
+                                     binary ? 1.0e-05 : text_tolerance));
+  }
+}
+
+// Returns the FLOPs that NnetComputer attributes to the Propagate commands when
+// computing the output of 'nnet' for 'input'.
+static double PropagateFlops(const Nnet &nnet,
+                             const Matrix<BaseFloat> &input) {
+  GetNnetComputeProfiler().Clear();
+  Matrix<BaseFloat> output;
+  ComputeNnetOutput(nnet, input, &output, true);
+  double ans = GetNnetComputeProfiler().CommandTypeStats("Propagate").flops;
+  GetNnetComputeProfiler().Clear();
+  return ans;
+}
+
+// Checks that 'nnet_b' computes nearly the same output as 'nnet_a' for a
+// random input of 500 frames: the Frobenius norm of the difference must be
+// less than 'tolerance' times that of the output of 'nnet_a'.  If 'input' and
+// 'output_b' are non-NULL, outputs the input and the output of 'nnet_b' to
+// them, for further checks.
+static void CheckNnetOutputsClose(const Nnet &nnet_a, const Nnet &nnet_b,
+                                  BaseFloat tolerance,
+                                  Matrix<BaseFloat> *input = NULL,
+                                  Matrix<BaseFloat> *output_b = NULL) {
+  Matrix<BaseFloat> random_input(500, nnet_a.InputDim("input")), output_a,
+      temp_output_b;
+  random_input.SetRandn();
+  ComputeNnetOutput(nnet_a, random_input, &output_a);
+  ComputeNnetOutput(nnet_b, random_input, &temp_output_b);
+  Matrix<BaseFloat> diff(output_a);
+  diff.AddMat(-1.0, temp_output_b);
+  BaseFloat relative_error = diff.FrobeniusNorm() / output_a.FrobeniusNorm();
+  KALDI_VLOG(1) << "Relative difference of nnet outputs is "
+                << relative_error;
+  KALDI_ASSERT(relative_error < tolerance);
+  if (input != NULL)
+    input->Swap(&random_input);
+  if (output_b != NULL)
+    output_b->Swap(&temp_output_b);
+}
+
+void UnitTestQuantizeNnet() {
+  Nnet nnet;
+  ReadTdnnTestNnet(&nnet);
+  Nnet quantized_nnet(nnet);
+  KALDI_ASSERT(QuantizeNnet("*", &quantized_nnet) == 4);
+  KALDI_ASSERT(NumComponentsOfType(quantized_nnet, "Quantized") == 4);
+
+  Matrix<BaseFloat> input, quantized_output;
+  CheckNnetOutputsClose(nnet, quantized_nnet, 0.05, &input, &quantized_output);
+  // The quantized components do as many multiplications as the float ones.
+  KALDI_ASSERT(ApproxEqual(PropagateFlops(quantized_nnet, input),
+                           PropagateFlops(nnet, input)));
+
+  // In text mode the scales and biases are rounded, which can change the
+  // rounding of the quantized activations in later layers, so we allow more
+  // error.
+  CheckNnetWriteRead(quantized_nnet, input, quantized_output, 0.01);
+}
+
+// Sets to zero each 4x4 block of 'params' with probability 'zero_prob'.
+static void PruneParams(BaseFloat zero_prob, CuMatrixBase<BaseFloat> *params) {
+  Matrix<BaseFloat> mat(*params);
+  for (int32 r = 0; r < mat.NumRows(); r += 4)
+    for (int32 c = 0; c < mat.NumCols(); c += 4)
+      if (RandUniform() < zero_prob)
+        mat.Range(r, std::min(4, mat.NumRows() - r),
+                  c, std::min(4, mat.NumCols() - c)).SetZero();
+  params->CopyFromMat(mat);
+}
+
+void UnitTestSparsifyNnet() {
+  Nnet nnet;
+  ReadTdnnTestNnet(&nnet);
+  // Prune all but the last component, which should then be left dense since
+  // its density is more than max_density.
+  PruneParams(0.9, &(dynamic_cast<TdnnComponent*>(
+      nnet.GetComponent(nnet.GetComponentIndex("tdnn1")))->LinearParams()));
+  PruneParams(0.8, &(dynamic_cast<LinearComponent*>(
+      nnet.GetComponent(nnet.GetComponentIndex("linear2")))->Params()));
+  PruneParams(0.9, &(dynamic_cast<TdnnComponent*>(
+      nnet.GetComponent(nnet.GetComponentIndex("tdnn3")))->LinearParams()));
+  PruneParams(0.2, &(dynamic_cast<AffineComponent*>(
+      nnet.GetComponent(nnet.GetComponentIndex("affine4")))->LinearParams()));
+
+  SparsifyNnetConfig sparsify_config;
+  Nnet sparse_nnet(nnet);
+  KALDI_ASSERT(SparsifyNnet(sparsify_config, "*", &sparse_nnet) == 3);
+  KALDI_ASSERT(NumComponentsOfType(sparse_nnet, "Sparse") == 3);
+
+  Matrix<BaseFloat> input, sparse_output;
+  CheckNnetOutputsClose(nnet, sparse_nnet, 1.0e-04, &input, &sparse_output);
+  // About 40% of the parameters are stored (affine4 is dense).
+  double flops_ratio = PropagateFlops(sparse_nnet, input) /
+      PropagateFlops(nnet, input);
+  KALDI_ASSERT(flops_ratio > 0.3 && flops_ratio < 0.5);
+
+  CheckNnetWriteRead(sparse_nnet, input, sparse_output, 1.0e-03);
+}
+
+void UnitTestCollapseAffineBatchnorm() {
+  std::string config =
+    "component name=affine1 type=NaturalGradientAffineComponent "
+    "input-dim=40 output-dim=256\n"
+    "component name=bn1 type=BatchNormComponent dim=256 block-dim=128\n"
+    "component name=relu1 type=RectifiedLinearComponent dim=256\n"
+    "component name=affine2 type=AffineComponent input-dim=256 "
+    "output-dim=100\n"
+    "component name=bn2 type=BatchNormComponent dim=100\n"
+    "\n"
+    "input-node name=input dim=40\n"
+    "component-node name=affine1 component=affine1 input=input\n"
+    "component-node name=bn1 component=bn1 input=affine1\n"
+    "component-node name=relu1 component=relu1 input=bn1\n"
+    "component-node name=affine2 component=affine2 input=relu1\n"
+    "component-node name=bn2 component=bn2 input=affine2\n"
+    "output-node name=output input=bn2\n";
+
+  Nnet nnet;
+  std::istringstream is(config);
+  nnet.ReadConfig(is);
+  SetBatchnormTestMode(true, &nnet);
+  Nnet collapsed_nnet(nnet);
+  CollapseModelConfig collapse_config;
+  collapse_config.collapse_batchnorm = true;
+  CollapseModel(collapse_config, &collapsed_nnet);
+  // Both batch-norm components should have been folded into the affine
+  // components before them.
+  KALDI_ASSERT(collapsed_nnet.NumComponents() == 3);
+  for (int32 i = 0; i < collapsed_nnet.NumComponents(); i++)
+    KALDI_ASSERT(collapsed_nnet.GetComponent(i)->Type() !=
+                 "BatchNormComponent");
+
+  CheckNnetOutputsClose(nnet, collapsed_nnet, 1.0e-04);
+}
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -111,6 +324,9 @@ int main() {
   UnitTestNnetContext();
   UnitTestConvertRepeatedToBlockAffine();
   UnitTestConvertRepeatedToBlockAffineComposite();
+  UnitTestQuantizeNnet();
+  UnitTestSparsifyNnet();
+  UnitTestCollapseAffineBatchnorm();
 
   KALDI_LOG << "Nnet tests succeeded.";
 
@@ -25,6 +25,8 @@
 #include "nnet3/nnet-normalize-component.h"
 #include "nnet3/nnet-general-component.h"
 #include "nnet3/nnet-convolutional-component.h"
+#include "nnet3/nnet-quantized-component.h"
+#include "nnet3/nnet-sparse-component.h"
 #include "nnet3/nnet-parse.h"
 #include "nnet3/nnet-computation-graph.h"
 #include "nnet3/nnet-diagnostics.h"
@@ -489,6 +491,78 @@ void ConvertRepeatedToBlockAffine(Nnet *nnet) {
   }
 }
 
+int32 QuantizeNnet(const std::string &name_pattern, Nnet *nnet) {
+  int32 num_converted = 0;
+  for (int32 i = 0; i < nnet->NumComponents(); i++) {
+    if (!NameMatchesPattern(nnet->GetComponentName(i).c_str(),
+                            name_pattern.c_str()))
+      continue;
+    const Component *c = nnet->GetComponent(i);
+    Component *new_c = NULL;
+    if (const AffineComponent *ac = dynamic_cast<const AffineComponent*>(c))
+      new_c = new QuantizedAffineComponent(*ac);
+    else if (const LinearComponent *lc =
+             dynamic_cast<const LinearComponent*>(c))
+      new_c = new QuantizedAffineComponent(*lc);
+    else if (const TdnnComponent *tc = dynamic_cast<const TdnnComponent*>(c))
+      new_c = new QuantizedTdnnComponent(*tc);
+    if (new_c != NULL) {
+      // the following call deletes c.
+      nnet->SetComponent(i, new_c);
+      num_converted++;
+    }
+  }
+  KALDI_LOG << "Quantized " << num_converted << " components.";
+  return num_converted;
+}
+
+int32 SparsifyNnet(const SparsifyNnetConfig &config,
+                   const std::string &name_pattern, Nnet *nnet) {
+  int32 num_converted = 0, num_matched = 0;
+  for (int32 i = 0; i < nnet->NumComponents(); i++) {
+    if (!NameMatchesPattern(nnet->GetComponentName(i).c_str(),
+                            name_pattern.c_str()))
+      continue;
+    const Component *c = nnet->GetComponent(i);
+    Component *new_c = NULL;
+    BaseFloat density = 1.0;
+    if (const AffineComponent *ac = dynamic_cast<const AffineComponent*>(c)) {
+      SparseAffineComponent *sc = new SparseAffineComponent(
+          *ac, config.block_rows, config.block_cols);
+      density = sc->Density();
+      new_c = sc;
+    } else if (const LinearComponent *lc =
+               dynamic_cast<const LinearComponent*>(c)) {
+      SparseAffineComponent *sc = new SparseAffineComponent(
+          *lc, config.block_rows, config.block_cols);
+      density = sc->Density();
+      new_c = sc;
+    } else if (const TdnnComponent *tc =
+               dynamic_cast<const TdnnComponent*>(c)) {
+      SparseTdnnComponent *sc = new SparseTdnnComponent(
+          *tc, config.block_rows, config.block_cols);
+      density = sc->Density();
+      new_c = sc;
+    }
+    if (new_c == NULL)
+      continue;
+    num_matched++;
+    if (density > config.max_density) {
+      KALDI_VLOG(2) << "Not making component " << nnet->GetComponentName(i)
+                    << " sparse since its density " << density
+                    << " is more than " << config.max_density;
+      delete new_c;
+      continue;
+    }
+    // the following call deletes c.
+    nnet->SetComponent(i, new_c);
+    num_converted++;
+  }
+  KALDI_LOG << "Made " << num_converted << " out of " << num_matched
+            << " affine and TDNN components sparse.";
+  return num_converted;
+}
+
 std::string NnetInfo(const Nnet &nnet) {
   std::ostringstream ostr;
   if (IsSimpleNnet(nnet)) {
@@ -1498,8 +1572,10 @@ class ModelCollapser {
                                          component_index2)) != -1)
       return ans;
     if (config_.collapse_batchnorm &&
-        (ans = CollapseComponentsBatchnorm(component_index1,
-                                           component_index2)) != -1)
+        ((ans = CollapseComponentsBatchnorm(component_index1,
+                                            component_index2)) != -1 ||
+         (ans = CollapseComponentsAffineBatchnorm(component_index1,
+                                                  component_index2)) != -1))
       return ans;
     if (config_.collapse_affine &&
         (ans = CollapseComponentsAffine(component_index1,
@@ -1895,6 +1971,68 @@ class ModelCollapser {
   }
 
 
+  /**
+     Tries to produce a component that's equivalent to running the component
+     'component_index2' with input given by 'component_index1'.  This handles
+     the case where 'component_index1' is of type AffineComponent or
+     NaturalGradientAffineComponent, and 'component_index2' is a
+     BatchNormComponent (which must be in test mode) whose input dim is the
+     output dim of the first component: the batch-norm is folded into the
+     parameters of the affine component.
+
+     Returns -1 if this code can't produce a combined component.
+   */
+  int32 CollapseComponentsAffineBatchnorm(int32 component_index1,
+                                          int32 component_index2) {
+    const AffineComponent *affine_component1 =
+        dynamic_cast<const AffineComponent*>(
+            nnet_->GetComponent(component_index1));
+    const BatchNormComponent *batchnorm_component2 =
+        dynamic_cast<const BatchNormComponent*>(
+            nnet_->GetComponent(component_index2));
+    if (affine_component1 == NULL || batchnorm_component2 == NULL ||
+        affine_component1->OutputDim() != batchnorm_component2->InputDim() ||
+        batchnorm_component2->OutputDim() != batchnorm_component2->InputDim())
+      return -1;
+    if (batchnorm_component2->Offset().Dim() == 0) {
+      KALDI_ERR << "Expected batch-norm components to have test-mode set.";
+    }
+
+    std::ostringstream new_component_name_os;
+    new_component_name_os << nnet_->GetComponentName(component_index1)
+                          << "." << nnet_->GetComponentName(component_index2);
+    std::string new_component_name = new_component_name_os.str();
+    int32 new_component_index = nnet_->GetComponentIndex(new_component_name);
+    if (new_component_index >= 0)
+      return new_component_index;  // we previously created this.
+
+    // If the batch-norm's block-dim is less than its dim, its offset and scale
+    // repeat every block-dim dimensions.
+    int32 dim = affine_component1->OutputDim(),
+        block_dim = batchnorm_component2->Scale().Dim();
+    KALDI_ASSERT(dim % block_dim == 0);
+    CuVector<BaseFloat> scale(dim), offset(dim);
+    for (int32 i = 0; i < dim / block_dim; i++) {
+      scale.Range(i * block_dim, block_dim).CopyFromVec(
+          batchnorm_component2->Scale());
+      offset.Range(i * block_dim, block_dim).CopyFromVec(
+          batchnorm_component2->Offset());
+    }
+
+    CuMatrix<BaseFloat> linear_params(affine_component1->LinearParams());
+    CuVector<BaseFloat> bias_params(affine_component1->BiasParams());
+    linear_params.MulRowsVec(scale);
+    bias_params.MulElements(scale);
+    bias_params.AddVec(1.0, offset);
+
+    AffineComponent *new_affine_component =
+        dynamic_cast<AffineComponent*>(affine_component1->Copy());
+    new_affine_component->SetParams(bias_params, linear_params);
+    return nnet_->AddComponent(new_component_name,
+                               new_affine_component);
+  }
+
+
   /**
      This function finds, or creates, a component which is like
      'component_index' but is combined with a diagonal offset-and-scale
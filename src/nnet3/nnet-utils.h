@@ -22,6 +22,7 @@
 
 #include "base/kaldi-common.h"
 #include "util/kaldi-io.h"
+#include "itf/options-itf.h"
 #include "matrix/matrix-lib.h"
 #include "nnet3/nnet-common.h"
 #include "nnet3/nnet-component-itf.h"
@@ -164,6 +165,48 @@ void FreezeNaturalGradient(bool freeze, Nnet *nnet);
 /// NaturalGradientRepeatedAffineComponent to BlockAffineComponent in nnet.
 void ConvertRepeatedToBlockAffine(Nnet *nnet);
 
+/// Converts the components of type AffineComponent (or child classes such as
+/// NaturalGradientAffineComponent), LinearComponent and TdnnComponent whose
+/// names match 'name_pattern' (e.g. "*"; see NameMatchesPattern()) to the
+/// inference-only QuantizedAffineComponent and QuantizedTdnnComponent, which
+/// store their parameters as 8-bit integers; see nnet-quantized-component.h.
+/// The nnet can no longer be trained or used on a GPU afterwards.  This should
+/// be done after CollapseModel(), which does not know about the quantized
+/// components.  Components inside CompositeComponents are not converted.
+/// Returns the number of components converted.
+int32 QuantizeNnet(const std::string &name_pattern, Nnet *nnet);
+
+struct SparsifyNnetConfig {
+  int32 block_rows;
+  int32 block_cols;
+  BaseFloat max_density;
+  SparsifyNnetConfig(): block_rows(4), block_cols(4), max_density(0.5) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("sparse-block-rows", &block_rows, "Number of rows of the "
+                   "blocks in which the weights of sparse components are "
+                   "stored (must be 1, 2, 4 or 8).");
+    opts->Register("sparse-block-cols", &block_cols, "Number of columns of "
+                   "the blocks in which the weights of sparse components are "
+                   "stored.");
+    opts->Register("sparse-max-density", &max_density, "Components are only "
+                   "made sparse if at most this fraction of the blocks of "
+                   "their weights contain nonzero values; denser ones are "
+                   "faster with dense matrix multiplication.");
+  }
+};
+
+/// Converts the components of type AffineComponent (or child classes),
+/// LinearComponent and TdnnComponent whose names match 'name_pattern' to the
+/// inference-only SparseAffineComponent and SparseTdnnComponent, which store
+/// their weights in block-sparse form; see nnet-sparse-component.h.  This is
+/// only done for components in which the fraction of blocks of the weights
+/// that contain nonzero values is no more than config.max_density.  It is
+/// useful for models whose weights have been pruned.  The same restrictions
+/// apply as for QuantizeNnet(), and the two cannot be applied to the same
+/// component.  Returns the number of components converted.
+int32 SparsifyNnet(const SparsifyNnetConfig &config,
+                   const std::string &name_pattern, Nnet *nnet);
+
 /// This function returns various info about the neural net.
 /// If the nnet satisfied IsSimpleNnet(nnet), the info includes "left-context=5\nright-context=3\n...".  The info includes
 /// the output of nnet.Info().
@@ -239,7 +282,7 @@ void FindOrphanNodes(const Nnet &nnet, std::vector<int32> *nodes);
  */
 struct CollapseModelConfig {
   bool collapse_dropout;  // dropout then affine/conv.
-  bool collapse_batchnorm;  // batchnorm then affine.
+  bool collapse_batchnorm;  // batchnorm then affine, or affine then batchnorm.
   bool collapse_affine;  // affine or fixed-affine then affine.
   bool collapse_scale;  // affine then fixed-scale.
   CollapseModelConfig(): collapse_dropout(false),
@@ -51,6 +51,10 @@ int main(int argc, char *argv[]) {
     bool convert_repeated_to_block = false;
     BaseFloat scale = 1.0;
     bool prepare_for_test = false;
+    bool quantize = false, sparsify = false;
+    bool align_for_mmap = false;
+    std::string quantize_components = "*", sparsify_components = "*";
+    SparsifyNnetConfig sparsify_config;
     std::string nnet_config, edits_config, edits_str;
 
     ParseOptions po(usage);
@@ -87,6 +91,31 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("quantize", &quantize,
+                "If true, convert the affine, linear and TDNN components to "
+                "8-bit quantized versions which are faster on CPUs but "
+                "cannot be trained or used on GPU (this is done after "
+                "--prepare-for-test, which you should normally also set).");
+    po.Register("quantize-components", &quantize_components,
+                "Pattern (e.g. 'tdnn*') that selects the components which "
+                "--quantize=true converts, by name.");
+    po.Register("sparsify", &sparsify,
+                "If true, convert the affine, linear and TDNN components whose "
+                "weights are mostly zero (e.g. after pruning) to versions "
+                "that store the weights in block-sparse form, which are faster "
+                "on CPUs but cannot be trained or used on GPU (this is done "
+                "after --prepare-for-test and before --quantize, which then "
+                "only applies to the components that were not converted).");
+    po.Register("sparsify-components", &sparsify_components,
+                "Pattern (e.g. 'tdnn*') that selects the components which "
+                "--sparsify=true converts, by name.");
+    sparsify_config.Register(&po);
+    po.Register("align-for-mmap", &align_for_mmap,
+                "If true (and --binary=true), pad the output so that the large "
+                "parameter matrices start at multiples of 4096 bytes in the "
+                "file.  Decoding programs given --mmap-model=true can then map "
+                "the model into memory and share its parameters between "
+                "processes.  The model can still be read as usual.");
 
     po.Read(argc, argv);
 
@@ -147,7 +176,12 @@ int main(int argc, char *argv[]) {
       SetDropoutTestMode(true, &am_nnet.GetNnet());
       CollapseModel(CollapseModelConfig(), &am_nnet.GetNnet());
     }
+    if (sparsify)
+      SparsifyNnet(sparsify_config, sparsify_components, &am_nnet.GetNnet());
+    if (quantize)
+      QuantizeNnet(quantize_components, &am_nnet.GetNnet());
 
+    SetAlignMatrixData(align_for_mmap);
     if (raw) {
       WriteKaldiObject(am_nnet.GetNnet(), nnet_wxfilename, binary_write);
       KALDI_LOG << "Copied neural net from " << nnet_rxfilename
@@ -35,7 +35,10 @@ int main(int argc, char *argv[]) {
 
     const char *usage =
         "Propagate the features through raw neural network model "
-        "and write the output.  This version is optimized for GPU use. "
+        "and write the output.  This version is optimized for GPU use, "
+        "but with --num-threads > 1 it is also faster than nnet3-compute on "
+        "CPU (see also --length-bucket-size).  The output is written in the "
+        "same order as the input.  "
         "If --apply-exp=true, apply the Exp() function to the output "
         "before writing it out.\n"
         "\n"
@@ -51,7 +54,9 @@ int main(int argc, char *argv[]) {
     opts.acoustic_scale = 1.0;  // by default do no scaling
 
     bool apply_exp = false, use_priors = false;
+    bool mmap_model = false;
     std::string use_gpu = "yes";
+    int32 num_threads = 1;
 
     std::string word_syms_filename;
     std::string ivector_rspecifier,
@@ -79,6 +84,15 @@ int main(int argc, char *argv[]) {
     po.Register("use-priors", &use_priors, "If true, subtract the logs of the "
                 "priors stored with the model (in this case, "
                 "a .mdl file is expected as input).");
+    po.Register("mmap-model", &mmap_model, "If true, map the model file "
+                "into memory, so that processes using the same model share "
+                "the memory of its parameters.  This only has an effect for "
+                "models written with --align-for-mmap=true by nnet3-am-copy "
+                "or nnet3-copy.");
+    po.Register("num-threads", &num_threads, "Number of threads that do the "
+                "neural net computation, each on its own minibatch.  Use "
+                "this when not using a GPU, together with a single-threaded "
+                "BLAS library.");
 
 #if HAVE_CUDA==1
     CuDevice::RegisterDeviceOptions(&po);
@@ -102,14 +116,19 @@ int main(int argc, char *argv[]) {
 
     Nnet raw_nnet;
     AmNnetSimple am_nnet;
-    if (use_priors) {
+    {
       bool binary;
-      TransitionModel trans_model;
-      Input ki(nnet_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
-    } else {
-      ReadKaldiObject(nnet_rxfilename, &raw_nnet);
+      Input ki;
+      if (!(mmap_model ? ki.OpenMapped(nnet_rxfilename, &binary, true) :
+            ki.Open(nnet_rxfilename, &binary)))
+        KALDI_ERR << "Error opening model " << nnet_rxfilename;
+      if (use_priors) {
+        TransitionModel trans_model;
+        trans_model.Read(ki.Stream(), binary);
+        am_nnet.Read(ki.Stream(), binary);
+      } else {
+        raw_nnet.Read(ki.Stream(), binary);
+      }
     }
     Nnet &nnet = (use_priors ? am_nnet.GetNnet() : raw_nnet);
     SetBatchnormTestMode(true, &nnet);
@@ -132,7 +151,7 @@ int main(int argc, char *argv[]) {
     Matrix<BaseFloat> output_matrix;
 
 
-    NnetBatchInference inference(opts, nnet, priors);
+    NnetBatchInference inference(opts, nnet, priors, num_threads);
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
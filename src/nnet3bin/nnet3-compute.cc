@@ -24,6 +24,9 @@
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "base/timer.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-compute-profile.h"
+#include "matrix/cpu-allocator.h"
+#include "matrix/small-gemm.h"
 
 
 int main(int argc, char *argv[]) {
@@ -51,7 +54,9 @@ int main(int argc, char *argv[]) {
     opts.acoustic_scale = 1.0; // by default do no scaling.
 
     bool apply_exp = false, use_priors = false;
+    bool mmap_model = false;
     std::string use_gpu = "yes";
+    std::string computation_cache_filename;
 
     std::string ivector_rspecifier,
                 online_ivector_rspecifier,
@@ -77,10 +82,22 @@ int main(int argc, char *argv[]) {
     po.Register("use-priors", &use_priors, "If true, subtract the logs of the "
                 "priors stored with the model (in this case, "
                 "a .mdl file is expected as input).");
+    po.Register("mmap-model", &mmap_model, "If true, map the model file "
+                "into memory, so that processes using the same model share "
+                "the memory of its parameters.  This only has an effect for "
+                "models written with --align-for-mmap=true by nnet3-am-copy "
+                "or nnet3-copy.");
+    po.Register("computation-cache", &computation_cache_filename,
+                "Filename of a cache of compiled nnet3 computations, which "
+                "is read at the start and updated at the end if anything new "
+                "was compiled.  It may be shared by many jobs that use the "
+                "same model and options; concurrent updates are safe.");
 
 #if HAVE_CUDA==1
     CuDevice::RegisterDeviceOptions(&po);
 #endif
+    RegisterCpuAllocatorOptions(&po);
+    RegisterSmallGemmOptions(&po);
 
     po.Read(argc, argv);
 
@@ -99,14 +116,19 @@ int main(int argc, char *argv[]) {
 
     Nnet raw_nnet;
     AmNnetSimple am_nnet;
-    if (use_priors) {
+    {
       bool binary;
-      TransitionModel trans_model;
-      Input ki(nnet_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
-    } else {
-      ReadKaldiObject(nnet_rxfilename, &raw_nnet);
+      Input ki;
+      if (!(mmap_model ? ki.OpenMapped(nnet_rxfilename, &binary, true) :
+            ki.Open(nnet_rxfilename, &binary)))
+        KALDI_ERR << "Error opening model " << nnet_rxfilename;
+      if (use_priors) {
+        TransitionModel trans_model;
+        trans_model.Read(ki.Stream(), binary);
+        am_nnet.Read(ki.Stream(), binary);
+      } else {
+        raw_nnet.Read(ki.Stream(), binary);
+      }
     }
     Nnet &nnet = (use_priors ? am_nnet.GetNnet() : raw_nnet);
     SetBatchnormTestMode(true, &nnet);
@@ -123,17 +145,20 @@ int main(int argc, char *argv[]) {
         ivector_rspecifier, utt2spk_rspecifier);
 
     CachingOptimizingCompiler compiler(nnet, opts.optimize_config);
+    if (!computation_cache_filename.empty())
+      compiler.ReadCacheFile(computation_cache_filename);
 
     BaseFloatMatrixWriter matrix_writer(matrix_wspecifier);
 
     int32 num_success = 0, num_fail = 0;
     int64 frame_count = 0;
 
-    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    // With e.g. "ark,mmap:feats.ark" the features are used in place.
+    SequentialBaseFloatMatrixViewReader feature_reader(feature_rspecifier);
 
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string utt = feature_reader.Key();
-      const Matrix<BaseFloat> &features (feature_reader.Value());
+      const MatrixBase<BaseFloat> &features (feature_reader.Value());
       if (features.NumRows() == 0) {
         KALDI_WARN << "Zero-length utterance: " << utt;
         num_fail++;
@@ -182,9 +207,15 @@ int main(int argc, char *argv[]) {
       num_success++;
     }
 
+    if (!computation_cache_filename.empty())
+      compiler.WriteCacheFile(computation_cache_filename);
+
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    PrintNnetComputeProfile();
+    if (g_cpu_allocator_options.cache_memory)
+      KALDI_LOG << GetCpuAllocatorStats().Info();
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
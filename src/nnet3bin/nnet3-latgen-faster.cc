@@ -27,6 +27,9 @@
 #include "decoder/decoder-wrappers.h"
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-compute-profile.h"
+#include "matrix/cpu-allocator.h"
+#include "matrix/small-gemm.h"
 #include "base/timer.h"
 
 
@@ -46,14 +49,18 @@ int main(int argc, char *argv[]) {
         "Generate lattices using nnet3 neural net model.\n"
         "Usage: nnet3-latgen-faster [options] <nnet-in> <fst-in|fsts-rspecifier> <features-rspecifier>"
         " <lattice-wspecifier> [ <words-wspecifier> [<alignments-wspecifier>] ]\n"
+        "<fst-in> may also be a graph in the format written by make-flat-fst.\n"
+        "With the \"mmap\" option in <features-rspecifier>, e.g. \"ark,mmap:feats.ark\",\n"
+        "the features are read in place from the memory-mapped archive.\n"
         "See also: nnet3-latgen-faster-parallel, nnet3-latgen-faster-batch\n";
     ParseOptions po(usage);
     Timer timer;
     bool allow_partial = false;
+    bool mmap_model = false;
     LatticeFasterDecoderConfig config;
     NnetSimpleComputationOptions decodable_opts;
 
-    std::string word_syms_filename;
+    std::string word_syms_filename, computation_cache_filename;
     std::string ivector_rspecifier,
         online_ivector_rspecifier,
         utt2spk_rspecifier;
@@ -75,6 +82,17 @@ int main(int argc, char *argv[]) {
     po.Register("online-ivector-period", &online_ivector_period, "Number of frames "
                 "between iVectors in matrices supplied to the --online-ivectors "
                 "option");
+    po.Register("computation-cache", &computation_cache_filename,
+                "Filename of a cache of compiled nnet3 computations, which "
+                "is read at the start and updated at the end if anything new "
+                "was compiled.  It may be shared by many jobs that use the "
+                "same model and options; concurrent updates are safe.");
+    po.Register("mmap-model", &mmap_model, "If true, map the model file "
+                "into memory, so that processes using the same model share "
+                "the memory of its parameters.  This only has an effect for "
+                "models written with --align-for-mmap=true by nnet3-am-copy.");
+    RegisterCpuAllocatorOptions(&po);
+    RegisterSmallGemmOptions(&po);
 
     po.Read(argc, argv);
 
@@ -82,7 +100,6 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
-
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -94,7 +111,10 @@ int main(int argc, char *argv[]) {
     AmNnetSimple am_nnet;
     {
       bool binary;
-      Input ki(model_in_filename, &binary);
+      Input ki;
+      if (!(mmap_model ? ki.OpenMapped(model_in_filename, &binary, true) :
+            ki.Open(model_in_filename, &binary)))
+        KALDI_ERR << "Error opening model " << model_in_filename;
       trans_model.Read(ki.Stream(), binary);
       am_nnet.Read(ki.Stream(), binary);
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
@@ -127,24 +147,46 @@ int main(int argc, char *argv[]) {
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
     int num_success = 0, num_fail = 0;
+    // with --lazy-output, the compiler is for the network without its final
+    // affine layer, which is computed only for the pdf-ids the decoder needs.
+    NnetLazyOutputInfo *lazy_output_info = NULL;
+    if (decodable_opts.lazy_output)
+      lazy_output_info = new NnetLazyOutputInfo(am_nnet.GetNnet());
     // this compiler object allows caching of computations across
     // different utterances.
-    CachingOptimizingCompiler compiler(am_nnet.GetNnet(),
+    CachingOptimizingCompiler compiler(lazy_output_info != NULL ?
+                                       lazy_output_info->Trunk() :
+                                       am_nnet.GetNnet(),
                                        decodable_opts.optimize_config);
+    if (!computation_cache_filename.empty())
+      compiler.ReadCacheFile(computation_cache_filename);
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
-      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      SequentialBaseFloatMatrixViewReader feature_reader(feature_rspecifier);
 
-      // Input FST is just one FST, not a table of FSTs.
-      Fst<StdArc> *decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      // Input FST is just one FST, not a table of FSTs.  It may be in the
+      // FlatFst format (see make-flat-fst), which is mapped into memory.
+      Fst<StdArc> *decode_fst = NULL;
+      fst::FlatFst *flat_fst = NULL;
+      if (fst::FlatFst::IsFlatFst(fst_in_str)) {
+        flat_fst = new fst::FlatFst();
+        flat_fst->Read(fst_in_str);
+      } else {
+        decode_fst = fst::ReadFstKaldiGeneric(fst_in_str);
+      }
       timer.Reset();
 
       {
-        LatticeFasterDecoder decoder(*decode_fst, config);
+        // Exactly one of these will be non-NULL.
+        LatticeFasterDecoder *decoder = (decode_fst == NULL ? NULL :
+            new LatticeFasterDecoder(*decode_fst, config));
+        LatticeFasterDecoderTpl<fst::FlatFst> *flat_decoder =
+            (flat_fst == NULL ? NULL :
+             new LatticeFasterDecoderTpl<fst::FlatFst>(*flat_fst, config));
 
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
-          const Matrix<BaseFloat> &features (feature_reader.Value());
+          const MatrixBase<BaseFloat> &features (feature_reader.Value());
           if (features.NumRows() == 0) {
             KALDI_WARN << "Zero-length utterance: " << utt;
             num_fail++;
@@ -174,25 +216,35 @@ int main(int argc, char *argv[]) {
           DecodableAmNnetSimple nnet_decodable(
               decodable_opts, trans_model, am_nnet,
               features, ivector, online_ivectors,
-              online_ivector_period, &compiler);
+              online_ivector_period, &compiler, lazy_output_info);
 
           double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, nnet_decodable, trans_model, word_syms, utt,
+          bool ans = (decoder != NULL ?
+              DecodeUtteranceLatticeFaster(
+                  *decoder, nnet_decodable, trans_model, word_syms, utt,
                   decodable_opts.acoustic_scale, determinize, allow_partial,
                   &alignment_writer, &words_writer, &compact_lattice_writer,
-                  &lattice_writer,
-                  &like)) {
+                  &lattice_writer, &like) :
+              DecodeUtteranceLatticeFaster(
+                  *flat_decoder, nnet_decodable, trans_model, word_syms, utt,
+                  decodable_opts.acoustic_scale, determinize, allow_partial,
+                  &alignment_writer, &words_writer, &compact_lattice_writer,
+                  &lattice_writer, &like));
+          if (ans) {
             tot_like += like;
             frame_count += nnet_decodable.NumFramesReady();
             num_success++;
           } else num_fail++;
         }
+        delete decoder;
+        delete flat_decoder;
       }
-      delete decode_fst; // delete this only after decoder goes out of scope.
+      // delete these only after the decoders are deleted.
+      delete decode_fst;
+      delete flat_fst;
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
-      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      RandomAccessBaseFloatMatrixViewReader feature_reader(feature_rspecifier);
       for (; !fst_reader.Done(); fst_reader.Next()) {
         std::string utt = fst_reader.Key();
         if (!feature_reader.HasKey(utt)) {
@@ -201,7 +253,7 @@ int main(int argc, char *argv[]) {
           num_fail++;
           continue;
         }
-        const Matrix<BaseFloat> &features = feature_reader.Value(utt);
+        const MatrixBase<BaseFloat> &features = feature_reader.Value(utt);
         if (features.NumRows() == 0) {
           KALDI_WARN << "Zero-length utterance: " << utt;
           num_fail++;
@@ -234,7 +286,7 @@ int main(int argc, char *argv[]) {
         DecodableAmNnetSimple nnet_decodable(
             decodable_opts, trans_model, am_nnet,
             features, ivector, online_ivectors,
-            online_ivector_period, &compiler);
+            online_ivector_period, &compiler, lazy_output_info);
 
         double like;
         if (DecodeUtteranceLatticeFaster(
@@ -249,9 +301,15 @@ int main(int argc, char *argv[]) {
       }
     }
 
+    if (!computation_cache_filename.empty())
+      compiler.WriteCacheFile(computation_cache_filename);
+
     kaldi::int64 input_frame_count =
         frame_count * decodable_opts.frame_subsampling_factor;
 
+    PrintNnetComputeProfile();
+    if (g_cpu_allocator_options.cache_memory)
+      KALDI_LOG << GetCpuAllocatorStats().Info();
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
@@ -263,6 +321,7 @@ int main(int argc, char *argv[]) {
               << frame_count << " frames.";
 
     delete word_syms;
+    delete lazy_output_info;
     if (num_success != 0) return 0;
     else return 1;
   } catch(const std::exception &e) {
@@ -0,0 +1,152 @@
+// nnet3bin/nnet3-memory-info.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-optimize.h"
+#include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-analyze.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Print information about the memory used by the computation for one\n"
+        "chunk of decoding with a 'raw' nnet3 neural network (as in\n"
+        "nnet3-compute or nnet3-latgen-faster): the peak number of bytes in\n"
+        "matrices at any one time, the total number of bytes allocated, and the\n"
+        "size of the block of memory that the matrices are allocated in if the\n"
+        "memory plan is used (see --use-memory-plan in nnet3-compute).\n"
+        "\n"
+        "Usage:  nnet3-memory-info [options] <raw-nnet>\n"
+        "e.g.:\n"
+        " nnet3-memory-info --frames-per-chunk=150 final.raw\n"
+        "See also: nnet3-info\n";
+
+    ParseOptions po(usage);
+
+    int32 frames_per_chunk = 150,
+        extra_left_context = 0,
+        extra_right_context = 0,
+        frame_subsampling_factor = 1;
+    NnetOptimizeOptions optimize_opts;
+
+    po.Register("frames-per-chunk", &frames_per_chunk, "Number of output "
+                "frames in the chunk (before frame subsampling).");
+    po.Register("extra-left-context", &extra_left_context, "Number of frames "
+                "of additional left-context to add on top of the neural net's "
+                "inherent left context");
+    po.Register("extra-right-context", &extra_right_context, "Number of frames "
+                "of additional right-context to add on top of the neural net's "
+                "inherent right context");
+    po.Register("frame-subsampling-factor", &frame_subsampling_factor,
+                "Required if the frame-rate of the output (e.g. in 'chain' "
+                "models) is less than the frame-rate of the original alignment.");
+    optimize_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 1 || frames_per_chunk <= 0 ||
+        frame_subsampling_factor <= 0) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string raw_nnet_rxfilename = po.GetArg(1);
+
+    Nnet nnet;
+    ReadKaldiObject(raw_nnet_rxfilename, &nnet);
+    SetBatchnormTestMode(true, &nnet);
+    SetDropoutTestMode(true, &nnet);
+    CollapseModel(CollapseModelConfig(), &nnet);
+
+    int32 left_context, right_context;
+    ComputeSimpleNnetContext(nnet, &left_context, &right_context);
+    left_context += extra_left_context;
+    right_context += extra_right_context;
+
+    // Set up the request in the same way as DecodableNnetSimple.
+    int32 num_subsampled_frames =
+        (frames_per_chunk + frame_subsampling_factor - 1) /
+        frame_subsampling_factor,
+        last_output_t = (num_subsampled_frames - 1) * frame_subsampling_factor;
+    ComputationRequest request;
+    request.inputs.push_back(
+        IoSpecification("input", -left_context,
+                        last_output_t + right_context + 1));
+    if (nnet.InputDim("ivector") > 0) {
+      std::vector<Index> indexes;
+      indexes.push_back(Index(0, 0, 0));
+      request.inputs.push_back(IoSpecification("ivector", indexes));
+    }
+    IoSpecification output_spec;
+    output_spec.name = "output";
+    output_spec.indexes.resize(num_subsampled_frames);
+    for (int32 i = 0; i < num_subsampled_frames; i++)
+      output_spec.indexes[i].t = i * frame_subsampling_factor;
+    request.outputs.push_back(output_spec);
+
+    CachingOptimizingCompiler compiler(nnet, optimize_opts);
+    std::shared_ptr<const NnetComputation> computation =
+        compiler.Compile(request);
+    const NnetComputation::MemoryPlan &plan = computation->GetMemoryPlan();
+
+    int64 num_allocations = 0, num_planned = 0,
+        allocated_bytes = 0, planned_bytes = 0;
+    for (size_t c = 0; c < computation->commands.size(); c++) {
+      const NnetComputation::Command &command = computation->commands[c];
+      if (command.command_type != kAllocMatrix)
+        continue;
+      const NnetComputation::SubMatrixInfo &info =
+          computation->submatrices[command.arg1];
+      int64 num_bytes = static_cast<int64>(sizeof(BaseFloat)) *
+          info.num_rows * info.num_cols;
+      num_allocations++;
+      allocated_bytes += num_bytes;
+      if (!plan.offsets.empty() && plan.offsets[c] >= 0) {
+        num_planned++;
+        planned_bytes += num_bytes;
+      }
+    }
+
+    std::cout << "left-context: " << left_context << "\n"
+              << "right-context: " << right_context << "\n"
+              << "num-input-frames: "
+              << (last_output_t + left_context + right_context + 1) << "\n"
+              << "num-output-frames: " << num_subsampled_frames << "\n"
+              << "num-commands: " << computation->commands.size() << "\n"
+              << "num-matrices: " << (computation->matrices.size() - 1) << "\n"
+              << "num-allocations: " << num_allocations << "\n"
+              << "total-allocated-bytes: " << allocated_bytes << "\n"
+              << "peak-bytes: " << GetMaxMemoryUse(*computation) << "\n"
+              << "num-planned-allocations: " << num_planned << "\n"
+              << "planned-bytes: " << planned_bytes << "\n"
+              << "memory-plan-arena-bytes: "
+              << (static_cast<int64>(sizeof(BaseFloat)) * plan.size) << "\n";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -31,12 +31,14 @@ SingleUtteranceNnet3DecoderTpl<FST>::SingleUtteranceNnet3DecoderTpl(
     const TransitionModel &trans_model,
     const nnet3::DecodableNnetSimpleLoopedInfo &info,
     const FST &fst,
-    OnlineNnet2FeaturePipeline *features):
+    OnlineNnet2FeaturePipeline *features,
+    nnet3::NnetBatchLoopedComputer *batch_computer):
     decoder_opts_(decoder_opts),
     input_feature_frame_shift_in_seconds_(features->FrameShiftInSeconds()),
     trans_model_(trans_model),
     decodable_(trans_model_, info,
-               features->InputFeature(), features->IvectorFeature()),
+               features->InputFeature(), features->IvectorFeature(),
+               batch_computer),
     decoder_(fst, decoder_opts_) {
   decoder_.InitDecoding();
 }
@@ -53,12 +53,16 @@ class SingleUtteranceNnet3DecoderTpl {
  public:
 
   // Constructor. The pointer 'features' is not being given to this class to own
-  // and deallocate, it is owned externally.
-  SingleUtteranceNnet3DecoderTpl(const LatticeFasterDecoderConfig &decoder_opts,
-                                 const TransitionModel &trans_model,
-                                 const nnet3::DecodableNnetSimpleLoopedInfo &info,
-                                 const FST &fst,
-                                 OnlineNnet2FeaturePipeline *features);
+  // and deallocate, it is owned externally.  If 'batch_computer' is non-NULL,
+  // the neural net is computed by it, in batches with other decoders (see
+  // nnet3::NnetBatchLoopedComputer).
+  SingleUtteranceNnet3DecoderTpl(
+      const LatticeFasterDecoderConfig &decoder_opts,
+      const TransitionModel &trans_model,
+      const nnet3::DecodableNnetSimpleLoopedInfo &info,
+      const FST &fst,
+      OnlineNnet2FeaturePipeline *features,
+      nnet3::NnetBatchLoopedComputer *batch_computer = NULL);
 
   /// Initializes the decoding and sets the frame offset of the underlying
   /// decodable object. This method is called by the constructor. You can also
@@ -29,42 +29,212 @@
 #include "lat/lattice-functions.h"
 #include "util/kaldi-thread.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-batch-compute.h"
 
 #include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace kaldi {
 
-class TcpServer {
+// The models and options used by all the connections.  Nothing in here is
+// modified once the server is running, so the decoding threads share it
+// without locking.
+struct SharedDecodingInfo {
+  const OnlineNnet2FeaturePipelineInfo *feature_info;
+  const TransitionModel *trans_model;
+  const nnet3::DecodableNnetSimpleLoopedInfo *decodable_info;
+  const fst::Fst<fst::StdArc> *decode_fst;
+  const fst::SymbolTable *word_syms;
+  // NULL unless --batch-nnet=true.
+  nnet3::NnetBatchLoopedComputer *batch_computer;
+  LatticeFasterDecoderConfig decoder_opts;
+  OnlineEndpointConfig endpoint_opts;
+  BaseFloat samp_freq;
+  BaseFloat frame_shift;  // of the features, in seconds.
+  int32 frame_subsampling;
+  int32 check_period;  // how often to send partial results, in samples.
+  bool produce_time;
+};
+
+// Decodes the audio of one client and writes the transcripts to its socket.
+// The audio is given to it in chunks by whichever decoding thread is handling
+// the client.
+class TcpClientDecoder {
  public:
-  explicit TcpServer(int read_timeout);
-  ~TcpServer();
+  TcpClientDecoder(int32 client_desc, const SharedDecodingInfo &info);
 
-  bool Listen(int32 port);  // start listening on a given port
-  int32 Accept();  // accept a client and return its descriptor
+  // Decodes a chunk of audio; writes a partial transcript every
+  // info.check_period samples and a final one at each endpoint.
+  void AcceptChunk(const VectorBase<BaseFloat> &wave_part);
 
-  bool ReadChunk(size_t len); // get more data and return false if end-of-stream
+  // Called at the end of the stream; writes the final transcript.
+  void InputFinished();
 
-  Vector<BaseFloat> GetChunk(); // get the data read by above method
+ private:
+  // Starts decoding a new segment (at the start or after an endpoint).
+  void StartSegment();
+  void UpdateSilenceWeights();
+  // Writes the final transcript of the current segment.
+  void WriteFinalTranscript(const char *reason);
+
+  bool Write(const std::string &msg);
+  bool WriteLn(const std::string &msg, const std::string &eol = "\n");
+
+  int32 client_desc_;
+  const SharedDecodingInfo &info_;
+  OnlineNnet2FeaturePipeline feature_pipeline_;
+  SingleUtteranceNnet3Decoder decoder_;
+  // NULL between segments.
+  std::unique_ptr<OnlineSilenceWeighting> silence_weighting_;
+  std::vector<std::pair<int32, BaseFloat> > delta_weights_;
+  int32 frame_offset_;
+  int32 samp_count_;  // this is used for output refresh rate
+  int32 check_count_;
+  bool write_failed_;
+};
 
-  bool Write(const std::string &msg); // write to accepted client
-  bool WriteLn(const std::string &msg, const std::string &eol = "\n"); // write line to accepted client
+struct TcpServerOptions {
+  int32 num_threads;
+  int32 max_clients;
+  BaseFloat max_buffered_secs;
+  BaseFloat chunk_length_secs;
+  int32 read_timeout;
+  TcpServerOptions(): num_threads(1), max_clients(1), max_buffered_secs(10.0),
+                      chunk_length_secs(0.18), read_timeout(3) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("num-threads", &num_threads, "Number of threads that "
+                   "decode the audio of the clients.");
+    opts->Register("max-clients", &max_clients, "Maximum number of clients "
+                   "that are served at the same time; more connections wait "
+                   "until one of them finishes.");
+    opts->Register("max-buffered-secs", &max_buffered_secs, "Maximum amount "
+                   "of audio, in seconds, that is buffered for a client before "
+                   "it is decoded; beyond that, the server stops reading from "
+                   "the client until the decoding catches up.");
+    opts->Register("chunk-length", &chunk_length_secs,
+                   "Length of chunk size in seconds, that we process.");
+    opts->Register("read-timeout", &read_timeout, "Number of seconds of "
+                   "timout for TCP audio data to appear on the stream. Use -1 "
+                   "for blocking.");
+  }
+};
 
-  void Disconnect();
+/*
+   TcpServer serves up to --max-clients clients at the same time.  The main
+   thread (Run()) waits with epoll for new connections and for audio from the
+   clients, and appends the audio to a per-client buffer; the clients with
+   enough audio buffered are queued for the decoding threads, which decode it
+   with the client's TcpClientDecoder and write the transcripts to the client.
+   A client is only handled by one decoding thread at a time, so its audio is
+   decoded in order.  If a client sends audio faster than it can be decoded,
+   the server stops reading from it (and TCP flow control slows the client
+   down) while more than --max-buffered-secs of its audio is buffered.
+
+   When a client has finished, the server prints the real-time factor of its
+   decoding and the latency, i.e. the time from when the oldest audio in each
+   batch that a decoding thread takes is received until the batch has been
+   decoded, which includes the time spent waiting for a decoding thread.
+ */
+class TcpServer {
+ public:
+  TcpServer(const TcpServerOptions &opts, const SharedDecodingInfo &info);
+  ~TcpServer();
+
+  bool Listen(int32 port);  // start listening on a given port
+
+  void Run();  // serves clients; does not return.
 
  private:
-  struct ::sockaddr_in h_addr_;
-  int32 server_desc_, client_desc_;
-  int16 *samp_buf_;
-  size_t buf_len_, has_read_;
-  pollfd client_set_[1];
-  int read_timeout_;
+  struct Client {
+    Client(int32 desc, const std::string &peer, double now,
+           const SharedDecodingInfo &info);
+
+    int32 desc;
+    std::string peer;
+
+    // Only used by the main thread.
+    double last_read_time;
+    bool has_odd_byte;  // true if the last read ended in the middle of a sample
+    char odd_byte;
+
+    // Guarded by 'mutex'.
+    std::mutex mutex;
+    std::vector<int16> pending;  // audio not yet decoded.
+    int64 num_samples_read;  // total samples read, including 'pending'.
+    // For each read whose audio is still (partly) pending, the value of
+    // num_samples_read after it and the time it happened; used to work out
+    // when the oldest pending audio arrived.
+    std::deque<std::pair<int64, double> > arrivals;
+    bool input_finished;
+    bool scheduled;  // true if queued or being decoded by a decoding thread.
+    bool reading_paused;  // true if not reading because too much is pending.
+
+    // Only used by the decoding thread that is handling the client.
+    TcpClientDecoder decoder;
+    int64 num_samples_decoded;
+    double decode_time;
+    double latency_sum;
+    double latency_max;
+    int64 num_batches;
+  };
+
+  void AcceptClients();
+  // Reads what is available from the client, and queues it for decoding.
+  void ReadClient(Client *client);
+  // Ends the input of clients from which nothing has been read for
+  // --read-timeout seconds.
+  void CheckTimeouts();
+  // Closes the connections that the decoding threads have finished with.
+  void CloseFinished();
+  // Only listens for new connections while there are fewer than
+  // --max-clients.
+  void UpdateListening();
+
+  // Queues the client for decoding if there is something to decode and it is
+  // not already queued.  Requires client->mutex to be held.
+  void Schedule(Client *client);
+  // Changes the events the main thread waits for on the client's socket.
+  void SetEvents(int32 desc, uint32 events);
+
+  void DecodingThread();
+  // Decodes the pending audio of the client until there is no more.
+  void Decode(Client *client);
+
+  TcpServerOptions opts_;
+  const SharedDecodingInfo &info_;
+  size_t chunk_len_;  // in samples.
+  size_t max_pending_;  // in samples.
+  Timer timer_;
+
+  int32 server_desc_;
+  int32 epoll_desc_;
+  int32 event_desc_;  // eventfd that wakes up the main thread.
+  bool listening_;
+  std::map<int32, std::unique_ptr<Client> > clients_;  // main thread only.
+
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::deque<Client*> queue_;  // clients with audio to decode.
+  std::vector<int32> finished_;  // clients to close.
+  bool exit_;
+  std::vector<std::thread> threads_;
 };
 
 std::string LatticeToString(const Lattice &lat, const fst::SymbolTable &word_syms) {
@@ -124,7 +294,9 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Reads in audio from a network socket and performs online\n"
         "decoding with neural nets (nnet3 setup), with iVector-based\n"
-        "speaker adaptation and endpointing.\n"
+        "speaker adaptation and endpointing.  Several clients can be\n"
+        "served at the same time (see --max-clients and --num-threads);\n"
+        "they share the models.\n"
         "Note: some configuration values and inputs are set via config\n"
         "files whose filenames are passed as options\n"
         "\n"
@@ -138,35 +310,37 @@ int main(int argc, char *argv[]) {
     // as well as the basic features.
     OnlineNnet2FeaturePipelineConfig feature_opts;
     nnet3::NnetSimpleLoopedComputationOptions decodable_opts;
-    LatticeFasterDecoderConfig decoder_opts;
-    OnlineEndpointConfig endpoint_opts;
+    TcpServerOptions server_opts;
+    nnet3::NnetBatchLoopedComputerOptions batch_opts;
+    SharedDecodingInfo info;
 
-    BaseFloat chunk_length_secs = 0.18;
     BaseFloat output_period = 1;
     BaseFloat samp_freq = 16000.0;
     int port_num = 5050;
-    int read_timeout = 3;
     bool produce_time = false;
+    bool batch_nnet = false;
 
     po.Register("samp-freq", &samp_freq,
                 "Sampling frequency of the input signal (coded as 16-bit slinear).");
-    po.Register("chunk-length", &chunk_length_secs,
-                "Length of chunk size in seconds, that we process.");
     po.Register("output-period", &output_period,
                 "How often in seconds, do we check for changes in output.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
-    po.Register("read-timeout", &read_timeout,
-                "Number of seconds of timout for TCP audio data to appear on the stream. Use -1 for blocking.");
     po.Register("port-num", &port_num,
                 "Port number the server will listen on.");
     po.Register("produce-time", &produce_time,
                 "Prepend begin/end times between endpoints (e.g. '5.46 6.81 <text_output>', in seconds)");
+    po.Register("batch-nnet", &batch_nnet,
+                "If true, compute the neural net for the chunks of different "
+                "clients together (see --nnet-batch-size).  Only for models "
+                "without recurrence; only useful with --num-threads > 1.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
-    decoder_opts.Register(&po);
-    endpoint_opts.Register(&po);
+    info.decoder_opts.Register(&po);
+    info.endpoint_opts.Register(&po);
+    server_opts.Register(&po);
+    batch_opts.Register(&po);
 
     po.Read(argc, argv);
 
@@ -181,9 +355,6 @@ int main(int argc, char *argv[]) {
 
     OnlineNnet2FeaturePipelineInfo feature_info(feature_opts);
 
-    BaseFloat frame_shift = feature_info.FrameShiftInSeconds();
-    int32 frame_subsampling = decodable_opts.frame_subsampling_factor;
-
     KALDI_VLOG(1) << "Loading AM...";
 
     TransitionModel trans_model;
@@ -214,133 +385,30 @@ int main(int argc, char *argv[]) {
         KALDI_ERR << "Could not read symbol table from file "
                   << word_syms_filename;
 
+    info.feature_info = &feature_info;
+    info.trans_model = &trans_model;
+    info.decodable_info = &decodable_info;
+    info.decode_fst = decode_fst;
+    info.word_syms = word_syms;
+    std::unique_ptr<nnet3::NnetBatchLoopedComputer> batch_computer;
+    if (batch_nnet)
+      batch_computer.reset(new nnet3::NnetBatchLoopedComputer(batch_opts,
+                                                              decodable_info));
+    info.batch_computer = batch_computer.get();
+    info.samp_freq = samp_freq;
+    info.frame_shift = feature_info.FrameShiftInSeconds();
+    info.frame_subsampling = decodable_opts.frame_subsampling_factor;
+    info.check_period = static_cast<int32>(samp_freq * output_period);
+    info.produce_time = produce_time;
+
     signal(SIGPIPE, SIG_IGN); // ignore SIGPIPE to avoid crashing when socket forcefully disconnected
 
-    TcpServer server(read_timeout);
-
-    server.Listen(port_num);
-
-    while (true) {
-
-      server.Accept();
-
-      int32 samp_count = 0;// this is used for output refresh rate
-      size_t chunk_len = static_cast<size_t>(chunk_length_secs * samp_freq);
-      int32 check_period = static_cast<int32>(samp_freq * output_period);
-      int32 check_count = check_period;
-
-      int32 frame_offset = 0;
-
-      bool eos = false;
-
-      OnlineNnet2FeaturePipeline feature_pipeline(feature_info);
-      SingleUtteranceNnet3Decoder decoder(decoder_opts, trans_model,
-                                          decodable_info,
-                                          *decode_fst, &feature_pipeline);
-
-      while (!eos) {
-
-        decoder.InitDecoding(frame_offset);
-        OnlineSilenceWeighting silence_weighting(
-            trans_model,
-            feature_info.silence_weighting_config,
-            decodable_opts.frame_subsampling_factor);
-        std::vector<std::pair<int32, BaseFloat>> delta_weights;
-
-        while (true) {
-          eos = !server.ReadChunk(chunk_len);
-
-          if (eos) {
-            feature_pipeline.InputFinished();
-
-            if (silence_weighting.Active() &&
-                feature_pipeline.IvectorFeature() != NULL) {
-              silence_weighting.ComputeCurrentTraceback(decoder.Decoder());
-              silence_weighting.GetDeltaWeights(feature_pipeline.NumFramesReady(),
-                                                frame_offset * decodable_opts.frame_subsampling_factor,
-                                                &delta_weights);
-              feature_pipeline.UpdateFrameWeights(delta_weights);
-            }
-
-            decoder.AdvanceDecoding();
-            decoder.FinalizeDecoding();
-            frame_offset += decoder.NumFramesDecoded();
-            if (decoder.NumFramesDecoded() > 0) {
-              CompactLattice lat;
-              decoder.GetLattice(true, &lat);
-              std::string msg = LatticeToString(lat, *word_syms);
-
-              // get time-span from previous endpoint to end of audio,
-              if (produce_time) {
-                int32 t_beg = frame_offset - decoder.NumFramesDecoded();
-                int32 t_end = frame_offset;
-                msg = GetTimeString(t_beg, t_end, frame_shift * frame_subsampling) + " " + msg;
-              }
-
-              KALDI_VLOG(1) << "EndOfAudio, sending message: " << msg;
-              server.WriteLn(msg);
-            } else
-              server.Write("\n");
-            server.Disconnect();
-            break;
-          }
-
-          Vector<BaseFloat> wave_part = server.GetChunk();
-          feature_pipeline.AcceptWaveform(samp_freq, wave_part);
-          samp_count += chunk_len;
-
-          if (silence_weighting.Active() &&
-              feature_pipeline.IvectorFeature() != NULL) {
-            silence_weighting.ComputeCurrentTraceback(decoder.Decoder());
-            silence_weighting.GetDeltaWeights(feature_pipeline.NumFramesReady(),
-                                              frame_offset * decodable_opts.frame_subsampling_factor,
-                                              &delta_weights);
-            feature_pipeline.UpdateFrameWeights(delta_weights);
-          }
-
-          decoder.AdvanceDecoding();
-
-          if (samp_count > check_count) {
-            if (decoder.NumFramesDecoded() > 0) {
-              Lattice lat;
-              decoder.GetBestPath(false, &lat);
-              TopSort(&lat); // for LatticeStateTimes(),
-              std::string msg = LatticeToString(lat, *word_syms);
-
-              // get time-span after previous endpoint,
-              if (produce_time) {
-                int32 t_beg = frame_offset;
-                int32 t_end = frame_offset + GetLatticeTimeSpan(lat);
-                msg = GetTimeString(t_beg, t_end, frame_shift * frame_subsampling) + " " + msg;
-              }
-
-              KALDI_VLOG(1) << "Temporary transcript: " << msg;
-              server.WriteLn(msg, "\r");
-            }
-            check_count += check_period;
-          }
-
-          if (decoder.EndpointDetected(endpoint_opts)) {
-            decoder.FinalizeDecoding();
-            frame_offset += decoder.NumFramesDecoded();
-            CompactLattice lat;
-            decoder.GetLattice(true, &lat);
-            std::string msg = LatticeToString(lat, *word_syms);
-
-            // get time-span between endpoints,
-            if (produce_time) {
-              int32 t_beg = frame_offset - decoder.NumFramesDecoded();
-              int32 t_end = frame_offset;
-              msg = GetTimeString(t_beg, t_end, frame_shift * frame_subsampling) + " " + msg;
-            }
-
-            KALDI_VLOG(1) << "Endpoint, sending message: " << msg;
-            server.WriteLn(msg);
-            break; // while (true)
-          }
-        }
-      }
-    }
+    TcpServer server(server_opts, info);
+
+    if (!server.Listen(port_num))
+      return 1;
+
+    server.Run();
   } catch (const std::exception &e) {
     std::cerr << e.what();
     return -1;
@@ -349,18 +417,172 @@ int main(int argc, char *argv[]) {
 
 
 namespace kaldi {
-TcpServer::TcpServer(int read_timeout) {
-  server_desc_ = -1;
-  client_desc_ = -1;
-  samp_buf_ = NULL;
-  buf_len_ = 0;
-  read_timeout_ = 1000 * read_timeout;
+TcpClientDecoder::TcpClientDecoder(int32 client_desc,
+                                   const SharedDecodingInfo &info):
+    client_desc_(client_desc), info_(info),
+    feature_pipeline_(*info.feature_info),
+    decoder_(info.decoder_opts, *info.trans_model, *info.decodable_info,
+             *info.decode_fst, &feature_pipeline_, info.batch_computer),
+    frame_offset_(0), samp_count_(0), check_count_(info.check_period),
+    write_failed_(false) { }
+
+void TcpClientDecoder::StartSegment() {
+  decoder_.InitDecoding(frame_offset_);
+  silence_weighting_.reset(new OnlineSilenceWeighting(
+      *info_.trans_model, info_.feature_info->silence_weighting_config,
+      info_.frame_subsampling));
+}
+
+void TcpClientDecoder::UpdateSilenceWeights() {
+  if (silence_weighting_->Active() &&
+      feature_pipeline_.IvectorFeature() != NULL) {
+    silence_weighting_->ComputeCurrentTraceback(decoder_.Decoder());
+    silence_weighting_->GetDeltaWeights(feature_pipeline_.NumFramesReady(),
+                                        frame_offset_ * info_.frame_subsampling,
+                                        &delta_weights_);
+    feature_pipeline_.UpdateFrameWeights(delta_weights_);
+  }
+}
+
+void TcpClientDecoder::WriteFinalTranscript(const char *reason) {
+  decoder_.FinalizeDecoding();
+  frame_offset_ += decoder_.NumFramesDecoded();
+  CompactLattice lat;
+  decoder_.GetLattice(true, &lat);
+  std::string msg = LatticeToString(lat, *info_.word_syms);
+
+  // get time-span between endpoints,
+  if (info_.produce_time) {
+    int32 t_beg = frame_offset_ - decoder_.NumFramesDecoded();
+    int32 t_end = frame_offset_;
+    msg = GetTimeString(t_beg, t_end,
+                        info_.frame_shift * info_.frame_subsampling) + " " + msg;
+  }
+
+  KALDI_VLOG(1) << reason << ", sending message: " << msg;
+  WriteLn(msg);
+}
+
+void TcpClientDecoder::AcceptChunk(const VectorBase<BaseFloat> &wave_part) {
+  if (silence_weighting_ == NULL)
+    StartSegment();
+  feature_pipeline_.AcceptWaveform(info_.samp_freq, wave_part);
+  samp_count_ += wave_part.Dim();
+
+  UpdateSilenceWeights();
+  decoder_.AdvanceDecoding();
+
+  if (samp_count_ > check_count_) {
+    if (decoder_.NumFramesDecoded() > 0) {
+      Lattice lat;
+      decoder_.GetBestPath(false, &lat);
+      TopSort(&lat); // for LatticeStateTimes(),
+      std::string msg = LatticeToString(lat, *info_.word_syms);
+
+      // get time-span after previous endpoint,
+      if (info_.produce_time) {
+        int32 t_beg = frame_offset_;
+        int32 t_end = frame_offset_ + GetLatticeTimeSpan(lat);
+        msg = GetTimeString(t_beg, t_end,
+                            info_.frame_shift * info_.frame_subsampling) +
+            " " + msg;
+      }
+
+      KALDI_VLOG(1) << "Temporary transcript: " << msg;
+      WriteLn(msg, "\r");
+    }
+    check_count_ += info_.check_period;
+  }
+
+  if (decoder_.EndpointDetected(info_.endpoint_opts)) {
+    WriteFinalTranscript("Endpoint");
+    silence_weighting_.reset();
+  }
+}
+
+void TcpClientDecoder::InputFinished() {
+  if (silence_weighting_ == NULL)
+    StartSegment();
+  feature_pipeline_.InputFinished();
+  UpdateSilenceWeights();
+  decoder_.AdvanceDecoding();
+  if (decoder_.NumFramesDecoded() > 0) {
+    WriteFinalTranscript("EndOfAudio");
+  } else {
+    decoder_.FinalizeDecoding();
+    Write("\n");
+  }
+  silence_weighting_.reset();
+}
+
+bool TcpClientDecoder::Write(const std::string &msg) {
+  if (write_failed_)
+    return false;
+  const char *p = msg.c_str();
+  size_t to_write = msg.size();
+  size_t wrote = 0;
+  while (to_write > 0) {
+    ssize_t ret = write(client_desc_, static_cast<const void *>(p + wrote),
+                        to_write);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                    errno == EINTR)) {
+      // The socket is non-blocking; wait until we can write.
+      pollfd client_set;
+      client_set.fd = client_desc_;
+      client_set.events = POLLOUT;
+      if (poll(&client_set, 1, 10000) > 0)
+        continue;
+    }
+    if (ret <= 0) {
+      KALDI_WARN << "Cannot write to client; its output will be discarded.";
+      write_failed_ = true;
+      return false;
+    }
+
+    to_write -= ret;
+    wrote += ret;
+  }
+
+  return true;
+}
+
+bool TcpClientDecoder::WriteLn(const std::string &msg, const std::string &eol) {
+  if (Write(msg))
+    return Write(eol);
+  else return false;
+}
+
+TcpServer::Client::Client(int32 desc, const std::string &peer, double now,
+                          const SharedDecodingInfo &info):
+    desc(desc), peer(peer), last_read_time(now), has_odd_byte(false),
+    odd_byte(0), num_samples_read(0), input_finished(false),
+    scheduled(false), reading_paused(false), decoder(desc, info),
+    num_samples_decoded(0), decode_time(0.0), latency_sum(0.0),
+    latency_max(0.0), num_batches(0) { }
+
+TcpServer::TcpServer(const TcpServerOptions &opts,
+                     const SharedDecodingInfo &info):
+    opts_(opts), info_(info), server_desc_(-1), epoll_desc_(-1),
+    event_desc_(-1), listening_(false), exit_(false) {
+  if (opts.num_threads < 1 || opts.max_clients < 1 ||
+      opts.chunk_length_secs <= 0.0 || opts.max_buffered_secs < 0.0)
+    KALDI_ERR << "Invalid options: --num-threads and --max-clients must be "
+              << "positive, --chunk-length positive and --max-buffered-secs "
+              << "nonnegative.";
+  chunk_len_ = static_cast<size_t>(opts.chunk_length_secs * info.samp_freq);
+  KALDI_ASSERT(chunk_len_ > 0);
+  max_pending_ = std::max(chunk_len_, static_cast<size_t>(
+      opts.max_buffered_secs * info.samp_freq));
+  for (int32 i = 0; i < opts.num_threads; i++)
+    threads_.push_back(std::thread(&TcpServer::DecodingThread, this));
 }
 
 bool TcpServer::Listen(int32 port) {
-  h_addr_.sin_addr.s_addr = INADDR_ANY;
-  h_addr_.sin_port = htons(port);
-  h_addr_.sin_family = AF_INET;
+  struct ::sockaddr_in h_addr;
+  memset(&h_addr, 0, sizeof(h_addr));
+  h_addr.sin_addr.s_addr = INADDR_ANY;
+  h_addr.sin_port = htons(port);
+  h_addr.sin_family = AF_INET;
 
   server_desc_ = socket(AF_INET, SOCK_STREAM, 0);
 
@@ -376,16 +598,31 @@ bool TcpServer::Listen(int32 port) {
     return false;
   }
 
-  if (bind(server_desc_, (struct sockaddr *) &h_addr_, sizeof(h_addr_)) == -1) {
+  if (bind(server_desc_, (struct sockaddr *) &h_addr, sizeof(h_addr)) == -1) {
     KALDI_ERR << "Cannot bind to port: " << port << " (is it taken?)";
     return false;
   }
 
-  if (listen(server_desc_, 1) == -1) {
+  if (listen(server_desc_, std::max<int32>(opts_.max_clients, 16)) == -1 ||
+      fcntl(server_desc_, F_SETFL, O_NONBLOCK) == -1) {
     KALDI_ERR << "Cannot listen on port!";
     return false;
   }
 
+  epoll_desc_ = epoll_create1(0);
+  event_desc_ = eventfd(0, EFD_NONBLOCK);
+  if (epoll_desc_ == -1 || event_desc_ == -1) {
+    KALDI_ERR << "Cannot create epoll instance: " << strerror(errno);
+    return false;
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = server_desc_;
+  epoll_ctl(epoll_desc_, EPOLL_CTL_ADD, server_desc_, &ev);
+  ev.data.fd = event_desc_;
+  epoll_ctl(epoll_desc_, EPOLL_CTL_ADD, event_desc_, &ev);
+  listening_ = true;
+
   KALDI_LOG << "TcpServer: Listening on port: " << port;
 
   return true;
@@ -393,110 +630,300 @@ bool TcpServer::Listen(int32 port) {
 }
 
 TcpServer::~TcpServer() {
-  Disconnect();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    exit_ = true;
+  }
+  queue_cond_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+  for (std::map<int32, std::unique_ptr<Client> >::iterator iter =
+           clients_.begin(); iter != clients_.end(); ++iter)
+    close(iter->first);
+  if (event_desc_ != -1)
+    close(event_desc_);
+  if (epoll_desc_ != -1)
+    close(epoll_desc_);
   if (server_desc_ != -1)
     close(server_desc_);
-  delete[] samp_buf_;
 }
 
-int32 TcpServer::Accept() {
-  KALDI_LOG << "Waiting for client...";
-
-  socklen_t len;
-
-  len = sizeof(struct sockaddr);
-  client_desc_ = accept(server_desc_, (struct sockaddr *) &h_addr_, &len);
-
-  struct sockaddr_storage addr;
-  char ipstr[20];
-
-  len = sizeof addr;
-  getpeername(client_desc_, (struct sockaddr *) &addr, &len);
-
-  struct sockaddr_in *s = (struct sockaddr_in *) &addr;
-  inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
+void TcpServer::Run() {
+  KALDI_ASSERT(epoll_desc_ != -1 && "Listen() must be called first.");
+  KALDI_LOG << "Waiting for clients...";
+  std::vector<struct epoll_event> events(64);
+  while (true) {
+    int num_events = epoll_wait(epoll_desc_, &(events[0]), events.size(),
+                                opts_.read_timeout >= 0 ? 1000 : -1);
+    if (num_events < 0) {
+      if (errno == EINTR)
+        continue;
+      KALDI_ERR << "Error waiting for clients: " << strerror(errno);
+    }
+    for (int i = 0; i < num_events; i++) {
+      int32 desc = events[i].data.fd;
+      if (desc == server_desc_) {
+        AcceptClients();
+      } else if (desc == event_desc_) {
+        uint64 count;
+        if (read(event_desc_, &count, sizeof(count)) > 0)
+          CloseFinished();
+      } else {
+        std::map<int32, std::unique_ptr<Client> >::iterator iter =
+            clients_.find(desc);
+        if (iter != clients_.end())
+          ReadClient(iter->second.get());
+      }
+    }
+    if (opts_.read_timeout >= 0)
+      CheckTimeouts();
+  }
+}
 
-  client_set_[0].fd = client_desc_;
-  client_set_[0].events = POLLIN;
+void TcpServer::AcceptClients() {
+  while (clients_.size() < static_cast<size_t>(opts_.max_clients)) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int32 client_desc = accept(server_desc_, (struct sockaddr *) &addr, &len);
+    if (client_desc == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        KALDI_WARN << "Error accepting connection: " << strerror(errno);
+      break;
+    }
+    char ipstr[INET_ADDRSTRLEN] = "";
+    inet_ntop(AF_INET, &addr.sin_addr, ipstr, sizeof ipstr);
+    if (fcntl(client_desc, F_SETFL, O_NONBLOCK) == -1) {
+      KALDI_WARN << "Cannot make socket non-blocking; rejecting " << ipstr;
+      close(client_desc);
+      continue;
+    }
+    Client *client = new Client(client_desc, ipstr, timer_.Elapsed(), info_);
+    clients_[client_desc].reset(client);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = client_desc;
+    epoll_ctl(epoll_desc_, EPOLL_CTL_ADD, client_desc, &ev);
+    KALDI_LOG << "Accepted connection from: " << ipstr << " ("
+              << clients_.size() << " clients)";
+  }
+  UpdateListening();
+}
 
-  KALDI_LOG << "Accepted connection from: " << ipstr;
+void TcpServer::UpdateListening() {
+  bool listen = (clients_.size() < static_cast<size_t>(opts_.max_clients));
+  if (listen != listening_) {
+    SetEvents(server_desc_, listen ? EPOLLIN : 0);
+    listening_ = listen;
+  }
+}
 
-  return client_desc_;
+void TcpServer::SetEvents(int32 desc, uint32 events) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.fd = desc;
+  epoll_ctl(epoll_desc_, EPOLL_CTL_MOD, desc, &ev);
 }
 
-bool TcpServer::ReadChunk(size_t len) {
-  if (buf_len_ != len) {
-    buf_len_ = len;
-    delete[] samp_buf_;
-    samp_buf_ = new int16[len];
+void TcpServer::ReadClient(Client *client) {
+  char buf[65536];
+  size_t buf_len = 0;
+  if (client->has_odd_byte) {
+    buf[0] = client->odd_byte;
+    buf_len = 1;
+    client->has_odd_byte = false;
   }
-
-  ssize_t ret;
-  int poll_ret;
-  char *samp_buf_p = reinterpret_cast<char *>(samp_buf_);
-  size_t to_read = len * sizeof(int16);
-  has_read_ = 0;
-  while (to_read > 0) {
-    poll_ret = poll(client_set_, 1, read_timeout_);
-    if (poll_ret == 0) {
-      KALDI_WARN << "Socket timeout! Disconnecting..." << "(has_read_ = " << has_read_ << ")";
+  bool eos = false;
+  while (buf_len < sizeof(buf)) {
+    ssize_t ret = read(client->desc, buf + buf_len, sizeof(buf) - buf_len);
+    if (ret > 0) {
+      buf_len += ret;
+    } else if (ret == 0) {
+      eos = true;
       break;
-    }
-    if (poll_ret < 0) {
-      KALDI_WARN << "Socket error! Disconnecting...";
-      break;
-    }
-    ret = read(client_desc_, static_cast<void *>(samp_buf_p + has_read_), to_read);
-    if (ret <= 0) {
-      KALDI_WARN << "Stream over...";
+    } else if (errno == EINTR) {
+      continue;
+    } else {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        KALDI_WARN << "Socket error! Disconnecting... (" << client->peer
+                   << ": " << strerror(errno) << ")";
+        eos = true;
+      }
       break;
     }
-    to_read -= ret;
-    has_read_ += ret;
   }
-  has_read_ /= sizeof(int16);
-
-  return has_read_ > 0;
+  size_t num_samples = buf_len / sizeof(int16);
+  if (buf_len % sizeof(int16) != 0) {
+    client->has_odd_byte = true;
+    client->odd_byte = buf[buf_len - 1];
+  }
+  double now = timer_.Elapsed();
+  client->last_read_time = now;
+
+  std::lock_guard<std::mutex> lock(client->mutex);
+  if (num_samples > 0) {
+    size_t size = client->pending.size();
+    client->pending.resize(size + num_samples);
+    memcpy(&(client->pending[size]), buf, num_samples * sizeof(int16));
+    client->num_samples_read += num_samples;
+    client->arrivals.push_back(std::make_pair(client->num_samples_read, now));
+  }
+  if (eos) {
+    KALDI_VLOG(1) << "Stream over... (" << client->peer << ")";
+    client->input_finished = true;
+    epoll_ctl(epoll_desc_, EPOLL_CTL_DEL, client->desc, NULL);
+  } else if (client->pending.size() > max_pending_ &&
+             !client->reading_paused) {
+    client->reading_paused = true;
+    SetEvents(client->desc, 0);
+  }
+  Schedule(client);
 }
 
-Vector<BaseFloat> TcpServer::GetChunk() {
-  Vector<BaseFloat> buf;
-
-  buf.Resize(static_cast<MatrixIndexT>(has_read_));
-
-  for (int i = 0; i < has_read_; i++)
-    buf(i) = static_cast<BaseFloat>(samp_buf_[i]);
-
-  return buf;
+void TcpServer::CheckTimeouts() {
+  double now = timer_.Elapsed();
+  for (std::map<int32, std::unique_ptr<Client> >::iterator iter =
+           clients_.begin(); iter != clients_.end(); ++iter) {
+    Client *client = iter->second.get();
+    std::lock_guard<std::mutex> lock(client->mutex);
+    if (client->input_finished)
+      continue;
+    if (client->reading_paused) {
+      // We are not waiting for the client.
+      client->last_read_time = now;
+    } else if (now - client->last_read_time > opts_.read_timeout) {
+      KALDI_WARN << "Socket timeout! Disconnecting... (" << client->peer << ")";
+      client->input_finished = true;
+      epoll_ctl(epoll_desc_, EPOLL_CTL_DEL, client->desc, NULL);
+      Schedule(client);
+    }
+  }
 }
 
-bool TcpServer::Write(const std::string &msg) {
-
-  const char *p = msg.c_str();
-  size_t to_write = msg.size();
-  size_t wrote = 0;
-  while (to_write > 0) {
-    ssize_t ret = write(client_desc_, static_cast<const void *>(p + wrote), to_write);
-    if (ret <= 0)
-      return false;
-
-    to_write -= ret;
-    wrote += ret;
+void TcpServer::CloseFinished() {
+  std::vector<int32> finished;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    finished.swap(finished_);
+  }
+  for (size_t i = 0; i < finished.size(); i++) {
+    std::map<int32, std::unique_ptr<Client> >::iterator iter =
+        clients_.find(finished[i]);
+    KALDI_ASSERT(iter != clients_.end());
+    const Client &client = *(iter->second);
+    double audio_secs = client.num_samples_decoded / info_.samp_freq;
+    KALDI_LOG << "Closing connection from: " << client.peer << "; decoded "
+              << audio_secs << " seconds of audio, real-time factor "
+              << (audio_secs > 0.0 ? client.decode_time / audio_secs : 0.0)
+              << ", latency average "
+              << (client.num_batches > 0 ?
+                  1000.0 * client.latency_sum / client.num_batches : 0.0)
+              << " ms, max " << 1000.0 * client.latency_max << " ms.";
+    close(iter->first);
+    clients_.erase(iter);
   }
+  UpdateListening();
+}
 
-  return true;
+void TcpServer::Schedule(Client *client) {
+  if (client->scheduled ||
+      !(client->input_finished || client->pending.size() >= chunk_len_))
+    return;
+  client->scheduled = true;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.push_back(client);
+  }
+  queue_cond_.notify_one();
 }
 
-bool TcpServer::WriteLn(const std::string &msg, const std::string &eol) {
-  if (Write(msg))
-    return Write(eol);
-  else return false;
+void TcpServer::DecodingThread() {
+  while (true) {
+    Client *client;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      while (!exit_ && queue_.empty())
+        queue_cond_.wait(lock);
+      if (exit_)
+        return;
+      client = queue_.front();
+      queue_.pop_front();
+    }
+    Decode(client);
+  }
 }
 
-void TcpServer::Disconnect() {
-  if (client_desc_ != -1) {
-    close(client_desc_);
-    client_desc_ = -1;
+void TcpServer::Decode(Client *client) {
+  std::vector<int16> samples;
+  while (true) {
+    bool input_finished;
+    double arrival_time;
+    {
+      std::lock_guard<std::mutex> lock(client->mutex);
+      input_finished = client->input_finished;
+      size_t num_samples = client->pending.size();
+      if (!input_finished)  // we decode whole chunks until the end.
+        num_samples -= num_samples % chunk_len_;
+      if (num_samples == 0 && !input_finished) {
+        client->scheduled = false;
+        return;
+      }
+      samples.assign(client->pending.begin(),
+                     client->pending.begin() + num_samples);
+      client->pending.erase(client->pending.begin(),
+                            client->pending.begin() + num_samples);
+      // The oldest of these samples came with the first remaining read; we
+      // forget the reads that have now been completely taken.
+      int64 num_taken = client->num_samples_read - client->pending.size();
+      arrival_time = (client->arrivals.empty() ? timer_.Elapsed() :
+                      client->arrivals.front().second);
+      while (!client->arrivals.empty() &&
+             client->arrivals.front().first <= num_taken)
+        client->arrivals.pop_front();
+      if (client->reading_paused && !input_finished &&
+          client->pending.size() <= max_pending_) {
+        client->reading_paused = false;
+        SetEvents(client->desc, EPOLLIN);
+      }
+    }
+
+    double start_time = timer_.Elapsed();
+    try {
+      for (size_t i = 0; i < samples.size(); i += chunk_len_) {
+        size_t len = std::min(chunk_len_, samples.size() - i);
+        Vector<BaseFloat> wave_part(len);
+        for (size_t j = 0; j < len; j++)
+          wave_part(j) = static_cast<BaseFloat>(samples[i + j]);
+        client->decoder.AcceptChunk(wave_part);
+      }
+      if (input_finished)
+        client->decoder.InputFinished();
+    } catch (const std::exception &e) {
+      KALDI_WARN << "Error decoding audio from " << client->peer
+                 << "; disconnecting: " << e.what();
+      input_finished = true;
+    }
+    double end_time = timer_.Elapsed();
+    client->num_samples_decoded += samples.size();
+    client->decode_time += end_time - start_time;
+    if (!samples.empty()) {
+      double latency = end_time - arrival_time;
+      client->latency_sum += latency;
+      client->latency_max = std::max(client->latency_max, latency);
+      client->num_batches++;
+    }
+
+    if (input_finished) {
+      // The main thread closes the connection.  It remains 'scheduled' so it
+      // will not be queued again.
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        finished_.push_back(client->desc);
+      }
+      uint64 one = 1;
+      if (write(event_desc_, &one, sizeof(one)) != sizeof(one))
+        KALDI_WARN << "Error waking up the main thread.";
+      return;
+    }
   }
 }
 }  // namespace kaldi
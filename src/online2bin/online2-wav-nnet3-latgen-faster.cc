@@ -108,6 +108,7 @@ int main(int argc, char *argv[]) {
     BaseFloat chunk_length_secs = 0.18;
     bool do_endpointing = false;
     bool online = true;
+    bool mmap_model = false;
 
     po.Register("chunk-length", &chunk_length_secs,
                 "Length of chunk size in seconds, that we process.  Set to <= 0 "
@@ -127,11 +128,16 @@ int main(int argc, char *argv[]) {
                 "--chunk-length=-1.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
+    po.Register("mmap-model", &mmap_model, "If true, map the model file "
+                "into memory, so that processes using the same model share "
+                "the memory of its parameters.  This only has an effect for "
+                "models written with --align-for-mmap=true by nnet3-am-copy.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
     decoder_opts.Register(&po);
     endpoint_opts.Register(&po);
+    RegisterSmallGemmOptions(&po);
 
 
     po.Read(argc, argv);
@@ -163,7 +169,10 @@ int main(int argc, char *argv[]) {
     nnet3::AmNnetSimple am_nnet;
     {
       bool binary;
-      Input ki(nnet3_rxfilename, &binary);
+      Input ki;
+      if (!(mmap_model ? ki.OpenMapped(nnet3_rxfilename, &binary, true) :
+            ki.Open(nnet3_rxfilename, &binary)))
+        KALDI_ERR << "Error opening model " << nnet3_rxfilename;
       trans_model.Read(ki.Stream(), binary);
       am_nnet.Read(ki.Stream(), binary);
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
@@ -23,6 +23,8 @@
 #define KALDI_UTIL_KALDI_HOLDER_INL_H_
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <string>
@@ -119,6 +121,131 @@ template<class KaldiType> class KaldiObjectHolder {
 };
 
 
+template<class Real> class MatrixViewHolder {
+ public:
+  typedef const MatrixBase<Real> T;
+
+  MatrixViewHolder(): view_(NULL) { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
+    try {
+      t.Write(os, binary);
+      return os.good();
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Exception caught writing Table object. " << e.what();
+      return false;  // Write failure.
+    }
+  }
+
+  void Clear() {
+    delete view_;
+    view_ = NULL;
+    mapping_.reset();
+    matrix_.Resize(0, 0);
+  }
+
+  bool Read(std::istream &is) {
+    Clear();
+    bool is_binary;
+    if (!InitKaldiInputStream(is, &is_binary)) {
+      KALDI_WARN << "Reading Table object, failed reading binary header\n";
+      return false;
+    }
+    try {
+      MappedStreambuf *buf = dynamic_cast<MappedStreambuf*>(is.rdbuf());
+      if (!(is_binary && buf != NULL && ReadMapped(is, buf)))
+        matrix_.Read(is, is_binary);
+      return true;
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Exception caught reading Table object. " << e.what();
+      Clear();
+      return false;
+    }
+  }
+
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() {
+    if (view_ != NULL) return *view_;
+    return matrix_;
+  }
+
+  void Swap(MatrixViewHolder<Real> *other) {
+    matrix_.Swap(&(other->matrix_));
+    std::swap(view_, other->view_);
+    mapping_.swap(other->mapping_);
+  }
+
+  bool ExtractRange(const MatrixViewHolder<Real> &other,
+                    const std::string &range) {
+    Clear();
+    const MatrixBase<Real> &input = (other.view_ != NULL ?
+        static_cast<const MatrixBase<Real>&>(*(other.view_)) : other.matrix_);
+    std::vector<int32> row_range, col_range;
+    if (!ParseMatrixRangeSpecifier(range, input.NumRows(), input.NumCols(),
+                                   &row_range, &col_range))
+      return false;
+    int32 row_size = std::min(row_range[1], input.NumRows() - 1)
+                     - row_range[0] + 1,
+          col_size = col_range[1] - col_range[0] + 1;
+    if (other.view_ != NULL) {
+      // The range of a view is a view too.
+      view_ = new SubMatrix<Real>(input, row_range[0], row_size,
+                                  col_range[0], col_size);
+      mapping_ = other.mapping_;
+    } else {
+      matrix_.Resize(row_size, col_size, kUndefined);
+      matrix_.CopyFromMat(input.Range(row_range[0], row_size,
+                                      col_range[0], col_size));
+    }
+    return true;
+  }
+
+  ~MatrixViewHolder() { delete view_; }
+
+ private:
+  // If the stream is at a binary, uncompressed matrix of type Real, reads it
+  // from the mapping 'buf' and returns true: view_ points into the mapping if
+  // the data is suitably aligned (which depends on the length of the key),
+  // else it is copied into matrix_.  Otherwise returns false without reading
+  // anything, and Read() reads the matrix the normal way.
+  bool ReadMapped(std::istream &is, MappedStreambuf *buf) {
+    const char *token = (sizeof(Real) == 4 ? "FM " : "DM ");
+    if (buf->Remaining() < 3 || strncmp(buf->Current(), token, 3) != 0)
+      return false;
+    buf->Skip(3);
+    int32 rows, cols;
+    ReadBasicType(is, true, &rows);
+    ReadBasicType(is, true, &cols);
+    if (rows < 0 || cols < 0)
+      KALDI_ERR << "Invalid matrix size " << rows << " by " << cols;
+    size_t bytes = sizeof(Real) * static_cast<size_t>(rows) * cols;
+    if (bytes > buf->Remaining())
+      KALDI_ERR << "Matrix of size " << rows << " by " << cols
+                << " goes past the end of the file.";
+    const char *data = buf->Current();
+    if (bytes != 0 && reinterpret_cast<size_t>(data) % sizeof(Real) == 0) {
+      view_ = new SubMatrix<Real>(reinterpret_cast<Real*>(
+          const_cast<char*>(data)), rows, cols, cols);
+      mapping_ = buf->Mapping();
+    } else {
+      matrix_.Resize(rows, cols, kUndefined);
+      for (int32 r = 0; r < rows; r++)
+        memcpy(matrix_.RowData(r), data + r * cols * sizeof(Real),
+               cols * sizeof(Real));
+    }
+    buf->Skip(bytes);
+    return true;
+  }
+
+  Matrix<Real> matrix_;  // the value, if view_ is NULL.
+  SubMatrix<Real> *view_;  // if non-NULL, the value, pointing into mapping_.
+  std::shared_ptr<const char> mapping_;  // keeps the file mapped.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MatrixViewHolder);
+};
+
+
 // BasicHolder is valid for float, double, bool, and integer
 // types.  There will be a compile time error otherwise, because
 // we make sure that the {Write, Read}BasicType functions do not
@@ -172,6 +172,13 @@ template<class SomeType> class GenericHolder {
 /// and Write functions, and a copy constructor.
 template<class KaldiType> class KaldiObjectHolder;
 
+/// MatrixViewHolder is a read-only holder for matrices (T == const
+/// MatrixBase<Real>).  If the table was opened with the "mmap" option (e.g.
+/// "ark,mmap:feats.ark") and the matrix is stored uncompressed in binary with
+/// the same precision, the value is a SubMatrix pointing into the mapped file,
+/// so nothing is copied; otherwise it reads into a Matrix as usual.
+template<class Real> class MatrixViewHolder;
+
 /// BasicHolder is valid for float, double, bool, and integer
 /// types.  There will be a compile time error otherwise, because
 /// we make sure that the {Write, Read}BasicType functions do not
@@ -272,6 +279,15 @@ bool ExtractRangeSpecifier(const std::string &rxfilename_with_range,
                            std::string *range);
 
 
+/// Parses a matrix range specifier of the form "r1:r2,c1:c2", where any of the
+/// numbers may be missing, for a matrix with 'rows' rows and 'cols' columns
+/// (see ExtractObjectRange()).  Outputs the first and last row and column.
+bool ParseMatrixRangeSpecifier(const std::string &range,
+                               const int rows, const int cols,
+                               std::vector<int32> *row_range,
+                               std::vector<int32> *col_range);
+
+
 /// @} end "addtogroup holders"
 
 
@@ -24,11 +24,16 @@
 namespace kaldi {
 
 bool Input::Open(const std::string &rxfilename, bool *binary) {
-  return OpenInternal(rxfilename, true, binary);
+  return OpenInternal(rxfilename, true, false, false, binary);
+}
+
+bool Input::OpenMapped(const std::string &rxfilename, bool *binary,
+                       bool share_data) {
+  return OpenInternal(rxfilename, true, true, share_data, binary);
 }
 
 bool Input::OpenTextMode(const std::string &rxfilename) {
-  return OpenInternal(rxfilename, false, NULL);
+  return OpenInternal(rxfilename, false, false, false, NULL);
 }
 
 bool Input::IsOpen() {
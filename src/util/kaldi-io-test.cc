@@ -305,6 +305,68 @@ void UnitTestIoStandard() {
   }
 }
 
+// Tests reading matrices in place from a memory-mapped file, when it was
+// written with SetAlignMatrixData(true).
+void UnitTestIoSharedMatrix() {
+#ifndef _MSC_VER
+  const char *filename = "tmpf";
+  Matrix<float> big(100, 37), small(2, 3);
+  big.SetRandn();
+  small.SetRandn();
+  SetAlignMatrixData(true);
+  {
+    Output ko(filename, true);
+    WriteToken(ko.Stream(), true, "<Foo>");
+    big.Write(ko.Stream(), true);
+    small.Write(ko.Stream(), true);
+    big.Write(ko.Stream(), true);
+  }
+  SetAlignMatrixData(false);
+  for (int32 share = 0; share < 2; share++) {
+    bool binary;
+    Input ki;
+    KALDI_ASSERT(ki.OpenMapped(filename, &binary, share == 1) && binary);
+    ExpectToken(ki.Stream(), binary, "<Foo>");
+    Matrix<float> a, b, c;
+    a.Read(ki.Stream(), binary);
+    b.Read(ki.Stream(), binary);
+    c.Read(ki.Stream(), binary);
+    ki.Close();
+    // The data stays valid after the Input is closed.
+    KALDI_ASSERT(a.Equal(big) && b.Equal(small) && c.Equal(big));
+    KALDI_ASSERT(IsSharedMappedData(a.Data()) == (share == 1) &&
+                 IsSharedMappedData(c.Data()) == (share == 1) &&
+                 !IsSharedMappedData(b.Data()));
+    a(0, 0) = 1.0;  // The mapping is copy-on-write.
+    KALDI_ASSERT(!c.Equal(a) && c.Equal(big));
+    a.Resize(2, 2);  // Does not free the mapped memory.
+  }
+  {
+    // Without share_data the mapping is read-only, so reopening the same file
+    // with share_data has to map it again, writably.
+    bool binary;
+    Input ki;
+    KALDI_ASSERT(ki.OpenMapped(filename, &binary, false) && binary);
+    KALDI_ASSERT(ki.OpenMapped(filename, &binary, true) && binary);
+    ExpectToken(ki.Stream(), binary, "<Foo>");
+    Matrix<float> a;
+    a.Read(ki.Stream(), binary);
+    KALDI_ASSERT(IsSharedMappedData(a.Data()) && a.Equal(big));
+    a(0, 0) = 1.0;
+  }
+  {
+    // Reading normally (also as double) skips the padding.
+    bool binary;
+    Input ki(filename, &binary);
+    ExpectToken(ki.Stream(), binary, "<Foo>");
+    Matrix<double> a, b;
+    a.Read(ki.Stream(), binary);
+    b.Read(ki.Stream(), binary);
+    KALDI_ASSERT(Matrix<float>(a).Equal(big) && Matrix<float>(b).Equal(small));
+  }
+#endif
+}
+
 // This is Windows-specific.
 void UnitTestNativeFilename() {
 #ifdef KALDI_CYGWIN_COMPAT
@@ -361,6 +423,7 @@ int main(int argc, const char** argv) {
   UnitTestIoPipe(true);
   UnitTestIoPipe(false);
   UnitTestIoStandard();
+  UnitTestIoSharedMatrix();
   UnitTestClassifyRxfilename();
   UnitTestClassifyWxfilename();
 
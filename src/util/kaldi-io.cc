@@ -28,6 +28,13 @@
 #include "util/kaldi-table.h"  // for Classify{W,R}specifier
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifdef KALDI_CYGWIN_COMPAT
 #include "util/kaldi-cygwin-io-inl.h"
@@ -662,6 +669,120 @@ class OffsetFileInputImpl: public InputImplBase {
 };
 
 
+#if !defined(_MSC_VER)
+// MappedFileInputImpl reads ordinary files and offsets into them (like
+// FileInputImpl and OffsetFileInputImpl) by mapping the whole file into memory.
+// Like OffsetFileInputImpl it may be opened again while open, and if the file
+// is the same it just moves the read position.
+class MappedFileInputImpl: public InputImplBase {
+ public:
+  MappedFileInputImpl(): is_(&buf_), type_(kNoInput), size_(0),
+                         share_data_(false), writable_(false) { }
+
+  // Must be called before Open(); see Input::OpenMapped().  If share_data is
+  // true, the mapping is writable, because matrices read from it may point
+  // into it and be changed.
+  void SetShareData(bool share_data) { share_data_ = share_data; }
+
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    // 'binary' makes no difference, as there are no text-mode files here.
+    InputType type = ClassifyRxfilename(rxfilename);
+    KALDI_ASSERT(type == kFileInput || type == kOffsetFileInput);
+    std::string filename;
+    size_t offset = 0;
+    if (type == kOffsetFileInput)
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+    else
+      filename = rxfilename;
+    if (type_ == kNoInput || filename != filename_ ||
+        writable_ != share_data_) {
+      if (!Map(filename)) {
+        type_ = kNoInput;
+        return false;
+      }
+    }
+    type_ = type;
+    if (offset > size_) {
+      KALDI_WARN << "Offset " << offset << " is past the end of " << filename_
+                 << " (size " << size_ << ")";
+      return false;
+    }
+    buf_.SetMapping(mapping_, size_, offset);
+    buf_.SetShareData(share_data_);
+    is_.clear();
+    return true;
+  }
+
+  virtual std::istream &Stream() {
+    if (type_ == kNoInput)
+      KALDI_ERR << "MappedFileInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual int32 Close() {
+    if (type_ == kNoInput)
+      KALDI_ERR << "MappedFileInputImpl::Close(), file is not open.";
+    buf_.SetMapping(std::shared_ptr<const char>(), 0, 0);
+    mapping_.reset();  // unmaps, unless someone holds a copy.
+    type_ = kNoInput;
+    return 0;
+  }
+
+  // If it's kOffsetFileInput, Input may call Open again.
+  virtual InputType MyType() { return type_; }
+
+  virtual ~MappedFileInputImpl() { }
+
+ private:
+  bool Map(const std::string &filename) {
+    buf_.SetMapping(std::shared_ptr<const char>(), 0, 0);
+    mapping_.reset();
+    filename_ = filename;
+    int fd = open(MapOsPath(filename).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+    if (size_ == 0) {  // mmap() refuses empty mappings.
+      close(fd);
+      static const char empty = '\0';
+      mapping_.reset(&empty, [](const char*) { });
+      return true;
+    }
+    // Normally the mapping is read-only.  With share_data it is private and
+    // writable, i.e. copy-on-write: the pages are shared with other processes
+    // reading the file unless they are modified (e.g. model parameters that
+    // are changed after reading).
+    writable_ = share_data_;
+    void *data = mmap(NULL, size_,
+                      writable_ ? PROT_READ | PROT_WRITE : PROT_READ,
+                      writable_ ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid after closing.
+    if (data == MAP_FAILED) {
+      KALDI_WARN << "Could not mmap " << filename << ": " << strerror(errno);
+      return false;
+    }
+    size_t size = size_;
+    mapping_.reset(static_cast<const char*>(data), [size](const char *p) {
+        munmap(const_cast<char*>(p), size); });
+    return true;
+  }
+
+  MappedStreambuf buf_;
+  std::istream is_;
+  InputType type_;  // kNoInput if not open.
+  std::string filename_;
+  std::shared_ptr<const char> mapping_;
+  size_t size_;
+  bool share_data_;  // as set by SetShareData().
+  bool writable_;  // true if mapping_ is writable.
+};
+#endif  // !defined(_MSC_VER)
+
+
 Output::Output(const std::string &wxfilename, bool binary,
                bool write_header):impl_(NULL) {
   if (!Open(wxfilename, binary, write_header)) {
@@ -771,13 +892,30 @@ int32 Input::Close() {
 
 bool Input::OpenInternal(const std::string &rxfilename,
                          bool file_binary,
+                         bool mapped,
+                         bool share_data,
                          bool *contents_binary) {
   InputType type = ClassifyRxfilename(rxfilename);
+#if defined(_MSC_VER)
+  mapped = false;
+#endif
+  if (mapped && type != kFileInput && type != kOffsetFileInput)
+    mapped = false;
   if (IsOpen()) {
     // May have to close the stream first.
-    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput) {
+    bool impl_mapped = false;
+#if !defined(_MSC_VER)
+    impl_mapped = (dynamic_cast<MappedFileInputImpl*>(impl_) != NULL);
+#endif
+    if (mapped ? impl_mapped :
+        (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput &&
+         !impl_mapped)) {
       // We want to use the same object to Open... this is in case
       // the files are the same, so we can just seek.
+#if !defined(_MSC_VER)
+      if (mapped)
+        static_cast<MappedFileInputImpl*>(impl_)->SetShareData(share_data);
+#endif
       if (!impl_->Open(rxfilename, file_binary)) {  // true is binary mode--
         // always open in binary.
         delete impl_;
@@ -794,7 +932,13 @@ bool Input::OpenInternal(const std::string &rxfilename,
       // and fall through to code below which actually opens the file.
     }
   }
-  if (type ==  kFileInput) {
+  if (mapped) {
+#if !defined(_MSC_VER)
+    MappedFileInputImpl *mapped_impl = new MappedFileInputImpl();
+    mapped_impl->SetShareData(share_data);
+    impl_ = mapped_impl;
+#endif
+  } else if (type ==  kFileInput) {
     impl_ = new FileInputImpl();
   } else if (type == kStandardInput) {
     impl_ = new StandardInputImpl();
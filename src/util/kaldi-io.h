@@ -26,6 +26,8 @@
 #endif
 #include <cctype>  // For isspace.
 #include <limits>
+#include <memory>
+#include <streambuf>
 #include <string>
 #include "base/kaldi-common.h"
 #include "matrix/kaldi-matrix.h"
@@ -213,6 +215,19 @@ class Input {
   // binary mode (and ignore the \r).
   inline bool OpenTextMode(const std::string &rxfilename);
 
+  // As Open, but if rxfilename is an ordinary file or an offset into one
+  // (e.g. "foo.ark:1234"), the file is mapped into memory and read through a
+  // MappedStreambuf (see base/io-funcs.h).  Reopening the same file at another
+  // offset reuses the mapping.  Other kinds of rxfilename are opened as by
+  // Open; so is everything, if mmap() is not available.  If share_data is
+  // true, Matrix::Read() makes large matrices point into the mapping when the
+  // file was written with SetAlignMatrixData(true), so processes that read
+  // the same model share the memory of its parameters; the mapping is then
+  // private and writable (copy-on-write), otherwise it is read-only.
+  inline bool OpenMapped(const std::string &rxfilename,
+                         bool *contents_binary = NULL,
+                         bool share_data = false);
+
   // Return true if currently open for reading and Stream() will
   // succeed.  Does not guarantee that the stream is good.
   inline bool IsOpen();
@@ -231,7 +246,7 @@ class Input {
   ~Input();
  private:
   bool OpenInternal(const std::string &rxfilename, bool file_binary,
-                    bool *contents_binary);
+                    bool mapped, bool share_data, bool *contents_binary);
   InputImplBase *impl_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(Input);
 };
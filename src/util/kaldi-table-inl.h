@@ -24,6 +24,10 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
@@ -34,6 +38,7 @@
 #include "util/text-utils.h"
 #include "util/stl-utils.h"  // for StringHasher.
 #include "util/kaldi-semaphore.h"
+#include "util/script-index.h"
 
 
 namespace kaldi {
@@ -102,6 +107,13 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     RspecifierType rs = ClassifyRspecifier(rspecifier, &script_rxfilename_,
                                            &opts_);
     KALDI_ASSERT(rs == kScriptRspecifier);
+    if (ScriptIndex::IsScriptIndex(script_rxfilename_)) {
+      KALDI_WARN << "File " << script_rxfilename_ << " is a script index "
+                 << "(see make-scp-index), which can only be used for "
+                 << "random access.";
+      state_ = kUninitialized;
+      return false;
+    }
     if (!script_input_.Open(script_rxfilename_, &binary)) {  // Failure on Open
       KALDI_WARN << "Failed to open script file "
                  << PrintableRxfilename(script_rxfilename_);
@@ -302,7 +314,8 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       bool ans;
       // note, NULL means it doesn't read the binary-mode header
       if (Holder::IsReadInBinary()) {
-        ans = data_input_.Open(data_rxfilename_, NULL);
+        ans = opts_.mmap ? data_input_.OpenMapped(data_rxfilename_, NULL) :
+            data_input_.Open(data_rxfilename_, NULL);
       } else {
         ans = data_input_.OpenTextMode(data_rxfilename_);
       }
@@ -506,7 +519,8 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     bool ans;
     // NULL means don't expect binary-mode header
     if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
+      ans = opts_.mmap ? input_.OpenMapped(archive_rxfilename_, NULL) :
+          input_.Open(archive_rxfilename_, NULL);
     else
       ans = input_.OpenTextMode(archive_rxfilename_);
     if (!ans) {  // header.
@@ -696,8 +710,10 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   } state_;
 };
 
-// this is for when someone adds the 'th' modifier; it wraps around the basic
-// implementation and allows it to do the reading in a background thread.
+// this is for when someone adds the 'bg' modifier; it wraps around the basic
+// implementation and allows it to do the reading in a background thread.  With
+// "bg=N" the background thread may read up to N objects ahead; they wait in a
+// ring of N holders.
 template<class Holder>
 class SequentialTableReaderBackgroundImpl:
       public SequentialTableReaderImplBase<Holder> {
@@ -705,8 +721,11 @@ class SequentialTableReaderBackgroundImpl:
   typedef typename Holder::T T;
 
   SequentialTableReaderBackgroundImpl(
-      SequentialTableReaderImplBase<Holder> *base_reader):
-      base_reader_(base_reader) {}
+      SequentialTableReaderImplBase<Holder> *base_reader, int32 depth = 1):
+      slots_(depth), head_(0), at_end_(false), producer_sem_(depth),
+      closing_(false), failed_(false), base_reader_(base_reader) {
+    KALDI_ASSERT(depth >= 1);
+  }
 
   // This function ignores the rxfilename argument.
   // We use the same function signature as the regular Open(),
@@ -718,9 +737,7 @@ class SequentialTableReaderBackgroundImpl:
       thread_ = std::thread(SequentialTableReaderBackgroundImpl<Holder>::run,
                             this);
     }
-
-    if (!base_reader_->Done())
-      Next();
+    Next();
     return true;
   }
 
@@ -734,35 +751,29 @@ class SequentialTableReaderBackgroundImpl:
     try {
       // This function is called in the background thread.  The whole point of
       // the background thread is that we don't want to do the actual reading
-      // (inside Next()) in the foreground.
-      while (base_reader_ != NULL && !base_reader_->Done()) {
-        consumer_sem_.Signal();
-        // Here is where the consumer process (parent thread) gets to do its
-        // stuff.  Principally it calls SwapHolder()-- a shallow swap that is
-        // cheap.
+      // (inside Next()) in the foreground.  Each time round the loop it waits
+      // for a free slot, moves the current object of base_reader_ into it (a
+      // shallow swap that is cheap) and reads the next one.  An empty key
+      // marks the end.
+      for (size_t i = 0; ; i = (i + 1) % slots_.size()) {
         producer_sem_.Wait();
-        // we check that base_reader_ is not NULL in case Close() was
-        // called in the main thread.
-        if (base_reader_ != NULL)
-          base_reader_->Next();   //  here is where the work happens.
+        Slot &slot = slots_[i];
+        if (closing_ || base_reader_->Done()) {
+          slot.key = "";
+          consumer_sem_.Signal();
+          return;
+        }
+        slot.key = base_reader_->Key();
+        base_reader_->SwapHolder(&(slot.holder));
+        consumer_sem_.Signal();
+        base_reader_->Next();   //  here is where the work happens.
       }
-      // this signal will be waited on in the Next() function of the foreground
-      // thread if it is still running, or Close() otherwise.
-      consumer_sem_.Signal();
-      // this signal may be waited on in Close().
-      consumer_sem_.Signal();
     } catch (...) {
-      // There is nothing we called above that could potentially throw due to
-      // user data.  So we treat reaching this point as a code-error condition.
-      // Closing base_reader_ will trigger an exception in Next() in the main
-      // thread when it checks that base_reader_->IsOpen().
-      if (base_reader_->IsOpen()) {
-        base_reader_->Close();
-        delete base_reader_;
-        base_reader_ = NULL;
-      }
+      // This can happen for instance if a script file points to an object
+      // that can't be read (without the 'p' option).  Next() in the main
+      // thread will throw when it sees failed_.
+      failed_ = true;
       consumer_sem_.Signal();
-      return;
     }
   }
   static void run(SequentialTableReaderBackgroundImpl<Holder> *object) {
@@ -795,19 +806,21 @@ class SequentialTableReaderBackgroundImpl:
     holder_.Clear();
   }
   virtual void Next() {
+    if (at_end_)
+      KALDI_ERR << "Next() called after the end of the table.";
     consumer_sem_.Wait();
-    if (base_reader_ == NULL || !base_reader_->IsOpen())
-      KALDI_ERR << "Error detected (likely code error) in background "
-                << "reader (',bg' option)";
-    if (base_reader_->Done()) {
-      // there is nothing else to read.
-      key_ = "";
-    } else {
-      key_ = base_reader_->Key();
-      base_reader_->SwapHolder(&holder_);
-    }
+    if (failed_)
+      KALDI_ERR << "Error detected in background reader (',bg' option); "
+                << "see the warnings above.";
+    Slot &slot = slots_[head_];
+    head_ = (head_ + 1) % slots_.size();
+    key_ = slot.key;
+    if (!key_.empty())
+      holder_.Swap(&(slot.holder));
+    else
+      at_end_ = true;
     // this Signal() tells the producer thread, in the background,
-    // that it's now safe to read the next value.
+    // that the slot is free again.
     producer_sem_.Signal();
   }
 
@@ -815,21 +828,19 @@ class SequentialTableReaderBackgroundImpl:
   // object will delete this object after calling Close.
   virtual bool Close() {
     KALDI_ASSERT(base_reader_ != NULL && thread_.joinable());
-    // wait until the producer thread is idle.
-    consumer_sem_.Wait();
-    bool ans = true;
+    // make the producer thread stop if it's waiting for a free slot, and wait
+    // for it to finish.
+    closing_ = true;
+    producer_sem_.Signal();
+    thread_.join();
+    bool ans = !failed_;
     try {
-      ans = base_reader_->Close();
+      ans = base_reader_->Close() && ans;
     } catch (...) {
       ans = false;
     }
     delete base_reader_;
-    // setting base_reader_ to NULL will cause the loop in the producer thread
-    // to exit.
     base_reader_ = NULL;
-    producer_sem_.Signal();
-
-    thread_.join();
     return ans;
   }
   ~SequentialTableReaderBackgroundImpl() {
@@ -841,13 +852,24 @@ class SequentialTableReaderBackgroundImpl:
     }
   }
  private:
+  struct Slot {
+    std::string key;  // empty at the end of the table.
+    Holder holder;
+  };
+
   std::string key_;
   Holder holder_;
-  // I couldn't figure out what to call these semaphores.  consumer_sem_ is the
-  // one that the consumer (main thread) waits on; producer_sem_ is the one
-  // that the producer (background thread) waits on.
+  std::vector<Slot> slots_;  // objects that have been read ahead.
+  size_t head_;  // the slot the next call to Next() takes; only the main
+                 // thread uses this.
+  bool at_end_;  // true once Next() has taken the end marker.
+  // consumer_sem_ counts the slots holding objects, and is what the consumer
+  // (main thread) waits on; producer_sem_ counts the free slots, and is what
+  // the producer (background thread) waits on.
   Semaphore consumer_sem_;
   Semaphore producer_sem_;
+  std::atomic<bool> closing_;  // set by Close() to stop the producer.
+  std::atomic<bool> failed_;  // set by the producer if the reading threw.
   std::thread thread_;
   SequentialTableReaderImplBase<Holder> *base_reader_;
 
@@ -887,7 +909,7 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
   }
   if (opts.background) {
     impl_ = new SequentialTableReaderBackgroundImpl<Holder>(
-        impl_);
+        impl_, opts.background_depth);
     if (!impl_->Open("")) {
       // the rxfilename is ignored in that Open() call.
       // It should only return false on code error.
@@ -1582,6 +1604,149 @@ template<class Holder> class RandomAccessTableReaderImplBase {
 };
 
 
+// ScriptPrefetcher is used by RandomAccessTableReaderScriptImpl for the "bg"
+// option.  A background thread reads the objects that a script file points to
+// in the order of the script file, up to 'depth' objects ahead of the one the
+// reader last asked for.  If the reader asks for an object further on, the
+// thread skips ahead to it; if it asks for one the thread has already passed,
+// Take() returns false and the reader reads it the normal way.
+template<class Holder>
+class ScriptPrefetcher {
+ public:
+  // 'script' is the sorted script (key, rxfilename), and script_pos[i] is the
+  // position of script[i] in the original script file.  Both must outlive this
+  // object.
+  ScriptPrefetcher(
+      const std::vector<std::pair<std::string, std::string> > &script,
+      const std::vector<size_t> &script_pos, int32 depth, bool mmap):
+      script_(script), order_(script.size()), depth_(depth), mmap_(mmap),
+      next_pos_(0), wanted_pos_(0), reading_pos_(-1), stop_(false),
+      done_(false) {
+    KALDI_ASSERT(script_pos.size() == script.size() && depth >= 1);
+    for (size_t i = 0; i < script_pos.size(); i++)
+      order_[script_pos[i]] = i;
+    thread_ = std::thread(ScriptPrefetcher<Holder>::run, this);
+  }
+
+  // If the object at position 'pos' in the script file has been or will be
+  // read by the background thread, waits for it and swaps it into 'holder'
+  // and returns true.  Returns false if the background thread has passed
+  // 'pos' or failed to read the object; the caller should then read it
+  // itself.
+  bool Take(size_t pos, Holder *holder) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pos > wanted_pos_) {
+      wanted_pos_ = pos;
+      cond_.notify_all();
+    }
+    while (true) {
+      // discard objects that were not asked for.
+      while (!prefetched_.empty() && prefetched_.front().first < pos) {
+        delete prefetched_.front().second;
+        prefetched_.pop_front();
+        cond_.notify_all();
+      }
+      if (!prefetched_.empty()) {
+        if (prefetched_.front().first > pos)
+          return false;
+        Holder *prefetched = prefetched_.front().second;
+        prefetched_.pop_front();
+        cond_.notify_all();
+        if (prefetched == NULL)
+          return false;  // there was an error reading it.
+        holder->Swap(prefetched);
+        delete prefetched;
+        return true;
+      }
+      if (reading_pos_ != static_cast<int64>(pos) &&
+          (done_ || next_pos_ > pos))
+        return false;  // it has passed 'pos'.
+      cond_.wait(lock);
+    }
+  }
+
+  ~ScriptPrefetcher() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+      cond_.notify_all();
+    }
+    thread_.join();
+    for (size_t i = 0; i < prefetched_.size(); i++)
+      delete prefetched_[i].second;
+  }
+
+ private:
+  static void run(ScriptPrefetcher<Holder> *object) {
+    object->RunInBackground();
+  }
+
+  void RunInBackground() {
+    Input input;
+    std::string last_rxfilename;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (!stop_ && prefetched_.size() >= static_cast<size_t>(depth_))
+        cond_.wait(lock);
+      if (stop_) break;
+      next_pos_ = std::max(next_pos_, wanted_pos_);
+      if (next_pos_ >= order_.size()) break;
+      size_t pos = next_pos_++;
+      const std::string &value = script_[order_[pos]].second;
+      std::string data_rxfilename, range;
+      if (value[value.size() - 1] != ']' ||
+          !ExtractRangeSpecifier(value, &data_rxfilename, &range))
+        data_rxfilename = value;
+      // Lines with ranges of the same object are usually consecutive, and the
+      // reader keeps the object, so we don't need it again.
+      if (data_rxfilename == last_rxfilename) continue;
+      last_rxfilename = data_rxfilename;
+      reading_pos_ = pos;
+      lock.unlock();
+      Holder *holder = new Holder;
+      bool ok;
+      try {
+        ok = (mmap_ ? input.OpenMapped(data_rxfilename) :
+              input.Open(data_rxfilename)) && holder->Read(input.Stream());
+      } catch (...) {
+        ok = false;
+      }
+      if (!ok) {
+        // The reader will try again and print the warnings.
+        delete holder;
+        holder = NULL;
+      }
+      lock.lock();
+      reading_pos_ = -1;
+      prefetched_.push_back(std::make_pair(pos, holder));
+      cond_.notify_all();
+    }
+    done_ = true;
+    cond_.notify_all();
+  }
+
+  const std::vector<std::pair<std::string, std::string> > &script_;
+  std::vector<size_t> order_;  // order_[pos] is the index in script_ of the
+                               // line at position 'pos' in the script file.
+  int32 depth_;
+  bool mmap_;
+
+  // The following are protected by mutex_.
+  std::deque<std::pair<size_t, Holder*> > prefetched_;  // (position, object),
+                                    // the object being NULL if it failed.
+  size_t next_pos_;  // next position the background thread will look at.
+  size_t wanted_pos_;  // the position last asked for by Take().
+  int64 reading_pos_;  // the position being read, or -1.
+  bool stop_;
+  bool done_;  // true when the background thread has finished.
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread thread_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ScriptPrefetcher);
+};
+
+
 // Implementation of RandomAccessTableReader for a script file; for simplicity
 // we just read it in all in one go, as it's unlikely someone would generate
 // this from a pipe.  In principle we could read it on-demand as for the
@@ -1595,7 +1760,8 @@ class RandomAccessTableReaderScriptImpl:
  public:
   typedef typename Holder::T T;
 
-  RandomAccessTableReaderScriptImpl(): last_found_(0), state_(kUninitialized) {}
+  RandomAccessTableReaderScriptImpl(): prefetcher_(NULL), last_found_(0),
+                                       state_(kUninitialized) {}
 
   virtual bool Open(const std::string &rspecifier) {
     switch (state_) {
@@ -1612,6 +1778,18 @@ class RandomAccessTableReaderScriptImpl:
     KALDI_ASSERT(rs == kScriptRspecifier);  // or wrongly called.
     KALDI_ASSERT(script_.empty());  // no way it could be nonempty at this point
 
+    if (ScriptIndex::IsScriptIndex(script_rxfilename_)) {
+      // A binary index of a script file, made by make-scp-index; we look up
+      // keys in it directly rather than reading it into script_.
+      if (!index_.Open(script_rxfilename_)) {
+        state_ = kNotReadScript;
+        return false;
+      }
+      state_ = kNotHaveObject;
+      key_ = "";
+      return true;
+    }
+
     if (!ReadScriptFile(script_rxfilename_,
                         true,  // print any warnings
                         &script_)) {  // error reading script file or invalid
@@ -1625,8 +1803,28 @@ class RandomAccessTableReaderScriptImpl:
     // Although we could easily sort them, we want to let the user know of this
     // mistake.  This same mistake could have serious effects if used with an
     // archive rather than a script.
-    if (!opts_.sorted)
-      std::sort(script_.begin(), script_.end());
+    if (opts_.background) {
+      // Remember the order of the script file, for the prefetcher.
+      script_pos_.resize(script_.size());
+      for (size_t i = 0; i < script_pos_.size(); i++)
+        script_pos_[i] = i;
+    }
+    if (!opts_.sorted) {
+      if (opts_.background) {
+        const std::vector<std::pair<std::string, std::string> > &script =
+            script_;
+        std::sort(script_pos_.begin(), script_pos_.end(),
+                  [&script](size_t a, size_t b) {
+                    return script[a] < script[b]; });
+        std::vector<std::pair<std::string, std::string> > sorted_script(
+            script_.size());
+        for (size_t i = 0; i < script_pos_.size(); i++)
+          sorted_script[i].swap(script_[script_pos_[i]]);
+        script_.swap(sorted_script);
+      } else {
+        std::sort(script_.begin(), script_.end());
+      }
+    }
     for (size_t i = 0; i + 1 < script_.size(); i++) {
       if (script_[i].first.compare(script_[i+1].first) >= 0) {
         // script[i] not < script[i+1] in lexical order...
@@ -1639,6 +1837,10 @@ class RandomAccessTableReaderScriptImpl:
         return false;
       }
     }
+    if (opts_.background)
+      prefetcher_ = new ScriptPrefetcher<Holder>(script_, script_pos_,
+                                                 opts_.background_depth,
+                                                 opts_.mmap);
     state_ = kNotHaveObject;
     key_ = "";  // make sure we don't have a key set
     return true;
@@ -1653,11 +1855,15 @@ class RandomAccessTableReaderScriptImpl:
     if (!IsOpen())
       KALDI_ERR << "Close() called on RandomAccessTableReader that was not"
                    " open.";
+    delete prefetcher_;  // stops the background thread.
+    prefetcher_ = NULL;
     holder_.Clear();
     range_holder_.Clear();
     state_ = kUninitialized;
     last_found_ = 0;
     script_.clear();
+    script_pos_.clear();
+    index_.Close();
     key_ = "";
     range_ = "";
     data_rxfilename_ = "";
@@ -1690,7 +1896,7 @@ class RandomAccessTableReaderScriptImpl:
     }
   }
 
-  virtual ~RandomAccessTableReaderScriptImpl() { }
+  virtual ~RandomAccessTableReaderScriptImpl() { delete prefetcher_; }
 
  private:
 
@@ -1716,8 +1922,8 @@ class RandomAccessTableReaderScriptImpl:
       case kNotHaveObject: default: break;
     }
     KALDI_ASSERT(IsToken(key));
-    size_t key_pos = 0;
-    if (!LookupKey(key, &key_pos)) {
+    const std::string *value = NULL;
+    if (!LookupKey(key, &value)) {
       return false;
     } else {
       if (!preload) {
@@ -1726,17 +1932,17 @@ class RandomAccessTableReaderScriptImpl:
       } else {  // preload specified, so we have to attempt to pre-load the
                 // object before returning.
         std::string data_rxfilename, range; // We will split
-        // script_[key_pos].second (e.g. "1.ark:100[0:2]" into data_rxfilename
+        // *value (e.g. "1.ark:100[0:2]" into data_rxfilename
         // (e.g. "1.ark:100") and range (if any), e.g. "0:2".
-        if (script_[key_pos].second[script_[key_pos].second.size()-1] == ']') {
-          if(!ExtractRangeSpecifier(script_[key_pos].second,
+        if ((*value)[value->size()-1] == ']') {
+          if(!ExtractRangeSpecifier(*value,
                                     &data_rxfilename,
                                     &range)) {
             KALDI_ERR << "TableReader: failed to parse range in '"
-                      << script_[key_pos].second << "'";
+                      << *value << "'";
           }
         } else {
-          data_rxfilename = script_[key_pos].second;
+          data_rxfilename = *value;
         }
         if (state_ == kHaveRange) {
           if (data_rxfilename_ == data_rxfilename && range_ == range) {
@@ -1763,9 +1969,16 @@ class RandomAccessTableReaderScriptImpl:
         key_ = key;
         data_rxfilename_ = data_rxfilename;
         range_ = range;
+        if (state_ == kNotHaveObject && prefetcher_ != NULL &&
+            prefetcher_->Take(script_pos_[last_found_], &holder_)) {
+          // LookupKey() set last_found_ to the position of the key in
+          // script_.
+          state_ = kHaveObject;
+        }
         if (state_ == kNotHaveObject) {
           // we need to read the object.
-          if (!input_.Open(data_rxfilename)) {
+          if (!(opts_.mmap ? input_.OpenMapped(data_rxfilename) :
+                input_.Open(data_rxfilename))) {
             KALDI_WARN << "Error opening stream "
                        << PrintableRxfilename(data_rxfilename);
             return false;
@@ -1797,20 +2010,27 @@ class RandomAccessTableReaderScriptImpl:
   }
 
   // This function attempts to look up the key "key" in the sorted array
-  // script_.  If it was found it returns true and puts the array offset into
-  // 'script_offset'; otherwise it returns false.
-  bool LookupKey(const std::string &key, size_t *script_offset) {
+  // script_, or in index_ if we opened a script index.  If it was found it
+  // returns true and sets '*value' to point to the rxfilename for the key
+  // (which is valid until the next call); otherwise it returns false.
+  bool LookupKey(const std::string &key, const std::string **value) {
+    if (index_.IsOpen()) {
+      if (!index_.Lookup(key, &index_value_))
+        return false;
+      *value = &index_value_;
+      return true;
+    }
     // First, an optimization: if we're going consecutively, this will
     // make the lookup very fast.  Since we may call HasKey and then
     // Value(), which both may look up the key, we test if either the
     // current or next position are correct.
     if (last_found_ < script_.size() && script_[last_found_].first == key) {
-      *script_offset = last_found_;
+      *value = &(script_[last_found_].second);
       return true;
     }
     last_found_++;
     if (last_found_ < script_.size() && script_[last_found_].first == key) {
-      *script_offset = last_found_;
+      *value = &(script_[last_found_].second);
       return true;
     }
     std::pair<std::string, std::string> pr(key, "");  // Important that ""
@@ -1820,7 +2040,8 @@ class RandomAccessTableReaderScriptImpl:
                      ::const_iterator IterType;
     IterType iter = std::lower_bound(script_.begin(), script_.end(), pr);
     if (iter != script_.end() && iter->first == key) {
-      last_found_ = *script_offset = iter - script_.begin();
+      last_found_ = iter - script_.begin();
+      *value = &(iter->second);
       return true;
     } else {
       return false;
@@ -1858,10 +2079,20 @@ class RandomAccessTableReaderScriptImpl:
   // only the relevant part of the scp file rather than expecting us to get too
   // clever in the code.
   std::vector<std::pair<std::string, std::string> > script_;
+  // For the "bg" option: script_pos_[i] is the position of script_[i] in the
+  // script file, and prefetcher_ reads the objects in that order.
+  std::vector<size_t> script_pos_;
+  ScriptPrefetcher<Holder> *prefetcher_;
   size_t last_found_;  // This is for an optimization used in FindFilename.
 
+  // If the rspecifier named a script index rather than a script file, index_
+  // is open and script_ is empty.  index_value_ is a temporary used in
+  // LookupKey().
+  ScriptIndex index_;
+  std::string index_value_;
+
   enum {
-    //                   (*) is script_ set up?
+    //                   (*) is script_ (or index_) set up?
     //                          (*) does holder_ contain an object?
     //                               (*) does range_holder_ contain and object?
     //
@@ -1913,7 +2144,8 @@ class RandomAccessTableReaderArchiveImplBase:
     // NULL means don't expect binary-mode header
     bool ans;
     if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
+      ans = opts_.mmap ? input_.OpenMapped(archive_rxfilename_, NULL) :
+          input_.Open(archive_rxfilename_, NULL);
     else
       ans = input_.OpenTextMode(archive_rxfilename_);
     if (!ans) {  // header.
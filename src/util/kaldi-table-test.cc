@@ -22,6 +22,7 @@
 #include "util/kaldi-table.h"
 #include "util/kaldi-holder.h"
 #include "util/table-types.h"
+#include "util/parallel-table-writer.h"
 
 namespace kaldi {
 
@@ -184,6 +185,29 @@ void UnitTestClassifyRspecifier() {
   }
 
 
+  {
+    std::string a = "ark,bg=3:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo" &&
+                 opts.background && opts.background_depth == 3);
+  }
+
+  {
+    std::string a = "ark,bg=0:foo";
+    RspecifierType ans = ClassifyRspecifier(a, NULL, NULL);
+    KALDI_ASSERT(ans == kNoRspecifier);
+  }
+
+  {
+    std::string a = "ark,mmap:foo";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo" && opts.mmap);
+  }
+
   {
     std::string a = "b,ark:foo|";  // b, is ignored.
     std::string fname = "x";
@@ -839,6 +863,107 @@ void UnitTestTableRandomBothDouble(bool binary, bool read_scp,
 
 
 
+void UnitTestTableMatrixView(bool binary, bool read_scp, bool mmap) {
+  int32 sz = Rand() % 10;
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    // keys of different lengths, so the data has different alignments.
+    k.push_back(std::string(1 + i, 'a' + static_cast<char>(i)));
+    if (Rand() % 5 != 0) {  // else leave it empty.
+      v[i].Resize(1 + Rand() % 4, 1 + Rand() % 4);
+      v[i].SetRandn();
+    }
+  }
+  {
+    BaseFloatMatrixWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
+                             "t,ark,scp:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++)
+      bw.Write(k[i], v[i]);
+  }
+  std::string rspecifier = std::string(mmap ? "mmap," : "") +
+      (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  SequentialBaseFloatMatrixViewReader sbr(rspecifier);
+  int32 i = 0;
+  for (; !sbr.Done(); sbr.Next(), i++) {
+    KALDI_ASSERT(i < sz && sbr.Key() == k[i]);
+    KALDI_ASSERT(sbr.Value().ApproxEqual(v[i], binary ? 1.0e-10 : 1.0e-03));
+  }
+  KALDI_ASSERT(sbr.Close() && i == sz);
+
+  RandomAccessBaseFloatMatrixViewReader rbr(rspecifier);
+  for (int32 n = 0; n < 2 * sz; n++) {
+    i = Rand() % sz;
+    KALDI_ASSERT(rbr.HasKey(k[i]));
+    KALDI_ASSERT(rbr.Value(k[i]).ApproxEqual(v[i],
+                                             binary ? 1.0e-10 : 1.0e-03));
+  }
+  KALDI_ASSERT(!rbr.HasKey("foo"));
+  KALDI_ASSERT(rbr.Close());
+
+  if (sz > 0 && v[0].NumRows() > 0) {
+    // A range of the first matrix.
+    std::vector<std::pair<std::string, std::string> > script;
+    KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script));
+    script[0].second += "[0:0]";
+    KALDI_ASSERT(WriteScriptFile("tmpf.scp", script));
+    RandomAccessBaseFloatMatrixViewReader range_reader(
+        mmap ? "mmap,scp:tmpf.scp" : "scp:tmpf.scp");
+    KALDI_ASSERT(range_reader.Value(k[0]).ApproxEqual(
+        v[0].RowRange(0, 1), binary ? 1.0e-10 : 1.0e-03));
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
+void UnitTestTableBackground(bool read_scp) {
+  int32 sz = Rand() % 20;
+  std::vector<std::string> k;
+  std::vector<Vector<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream key;
+    key << "utt" << (Rand() % 1000) << "-" << i;  // not in sorted order.
+    k.push_back(key.str());
+    v[i].Resize(1 + Rand() % 5);
+    v[i].SetRandn();
+  }
+  {
+    BaseFloatVectorWriter bw("ark,scp:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++)
+      bw.Write(k[i], v[i]);
+  }
+  int32 depth = 1 + Rand() % 4;
+  std::ostringstream rspecifier;
+  rspecifier << "bg=" << depth << (read_scp ? ",scp:tmpf.scp" : ",ark:tmpf");
+  {
+    SequentialBaseFloatVectorReader sbr(rspecifier.str());
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++) {
+      KALDI_ASSERT(i < sz && sbr.Key() == k[i]);
+      KALDI_ASSERT(sbr.Value().ApproxEqual(v[i]));
+    }
+    KALDI_ASSERT(sbr.Close() && i == sz);
+  }
+  {
+    // Close it before reaching the end.
+    SequentialBaseFloatVectorReader sbr(rspecifier.str());
+    KALDI_ASSERT(sbr.Close());
+  }
+  {
+    // Mostly in the order of the script file, skipping some keys and
+    // sometimes going back.
+    RandomAccessBaseFloatVectorReader rbr(rspecifier.str());
+    for (int32 i = 0; i < sz; i++) {
+      if (Rand() % 3 == 0) continue;
+      int32 j = (Rand() % 5 == 0 ? Rand() % sz : i);
+      KALDI_ASSERT(rbr.HasKey(k[j]) && rbr.Value(k[j]).ApproxEqual(v[j]));
+    }
+    KALDI_ASSERT(!rbr.HasKey("foo"));
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
 void UnitTestRangesMatrix(bool binary) {
   int32 archive_size = RandInt(1, 10);
   std::vector<std::pair<std::string, Matrix<BaseFloat> > > archive_contents(
@@ -1046,6 +1171,48 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 
 
 
+void UnitTestParallelTableWriter(bool binary) {
+  int32 num_utts = Rand() % 40;
+  std::vector<std::string> keys;
+  std::vector<Vector<BaseFloat> > values;
+  TaskSequencerConfig config;
+  config.num_threads = Rand() % 4;
+  std::string wspecifier = (binary ? "ark,scp:tmpf,tmpf.scp" :
+                            "ark,scp,t:tmpf,tmpf.scp");
+  {
+    // The conversion scales the vector by 2, and takes longer for some
+    // objects than for others so that they finish out of order.
+    ParallelTableWriter<KaldiObjectHolder<Vector<BaseFloat> >,
+                        Vector<BaseFloat> > writer(
+        wspecifier, config,
+        [](const Vector<BaseFloat> &in, Vector<BaseFloat> *out) {
+          Sleep(0.001 * (Rand() % 5));
+          *out = in;
+          out->Scale(2.0);
+        });
+    for (int32 i = 0; i < num_utts; i++) {
+      std::ostringstream key;
+      key << "utt" << i;
+      Vector<BaseFloat> vec(Rand() % 10);
+      vec.SetRandn();
+      writer.Write(key.str(), vec);
+      keys.push_back(key.str());
+      vec.Scale(2.0);
+      values.push_back(vec);
+    }
+    KALDI_ASSERT(writer.Close());
+  }
+  SequentialBaseFloatVectorReader reader("scp:tmpf.scp");
+  int32 i = 0;
+  for (; !reader.Done(); reader.Next(), i++) {
+    KALDI_ASSERT(i < num_utts && reader.Key() == keys[i]);
+    KALDI_ASSERT(reader.Value().ApproxEqual(values[i]));
+  }
+  KALDI_ASSERT(i == num_utts);
+  unlink("tmpf");
+  unlink("tmpf.scp");
+}
+
 }  // end namespace kaldi.
 
 int main() {
@@ -1055,6 +1222,8 @@ int main() {
   UnitTestClassifyRspecifier();
   for (int i = 0; i < 10; i++) {
     bool b = (i == 0);
+    UnitTestTableBackground(b);
+    UnitTestParallelTableWriter(b);
     UnitTestTableSequentialBool(b);
     UnitTestTableSequentialInt32(b);
     UnitTestTableSequentialInt32Script(b);
@@ -1068,6 +1237,8 @@ int main() {
       UnitTestTableSequentialInt32PairVectorBoth(b, c);
       UnitTestTableSequentialInt32VectorVectorBoth(b, c);
       UnitTestTableSequentialBaseFloatVectorBoth(b, c);
+      UnitTestTableMatrixView(b, c, true);
+      UnitTestTableMatrixView(b, c, false);
       for (int k = 0; k < 2; k++) {
         bool d = (k == 0);
         for (int l = 0; l < 2; l++) {
@@ -293,6 +293,16 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = false;
     } else if (!strcmp(c, "bg")) {
       if (opts) opts->background = true;
+    } else if (!strncmp(c, "bg=", 3)) {
+      int32 depth;
+      if (!ConvertStringToInteger(c + 3, &depth) || depth < 1)
+        return kNoRspecifier;
+      if (opts) {
+        opts->background = true;
+        opts->background_depth = depth;
+      }
+    } else if (!strcmp(c, "mmap")) {
+      if (opts) opts->mmap = true;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else
@@ -184,11 +184,21 @@ bool WriteScriptFile(std::ostream &os,
 //       [any of the above options can be prefixed by n to negate them, e.g. no,
 //       ns, ncs, np; but these aren't currently useful as you could just omit
 //       the option].
-//   bg means "background".  It currently has no effect for random-access readers,
-//       but for sequential readers it will cause it to "read ahead" to the next
-//       value, in a background thread.  Recommended when reading larger objects
-//       such as neural-net training examples, especially when you want to
-//       maximize GPU usage.
+//   bg means "background".  For sequential readers it will cause it to "read
+//       ahead" to the next value, in a background thread.  Recommended when
+//       reading larger objects such as neural-net training examples, especially
+//       when you want to maximize GPU usage.  For random-access readers of
+//       script files it makes a background thread read the objects in the
+//       order of the script file, which helps if the program asks for them
+//       in (roughly) that order; otherwise it makes no difference.  It has no
+//       effect for random-access readers of archives.
+//   bg=N is as bg, but reads up to N objects ahead instead of one, e.g.
+//       "ark,bg=4:foo.ark".
+//   mmap means that ordinary files (the archive, or for "scp:" the files the
+//       script file points to) are mapped into memory with mmap() instead of
+//       being read through an ifstream; see Input::OpenMapped().  With holders
+//       that support it, currently MatrixViewHolder, this lets the values
+//       point into the mapped file instead of being copied.
 //
 //   b   is ignored [for scripting convenience]
 //   t   is ignored [for scripting convenience]
@@ -211,9 +221,14 @@ struct  RspecifierOptions {
   bool background;  // For sequential readers, if the background option ("bg")
                     // is provided, it will read ahead to the next object in a
                     // background thread.
+  int32 background_depth;  // The number of objects that the background thread
+                           // may read ahead (N in "bg=N"; 1 for "bg").
+  bool mmap;  // If the "mmap" option is provided, ordinary files are read
+              // through a memory mapping (see Input::OpenMapped()).
   RspecifierOptions(): once(false), sorted(false),
                        called_sorted(false), permissive(false),
-                       background(false) { }
+                       background(false), background_depth(1),
+                       mmap(false) { }
 };
 
 enum RspecifierType  {
@@ -123,11 +123,35 @@ void TestTaskSequencer() {
 }
 
 
+void TestThreadPool() {
+  int32 num_threads = 1 + Rand() % 8;
+  ThreadPool pool(num_threads);
+  KALDI_ASSERT(pool.NumThreads() == num_threads);
+  std::vector<int64> partial_sums(num_threads);
+  // Run several jobs in a row on the same threads.
+  for (int32 job = 0; job < 20; job++) {
+    int32 max_to_count = Rand() % 10000;
+    std::fill(partial_sums.begin(), partial_sums.end(), 0);
+    pool.Run([&](int32 thread_id) {
+        for (int32 j = thread_id; j < max_to_count; j += num_threads)
+          partial_sums[thread_id] += j;
+      });
+    int64 tot = 0;
+    for (int32 t = 0; t < num_threads; t++)
+      tot += partial_sums[t];
+    KALDI_ASSERT(tot == (static_cast<int64>(max_to_count) *
+                         (max_to_count - 1)) / 2);
+  }
+}
+
+
 }  // end namespace kaldi.
 
 int main() {
   using namespace kaldi;
   TestThreads();
+  for (int32 i = 0; i < 10; i++)
+    TestThreadPool();
   for (int32 i = 0; i < 10; i++)
     TestTaskSequencer();
 }
@@ -28,6 +28,69 @@ MultiThreadable::~MultiThreadable() {
   // default implementation does nothing
 }
 
+ThreadPool::ThreadPool(int32 num_threads):
+    num_threads_(num_threads), func_(NULL), job_index_(0), num_running_(0),
+    exit_(false) {
+  KALDI_ASSERT(num_threads > 0);
+  for (int32 i = 1; i < num_threads; i++)
+    threads_.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+void ThreadPool::Run(const std::function<void(int32)> &func) {
+  if (num_threads_ == 1) {
+    func(0);
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    KALDI_ASSERT(num_running_ == 0 &&
+                 "ThreadPool::Run() must not be called concurrently.");
+    func_ = &func;
+    num_running_ = num_threads_ - 1;
+    job_index_++;
+  }
+  work_cond_.notify_all();
+  func(0);  // The calling thread does part zero of the job.
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (num_running_ != 0)
+    done_cond_.wait(lock);
+  func_ = NULL;
+}
+
+void ThreadPool::WorkerLoop(int32 thread_id) {
+  int64 jobs_done = 0;
+  while (true) {
+    const std::function<void(int32)> *func;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!exit_ && job_index_ == jobs_done)
+        work_cond_.wait(lock);
+      if (exit_)
+        return;
+      jobs_done = job_index_;
+      func = func_;
+    }
+    (*func)(thread_id);
+    bool last;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      last = (--num_running_ == 0);
+    }
+    if (last)
+      done_cond_.notify_one();
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  work_cond_.notify_all();
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+}
+
 
 
 }  // end namespace kaldi
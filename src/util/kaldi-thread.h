@@ -24,6 +24,10 @@
 
 #include <thread>
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
 #include "itf/options-itf.h"
 #include "util/kaldi-semaphore.h"
 
@@ -153,6 +157,60 @@ template<class C> void RunMultiThreaded(const C &c_in) {
 }
 
 
+/**
+   ThreadPool is a set of worker threads that stay alive for the lifetime of the
+   object, for use in code that needs to repeatedly run short parallel jobs
+   (e.g. once per frame in a decoder), where the cost of creating threads each
+   time, as RunMultiThreaded() does, would be prohibitive.
+
+   Usage:
+     ThreadPool pool(4);
+     for (...) {
+       pool.Run([&](int32 thread_id) {
+           // do part 'thread_id' of 'pool.NumThreads()' parts of the job.
+         });
+     }
+
+   Run() calls the function once for each thread_id in 0 ... NumThreads() - 1,
+   and returns when all of those calls have finished.  The calling thread does
+   the work for thread_id 0 itself, so only NumThreads() - 1 threads are
+   created.  Run() must not be called concurrently from different threads.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(int32 num_threads);
+
+  int32 NumThreads() const { return num_threads_; }
+
+  void Run(const std::function<void(int32)> &func);
+
+  /// The destructor waits for the worker threads to exit.
+  ~ThreadPool();
+ private:
+  // The function that the worker threads run.
+  void WorkerLoop(int32 thread_id);
+
+  int32 num_threads_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  // work_cond_ is notified when there is a new job (or we are exiting);
+  // done_cond_ is notified when the last worker finishes a job.
+  std::condition_variable work_cond_;
+  std::condition_variable done_cond_;
+  // The current job; only valid while a call to Run() is in progress.
+  const std::function<void(int32)> *func_;
+  // Incremented each time Run() is called; lets the workers tell a new job
+  // from one they have already done.
+  int64 job_index_;
+  // The number of worker threads that have not yet finished the current job.
+  int32 num_running_;
+  bool exit_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+
 struct TaskSequencerConfig {
   int32 num_threads;
   int32 num_threads_total;
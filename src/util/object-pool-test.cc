@@ -0,0 +1,86 @@
+// util/object-pool-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/object-pool.h"
+#include <set>
+
+namespace kaldi {
+
+struct TestObject {
+  int32 a;
+  double b;
+  TestObject *next;
+  TestObject(int32 a, double b, TestObject *next): a(a), b(b), next(next) { }
+};
+
+void TestObjectPool() {
+  size_t block_size = 1 + Rand() % 20;
+  ObjectPool<TestObject> pool(block_size);
+
+  for (int32 utt = 0; utt < 10; utt++) {
+    std::vector<TestObject*> live;
+    int32 num_new = 0, num_delete = 0;
+    for (int32 i = 0; i < 200; i++) {
+      if (!live.empty() && Rand() % 3 == 0) {
+        size_t j = Rand() % live.size();
+        pool.Delete(live[j]);
+        live[j] = live.back();
+        live.pop_back();
+        num_delete++;
+      } else {
+        TestObject *prev = (live.empty() ? NULL : live.back());
+        live.push_back(pool.New(i, 0.5 * i, prev));
+        num_new++;
+      }
+    }
+    KALDI_ASSERT(pool.NumAllocated() == num_new &&
+                 pool.NumDeleted() == num_delete);
+    // Make sure no two live objects share memory, and that their contents
+    // were not overwritten by other allocations.
+    std::set<TestObject*> distinct(live.begin(), live.end());
+    KALDI_ASSERT(distinct.size() == live.size());
+    for (size_t j = 0; j < live.size(); j++)
+      KALDI_ASSERT(live[j]->b == 0.5 * live[j]->a);
+
+    int64 num_blocks = pool.NumBlocksAllocated();
+    KALDI_ASSERT(num_blocks * block_size >= live.size());
+    KALDI_ASSERT(pool.MemoryUsage() >=
+                 num_blocks * block_size * sizeof(TestObject));
+    pool.Reset();
+    KALDI_ASSERT(pool.NumAllocated() == 0 && pool.NumDeleted() == 0 &&
+                 pool.NumBlocksAllocated() == num_blocks);
+  }
+  // After Reset(), allocating no more objects than before should not need any
+  // new blocks.
+  int64 num_blocks = pool.NumBlocksAllocated();
+  for (size_t i = 0; i < block_size; i++)
+    pool.New(0, 0.0, static_cast<TestObject*>(NULL));
+  KALDI_ASSERT(pool.NumBlocksAllocated() == num_blocks);
+}
+
+}  // end namespace kaldi
+
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    TestObjectPool();
+  KALDI_LOG << "Test OK";
+}
@@ -0,0 +1,184 @@
+// util/object-pool.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_OBJECT_POOL_H_
+#define KALDI_UTIL_OBJECT_POOL_H_
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "base/kaldi-common.h"
+
+
+/* This header provides a simple pooled allocator for small, trivially
+   destructible objects of a single type, such as the tokens and forward-links
+   used in the lattice-generating decoders.  Memory is obtained from the system
+   in large blocks and handed out in order (so that objects created on the same
+   frame of decoding tend to be close together in memory); objects that are
+   freed individually with Delete() go onto a free list and are reused first.
+
+   The main point of this object is that Reset() "frees" everything in one
+   operation, without visiting the individual objects, while retaining the
+   blocks for reuse.  So e.g. a decoder can call Reset() at the start of each
+   utterance and after the first few utterances will no longer need to call the
+   system allocator at all.
+
+   See object-pool-test.cc for an example of how to use this object.
+*/
+
+
+namespace kaldi {
+
+template<class T> class ObjectPool {
+ public:
+  /// The objects we hand out are never destroyed individually (Reset() just
+  /// discards them), so we require that the destructor does nothing.
+  static_assert(std::is_trivially_destructible<T>::value,
+                "ObjectPool requires a trivially destructible type.");
+
+  /// 'block_size' is the number of objects to allocate in one block.  It
+  /// should be largish so that storing the list of blocks doesn't become a
+  /// problem.
+  explicit ObjectPool(size_t block_size = 1024);
+
+  /// Constructs a new object in pool-owned memory, forwarding the arguments to
+  /// T's constructor.  Think of this like new().
+  template<typename... Args>
+  inline T *New(Args&&... args);
+
+  /// Returns an object previously obtained from New() to the pool.  Think of
+  /// this like delete().  It is an error to call this on an object that was
+  /// not obtained from this pool, or after Reset() was called.
+  inline void Delete(T *t);
+
+  /// Makes all memory available for reuse, as if Delete() had been called on
+  /// every object currently allocated.  This is a constant-time operation; the
+  /// blocks are retained, not returned to the system.  Any pointers to objects
+  /// from this pool become invalid.
+  void Reset();
+
+  /// Number of calls to New() since the last Reset().
+  int64 NumAllocated() const { return num_allocated_; }
+
+  /// Number of calls to Delete() since the last Reset().
+  int64 NumDeleted() const { return num_deleted_; }
+
+  /// Number of times we had to obtain a new block from the system, over the
+  /// lifetime of this object (i.e. this is not cleared by Reset()).
+  int64 NumBlocksAllocated() const { return blocks_.size(); }
+
+  /// Total memory held by this object, in bytes.
+  size_t MemoryUsage() const {
+    return blocks_.size() * block_size_ * sizeof(Slot);
+  }
+
+  ~ObjectPool();
+ private:
+  // A slot either holds an object or, while it's on the free list, a pointer
+  // to the next free slot.
+  union Slot {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    Slot *next_free;
+  };
+
+  // Returns a slot from the free list, or from the current block, or from a
+  // new block if necessary.
+  inline Slot *GetSlot();
+
+  size_t block_size_;
+
+  std::vector<Slot*> blocks_;  // list of allocated blocks.
+
+  size_t cur_block_;  // index into blocks_ of the block we are currently
+                      // taking new slots from; equals blocks_.size() if no
+                      // block is in use yet.
+  size_t cur_pos_;  // index of the next unused slot in blocks_[cur_block_].
+
+  Slot *freed_head_;  // head of list of freed slots [ready for reuse].
+
+  int64 num_allocated_;
+  int64 num_deleted_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+
+template<class T>
+ObjectPool<T>::ObjectPool(size_t block_size):
+    block_size_(block_size), cur_block_(0), cur_pos_(0), freed_head_(NULL),
+    num_allocated_(0), num_deleted_(0) {
+  KALDI_ASSERT(block_size > 0);
+}
+
+template<class T>
+inline typename ObjectPool<T>::Slot* ObjectPool<T>::GetSlot() {
+  if (freed_head_ != NULL) {
+    Slot *ans = freed_head_;
+    freed_head_ = freed_head_->next_free;
+    return ans;
+  }
+  if (cur_block_ < blocks_.size() && cur_pos_ < block_size_)
+    return blocks_[cur_block_] + cur_pos_++;
+  // The current block is exhausted (or there is no current block): move on to
+  // the next block we already own, or allocate one.
+  if (cur_block_ < blocks_.size())
+    cur_block_++;
+  if (cur_block_ == blocks_.size())
+    blocks_.push_back(new Slot[block_size_]);
+  cur_pos_ = 0;
+  return blocks_[cur_block_] + cur_pos_++;
+}
+
+template<class T>
+template<typename... Args>
+inline T* ObjectPool<T>::New(Args&&... args) {
+  Slot *slot = GetSlot();
+  num_allocated_++;
+  return new (static_cast<void*>(&(slot->storage)))
+      T(std::forward<Args>(args)...);
+}
+
+template<class T>
+inline void ObjectPool<T>::Delete(T *t) {
+  Slot *slot = reinterpret_cast<Slot*>(t);
+  slot->next_free = freed_head_;
+  freed_head_ = slot;
+  num_deleted_++;
+}
+
+template<class T>
+void ObjectPool<T>::Reset() {
+  freed_head_ = NULL;
+  cur_block_ = 0;
+  cur_pos_ = 0;
+  num_allocated_ = 0;
+  num_deleted_ = 0;
+}
+
+template<class T>
+ObjectPool<T>::~ObjectPool() {
+  for (size_t i = 0; i < blocks_.size(); i++)
+    delete[] blocks_[i];
+}
+
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_OBJECT_POOL_H_
@@ -0,0 +1,144 @@
+// util/parallel-table-writer.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_PARALLEL_TABLE_WRITER_H_
+#define KALDI_UTIL_PARALLEL_TABLE_WRITER_H_
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include "util/kaldi-table.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+/// \addtogroup table_group
+/// @{
+
+/**
+   ParallelTableWriter is a TableWriter for programs that spend most of their
+   time preparing the objects they write, e.g. compressing matrices as in
+   "copy-feats --compress=true".  Write() takes an object of type InputType,
+   and the conversion of it to the type of the table (with the function given
+   to the constructor) is done in several threads using TaskSequencer; the
+   objects are still written in the order in which Write() was called.  For
+   example:
+   \code
+     ParallelTableWriter<KaldiObjectHolder<CompressedMatrix>,
+                         Matrix<BaseFloat> > writer(
+        wspecifier, sequencer_config,
+        [](const Matrix<BaseFloat> &in, CompressedMatrix *out) {
+          out->CopyFromMat(in);
+        });
+     writer.Write(key, mat);
+   \endcode
+   Holder::T must have a default constructor, and InputType a copy
+   constructor.  With --num-threads=0 (see TaskSequencerConfig) everything is
+   done in the calling thread.
+ */
+template<class Holder, class InputType>
+class ParallelTableWriter {
+ public:
+  typedef typename Holder::T T;
+  typedef std::function<void(const InputType&, T*)> ConvertFunction;
+
+  /// Opens the table; throws on error, like the TableWriter constructor.
+  ParallelTableWriter(const std::string &wspecifier,
+                      const TaskSequencerConfig &config,
+                      const ConvertFunction &convert):
+      writer_(wspecifier), convert_(convert), error_(false),
+      sequencer_(new TaskSequencer<WriteTask>(config)) { }
+
+  /// Copies 'value' and queues it to be converted and written.  It blocks if
+  /// there are already too many objects being converted (see
+  /// TaskSequencerConfig).  Since the objects are written in another thread,
+  /// an error writing an object (see TableWriter::Write()) is only reported by
+  /// the next call to Write(), Flush() or Close().
+  void Write(const std::string &key, const InputType &value) {
+    KALDI_ASSERT(sequencer_ != NULL && "Write() called after Close()");
+    CheckError();
+    sequencer_->Run(new WriteTask(this, key, value));
+  }
+
+  /// Waits until everything has been written, and flushes the table.
+  void Flush() {
+    KALDI_ASSERT(sequencer_ != NULL);
+    sequencer_->Wait();
+    CheckError();
+    writer_.Flush();
+  }
+
+  /// Waits until everything has been written and closes the table; returns
+  /// the status of TableWriter::Close().
+  bool Close() {
+    delete sequencer_;  // waits for all the tasks.
+    sequencer_ = NULL;
+    CheckError();
+    return writer_.Close();
+  }
+
+  ~ParallelTableWriter() { delete sequencer_; }
+
+ private:
+  class WriteTask {
+   public:
+    WriteTask(ParallelTableWriter<Holder, InputType> *writer,
+              const std::string &key, const InputType &value):
+        writer_(writer), key_(key), value_(value) { }
+    // Runs in a worker thread.
+    void operator () () { writer_->convert_(value_, &output_); }
+    // TaskSequencer calls the destructors in the order of Write(), one at a
+    // time.  The exception cannot be let out of the thread.
+    ~WriteTask() {
+      if (writer_->error_) return;
+      try {
+        writer_->writer_.Write(key_, output_);
+      } catch (const std::exception &e) {
+        writer_->error_message_ = e.what();
+        writer_->error_ = true;
+      }
+    }
+   private:
+    ParallelTableWriter<Holder, InputType> *writer_;
+    std::string key_;
+    InputType value_;
+    typename std::remove_const<T>::type output_;
+  };
+
+  void CheckError() {
+    if (error_)
+      KALDI_ERR << "Error writing table: " << error_message_;
+  }
+
+  TableWriter<Holder> writer_;
+  ConvertFunction convert_;
+  // error_ is set, and error_message_ before it, if writing any object failed.
+  std::atomic<bool> error_;
+  std::string error_message_;
+  TaskSequencer<WriteTask> *sequencer_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ParallelTableWriter);
+};
+
+/// @} end "addtogroup table_group"
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_PARALLEL_TABLE_WRITER_H_
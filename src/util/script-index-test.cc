@@ -0,0 +1,122 @@
+// util/script-index-test.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/script-index.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-table.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+void UnitTestScriptIndexLookup() {
+  typedef std::pair<std::string, std::string> pr;
+  std::vector<pr> script;
+  script.push_back(pr("utt1", "foo.ark:100"));
+  script.push_back(pr("utt2", "foo.ark:2000[3:5]"));
+  script.push_back(pr("utt3", "bar.ark"));
+  script.push_back(pr("utt4", "gunzip -c bar.gz |"));
+  script.push_back(pr("utt5", "foo.ark:1234567890123"));
+  script.push_back(pr("utt6", "foo.ark:12[0:1,3:4]"));
+  for (int32 i = 0; i < 1000; i++) {
+    std::ostringstream key, value;
+    key << "key" << (Rand() % 100000) << "-" << i;
+    value << "archive" << (i % 7) << ".ark:" << Rand();
+    script.push_back(pr(key.str(), value.str()));
+  }
+  {
+    Output ko("tmpf.idx", true, false);
+    KALDI_ASSERT(ScriptIndex::Write(script, ko.Stream()));
+  }
+  KALDI_ASSERT(ScriptIndex::IsScriptIndex("tmpf.idx"));
+  ScriptIndex index;
+  KALDI_ASSERT(index.Open("tmpf.idx"));
+  KALDI_ASSERT(index.NumEntries() == static_cast<int64>(script.size()));
+  for (size_t i = 0; i < script.size(); i++) {
+    std::string rxfilename;
+    KALDI_ASSERT(index.Lookup(script[i].first, &rxfilename));
+    KALDI_ASSERT(rxfilename == script[i].second);
+  }
+  KALDI_ASSERT(!index.Lookup("utt7", NULL));
+  KALDI_ASSERT(!index.Lookup("", NULL));
+  index.Close();
+
+  // Duplicate keys are an error.
+  script.push_back(pr("utt3", "baz.ark"));
+  std::ostringstream os;
+  KALDI_ASSERT(!ScriptIndex::Write(script, os));
+
+  // A script file is not an index.
+  {
+    Output ko("tmpf.scp", false, false);
+    ko.Stream() << "utt1 foo.ark:100\n";
+  }
+  KALDI_ASSERT(!ScriptIndex::IsScriptIndex("tmpf.scp"));
+  unlink("tmpf.idx");
+  unlink("tmpf.scp");
+}
+
+void UnitTestScriptIndexTable() {
+  int32 num_utts = 20;
+  std::vector<std::string> keys;
+  std::vector<Vector<BaseFloat> > values;
+  {
+    BaseFloatVectorWriter writer("ark,scp:tmpf.ark,tmpf.scp");
+    for (int32 i = 0; i < num_utts; i++) {
+      std::ostringstream key;
+      key << "utt" << (num_utts - i);  // not in sorted order.
+      Vector<BaseFloat> vec(1 + Rand() % 10);
+      vec.SetRandn();
+      writer.Write(key.str(), vec);
+      keys.push_back(key.str());
+      values.push_back(vec);
+    }
+  }
+  {
+    std::vector<std::pair<std::string, std::string> > script;
+    KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script));
+    Output ko("tmpf.idx", true, false);
+    KALDI_ASSERT(ScriptIndex::Write(script, ko.Stream()));
+  }
+  RandomAccessBaseFloatVectorReader reader("scp:tmpf.idx");
+  KALDI_ASSERT(reader.IsOpen());
+  for (int32 n = 0; n < 3 * num_utts; n++) {
+    int32 i = Rand() % num_utts;
+    KALDI_ASSERT(reader.HasKey(keys[i]));
+    KALDI_ASSERT(reader.Value(keys[i]).ApproxEqual(values[i]));
+  }
+  KALDI_ASSERT(!reader.HasKey("utt0"));
+  reader.Close();
+
+  // The sequential reader does not accept an index.
+  SequentialBaseFloatVectorReader seq_reader;
+  KALDI_ASSERT(!seq_reader.Open("scp:tmpf.idx"));
+  unlink("tmpf.ark");
+  unlink("tmpf.scp");
+  unlink("tmpf.idx");
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestScriptIndexLookup();
+  UnitTestScriptIndexTable();
+  std::cout << "Test OK.\n";
+  return 0;
+}
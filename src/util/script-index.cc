@@ -0,0 +1,293 @@
+// util/script-index.cc
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "util/script-index.h"
+#include "util/kaldi-holder.h"
+#include "util/kaldi-io.h"
+#include "util/stl-utils.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+static const char kScriptIndexMagic[8] = { 'K', 'A', 'L', 'D', 'I',
+                                           'S', 'C', 'X' };
+
+ScriptIndex::ScriptIndex(): data_(NULL), size_(0), mapped_(false),
+                            header_(NULL), entries_(NULL), files_(NULL),
+                            strings_(NULL) {
+  static_assert(sizeof(ScriptIndexHeader) % 8 == 0 &&
+                sizeof(ScriptIndexEntry) == 40,
+                "Unexpected sizes of ScriptIndex structs");
+}
+
+uint64 ScriptIndex::HashKey(const std::string &key) {
+  uint64 ans = 14695981039346656037ULL;
+  for (size_t i = 0; i < key.size(); i++) {
+    ans ^= static_cast<unsigned char>(key[i]);
+    ans *= 1099511628211ULL;
+  }
+  return ans;
+}
+
+void ScriptIndex::SplitRxfilename(const std::string &rxfilename,
+                                  std::string *filename, int64 *offset,
+                                  std::string *range) {
+  std::string rxfilename_no_range;
+  range->clear();
+  if (!rxfilename.empty() && rxfilename[rxfilename.size() - 1] == ']' &&
+      ExtractRangeSpecifier(rxfilename, &rxfilename_no_range, range)) {
+    // OK, the range was removed.
+  } else {
+    rxfilename_no_range = rxfilename;
+    range->clear();
+  }
+  *offset = -1;
+  *filename = rxfilename_no_range;
+  if (ClassifyRxfilename(rxfilename_no_range) == kOffsetFileInput) {
+    size_t pos = rxfilename_no_range.find_last_of(':');
+    int64 offset_tmp;
+    if (pos != std::string::npos &&
+        ConvertStringToInteger(rxfilename_no_range.substr(pos + 1),
+                               &offset_tmp) && offset_tmp >= 0) {
+      *offset = offset_tmp;
+      *filename = rxfilename_no_range.substr(0, pos);
+    }
+  }
+}
+
+bool ScriptIndex::Write(
+    const std::vector<std::pair<std::string, std::string> > &script,
+    std::ostream &os) {
+  int64 num_entries = script.size();
+  std::string strings;
+  std::vector<ScriptIndexEntry> entries(num_entries);
+  std::vector<int64> files;
+  std::unordered_map<std::string, int64, StringHasher> file_to_index;
+  for (int64 i = 0; i < num_entries; i++) {
+    const std::string &key = script[i].first;
+    std::string filename, range;
+    int64 offset;
+    SplitRxfilename(script[i].second, &filename, &offset, &range);
+    ScriptIndexEntry &entry = entries[i];
+    entry.hash = HashKey(key);
+    entry.key = strings.size();
+    strings.append(key.c_str(), key.size() + 1);
+    std::unordered_map<std::string, int64, StringHasher>::iterator iter =
+        file_to_index.find(filename);
+    if (iter == file_to_index.end()) {
+      entry.file = files.size();
+      file_to_index[filename] = files.size();
+      files.push_back(strings.size());
+      strings.append(filename.c_str(), filename.size() + 1);
+    } else {
+      entry.file = iter->second;
+    }
+    entry.offset = offset;
+    if (range.empty()) {
+      entry.range = -1;
+    } else {
+      entry.range = strings.size();
+      strings.append(range.c_str(), range.size() + 1);
+    }
+  }
+  // Sort on the hash and then on the key.
+  const char *strings_data = strings.c_str();
+  std::sort(entries.begin(), entries.end(),
+            [strings_data](const ScriptIndexEntry &a,
+                           const ScriptIndexEntry &b) {
+              if (a.hash != b.hash) return a.hash < b.hash;
+              return strcmp(strings_data + a.key, strings_data + b.key) < 0;
+            });
+  for (int64 i = 0; i + 1 < num_entries; i++) {
+    if (entries[i].hash == entries[i + 1].hash &&
+        strcmp(strings_data + entries[i].key,
+               strings_data + entries[i + 1].key) == 0) {
+      KALDI_WARN << "Script file contains duplicate key: "
+                 << (strings_data + entries[i].key);
+      return false;
+    }
+  }
+
+  ScriptIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kScriptIndexMagic, sizeof(kScriptIndexMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.num_entries = num_entries;
+  header.num_files = files.size();
+  header.entries_offset = sizeof(header);
+  header.files_offset = header.entries_offset +
+      num_entries * sizeof(ScriptIndexEntry);
+  header.strings_offset = header.files_offset + files.size() * sizeof(int64);
+  header.strings_size = strings.size();
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!entries.empty())
+    os.write(reinterpret_cast<const char*>(&(entries[0])),
+             entries.size() * sizeof(ScriptIndexEntry));
+  if (!files.empty())
+    os.write(reinterpret_cast<const char*>(&(files[0])),
+             files.size() * sizeof(int64));
+  os.write(strings.data(), strings.size());
+  if (!os.good()) {
+    KALDI_WARN << "Error writing script index.";
+    return false;
+  }
+  return true;
+}
+
+bool ScriptIndex::IsScriptIndex(const std::string &rxfilename) {
+  if (ClassifyRxfilename(rxfilename) != kFileInput)
+    return false;
+  std::ifstream is(rxfilename.c_str(), std::ios::binary);
+  char magic[sizeof(kScriptIndexMagic)];
+  if (!is.read(magic, sizeof(magic)))
+    return false;
+  return memcmp(magic, kScriptIndexMagic, sizeof(magic)) == 0;
+}
+
+bool ScriptIndex::Open(const std::string &filename) {
+  Close();
+#if !defined(_MSC_VER)
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    KALDI_WARN << "Could not open script index " << filename << ": "
+               << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    KALDI_WARN << "Could not stat script index " << filename
+               << " or it is empty.";
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping stays valid after closing.
+  if (data == MAP_FAILED) {
+    KALDI_WARN << "Could not mmap script index " << filename << ": "
+               << strerror(errno);
+    return false;
+  }
+  data_ = static_cast<const char*>(data);
+  size_ = st.st_size;
+  mapped_ = true;
+#else
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  std::vector<char> contents((std::istreambuf_iterator<char>(is)),
+                             std::istreambuf_iterator<char>());
+  if (!is.eof() || contents.empty()) {
+    KALDI_WARN << "Could not read script index " << filename;
+    return false;
+  }
+  buffer_.resize((contents.size() + sizeof(int64) - 1) / sizeof(int64));
+  memcpy(&(buffer_[0]), &(contents[0]), contents.size());
+  data_ = reinterpret_cast<const char*>(&(buffer_[0]));
+  size_ = contents.size();
+#endif
+  header_ = reinterpret_cast<const ScriptIndexHeader*>(data_);
+  if (size_ < sizeof(ScriptIndexHeader) ||
+      memcmp(header_->magic, kScriptIndexMagic,
+             sizeof(kScriptIndexMagic)) != 0 ||
+      header_->byte_order != kByteOrderMark ||
+      header_->version != kVersion ||
+      header_->num_entries < 0 || header_->num_files < 0 ||
+      header_->entries_offset != sizeof(ScriptIndexHeader) ||
+      header_->files_offset != header_->entries_offset +
+          header_->num_entries * static_cast<int64>(sizeof(ScriptIndexEntry)) ||
+      header_->strings_offset != header_->files_offset +
+          header_->num_files * static_cast<int64>(sizeof(int64)) ||
+      static_cast<int64>(size_) !=
+          header_->strings_offset + header_->strings_size) {
+    KALDI_WARN << "File " << filename << " is not a valid script index, "
+               << "or was written on a machine with different byte order.";
+    Close();
+    return false;
+  }
+  entries_ = reinterpret_cast<const ScriptIndexEntry*>(
+      data_ + header_->entries_offset);
+  files_ = reinterpret_cast<const int64*>(data_ + header_->files_offset);
+  strings_ = data_ + header_->strings_offset;
+  return true;
+}
+
+void ScriptIndex::Close() {
+#if !defined(_MSC_VER)
+  if (mapped_)
+    munmap(const_cast<char*>(data_), size_);
+#endif
+  std::vector<int64> empty;
+  buffer_.swap(empty);
+  data_ = NULL;
+  size_ = 0;
+  mapped_ = false;
+  header_ = NULL;
+  entries_ = NULL;
+  files_ = NULL;
+  strings_ = NULL;
+}
+
+int64 ScriptIndex::NumEntries() const {
+  KALDI_ASSERT(IsOpen());
+  return header_->num_entries;
+}
+
+bool ScriptIndex::Lookup(const std::string &key,
+                         std::string *rxfilename) const {
+  KALDI_ASSERT(IsOpen());
+  uint64 hash = HashKey(key);
+  const ScriptIndexEntry *begin = entries_,
+      *end = entries_ + header_->num_entries;
+  // Find the first entry with this hash; there will almost always be at most
+  // one.
+  const ScriptIndexEntry *iter = std::lower_bound(
+      begin, end, hash,
+      [](const ScriptIndexEntry &e, uint64 h) { return e.hash < h; });
+  for (; iter != end && iter->hash == hash; ++iter) {
+    if (key == String(iter->key)) {
+      if (rxfilename != NULL) {
+        *rxfilename = String(files_[iter->file]);
+        if (iter->offset >= 0) {
+          std::ostringstream ss;
+          ss << ':' << iter->offset;
+          *rxfilename += ss.str();
+        }
+        if (iter->range >= 0) {
+          *rxfilename += '[';
+          *rxfilename += String(iter->range);
+          *rxfilename += ']';
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // end namespace kaldi
@@ -0,0 +1,153 @@
+// util/script-index.h
+
+// Copyright 2026  The Kaldi Authors
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_SCRIPT_INDEX_H_
+#define KALDI_UTIL_SCRIPT_INDEX_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup table_impl_types
+/// @{
+
+/**
+   ScriptIndex is a binary, sorted index of a script (scp) file, which
+   RandomAccessTableReader can use in place of the script file itself: if the
+   rxfilename in an "scp:" rspecifier is an ordinary file that starts with the
+   header of a ScriptIndex, the reader maps it into memory and looks up keys
+   with a binary search, instead of reading and sorting the whole script file.
+   So opening the reader takes constant time and memory however large the
+   script file is, and only the pages of the index that are actually touched are
+   read from disk.  Use the program make-scp-index to create these files, e.g.
+   \code
+     make-scp-index data/train/feats.scp data/train/feats.scp.idx
+     some-program scp:data/train/feats.scp.idx ...
+   \endcode
+   The options in the rspecifier ("s", "cs", "p" and so on) are accepted but the
+   sorting options are irrelevant.  SequentialTableReader does not accept an
+   index, since it does not store the order of the original script.
+
+   The format, which is also the format in memory, is:
+     - A header (ScriptIndexHeader).
+     - An array of entries (ScriptIndexEntry), one per key, sorted on the
+       64-bit hash of the key and then on the key.  Each entry has the hash,
+       the position of the key in the string pool, and the rxfilename from the
+       script split up as filename, offset and range (e.g. "foo.ark:1234[0:9]"
+       gives filename "foo.ark", offset 1234 and range "0:9"), so that the
+       filenames, which are mostly the same, are only stored once.
+     - An array of the positions in the string pool of the distinct filenames.
+     - The string pool: null-terminated strings.
+   It is written in the native byte order; Open() refuses a file written with
+   a different byte order.
+ */
+class ScriptIndex {
+ public:
+  ScriptIndex();
+
+  /// Maps the index in 'filename', which must be an ordinary file, into
+  /// memory.  Returns true on success; on failure, prints a warning and
+  /// returns false.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return data_ != NULL; }
+
+  void Close();
+
+  /// Looks up 'key'.  If found, returns true and, if 'rxfilename' is not NULL,
+  /// sets it to the rxfilename the script file had for the key, e.g.
+  /// "foo.ark:1234".  Requires IsOpen().
+  bool Lookup(const std::string &key, std::string *rxfilename) const;
+
+  /// Returns the number of keys in the index.
+  int64 NumEntries() const;
+
+  /// Writes an index of 'script', the (key, rxfilename) pairs read from a
+  /// script file (see ReadScriptFile()), to the binary stream 'os'.  Returns
+  /// false, after printing a warning, if 'script' contains duplicate keys or
+  /// on write error.
+  static bool Write(const std::vector<std::pair<std::string,
+                                                std::string> > &script,
+                    std::ostream &os);
+
+  /// Returns true if 'rxfilename' is an ordinary file that starts with the
+  /// header of a ScriptIndex.  Never throws.
+  static bool IsScriptIndex(const std::string &rxfilename);
+
+  ~ScriptIndex() { Close(); }
+
+ private:
+  struct ScriptIndexHeader {
+    char magic[8];  // "KALDISCX"
+    int32 version;
+    int32 byte_order;
+    int64 num_entries;
+    int64 num_files;
+    int64 entries_offset;  // byte offsets from the start of the file.
+    int64 files_offset;
+    int64 strings_offset;
+    int64 strings_size;
+  };
+
+  struct ScriptIndexEntry {
+    uint64 hash;  // HashKey() of the key.
+    int64 key;  // position of the key in the string pool.
+    int64 file;  // index into the array of filenames.
+    int64 offset;  // offset in the file, or -1 if none.
+    int64 range;  // position of the range in the string pool, or -1 if none.
+  };
+
+  static const int32 kVersion = 1;
+  static const int32 kByteOrderMark = 0x01020304;
+
+  // The hash of the keys (64-bit FNV-1a, which unlike std::hash is the same
+  // on all platforms).
+  static uint64 HashKey(const std::string &key);
+
+  // Splits an rxfilename as it appears in a script file into filename, offset
+  // (or -1) and range (or "").
+  static void SplitRxfilename(const std::string &rxfilename,
+                              std::string *filename, int64 *offset,
+                              std::string *range);
+
+  const char *String(int64 pos) const { return strings_ + pos; }
+
+  // data_ and size_ describe the mapping (or the copy in buffer_).
+  const char *data_;
+  size_t size_;
+  bool mapped_;
+  std::vector<int64> buffer_;  // used if mmap() is not available.
+
+  const ScriptIndexHeader *header_;
+  const ScriptIndexEntry *entries_;
+  const int64 *files_;
+  const char *strings_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ScriptIndex);
+};
+
+/// @} end "addtogroup table_impl_types"
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_SCRIPT_INDEX_H_
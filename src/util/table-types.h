@@ -41,6 +41,12 @@ typedef RandomAccessTableReader<KaldiObjectHolder<Matrix<BaseFloat> > >
                                 RandomAccessBaseFloatMatrixReader;
 typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Matrix<BaseFloat> > >
                                       RandomAccessBaseFloatMatrixReaderMapped;
+// These read matrices in place from archives opened with the "mmap" option;
+// see MatrixViewHolder.
+typedef SequentialTableReader<MatrixViewHolder<BaseFloat> >
+                              SequentialBaseFloatMatrixViewReader;
+typedef RandomAccessTableReader<MatrixViewHolder<BaseFloat> >
+                                RandomAccessBaseFloatMatrixViewReader;
 
 typedef TableWriter<KaldiObjectHolder<MatrixBase<double> > >
                                       DoubleMatrixWriter;